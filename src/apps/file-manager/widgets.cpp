@@ -19,12 +19,12 @@ Ui::Child directorEntry(Sys::DirEntry const &entry) {
 }
 
 Ui::Child directoryListing(Sys::Dir const &dir) {
-    Ui::Children children;
-    for (auto const &entry : dir.entries()) {
-        children.pushBack(directorEntry(entry));
-    }
+    auto entries = dir.entries();
+    auto len = entries.len();
 
-    return Ui::vflow(children) |
+    return Ui::vlist(len, [entries = std::move(entries)](usize i) {
+               return directorEntry(entries[i]);
+           }) |
            Ui::align(Layout::Align::TOP | Layout::Align::HFILL) |
            Ui::spacing(8) |
            Ui::vscroll() |
@@ -7,6 +7,9 @@
 
 namespace ImageViewer {
 
+// The window never grows past this, larger images are decoded smaller.
+static constexpr Math::Vec2i MAX_SIZE = {700, 500};
+
 Ui::Child app(State initial) {
     return Ui::reducer<Model>(
         initial,
@@ -18,7 +21,7 @@ Ui::Child app(State initial) {
                                : viewer(state);
 
             return Ui::vflow(titlebar, content | Ui::grow()) |
-                   Ui::maxSize({700, 500}) |
+                   Ui::maxSize(MAX_SIZE) |
                    Ui::dialogLayer();
         });
 }
@@ -27,6 +30,6 @@ Ui::Child app(State initial) {
 
 Res<> entryPoint(Ctx &ctx) {
     auto &args = useArgs(ctx);
-    auto image = try$(Media::loadImage(args[0]));
+    auto image = try$(Media::loadThumbnail(Sys::Url::parse(args[0]), ImageViewer::MAX_SIZE));
     return Ui::runApp(ctx, ImageViewer::app(image));
 }
@@ -13,7 +13,7 @@ Ui::Child viewer(State const &state) {
 }
 
 Ui::Child viewerPreview(State const &state) {
-    return Ui::image(state.image) |
+    return Ui::image(state.image, Gfx::Sampling::BILINEAR) |
            Ui::spacing(8) |
            Ui::fit();
 }
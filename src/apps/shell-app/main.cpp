@@ -1,5 +1,6 @@
 #include <karm-main/main.h>
 #include <karm-ui/app.h>
+#include <karm-ui/cache.h>
 #include <karm-ui/dialog.h>
 #include <karm-ui/drag.h>
 #include <karm-ui/input.h>
@@ -287,6 +288,7 @@ Ui::Child lockscreen() {
             Model::bind<UnlockAction>(),
             Ui::DismisDir::TOP,
             0.3,
+            // Dragging only moves the origin, the recorded text is replayed as is.
             Ui::dragRegion(
                 Ui::spacing(
                     {48, 64},
@@ -297,13 +299,15 @@ Ui::Child lockscreen() {
                         Ui::grow(NONE),
                         Ui::vflow(
                             Ui::center(Ui::icon(Mdi::CHEVRON_UP, 48)),
-                            Ui::center(Ui::text(Ui::TextStyle::labelLarge(), "Swipe up to unlock"))))))));
+                            Ui::center(Ui::text(Ui::TextStyle::labelLarge(), "Swipe up to unlock"))))) |
+                Ui::recorded())));
 }
 
 Ui::Child app() {
     return Ui::reducer<Model>({}, [](auto state) {
         auto wallpapers = Media::loadImageOrFallback("bundle://skift-wallpapers/images/brutal.qoi"_url).unwrap();
-        auto background = Ui::align(Layout::Align::COVER, Ui::image(wallpapers));
+        // Scaled once, then blitted as is under everything else.
+        auto background = Ui::align(Layout::Align::COVER, Ui::image(wallpapers)) | Ui::cached();
         return Ui::dialogLayer(
             Ui::pinSize(
                 {411, 731},
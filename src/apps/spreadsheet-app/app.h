@@ -23,6 +23,10 @@ struct Pos {
     Ordr cmp(Pos const &o) const {
         return Karm::cmp(row, o.row) | Karm::cmp(col, o.col);
     }
+
+    u64 hash() const {
+        return hashCombine(Karm::hash(row), Karm::hash(col));
+    }
 };
 
 enum struct Wheight {
@@ -2,13 +2,22 @@
 #include <karm-hash/hash.h>
 #include <karm-main/main.h>
 #include <karm-sys/file.h>
+#include <karm-sys/mmap.h>
+
+// Hash the file where it lies rather than copying it through a reader, files
+// that can't be mapped, like empty ones, are read instead.
+static Res<Hash::AnyDigest> _digest(Sys::File &file, Hash::AnyHash hash) {
+    if (auto map = Sys::mmap().map(file))
+        return Ok(Hash::digest(map.unwrap().bytes(), hash));
+    return Hash::digest(file, hash);
+}
 
 Res<> entryPoint(Ctx &ctx) {
     auto &args = useArgs(ctx);
 
     auto file = try$(Sys::File::open(args[1]));
     auto hash = try$(Hash::fromName(args[0]));
-    auto digest = try$(Hash::digest(file, hash));
+    auto digest = try$(_digest(file, hash));
 
     Sys::println("{} {}", digest, args[1]);
 
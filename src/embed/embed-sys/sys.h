@@ -62,4 +62,19 @@ Res<> sleep(TimeSpan);
 
 Res<> exit(i32);
 
+/* --- Threads -------------------------------------------------------------- */
+
+// Number of threads the system can run in parallel.
+usize hardwareConcurrency();
+
+Res<usize> spawnThread(void (*entry)(void *), void *arg);
+
+Res<> joinThread(usize thread);
+
+// Block the calling thread as long as `*addr == expected`, may return early.
+Res<> waitAddr(u32 *addr, u32 expected);
+
+// Wake up to `count` threads blocked on `addr`.
+Res<> wakeAddr(u32 *addr, usize count);
+
 } // namespace Embed
@@ -323,4 +323,26 @@ Res<> exit(i32) {
         ;
 }
 
+/* --- Threads -------------------------------------------------------------- */
+
+usize hardwareConcurrency() {
+    return 1;
+}
+
+Res<usize> spawnThread(void (*)(void *), void *) {
+    return Error::notImplemented();
+}
+
+Res<> joinThread(usize) {
+    return Error::notImplemented();
+}
+
+Res<> waitAddr(u32 *, u32) {
+    return Error::notImplemented();
+}
+
+Res<> wakeAddr(u32 *, usize) {
+    return Error::notImplemented();
+}
+
 } // namespace Embed
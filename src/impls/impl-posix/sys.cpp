@@ -3,10 +3,14 @@
 #include <karm-logger/logger.h>
 
 /* Posix Stuff*/
+#include <errno.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/utsname.h>
 #include <time.h>
 #include <unistd.h>
@@ -317,4 +321,55 @@ Res<> exit(i32 res) {
     return Ok();
 }
 
+/* --- Threads -------------------------------------------------------------- */
+
+usize hardwareConcurrency() {
+    auto n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n;
+}
+
+struct PosixThreadStart {
+    void (*entry)(void *);
+    void *arg;
+};
+
+static void *_threadStart(void *arg) {
+    auto *start = static_cast<PosixThreadStart *>(arg);
+    auto [entry, entryArg] = *start;
+    delete start;
+    entry(entryArg);
+    return nullptr;
+}
+
+Res<usize> spawnThread(void (*entry)(void *), void *arg) {
+    auto *start = new PosixThreadStart{entry, arg};
+    pthread_t thread;
+    auto err = pthread_create(&thread, nullptr, _threadStart, start);
+    if (err != 0) {
+        delete start;
+        return Posix::fromErrno(err);
+    }
+    return Ok(static_cast<usize>(thread));
+}
+
+Res<> joinThread(usize thread) {
+    auto err = pthread_join(static_cast<pthread_t>(thread), nullptr);
+    if (err != 0)
+        return Posix::fromErrno(err);
+    return Ok();
+}
+
+Res<> waitAddr(u32 *addr, u32 expected) {
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0) < 0 and
+        errno != EAGAIN and errno != EINTR)
+        return Posix::fromLastErrno();
+    return Ok();
+}
+
+Res<> wakeAddr(u32 *addr, usize count) {
+    if (syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, (int)min(count, (usize)INT32_MAX), nullptr, nullptr, 0) < 0)
+        return Posix::fromLastErrno();
+    return Ok();
+}
+
 } // namespace Embed
@@ -32,8 +32,11 @@ struct SdlHost :
         };
     }
 
-    void flip(Slice<Math::Recti>) override {
-        SDL_UpdateWindowSurface(_window);
+    void flip(Slice<Math::Recti> regions) override {
+        Vec<SDL_Rect> rects;
+        for (auto r : regions)
+            rects.pushBack({(int)r.x, (int)r.y, (int)r.width, (int)r.height});
+        SDL_UpdateWindowSurfaceRects(_window, rects.buf(), rects.len());
     }
 
     void translate(SDL_Event const &sdlEvent) {
@@ -46,7 +49,7 @@ struct SdlHost :
                 break;
 
             case SDL_WINDOWEVENT_EXPOSED:
-                _dirty.pushBack(pixels().bound());
+                _dirty.add(pixels().bound());
                 break;
             }
             break;
@@ -224,7 +227,14 @@ Res<Strong<Karm::Ui::Host>> makeHost(Ui::Child root) {
         return Error::other(SDL_GetError());
     }
 
-    return Ok(makeStrong<SdlHost>(root, window));
+    auto host = makeStrong<SdlHost>(root, window);
+
+    // Damage is painted in bands across every core, a single core paints it
+    // inline as before.
+    if (Embed::hardwareConcurrency() > 1)
+        host->parallel(makeStrong<Sys::ThreadPool>());
+
+    return Ok(host);
 }
 
 } // namespace Embed
@@ -115,6 +115,13 @@ struct Buf {
         _cap = cap;
     }
 
+    // Grow geometrically, so that appending one element at a time stays
+    // amortized constant time.
+    void _grow(usize cap) {
+        if (cap > _cap)
+            ensure(max(cap, _cap * 2));
+    }
+
     void fit() {
         if (_len == _cap)
             return;
@@ -131,7 +138,7 @@ struct Buf {
 
     template <typename... Args>
     void emplace(usize index, Args &&...args) {
-        ensure(_len + 1);
+        _grow(_len + 1);
 
         for (usize i = _len; i > index; i--) {
             _buf[i].ctor(_buf[i - 1].take());
@@ -141,7 +148,7 @@ struct Buf {
     }
 
     void insert(usize index, T &&value) {
-        ensure(_len + 1);
+        _grow(_len + 1);
 
         for (usize i = _len; i > index; i--) {
             _buf[i].ctor(_buf[i - 1].take());
@@ -162,7 +169,7 @@ struct Buf {
     }
 
     void insert(Copy, usize index, T const *first, usize count) {
-        ensure(_len + count);
+        _grow(_len + count);
 
         for (usize i = _len; i > index; i--) {
             _buf[i].ctor(_buf[i - count].take());
@@ -176,7 +183,7 @@ struct Buf {
     }
 
     void insert(Move, usize index, T *first, usize count) {
-        ensure(_len + count);
+        _grow(_len + count);
 
         for (usize i = _len; i > index; i--) {
             _buf[i].ctor(_buf[i - count].take());
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <karm-meta/traits.h>
+
+#include "slice.h"
+
+namespace Karm {
+
+// Hashes used to index hash tables, not meant to be cryptographic nor stable
+// across versions. Types opt in by implementing `u64 hash() const`.
+
+template <typename T>
+concept Hashable = requires(T const &v) {
+                       { v.hash() } -> Meta::Same<u64>;
+                   };
+
+// Finalizer of MurmurHash3, spreads every input bit over the whole word.
+ALWAYS_INLINE constexpr u64 hashMix(u64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+ALWAYS_INLINE constexpr u64 hashCombine(u64 seed, u64 h) {
+    return hashMix(seed ^ (h + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2)));
+}
+
+template <Meta::Integral T>
+ALWAYS_INLINE constexpr u64 hash(T v) {
+    return hashMix((u64)v);
+}
+
+template <Meta::Enum T>
+ALWAYS_INLINE constexpr u64 hash(T v) {
+    return hashMix((u64)v);
+}
+
+template <typename T>
+ALWAYS_INLINE u64 hash(T const *ptr) {
+    return hashMix((u64)(usize)ptr);
+}
+
+template <Hashable T>
+ALWAYS_INLINE constexpr u64 hash(T const &v) {
+    return v.hash();
+}
+
+// Eight bytes per step, mixed once at the end.
+inline u64 hash(Bytes bytes) {
+    Byte const *buf = bytes.buf();
+    usize len = bytes.len();
+    u64 h = 0x9e3779b97f4a7c15 ^ len;
+
+    for (; len >= 8; buf += 8, len -= 8) {
+        u64 w;
+        memcpy(&w, buf, 8);
+        h = rol(h ^ w, 23) * 0x9e3779b97f4a7c15;
+    }
+
+    if (len) {
+        u64 w = 0;
+        memcpy(&w, buf, len);
+        h = rol(h ^ w, 23) * 0x9e3779b97f4a7c15;
+    }
+
+    return hashMix(h);
+}
+
+// So string literals hash like the `Str` they compare equal to rather than
+// like a pointer.
+inline u64 hash(char const *cstr) {
+    usize len = 0;
+    while (cstr[len])
+        len++;
+    return hash(Bytes{(Byte const *)cstr, len});
+}
+
+} // namespace Karm
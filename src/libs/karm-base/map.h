@@ -1,42 +1,211 @@
 #pragma once
 
+#include "clamp.h"
 #include "cons.h"
+#include "hash.h"
+#include "opt.h"
 #include "ordr.h"
 #include "std.h"
 #include "vec.h"
 
 namespace Karm {
 
+// Open addressing index into a dense array of entries. Probing is done Robin
+// Hood style: an entry further from its home slot than the one in its way
+// takes its place, which keeps probe sequences short and lets a lookup stop
+// as soon as it passes where its key would have been.
+struct _HashIndex {
+    struct Slot {
+        u32 hash;
+        u32 index; // index of the entry plus one, zero for empty slots
+    };
+
+    Vec<Slot> _slots{};
+
+    usize _mask() const {
+        return _slots.len() - 1;
+    }
+
+    usize _dist(usize pos, u32 hash) const {
+        return (pos - hash) & _mask();
+    }
+
+    usize entry(usize pos) const {
+        return _slots.buf()[pos].index - 1;
+    }
+
+    // Returns the slot of the entry with the given hash for which
+    // `match(index)` is true.
+    Opt<usize> find(u32 hash, auto match) const {
+        if (_slots.len() == 0)
+            return NONE;
+
+        Slot const *slots = _slots.buf();
+        usize mask = _mask();
+        usize pos = hash & mask;
+        for (usize dist = 0;; dist++, pos = (pos + 1) & mask) {
+            Slot slot = slots[pos];
+            if (slot.index == 0 or _dist(pos, slot.hash) < dist)
+                return NONE;
+            if (slot.hash == hash and match(slot.index - 1))
+                return pos;
+        }
+    }
+
+    // The index must have room for one more entry.
+    void insert(u32 hash, usize index) {
+        Slot *slots = _slots.buf();
+        usize mask = _mask();
+        Slot curr = {hash, (u32)(index + 1)};
+        usize pos = hash & mask;
+        for (usize dist = 0;; dist++, pos = (pos + 1) & mask) {
+            if (slots[pos].index == 0) {
+                slots[pos] = curr;
+                return;
+            }
+
+            usize other = _dist(pos, slots[pos].hash);
+            if (other < dist) {
+                std::swap(slots[pos], curr);
+                dist = other;
+            }
+        }
+    }
+
+    // Empty a slot, shifting back the entries probed past it.
+    void remove(usize pos) {
+        Slot *slots = _slots.buf();
+        usize mask = _mask();
+        usize next = (pos + 1) & mask;
+        while (slots[next].index and _dist(next, slots[next].hash) > 0) {
+            slots[pos] = slots[next];
+            pos = next;
+            next = (next + 1) & mask;
+        }
+        slots[pos] = {};
+    }
+
+    // Update the slot of an entry moved from `from` to `to`.
+    void relink(u32 hash, usize from, usize to) {
+        auto pos = find(hash, [&](usize index) {
+            return index == from;
+        });
+        _slots.buf()[pos.unwrap()].index = to + 1;
+    }
+
+    // Make room for `len` entries, keeping the table at most 3/4 full.
+    void reserve(usize len) {
+        usize cap = _slots.len();
+        if (len * 4 <= cap * 3)
+            return;
+
+        cap = max(cap * 2, 8uz);
+        while (len * 4 > cap * 3)
+            cap *= 2;
+
+        auto old = std::move(_slots);
+        _slots = {};
+        _slots.resize(cap, {});
+        for (auto const &slot : old)
+            if (slot.index)
+                insert(slot.hash, slot.index - 1);
+    }
+
+    void clear() {
+        _slots.clear();
+    }
+};
+
+// Hash map iterating in insertion order. Lookups accept any key that hashes
+// and compares like `K`, a `Str` for `String` keys for example.
 template <typename K, typename V>
 struct Map {
     Vec<Cons<K, V>> _els{};
+    _HashIndex _index{};
 
     Map() = default;
 
-    Map(std::initializer_list<Cons<K, V>> &&list)
-        : _els(std::move(list)) {}
+    Map(std::initializer_list<Cons<K, V>> &&list) {
+        reserve(list.size());
+        for (auto const &el : list)
+            put(el.car, el.cdr);
+    }
 
-    void put(K const &key, V const &value) {
-        for (auto &i : ::mutIter(_els)) {
-            if (Op::eq(i.car, key)) {
-                i.cdr = value;
-                return;
-            }
-        }
+    Opt<usize> _find(u32 hash, auto const &key) const {
+        auto pos = _index.find(hash, [&](usize index) {
+            return Op::eq(_els[index].car, key);
+        });
+        if (not pos)
+            return NONE;
+        return _index.entry(*pos);
+    }
 
-        _els.pushBack(Cons<K, V>{key, value});
+    Opt<usize> _find(auto const &key) const {
+        return _find(Karm::hash(key), key);
     }
 
-    Opt<V> get(K const &key) const {
-        for (auto &i : _els) {
-            if (Op::eq(i.car, key)) {
-                return i.cdr;
-            }
+    void put(K key, V value) {
+        u32 hash = Karm::hash(key);
+        if (auto index = _find(hash, key)) {
+            _els[*index].cdr = std::move(value);
+            return;
         }
 
+        _index.reserve(_els.len() + 1);
+        _index.insert(hash, _els.len());
+        _els.pushBack(Cons<K, V>{std::move(key), std::move(value)});
+    }
+
+    Opt<V> get(auto const &key) const {
+        if (auto index = _find(key))
+            return _els[*index].cdr;
         return NONE;
     }
 
+    V *lookup(auto const &key) {
+        if (auto index = _find(key))
+            return &_els[*index].cdr;
+        return nullptr;
+    }
+
+    V const *lookup(auto const &key) const {
+        if (auto index = _find(key))
+            return &_els[*index].cdr;
+        return nullptr;
+    }
+
+    bool has(auto const &key) const {
+        return bool(_find(key));
+    }
+
+    // Removing an entry moves the last one in its place.
+    bool del(auto const &key) {
+        auto pos = _index.find(Karm::hash(key), [&](usize index) {
+            return Op::eq(_els[index].car, key);
+        });
+        if (not pos)
+            return false;
+
+        usize index = _index.entry(*pos);
+        _index.remove(*pos);
+
+        usize last = _els.len() - 1;
+        if (index != last) {
+            _index.relink(Karm::hash(_els[last].car), last, index);
+            auto el = _els.popBack();
+            _els[index] = std::move(el);
+        } else {
+            _els.popBack();
+        }
+
+        return true;
+    }
+
+    void reserve(usize len) {
+        _els.ensure(len);
+        _index.reserve(len);
+    }
+
     auto iter() {
         return mutIter(_els);
     }
@@ -51,6 +220,7 @@ struct Map {
 
     void clear() {
         _els.clear();
+        _index.clear();
     }
 };
 
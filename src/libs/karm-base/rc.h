@@ -2,18 +2,21 @@
 
 #include <karm-meta/traits.h>
 
-#include "lock.h"
+#include "atomic.h"
 #include "opt.h"
 #include "ordr.h"
+#include "panic.h"
 #include "ref.h"
 
 namespace Karm {
 
 struct _Cell {
-    Lock _lock;
+    // References are counted atomically so cells can be shared between
+    // threads. The strong references together hold one weak reference, the
+    // cell is deleted once the last weak reference is dropped.
+    Atomic<isize> _strong = 0;
+    Atomic<isize> _weak = 0;
     bool _clear = false;
-    isize _strong = 0;
-    isize _weak = 0;
 
     virtual ~_Cell() = default;
 
@@ -21,58 +24,46 @@ struct _Cell {
     virtual void clear() = 0;
     virtual Meta::Type<> inspect() = 0;
 
-    _Cell *collect() {
-        if (_strong == 0 and not _clear) {
-            clear();
-            _clear = true;
-        }
-
-        if (_strong == 0 and _weak == 0) {
-            _lock.release();
-            delete this;
-            return nullptr;
-        } else {
-            _lock.release();
-            return nullptr;
-        }
-    }
-
     _Cell *refStrong() {
-        LockScope scope{_lock};
-
         if (_clear)
             panic("refStrong() called on cleared cell");
-        _strong++;
-        if (_strong < 0)
+
+        isize strong = _strong.fetchInc();
+        if (strong < 0)
             panic("refStrong() overflow");
+        if (strong == 0)
+            _weak.inc();
         return this;
     }
 
     _Cell *derefStrong() {
-        _lock.acquire();
-
-        _strong--;
-        if (_strong < 0)
+        isize strong = _strong.fetchDec();
+        if (strong <= 0)
             panic("derefStrong() underflow");
-        return collect();
+
+        if (strong == 1) {
+            clear();
+            _clear = true;
+            return derefWeak();
+        }
+        return nullptr;
     }
 
     _Cell *refWeak() {
-        LockScope scope{_lock};
-
-        _weak++;
-        if (_weak < 0)
+        isize weak = _weak.fetchInc();
+        if (weak < 0)
             panic("refWeak() overflow");
         return this;
     }
 
     _Cell *derefWeak() {
-        _lock.acquire();
-
-        _weak--;
-        if (_weak < 0)
+        isize weak = _weak.fetchDec();
+        if (weak <= 0)
             panic("derefWeak() underflow");
-        return collect();
+
+        if (weak == 1)
+            delete this;
+        return nullptr;
     }
 
     template <typename T>
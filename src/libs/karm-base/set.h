@@ -0,0 +1,88 @@
+#pragma once
+
+#include "map.h"
+
+namespace Karm {
+
+// Hash set iterating in insertion order, see `Map`.
+template <typename T>
+struct Set {
+    Vec<T> _els{};
+    _HashIndex _index{};
+
+    Set() = default;
+
+    Set(std::initializer_list<T> &&list) {
+        reserve(list.size());
+        for (auto const &el : list)
+            put(el);
+    }
+
+    Opt<usize> _find(u32 hash, auto const &el) const {
+        auto pos = _index.find(hash, [&](usize index) {
+            return Op::eq(_els[index], el);
+        });
+        if (not pos)
+            return NONE;
+        return _index.entry(*pos);
+    }
+
+    // Returns false if the element was already in the set.
+    bool put(T el) {
+        u32 hash = Karm::hash(el);
+        if (_find(hash, el))
+            return false;
+
+        _index.reserve(_els.len() + 1);
+        _index.insert(hash, _els.len());
+        _els.pushBack(std::move(el));
+        return true;
+    }
+
+    bool has(auto const &el) const {
+        return bool(_find(Karm::hash(el), el));
+    }
+
+    // Removing an element moves the last one in its place.
+    bool del(auto const &el) {
+        auto pos = _index.find(Karm::hash(el), [&](usize index) {
+            return Op::eq(_els[index], el);
+        });
+        if (not pos)
+            return false;
+
+        usize index = _index.entry(*pos);
+        _index.remove(*pos);
+
+        usize last = _els.len() - 1;
+        if (index != last) {
+            _index.relink(Karm::hash(_els[last]), last, index);
+            auto moved = _els.popBack();
+            _els[index] = std::move(moved);
+        } else {
+            _els.popBack();
+        }
+
+        return true;
+    }
+
+    void reserve(usize len) {
+        _els.ensure(len);
+        _index.reserve(len);
+    }
+
+    auto iter() const {
+        return ::iter(_els);
+    }
+
+    usize len() const {
+        return _els.len();
+    }
+
+    void clear() {
+        _els.clear();
+        _index.clear();
+    }
+};
+
+} // namespace Karm
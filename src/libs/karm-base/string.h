@@ -1,17 +1,15 @@
 #pragma once
 
+#include "hash.h"
 #include "ordr.h"
 #include "rune.h"
 #include "std.h"
 
 namespace Karm {
 
+// The builtin folds to a constant for literals.
 inline constexpr usize strLen(char const *str) {
-    usize len = 0;
-    while (*str++) {
-        len++;
-    }
-    return len;
+    return __builtin_strlen(str);
 }
 
 template <StaticEncoding E, typename U = typename E::Unit>
@@ -33,6 +31,10 @@ struct _Str : public Slice<U> {
 
     constexpr _Str(Sliceable<U> auto const &other)
         : Slice<U>(other.buf(), other.len()) {}
+
+    u64 hash() const {
+        return Karm::hash(Bytes{(Byte const *)this->buf(), this->len() * sizeof(U)});
+    }
 };
 
 template <StaticEncoding E, typename U = typename E::Unit>
@@ -53,22 +55,47 @@ struct _String {
     using Unit = typename E::Unit;
     using Inner = Unit;
 
-    Unit *_buf;
-    usize _len;
-
-    _String()
-        : _String("", 0) {}
+    // Short strings live inline, in 24 bytes shared with the heap buffer and
+    // its length, so a string is 8 bytes larger than those two alone. The
+    // last unit tells them apart: it is either HEAP or the number of inline
+    // units left, which makes it the null terminator when the inline buffer
+    // is full.
+    static constexpr usize INLINE_LEN = 24 / sizeof(Unit) - 1;
+    static constexpr Unit HEAP = (Unit)~0;
+
+    struct _Heap {
+        Unit *buf;
+        usize len;
+    };
+
+    union {
+        _Heap _heap;
+        Unit _inline[INLINE_LEN + 1];
+    };
+
+    _String() {
+        _inline[0] = 0;
+        _inline[INLINE_LEN] = INLINE_LEN;
+    }
 
-    _String(Move, Unit *buf, usize len)
-        : _buf(buf),
-          _len(len) {
+    _String(Move, Unit *buf, usize len) {
+        _heap = {buf, len};
+        _inline[INLINE_LEN] = HEAP;
     }
 
-    _String(Unit const *buf, usize len)
-        : _len(len) {
-        _buf = new Unit[len + 1];
-        _buf[len] = 0;
-        memcpy(_buf, buf, len * sizeof(Unit));
+    _String(Unit const *buf, usize len) {
+        if (len <= INLINE_LEN) {
+            memcpy(_inline, buf, len * sizeof(Unit));
+            _inline[len] = 0;
+            _inline[INLINE_LEN] = INLINE_LEN - len;
+            return;
+        }
+
+        Unit *heap = new Unit[len + 1];
+        heap[len] = 0;
+        memcpy(heap, buf, len * sizeof(Unit));
+        _heap = {heap, len};
+        _inline[INLINE_LEN] = HEAP;
     }
 
     _String(Unit const *cstr)
@@ -79,17 +106,18 @@ struct _String {
         : _String(str.buf(), str.len()) {}
 
     _String(_String const &other)
-        : _String(other._buf, other._len) {
+        : _String(other.buf(), other.len()) {
     }
 
-    _String(_String &&other)
-        : _buf(std::exchange(other._buf, nullptr)),
-          _len(std::exchange(other._len, 0)) {
+    _String(_String &&other) {
+        memcpy(_inline, other._inline, sizeof(_inline));
+        other._inline[0] = 0;
+        other._inline[INLINE_LEN] = INLINE_LEN;
     }
 
     ~_String() {
-        if (_buf) {
-            delete[] _buf;
+        if (not isInline()) {
+            delete[] _heap.buf;
         }
     }
 
@@ -99,20 +127,21 @@ struct _String {
     }
 
     _String &operator=(_String &&other) {
-        std::swap(_buf, other._buf);
-        std::swap(_len, other._len);
+        std::swap(_inline, other._inline);
 
         return *this;
     }
 
-    _Str<E> str() const { return {_buf, _len}; }
+    bool isInline() const { return _inline[INLINE_LEN] != HEAP; }
+
+    _Str<E> str() const { return {buf(), len()}; }
 
     Slice<Unit> units() const {
-        return {_buf, _len};
+        return {buf(), len()};
     }
 
     MutSlice<Unit> mutUnits() {
-        return {_buf, _len};
+        return {buf(), len()};
     }
 
     Ordr cmp(_Str<E> other) const {
@@ -123,11 +152,15 @@ struct _String {
         return ::cmp(str(), _Str<E>{other});
     }
 
-    Unit const &operator[](usize i) const { return _buf[i]; }
-    Unit &operator[](usize i) { return _buf[i]; }
-    Unit const *buf() const { return _buf; }
-    Unit *buf() { return _buf; }
-    usize len() const { return _len; }
+    u64 hash() const {
+        return str().hash();
+    }
+
+    Unit const &operator[](usize i) const { return buf()[i]; }
+    Unit &operator[](usize i) { return buf()[i]; }
+    Unit const *buf() const { return isInline() ? _inline : _heap.buf; }
+    Unit *buf() { return isInline() ? _inline : _heap.buf; }
+    usize len() const { return isInline() ? INLINE_LEN - (usize)_inline[INLINE_LEN] : _heap.len; }
 };
 
 template <
@@ -0,0 +1,162 @@
+#include <karm-base/map.h>
+#include <karm-base/set.h>
+#include <karm-base/string.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(mapPutGet) {
+    Map<usize, usize> map;
+    for (usize i = 0; i < 1000; i++)
+        map.put(i, i * 2);
+
+    expectEq$(map.len(), 1000uz);
+    for (usize i = 0; i < 1000; i++)
+        expectEq$(map.get(i).unwrap(), i * 2);
+    expect$(not map.get(1000uz));
+
+    map.put(42, 0);
+    expectEq$(map.len(), 1000uz);
+    expectEq$(map.get(42uz).unwrap(), 0uz);
+
+    return Ok();
+}
+
+test$(mapDel) {
+    Map<usize, usize> map;
+    for (usize i = 0; i < 1000; i++)
+        map.put(i, i);
+
+    for (usize i = 0; i < 1000; i += 2)
+        expect$(map.del(i));
+    expect$(not map.del(0uz));
+
+    expectEq$(map.len(), 500uz);
+    for (usize i = 0; i < 1000; i++)
+        expectEq$(map.has(i), i % 2 == 1);
+
+    for (auto &kv : map.iter())
+        expectEq$(kv.car, kv.cdr);
+
+    return Ok();
+}
+
+test$(mapInsertionOrder) {
+    Map<String, isize> map = {
+        {"one", 1},
+        {"two", 2},
+        {"three", 3},
+    };
+    map.put(String{"zero"}, 0);
+
+    Array<isize, 4> expected = {1, 2, 3, 0};
+    usize i = 0;
+    for (auto const &kv : map.iter())
+        expectEq$(kv.cdr, expected[i++]);
+
+    return Ok();
+}
+
+test$(mapHeterogeneousLookup) {
+    Map<String, usize> map;
+    map.put(String{"hello"}, 1);
+    map.put(String{"world"}, 2);
+
+    Str key = "world";
+    expectEq$(map.get(key).unwrap(), 2uz);
+    expectEq$(map.get("hello").unwrap(), 1uz);
+    expect$(not map.has("nope"));
+
+    *map.lookup(key) = 3;
+    expectEq$(map.get(String{"world"}).unwrap(), 3uz);
+
+    return Ok();
+}
+
+test$(setPutHasDel) {
+    Set<String> set = {"a", "b", "c"};
+    expect$(not set.put(String{"a"}));
+    expect$(set.put(String{"d"}));
+    expectEq$(set.len(), 4uz);
+
+    expect$(set.has("b"));
+    expect$(set.del("b"));
+    expect$(not set.has("b"));
+    expectEq$(set.len(), 3uz);
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+// The map as it was before, a list of pairs searched linearly.
+template <typename K, typename V>
+struct LinearMap {
+    Vec<Cons<K, V>> _els{};
+
+    void put(K const &key, V const &value) {
+        for (auto &i : ::mutIter(_els)) {
+            if (Op::eq(i.car, key)) {
+                i.cdr = value;
+                return;
+            }
+        }
+        _els.pushBack(Cons<K, V>{key, value});
+    }
+
+    Opt<V> get(K const &key) const {
+        for (auto &i : _els)
+            if (Op::eq(i.car, key))
+                return i.cdr;
+        return NONE;
+    }
+};
+
+template <typename M>
+static usize _fill(usize n) {
+    M map;
+    for (usize i = 0; i < n; i++)
+        map.put(i * 7919, i);
+
+    usize sum = 0;
+    for (usize i = 0; i < n; i++)
+        sum += map.get(i * 7919).unwrap();
+    return sum;
+}
+
+struct Size {
+    usize n;
+    Str hashed;
+    Str linear;
+};
+
+bench$(mapThroughput) {
+    Array<Size, 3> sizes = {
+        Size{10, "hashed 10", "linear 10"},
+        Size{1000, "hashed 1k", "linear 1k"},
+        // The linear map is quadratic, don't wait on it here.
+        Size{1000000, "hashed 1M", ""},
+    };
+
+    for (auto const &size : sizes) {
+        usize expected = size.n * (size.n - 1) / 2;
+        usize sum = 0;
+
+        _driver.bench(size.hashed, [&] {
+            sum = _fill<Map<usize, usize>>(size.n);
+        });
+        expectEq$(sum, expected);
+
+        if (not size.linear.len())
+            continue;
+
+        _driver.bench(size.linear, [&] {
+            sum = _fill<LinearMap<usize, usize>>(size.n);
+        });
+        expectEq$(sum, expected);
+    }
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
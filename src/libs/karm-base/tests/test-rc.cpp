@@ -1,3 +1,4 @@
+#include <karm-base/opt.h>
 #include <karm-base/rc.h>
 #include <karm-test/macros.h>
 
@@ -13,4 +14,29 @@ test$(strongRc) {
     return Ok();
 }
 
+test$(strongRcClearedOnce) {
+    static isize dtors = 0;
+    struct S {
+        ~S() { dtors++; }
+    };
+
+    Opt<Weak<S>> weak = NONE;
+    {
+        auto s = makeStrong<S>();
+        weak = Weak<S>{s};
+        {
+            auto copy = s;
+            expectEq$(s._cell->_strong.load(), 2);
+        }
+        expectEq$(s._cell->_strong.load(), 1);
+        expectEq$(dtors, 0);
+    }
+
+    // Cleared with the last strong reference, the weak one keeps the cell.
+    expectEq$(dtors, 1);
+    expectEq$(weak->_cell->_weak.load(), 1);
+
+    return Ok();
+}
+
 } // namespace Karm::Base::Tests
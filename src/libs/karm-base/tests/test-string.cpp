@@ -0,0 +1,115 @@
+#include <karm-base/string.h>
+#include <karm-test/macros.h>
+
+#ifdef __osdk_sys_linux__
+#    include <karm-base/panic.h>
+#    include <stdlib.h>
+
+// Count allocations to check that short strings don't make any. Only the
+// ones made while an _Allocs is alive are counted, the rest of the binary
+// allocates as usual.
+static bool _counting = false;
+static usize _allocs = 0;
+
+struct _Allocs {
+    usize _before = _allocs;
+
+    _Allocs() { _counting = true; }
+
+    ~_Allocs() { _counting = false; }
+
+    usize count() const { return _allocs - _before; }
+};
+
+static void *_alloc(usize size) {
+    if (_counting)
+        _allocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (not ptr)
+        panic("out of memory");
+    return ptr;
+}
+
+[[gnu::noinline]] void *operator new(usize size) {
+    return _alloc(size);
+}
+
+[[gnu::noinline]] void *operator new[](usize size) {
+    return _alloc(size);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { free(ptr); }
+[[gnu::noinline]] void operator delete[](void *ptr) noexcept { free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, usize) noexcept { free(ptr); }
+[[gnu::noinline]] void operator delete[](void *ptr, usize) noexcept { free(ptr); }
+#endif
+
+namespace Karm::Base::Tests {
+
+test$(stringInline) {
+    String empty;
+    expectEq$(empty.len(), 0uz);
+    expect$(empty.isInline());
+    expectEq$(empty.buf()[0], '\0');
+
+    // Exactly fills the inline buffer, the length doubles as terminator.
+    Str full = "0123456789abcdefghijklm";
+    expectEq$(full.len(), String::INLINE_LEN);
+
+    String a = full;
+    expect$(a.isInline());
+    expectEq$(a.len(), full.len());
+    expectEq$(a.buf()[a.len()], '\0');
+    expectEq$(a.str(), full);
+
+    Str longer = "0123456789abcdefghijklmn";
+    String b = longer;
+    expect$(not b.isInline());
+    expectEq$(b.str(), longer);
+    expectEq$(b.buf()[b.len()], '\0');
+
+    return Ok();
+}
+
+test$(stringCopyMove) {
+    String shrt = "short";
+    String lng = "a string too long to be stored inline";
+
+    String copy = lng;
+    expectEq$(copy.str(), lng.str());
+    expect$(copy.buf() != lng.buf());
+
+    String moved = std::move(copy);
+    expectEq$(moved.str(), lng.str());
+    expectEq$(copy.len(), 0uz);
+
+    moved = std::move(shrt);
+    expectEq$(moved.str(), Str{"short"});
+    expectEq$(shrt.str(), lng.str());
+
+    return Ok();
+}
+
+#ifdef __osdk_sys_linux__
+test$(stringAllocations) {
+    {
+        _Allocs allocs;
+        String a = "label";
+        String b = a;
+        String c = std::move(b);
+        c = a;
+        expectEq$(allocs.count(), 0uz);
+    }
+
+    {
+        _Allocs allocs;
+        String a = "a string too long to be stored inline";
+        String b = std::move(a);
+        expectEq$(allocs.count(), 1uz);
+    }
+
+    return Ok();
+}
+#endif
+
+} // namespace Karm::Base::Tests
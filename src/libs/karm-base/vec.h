@@ -67,7 +67,7 @@ struct _Vec {
 
     void fit() { _buf.fit(); }
 
-    void clear() { _buf.resize(0); }
+    void clear() { _buf.truncate(0); }
 
     usize cap() const { return _buf.cap(); }
 
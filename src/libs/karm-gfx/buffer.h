@@ -8,7 +8,18 @@
 
 namespace Karm::Gfx {
 
+struct Rgba8888Pm;
+
+struct Bgra8888Pm;
+
 struct Rgba8888 {
+    static constexpr bool PREMULTIPLIED = false;
+
+    // The format with the same byte order, without any conversion.
+    using Order = Rgba8888;
+
+    using Premultiplied = Rgba8888Pm;
+
     ALWAYS_INLINE static Color load(void const *pixel) {
         u8 const *p = static_cast<u8 const *>(pixel);
         return Color::fromRgba(p[0], p[1], p[2], p[3]);
@@ -30,6 +41,12 @@ struct Rgba8888 {
 [[gnu::used]] inline Rgba8888 RGBA8888;
 
 struct Bgra8888 {
+    static constexpr bool PREMULTIPLIED = false;
+
+    using Order = Bgra8888;
+
+    using Premultiplied = Bgra8888Pm;
+
     ALWAYS_INLINE static Color load(void const *pixel) {
         u8 const *p = static_cast<u8 const *>(pixel);
         return Color::fromRgba(p[2], p[1], p[0], p[3]);
@@ -50,7 +67,55 @@ struct Bgra8888 {
 
 [[gnu::used]] inline Bgra8888 BGRA8888;
 
-using _Fmts = Var<Rgba8888, Bgra8888>;
+// Premultiplied alpha variants, the color channels are stored already scaled
+// by the alpha. Compositing over them takes no division, loading and storing
+// a straight Color converts on the fly.
+
+struct Rgba8888Pm {
+    static constexpr bool PREMULTIPLIED = true;
+
+    using Order = Rgba8888;
+
+    using Premultiplied = Rgba8888Pm;
+
+    ALWAYS_INLINE static Color load(void const *pixel) {
+        return Rgba8888::load(pixel).unpremultiply();
+    }
+
+    ALWAYS_INLINE static void store(void *pixel, Color color) {
+        Rgba8888::store(pixel, color.premultiply());
+    }
+
+    ALWAYS_INLINE static usize bpp() {
+        return 4;
+    }
+};
+
+[[gnu::used]] inline Rgba8888Pm RGBA8888PM;
+
+struct Bgra8888Pm {
+    static constexpr bool PREMULTIPLIED = true;
+
+    using Order = Bgra8888;
+
+    using Premultiplied = Bgra8888Pm;
+
+    ALWAYS_INLINE static Color load(void const *pixel) {
+        return Bgra8888::load(pixel).unpremultiply();
+    }
+
+    ALWAYS_INLINE static void store(void *pixel, Color color) {
+        Bgra8888::store(pixel, color.premultiply());
+    }
+
+    ALWAYS_INLINE static usize bpp() {
+        return 4;
+    }
+};
+
+[[gnu::used]] inline Bgra8888Pm BGRA8888PM;
+
+using _Fmts = Var<Rgba8888, Bgra8888, Rgba8888Pm, Bgra8888Pm>;
 
 struct Fmt : public _Fmts {
     using _Fmts::_Fmts;
@@ -72,6 +137,20 @@ struct Fmt : public _Fmts {
             return f.bpp();
         });
     }
+
+    ALWAYS_INLINE bool premultiplied() const {
+        return visit([&](auto f) {
+            return f.PREMULTIPLIED;
+        });
+    }
+
+    // The premultiplied format with the same byte order, meant for
+    // intermediate buffers that get composited over and over.
+    ALWAYS_INLINE Fmt withPremultiplied() const {
+        return visit([&](auto f) -> Fmt {
+            return typename decltype(f)::Premultiplied{};
+        });
+    }
 };
 
 template <bool MUT>
@@ -5,6 +5,17 @@
 
 namespace Karm::Gfx {
 
+// x / 255 rounded down, exact for every product of two bytes.
+ALWAYS_INLINE constexpr u32 div255(u32 x) {
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+// x / 255 rounded to the nearest, exact for every product of two bytes.
+ALWAYS_INLINE constexpr u32 div255Round(u32 x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
 struct Color {
     u8 red, green, blue, alpha;
 
@@ -38,9 +49,9 @@ struct Color {
             return background;
         } else if (background.alpha == 255u) {
             return {
-                static_cast<u8>((background.red * 255u * (255u - alpha) + 255u * alpha * red) / 65025),
-                static_cast<u8>((background.green * 255u * (255u - alpha) + 255u * alpha * green) / 65025),
-                static_cast<u8>((background.blue * 255u * (255u - alpha) + 255u * alpha * blue) / 65025),
+                static_cast<u8>(div255(background.red * (255u - alpha) + alpha * red)),
+                static_cast<u8>(div255(background.green * (255u - alpha) + alpha * green)),
+                static_cast<u8>(div255(background.blue * (255u - alpha) + alpha * blue)),
                 static_cast<u8>(255),
             };
         } else {
@@ -55,6 +66,34 @@ struct Color {
         }
     }
 
+    // Scale the color channels by the alpha, as stored by premultiplied formats.
+    ALWAYS_INLINE constexpr Color premultiply() const {
+        if (alpha == 255)
+            return *this;
+
+        return {
+            static_cast<u8>(div255Round(red * alpha)),
+            static_cast<u8>(div255Round(green * alpha)),
+            static_cast<u8>(div255Round(blue * alpha)),
+            alpha,
+        };
+    }
+
+    ALWAYS_INLINE constexpr Color unpremultiply() const {
+        if (alpha == 255)
+            return *this;
+        if (alpha == 0)
+            return {};
+
+        u32 half = alpha / 2;
+        return {
+            static_cast<u8>(min((red * 255u + half) / alpha, 255u)),
+            static_cast<u8>(min((green * 255u + half) / alpha, 255u)),
+            static_cast<u8>(min((blue * 255u + half) / alpha, 255u)),
+            alpha,
+        };
+    }
+
     ALWAYS_INLINE constexpr Color lerpWith(Color const other, f64 const t) const {
         return {
             static_cast<u8>(red + (other.red - red) * t),
@@ -4,15 +4,30 @@
 
 #include "colors.h"
 #include "context.h"
+#include "display-list.h"
+#include "span.h"
 
 namespace Karm::Gfx {
 
 void Context::begin(MutPixels p) {
     _pixels = p;
+    _blurClipped = false;
     _stack.pushBack({
         .clip = pixels().bound(),
     });
     _scanline.resize(p.width());
+    _accum.resize(p.width() + 2);
+    _mask.resize(p.width());
+    _span.resize(p.width());
+    _updateTransform();
+}
+
+void Context::begin(DisplayList &list) {
+    list.clear();
+    _lists.pushBack(&list);
+    _stack.pushBack({
+        .clip = list.bound(),
+    });
     _updateTransform();
 }
 
@@ -23,6 +38,11 @@ void Context::end() {
 
     _stack.popBack();
     _pixels = NONE;
+
+    if (recording()) {
+        last(_lists)->_buildIndex();
+        _lists.popBack();
+    }
 }
 
 MutPixels Context::mutPixels() {
@@ -58,6 +78,53 @@ void Context::restore() {
     _updateTransform();
 }
 
+Math::Recti Context::_targetBound() const {
+    if (recording())
+        return last(_lists)->bound();
+    return pixels().bound();
+}
+
+void Context::_record(auto op, Math::Recti bound) {
+    last(_lists)->_record(std::move(op), clip(), bound, _antialiasing);
+}
+
+void Context::_beginLayer(Math::Vec2i offset) {
+    auto *list = last(_lists);
+    auto layer = makeStrong<DisplayList>(list->bound());
+    _lists.pushBack(&*layer);
+
+    // The bound is only known once the layer ended.
+    list->_cmds.pushBack({
+        .op = DisplayList::Layer{offset, layer},
+        .clip = clip(),
+        .bound = {},
+        .antialiasing = _antialiasing,
+    });
+}
+
+void Context::_endLayer() {
+    auto *layer = last(_lists);
+    layer->_buildIndex();
+    _lists.popBack();
+
+    Opt<Math::Recti> bound;
+    for (auto const &c : layer->_cmds)
+        bound = bound ? bound->mergeWith(c.bound) : c.bound;
+
+    auto *list = last(_lists);
+    auto &cmd = last(list->_cmds);
+    if (not bound) {
+        list->_cmds.popBack();
+        return;
+    }
+
+    // The layer is composited at its offset.
+    auto offset = cmd.op.unwrap<DisplayList::Layer>().offset;
+    cmd.bound = Math::Recti{bound->xy + offset, bound->wh}.clipTo(cmd.clip);
+    if (cmd.bound.width <= 0 or cmd.bound.height <= 0)
+        list->_cmds.popBack();
+}
+
 /* --- Origin & Clipping ---------------------------------------------------- */
 
 Math::Recti Context::clip() const {
@@ -139,6 +206,10 @@ ShadowStyle const &Context::shadowStyle() {
     return current().shadowStyle;
 }
 
+Antialiasing Context::antialiasing() const {
+    return _antialiasing;
+}
+
 Context &Context::fillStyle(Paint paint) {
     current().paint = paint;
     return *this;
@@ -159,12 +230,22 @@ Context &Context::shadowStyle(ShadowStyle style) {
     return *this;
 }
 
+Context &Context::antialiasing(Antialiasing mode) {
+    _antialiasing = mode;
+    return *this;
+}
+
 /* --- Drawing -------------------------------------------------------------- */
 
-void Context::clear(Color color) { clear(pixels().bound(), color); }
+void Context::clear(Color color) { clear(_targetBound(), color); }
 
 void Context::clear(Math::Recti rect, Color color) {
     rect = applyAll(rect);
+    if (recording()) {
+        _record(DisplayList::Clear{rect, color}, rect);
+        return;
+    }
+
     mutPixels()
         .clip(rect)
         .clear(color);
@@ -172,30 +253,189 @@ void Context::clear(Math::Recti rect, Color color) {
 
 /* --- Blitting ------------------------------------------------------------- */
 
-[[gnu::flatten]] void Context::blit(Math::Recti src, Math::Recti dest, Pixels p) {
-    dest = applyOrigin(dest);
-    auto clipDest = applyAll(dest);
+// Integer stepping of `from + i * num / den` without a division per step.
+struct _Step {
+    isize q, r;
+    isize dq, dr;
+    isize den;
+
+    _Step(isize from, isize start, isize num, isize den)
+        : q(from + start * num / den),
+          r(start * num % den),
+          dq(num / den),
+          dr(num % den),
+          den(den) {}
+
+    ALWAYS_INLINE isize next() {
+        isize v = q;
+        q += dq;
+        r += dr;
+        if (r >= den) {
+            r -= den;
+            q++;
+        }
+        return v;
+    }
+};
 
-    for (isize y = 0; y < clipDest.height; ++y) {
-        isize yy = clipDest.y - dest.y + y;
+// Premultiplied sources stay premultiplied in the span, only their byte order
+// changes, so they get composited without any division.
+template <typename S, typename D>
+using _SpanFmt = Meta::Cond<S::PREMULTIPLIED, typename D::Premultiplied, D>;
 
-        auto srcY = src.y + yy * src.height / dest.height;
-        auto destY = clipDest.y + y;
+template <typename S, typename D>
+ALWAYS_INLINE static void _storeSpan(u32 *span, u8 const *pixel) {
+    if constexpr (S::PREMULTIPLIED)
+        D::Order::store(span, S::Order::load(pixel));
+    else
+        _SpanFmt<S, D>::store(span, S::load(pixel));
+}
+
+[[gnu::flatten]] void Context::_blitNearest(Math::Recti src, Math::Recti dest, Math::Recti clipDest, Pixels p, auto srcFmt, auto destFmt) {
+    using S = decltype(srcFmt);
+    using D = decltype(destFmt);
+    static constexpr bool SAME_FMT = Meta::Same<S, D>;
+
+    // The source column of every destination column is the same on every row.
+    _columns.resize(clipDest.width);
+    _Step stepX{src.x, clipDest.x - dest.x, src.width, dest.width};
+    for (isize x = 0; x < clipDest.width; ++x)
+        _columns[x] = clamp(stepX.next(), 0, p.width() - 1);
+
+    bool contiguous = src.width == dest.width and
+                      _columns[0] == src.x + clipDest.x - dest.x and
+                      _columns[clipDest.width - 1] == _columns[0] + clipDest.width - 1;
+
+    _Step stepY{src.y, clipDest.y - dest.y, src.height, dest.height};
+    for (isize y = 0; y < clipDest.height; ++y) {
+        auto srcY = clamp(stepY.next(), 0, p.height() - 1);
+        auto *d = static_cast<u8 *>(mutPixels().pixelUnsafe({clipDest.x, clipDest.y + y}));
+        auto const *s = static_cast<u8 const *>(p.scanline(srcY));
+
+        if constexpr (SAME_FMT) {
+            if (contiguous) {
+                auto const *row = s + _columns[0] * srcFmt.bpp();
+                if (isOpaque(row, clipDest.width))
+                    memcpy(d, row, clipDest.width * srcFmt.bpp());
+                else
+                    blendSpan<S, D>(d, reinterpret_cast<u32 const *>(row), clipDest.width);
+                continue;
+            }
+        }
 
         for (isize x = 0; x < clipDest.width; ++x) {
-            isize xx = clipDest.x - dest.x + x;
+            auto const *pixel = s + _columns[x] * srcFmt.bpp();
+            if constexpr (SAME_FMT)
+                memcpy(&_span[x], pixel, sizeof(u32));
+            else
+                _storeSpan<S, D>(&_span[x], pixel);
+        }
+        blendSpan<_SpanFmt<S, D>, D>(d, _span.buf(), clipDest.width);
+    }
+}
+
+// 16.16 fixed point position of the center of destination pixels in the source.
+static isize _bilinearStart(isize from, isize start, isize num, isize den) {
+    return (from << 16) + ((2 * start + 1) * (num << 15)) / den - (1 << 15);
+}
+
+ALWAYS_INLINE static Color _lerp(Color a, Color b, u32 w) {
+    return {
+        static_cast<u8>((a.red * (256 - w) + b.red * w) >> 8),
+        static_cast<u8>((a.green * (256 - w) + b.green * w) >> 8),
+        static_cast<u8>((a.blue * (256 - w) + b.blue * w) >> 8),
+        static_cast<u8>((a.alpha * (256 - w) + b.alpha * w) >> 8),
+    };
+}
 
-            auto srcX = src.x + xx * src.width / dest.width;
-            auto destX = clipDest.x + x;
+[[gnu::flatten]] void Context::_blitBilinear(Math::Recti src, Math::Recti dest, Math::Recti clipDest, Pixels p, auto srcFmt, auto destFmt) {
+    using S = decltype(srcFmt);
+    using D = decltype(destFmt);
 
-            auto color = p.load({srcX, srcY});
-            mutPixels().blend({destX, destY}, color);
+    // Premultiplied pixels are interpolated as they are stored, which keeps
+    // transparent neighbours from bleeding their color.
+    using Load = Meta::Cond<S::PREMULTIPLIED, typename S::Order, S>;
+    using Store = Meta::Cond<S::PREMULTIPLIED, typename D::Order, D>;
+
+    _columns.resize(clipDest.width);
+    isize stepX = (src.width << 16) / dest.width;
+    isize posX = _bilinearStart(src.x, clipDest.x - dest.x, src.width, dest.width);
+    for (isize x = 0; x < clipDest.width; ++x, posX += stepX)
+        _columns[x] = posX;
+
+    isize stepY = (src.height << 16) / dest.height;
+    isize posY = _bilinearStart(src.y, clipDest.y - dest.y, src.height, dest.height);
+    for (isize y = 0; y < clipDest.height; ++y, posY += stepY) {
+        auto y0 = clamp(posY >> 16, 0, p.height() - 1);
+        auto y1 = clamp((posY >> 16) + 1, 0, p.height() - 1);
+        u32 wy = (posY >> 8) & 0xff;
+
+        auto const *s0 = static_cast<u8 const *>(p.scanline(y0));
+        auto const *s1 = static_cast<u8 const *>(p.scanline(y1));
+        auto *d = static_cast<u8 *>(mutPixels().pixelUnsafe({clipDest.x, clipDest.y + y}));
+
+        for (isize x = 0; x < clipDest.width; ++x) {
+            auto pos = _columns[x];
+            auto x0 = clamp(pos >> 16, 0, p.width() - 1) * srcFmt.bpp();
+            auto x1 = clamp((pos >> 16) + 1, 0, p.width() - 1) * srcFmt.bpp();
+            u32 wx = (pos >> 8) & 0xff;
+
+            auto top = _lerp(Load::load(s0 + x0), Load::load(s0 + x1), wx);
+            auto bottom = _lerp(Load::load(s1 + x0), Load::load(s1 + x1), wx);
+            Store::store(&_span[x], _lerp(top, bottom, wy));
         }
+        blendSpan<_SpanFmt<S, D>, D>(d, _span.buf(), clipDest.width);
+    }
+}
+
+void Context::_blit(Math::Recti src, Math::Recti dest, Pixels p, Sampling sampling, auto blit) {
+    dest = applyOrigin(dest);
+    auto clipDest = applyClip(dest);
+
+    if (clipDest.width <= 0 or clipDest.height <= 0 or src.width <= 0 or src.height <= 0)
+        return;
+
+    if (src.width == dest.width and src.height == dest.height)
+        sampling = Sampling::NEAREST;
+
+    if (recording()) {
+        _record(blit(dest, sampling), clipDest);
+        return;
     }
+
+    p.fmt().visit([&](auto srcFmt) {
+        pixels().fmt().visit([&](auto destFmt) {
+            if (sampling == Sampling::BILINEAR)
+                _blitBilinear(src, dest, clipDest, p, srcFmt, destFmt);
+            else
+                _blitNearest(src, dest, clipDest, p, srcFmt, destFmt);
+        });
+    });
+}
+
+void Context::blit(Math::Recti src, Math::Recti dest, Pixels p, Sampling sampling) {
+    _blit(src, dest, p, sampling, [&](Math::Recti dest, Sampling sampling) {
+        // Nothing says the pixels outlive the list.
+        auto copy = Media::Image::alloc(p.size(), p.fmt());
+        auto pixels = copy.mutPixels();
+        for (isize y = 0; y < p.height(); y++)
+            memcpy(pixels.scanline(y), p.scanline(y), p.width() * p.fmt().bpp());
+        return DisplayList::Blit{src, dest, copy, sampling};
+    });
+}
+
+void Context::blit(Math::Recti dest, Pixels pixels, Sampling sampling) {
+    blit(pixels.bound(), dest, pixels, sampling);
 }
 
-void Context::blit(Math::Recti dest, Pixels pixels) {
-    blit(pixels.bound(), dest, pixels);
+void Context::blit(Math::Recti src, Math::Recti dest, Media::Image const &image, Sampling sampling) {
+    _blit(src, dest, image.pixels(), sampling, [&](Math::Recti dest, Sampling sampling) {
+        return DisplayList::Blit{src, dest, image, sampling};
+    });
+}
+
+void Context::blit(Math::Recti dest, Media::Image const &image, Sampling sampling) {
+    blit(image.bound(), dest, image, sampling);
 }
 
 void Context::blit(Math::Vec2i dest, Pixels pixels) {
@@ -218,33 +458,49 @@ void Context::fill(Math::Edgei edge, f64 thickness) {
     stroke(StrokeStyle().withWidth(thickness));
 }
 
+// Rounded rectangles are flattened once per size and radius, and taken from
+// the shape cache afterward.
+static void _rect(Context &g, Math::Recti r, BorderRadius radius) {
+    if (radius.zero()) {
+        g.begin();
+        g.rect(r.cast<f64>());
+        return;
+    }
+
+    g.path(ShapeCache::Source::rect(r.wh, radius), r.xy.cast<f64>(), [&](Context &g) {
+        g.rect(Math::Rectf{0, 0, (f64)r.width, (f64)r.height}, radius);
+    });
+}
+
 void Context::stroke(Math::Recti r, BorderRadius radius) {
-    begin();
-    rect(r.cast<f64>(), radius);
+    _rect(*this, r, radius);
     stroke();
 }
 
 [[gnu::flatten]] void Context::_fillRect(Math::Recti r, Gfx::Color color) {
     r = applyAll(r);
-    if (color.alpha == 255) {
+    if (recording()) {
+        _record(DisplayList::FillRect{r, color}, r);
+    } else if (color.alpha == 255) {
         mutPixels()
             .clip(r)
             .clear(color);
-    } else {
+    } else if (r.width > 0) {
         pixels().fmt().visit([&](auto f) {
+            u32 c;
+            f.store(&c, Color::fromRgb(color.red, color.green, color.blue));
+            Karm::fill(mutSub(_mask, 0, r.width), color.alpha);
+
             for (isize y = r.y; y < r.y + r.height; ++y) {
-                for (isize x = r.x; x < r.x + r.width; ++x) {
-                    auto blended = color.blendOver(f.load(mutPixels().pixelUnsafe({x, y})));
-                    f.store(mutPixels().pixelUnsafe({x, y}), blended);
-                }
+                auto *d = static_cast<u8 *>(mutPixels().pixelUnsafe({r.x, y}));
+                blendSpan<decltype(f)>(d, c, _mask.buf(), r.width);
             }
         });
     }
 }
 
 void Context::fill(Math::Recti r, BorderRadius radius) {
-    begin();
-    rect(r.cast<f64>(), radius);
+    _rect(*this, r, radius);
 
     bool isSuitableForFastFill =
         radius.zero() and
@@ -258,15 +514,20 @@ void Context::fill(Math::Recti r, BorderRadius radius) {
     }
 }
 
+// Ellipses are flattened once per radius, like rounded rectangles.
+static void _ellipse(Context &g, Math::Ellipsei e) {
+    g.path(ShapeCache::Source::ellipse(e.radius), e.center.cast<f64>(), [&](Context &g) {
+        g.ellipse(Math::Ellipsef{0, 0, (f64)e.radius.x, (f64)e.radius.y});
+    });
+}
+
 void Context::stroke(Math::Ellipsei e) {
-    begin();
-    ellipse(e.cast<f64>());
+    _ellipse(*this, e);
     stroke();
 }
 
 void Context::fill(Math::Ellipsei e) {
-    begin();
-    ellipse(e.cast<f64>());
+    _ellipse(*this, e);
     fill();
 }
 
@@ -290,7 +551,7 @@ void Context::stroke(Math::Vec2i baseline, Rune rune) {
     restore();
 }
 
-void Context::fill(Math::Vec2i baseline, Rune rune) {
+void Context::_fillContour(Math::Vec2i baseline, Rune rune) {
     auto f = textFont();
 
     save();
@@ -302,32 +563,183 @@ void Context::fill(Math::Vec2i baseline, Rune rune) {
     restore();
 }
 
+bool Context::_useGlyphCache() const {
+    return current().paint.is<Color>() and
+           current().trans.isIdentity() and
+           _antialiasing == Antialiasing::SUPERSAMPLE;
+}
+
+void Context::_copyGlyph(GlyphCache const &cache, GlyphCache::Glyph const &glyph, Math::Vec2i pen) {
+    auto dest = applyOrigin(Math::Recti{glyph.bound.xy + pen, glyph.bound.wh});
+    auto clipDest = applyClip(dest);
+    if (clipDest.width <= 0 or clipDest.height <= 0)
+        return;
+
+    usize offset = _glyphMasks.len();
+    _glyphMasks.resize(offset + clipDest.width * clipDest.height);
+    for (isize y = 0; y < clipDest.height; ++y) {
+        auto const *mask = cache.mask(glyph, clipDest.y - dest.y + y) + (clipDest.x - dest.x);
+        memcpy(&_glyphMasks[offset + y * clipDest.width], mask, clipDest.width);
+    }
+
+    _placedGlyphs.pushBack({clipDest, offset});
+}
+
+void Context::_fillGlyphs(Color color) {
+    pixels().fmt().visit([&](auto f) {
+        u32 c;
+        f.store(&c, Color::fromRgb(color.red, color.green, color.blue));
+
+        for (auto const &glyph : _placedGlyphs) {
+            auto dest = glyph.dest;
+            for (isize y = 0; y < dest.height; ++y) {
+                auto const *mask = &_glyphMasks[glyph.offset + y * dest.width];
+
+                if (color.alpha != 255) {
+                    for (isize x = 0; x < dest.width; ++x)
+                        _mask[x] = (mask[x] * color.alpha + 127) / 255;
+                    mask = _mask.buf();
+                }
+
+                auto *d = static_cast<u8 *>(mutPixels().pixelUnsafe({dest.x, dest.y + y}));
+                blendSpan<decltype(f)>(d, c, mask, dest.width);
+            }
+        }
+    });
+
+    _placedGlyphs.clear();
+    _glyphMasks.clear();
+}
+
+void Context::fill(Math::Vec2i baseline, Rune rune) {
+    if (not _useGlyphCache()) {
+        _fillContour(baseline, rune);
+        return;
+    }
+
+    if (recording()) {
+        auto f = textFont();
+        auto pad = f.fontsize / 2;
+        Math::Rectf bound = {
+            baseline.x - pad,
+            baseline.y - f.metrics().ascend - pad,
+            f.advance(rune) + pad * 2,
+            f.metrics().ascend + f.metrics().descend + pad * 2,
+        };
+        _record(
+            DisplayList::FillRune{applyOrigin(baseline), rune, f, current().paint.unwrap<Color>()},
+            applyAll(bound.ceil().cast<isize>())
+        );
+        return;
+    }
+
+    auto &cache = glyphCache();
+    Opt<GlyphCache::Glyph> glyph;
+    {
+        LockScope scope(cache._lock);
+        glyph = cache.get(textFont(), rune, 0);
+        if (glyph)
+            _copyGlyph(cache, *glyph, baseline);
+    }
+
+    if (glyph)
+        _fillGlyphs(current().paint.unwrap<Color>());
+    else
+        _fillContour(baseline, rune);
+}
+
 void Context::stroke(Math::Vec2i baseline, Str str) {
     auto f = textFont();
-    for (auto r : iterRunes(str)) {
-        stroke(baseline, r);
-        baseline.x += f.advance(r);
-    }
+    auto scale = f.fontsize / f.fontface->units();
+
+    f.fontface->shape(str, [&](Media::Run const &run) {
+        for (auto const &glyph : run.glyphs) {
+            isize x = Math::floor(baseline.x + glyph.x * scale);
+            stroke(Math::Vec2i{x, baseline.y}, glyph.rune);
+        }
+    });
 }
 
 void Context::fill(Math::Vec2i baseline, Str str) {
     auto f = textFont();
-    for (auto r : iterRunes(str)) {
-        fill(baseline, r);
-        baseline.x += f.advance(r);
+    auto scale = f.fontsize / f.fontface->units();
+
+    // Glyphs may overhang their advance, the bound is padded generously.
+    if (recording() and _useGlyphCache()) {
+        auto m = f.mesureStr(str);
+        auto pad = f.fontsize / 2;
+        Math::Rectf bound = {
+            baseline.x - pad,
+            baseline.y - m.baseline.y - pad,
+            m.linebound.width + pad * 2,
+            m.linebound.height + pad * 2,
+        };
+        _record(
+            DisplayList::FillText{applyOrigin(baseline), str, f, current().paint.unwrap<Color>()},
+            applyAll(bound.ceil().cast<isize>())
+        );
+        return;
     }
+
+    f.fontface->shape(str, [&](Media::Run const &run) {
+        if (not _useGlyphCache()) {
+            for (auto const &glyph : run.glyphs) {
+                isize x = Math::floor(baseline.x + glyph.x * scale);
+                _fillContour({x, baseline.y}, glyph.rune);
+            }
+            return;
+        }
+
+        // The masks are copied out under the lock and blended after, so
+        // other threads drawing text only wait for the copy.
+        auto &cache = glyphCache();
+        Vec<Cons<Math::Vec2i, Rune>> uncached;
+        {
+            LockScope scope(cache._lock);
+
+            // Glyphs are placed at fractional positions, the remainder picks
+            // one of the subpixel variants of the glyph.
+            for (auto const &glyph : run.glyphs) {
+                f64 pen = baseline.x + glyph.x * scale;
+                isize x = Math::floor(pen);
+                isize subpixel = (pen - x) * GlyphCache::SUBPIXELS;
+
+                if (auto g = cache.get(f, glyph.rune, subpixel))
+                    _copyGlyph(cache, *g, {x, baseline.y});
+                else
+                    uncached.pushBack({{x, baseline.y}, glyph.rune});
+            }
+        }
+
+        _fillGlyphs(current().paint.unwrap<Color>());
+        for (auto [pen, rune] : uncached)
+            _fillContour(pen, rune);
+    });
 }
 
 /* --- Debug ---------------------------------------------------------------- */
 
 void Context::debugPlot(Math::Vec2i point, Color color) {
     point = applyOrigin(point);
-    if (clip().contains(point)) {
+    if (not clip().contains(point))
+        return;
+
+    if (recording())
+        _record(DisplayList::Plot{point, color}, {point, 1});
+    else
         mutPixels().blend(point, color);
-    }
 }
 
 void Context::debugLine(Math::Edgei edge, Color color) {
+    if (recording()) {
+        auto bound = edge.bound();
+        _record(
+            DisplayList::Line{{applyOrigin(edge.start), applyOrigin(edge.end)}, color},
+            applyAll({bound.xy, bound.wh + 1})
+        );
+        return;
+    }
+
     isize dx = Math::abs(edge.ex - edge.sx);
     isize sx = edge.sx < edge.ex ? 1 : -1;
 
@@ -410,6 +822,63 @@ void Context::debugTrace(Gfx::Color color) {
 
 /* --- Paths ---------------------------------------------------------------- */
 
+void Context::_buildEdgeTable() {
+    _edges.clear();
+
+    for (auto &edge : _shape) {
+        auto bound = edge.bound();
+
+        // Horizontal edges never cross a sample line.
+        if (bound.top() >= bound.bottom())
+            continue;
+
+        _edges.pushBack({
+            .edge = edge,
+            .top = bound.top(),
+            .bottom = bound.bottom(),
+            .sign = edge.sy > edge.ey ? 1 : -1,
+        });
+    }
+
+    sort(_edges, [](auto const &a, auto const &b) {
+        return cmp(a.top, b.top);
+    });
+}
+
+// Blend the paint over the pixels of a row, using the coverage from the scanline.
+[[gnu::flatten]] void Context::_composite(auto paint, auto format, Math::Rectf shapeBound, isize y, isize start, isize end) {
+    if (start >= end)
+        return;
+
+    u8 *pixels = static_cast<u8 *>(mutPixels().pixelUnsafe({start, y}));
+
+    // Solid colors don't need to be sampled, only the alpha changes.
+    if constexpr (Meta::Same<decltype(paint), Color>) {
+        for (isize x = start; x < end; x++)
+            _mask[x] = paint.withOpacity(clamp01(_scanline[x])).alpha;
+
+        u32 color;
+        format.store(&color, Color::fromRgb(paint.red, paint.green, paint.blue));
+        blendSpan<decltype(format)>(pixels, color, &_mask[start], end - start);
+    } else {
+        for (isize x = start; x < end; x++) {
+            auto coverage = clamp01(_scanline[x]);
+            if (coverage == 0) {
+                _span[x] = 0;
+                continue;
+            }
+
+            Math::Vec2f sample = {
+                (x - shapeBound.start()) / shapeBound.width,
+                (y - shapeBound.top()) / shapeBound.height,
+            };
+            format.store(&_span[x], paint.sample(sample).withOpacity(coverage));
+        }
+
+        blendSpan<decltype(format), decltype(format)>(pixels, &_span[start], end - start);
+    }
+}
+
 [[gnu::flatten]] void Context::_fillImpl(auto paint, auto format, FillRule fillRule) {
     static constexpr auto AA = 4;
     static constexpr auto UNIT = 1.0f / AA;
@@ -418,29 +887,51 @@ void Context::debugTrace(Gfx::Color color) {
     auto shapeBound = _shape.bound();
     auto rect = applyClip(shapeBound.ceil().cast<isize>());
 
+    _buildEdgeTable();
+    _active.clear();
+    usize next = 0;
+
     for (isize y = rect.top(); y < rect.bottom(); y++) {
         zeroFill<f64>(mutSub(_scanline, rect.start(), rect.end()));
 
         for (f64 yy = y; yy < y + 1.0; yy += UNIT) {
-            _active.clear();
+            auto sample = yy + HALF_UNIT;
 
-            for (auto &edge : _shape) {
-                auto sample = yy + HALF_UNIT;
+            // Retire the edges that ended above this sample line.
+            usize len = 0;
+            for (usize i = 0; i < _active.len(); i++) {
+                if (sample < _edges[_active[i].edge].bottom)
+                    _active[len++] = _active[i];
+            }
+            _active.truncate(len);
 
-                if (edge.bound().top() <= sample and sample < edge.bound().bottom()) {
-                    _active.pushBack({
-                        .x = edge.sx + (sample - edge.sy) / (edge.ey - edge.sy) * (edge.ex - edge.sx),
-                        .sign = edge.sy > edge.ey ? 1 : -1,
-                    });
-                }
+            // Enter the edges that start on or above this sample line.
+            while (next < _edges.len() and _edges[next].top <= sample) {
+                if (sample < _edges[next].bottom)
+                    _active.pushBack({.x = 0, .sign = _edges[next].sign, .edge = next});
+                next++;
             }
 
             if (_active.len() == 0)
                 continue;
 
-            sort(_active, [](auto const &a, auto const &b) {
-                return cmp(a.x, b.x);
-            });
+            // The intersection is evaluated directly rather than
+            // accumulated so the coverage stays exact.
+            for (auto &a : _active) {
+                auto &e = _edges[a.edge].edge;
+                a.x = e.sx + (sample - e.sy) / (e.ey - e.sy) * (e.ex - e.sx);
+            }
+
+            // The active edges are almost sorted from the previous sample line.
+            for (usize i = 1; i < _active.len(); i++) {
+                auto a = _active[i];
+                usize j = i;
+                while (j > 0 and _active[j - 1].x > a.x) {
+                    _active[j] = _active[j - 1];
+                    j--;
+                }
+                _active[j] = a;
+            }
 
             isize rule = 0;
             for (usize i = 0; i + 1 < _active.len(); i++) {
@@ -482,79 +973,284 @@ void Context::debugTrace(Gfx::Color color) {
             }
         }
 
-        u8 *pixel = static_cast<u8 *>(mutPixels().pixelUnsafe({rect.start(), y}));
-        for (isize x = rect.start(); x < rect.end(); x++) {
-            Math::Vec2f sample = {
-                (x - shapeBound.start()) / shapeBound.width,
-                (y - shapeBound.top()) / shapeBound.height,
-            };
-            auto color = paint.sample(sample);
+        _composite(paint, format, shapeBound, y, rect.start(), rect.end());
+    }
+}
+
+// Accumulate the signed area and cover of a line segment spanning a single
+// pixel row, going from x0 to x1 with a signed height of d.
+void Context::_accumulate(f64 x0, f64 x1, f32 d, isize start, isize end, isize &minX, isize &maxX) {
+    if (x0 > x1)
+        std::swap(x0, x1);
+
+    // Nothing right of the clip is ever visible.
+    if (x0 >= end)
+        return;
+
+    if (x1 > end) {
+        d *= (end - x0) / (x1 - x0);
+        x1 = end;
+    }
+
+    // Everything left of the clip covers the whole span.
+    if (x1 <= start) {
+        x0 = x1 = start;
+    } else if (x0 < start) {
+        f64 t = (start - x0) / (x1 - x0);
+        _accum[start] += d * t;
+        minX = min(minX, start);
+        d *= 1 - t;
+        x0 = start;
+    }
+
+    isize x0i = Math::floor(x0);
+    isize x1i = Math::ceil(x1);
+
+    minX = min(minX, x0i);
+    maxX = max(maxX, x1i + 1);
+
+    if (x1i <= x0i + 1) {
+        f32 xmf = 0.5 * (x0 + x1) - x0i;
+        _accum[x0i] += d - d * xmf;
+        _accum[x0i + 1] += d * xmf;
+        return;
+    }
+
+    f32 s = 1.0 / (x1 - x0);
+    f32 x0f = x0 - x0i;
+    f32 a0 = 0.5 * s * (1 - x0f) * (1 - x0f);
+    f32 x1f = x1 - x1i + 1;
+    f32 am = 0.5 * s * x1f * x1f;
+
+    _accum[x0i] += d * a0;
+
+    if (x1i == x0i + 2) {
+        _accum[x0i + 1] += d * (1 - a0 - am);
+    } else {
+        f32 a1 = s * (1.5 - x0f);
+        _accum[x0i + 1] += d * (a1 - a0);
+
+        for (isize x = x0i + 2; x < x1i - 1; x++)
+            _accum[x] += d * s;
+
+        f32 a2 = a1 + (x1i - x0i - 3) * s;
+        _accum[x1i - 1] += d * (1 - a2 - am);
+    }
+
+    _accum[x1i] += d * am;
+}
+
+[[gnu::flatten]] void Context::_fillAnalyticImpl(auto paint, auto format, FillRule fillRule) {
+    auto shapeBound = _shape.bound();
+    auto rect = applyClip(shapeBound.ceil().cast<isize>());
+
+    _buildEdgeTable();
+    _active.clear();
+    usize next = 0;
+
+    for (isize y = rect.top(); y < rect.bottom(); y++) {
+        // Retire the edges that ended above this row.
+        usize len = 0;
+        for (usize i = 0; i < _active.len(); i++) {
+            if (_edges[_active[i].edge].bottom > y)
+                _active[len++] = _active[i];
+        }
+        _active.truncate(len);
+
+        // Enter the edges that start above the bottom of this row.
+        while (next < _edges.len() and _edges[next].top < y + 1) {
+            if (_edges[next].bottom > y)
+                _active.pushBack({.x = 0, .sign = _edges[next].sign, .edge = next});
+            next++;
+        }
+
+        if (_active.len() == 0)
+            continue;
+
+        isize minX = rect.end();
+        isize maxX = rect.start();
+
+        for (auto &a : _active) {
+            auto edge = _edges[a.edge].edge;
+            if (edge.sy > edge.ey)
+                std::swap(edge.start, edge.end);
+
+            f64 dxdy = (edge.ex - edge.sx) / (edge.ey - edge.sy);
+            f64 y0 = max((f64)y, edge.sy);
+            f64 y1 = min(y + 1.0, edge.ey);
 
-            auto c = format.load(pixel);
-            c = color.withOpacity(clamp01(_scanline[x])).blendOver(c);
-            format.store(pixel, c);
-            pixel += format.bpp();
+            if (y1 <= y0)
+                continue;
+
+            _accumulate(
+                edge.sx + (y0 - edge.sy) * dxdy,
+                edge.sx + (y1 - edge.sy) * dxdy,
+                (y1 - y0) * a.sign,
+                rect.start(), rect.end(),
+                minX, maxX
+            );
+        }
+
+        if (minX >= maxX)
+            continue;
+
+        f32 acc = 0;
+        isize end = min(maxX, rect.end());
+        for (isize x = minX; x < end; x++) {
+            acc += _accum[x];
+
+            f64 coverage = Math::abs(acc);
+            if (fillRule == FillRule::EVENODD) {
+                coverage -= 2 * Math::floor(coverage / 2);
+                if (coverage > 1)
+                    coverage = 2 - coverage;
+            }
+            _scanline[x] = coverage;
         }
+
+        _composite(paint, format, shapeBound, y, minX, end);
+        zeroFill<f32>(mutSub(_accum, minX, maxX));
     }
 }
 
 void Context::_fill(Paint paint, FillRule fillRule) {
     paint.visit([&](auto p) {
         pixels().fmt().visit([&](auto f) {
-            _fillImpl(p, f, fillRule);
+            if (_antialiasing == Antialiasing::ANALYTIC)
+                _fillAnalyticImpl(p, f, fillRule);
+            else
+                _fillImpl(p, f, fillRule);
         });
     });
 }
 
 void Context::begin() {
+    _cachedPath = NONE;
     _path.clear();
 }
 
 void Context::close() {
+    _cachedPath = NONE;
     _path.close();
 }
 
 void Context::moveTo(Math::Vec2f p, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.moveTo(p, flags);
 }
 
 void Context::lineTo(Math::Vec2f p, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.lineTo(p, flags);
 }
 
 void Context::hlineTo(f64 x, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.hlineTo(x, flags);
 }
 
 void Context::vlineTo(f64 y, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.vlineTo(y, flags);
 }
 
 void Context::cubicTo(Math::Vec2f cp1, Math::Vec2f cp2, Math::Vec2f p, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.cubicTo(cp1, cp2, p, flags);
 }
 
 void Context::quadTo(Math::Vec2f cp, Math::Vec2f p, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.quadTo(cp, p, flags);
 }
 
 void Context::arcTo(Math::Vec2f radius, f64 angle, Math::Vec2f p, Path::Flags flags) {
+    _cachedPath = NONE;
     _path.arcTo(radius, angle, p, flags);
 }
 
 bool Context::evalSvg(Str path) {
+    _cachedPath = NONE;
     return _path.evalSvg(path);
 }
 
+void Context::path(Path const &path) {
+    _cachedPath = NONE;
+    _path.path(path);
+}
+
+Opt<Context::_CachedPath> Context::_beginCachedPath(ShapeCache::Source source, Math::Vec2f pos) {
+    begin();
+
+    // The whole pixels of the translation are left out of the cached path,
+    // so it can be reused anywhere on the pixel grid. What remains is rounded
+    // to 1/256th of a pixel, or rounding errors would make every position
+    // slightly different.
+    auto trans = current().transWithOrigin();
+    auto at = trans.apply(pos);
+    Math::Vec2f offset = {floor(at.x), floor(at.y)};
+    trans.ox = Math::round((at.x - offset.x) * 256) / 256.0;
+    trans.oy = Math::round((at.y - offset.y) * 256) / 256.0;
+
+    // Keys are hashed bitwise, -0 and 0 must be the same.
+    for (auto &v : trans._els)
+        v += 0.0;
+
+    _CachedPath cached = {{source, trans._els}, offset};
+
+    auto &cache = shapeCache();
+    LockScope scope(cache._lock);
+    if (auto *entry = cache.get(cached.key)) {
+        _useCachedPath(entry->path, cached);
+        return NONE;
+    }
+
+    _path.transform(trans);
+    return cached;
+}
+
+void Context::_endCachedPath(_CachedPath pending) {
+    auto &cache = shapeCache();
+    LockScope scope(cache._lock);
+    auto &entry = cache.put(pending.key, _path);
+    begin();
+    _useCachedPath(entry.path, pending);
+}
+
+void Context::_useCachedPath(Path const &path, _CachedPath cached) {
+    _path.transform(Math::Trans2f::translate(cached.offset.x, cached.offset.y));
+    _path.path(path);
+    _updateTransform();
+    _cachedPath = cached;
+}
+
+bool Context::_cachedShape(Opt<StrokeStyle> const &style) {
+    if (not _cachedPath)
+        return false;
+
+    auto &cache = shapeCache();
+    LockScope scope(cache._lock);
+    auto *entry = cache.lookup(_cachedPath->key);
+    if (not entry)
+        return false;
+
+    auto const &shape = style ? cache.stroke(*entry, *style) : cache.solid(*entry);
+    _shape.add(shape, _cachedPath->offset);
+    return true;
+}
+
 void Context::line(Math::Edgef line) {
+    _cachedPath = NONE;
     _path.line(line);
 }
 
 void Context::rect(Math::Rectf rect, BorderRadius radius) {
+    _cachedPath = NONE;
     _path.rect(rect, radius);
 }
 
 void Context::ellipse(Math::Ellipsef ellipse) {
+    _cachedPath = NONE;
     _path.ellipse(ellipse);
 }
 
@@ -562,9 +1258,20 @@ void Context::fill(FillRule rule) {
     fill(fillStyle(), rule);
 }
 
+// Bound of the flattened path, with the pixels it partially covers.
+static Math::Recti _pathBound(Path const &path) {
+    return path.bound().ceil().cast<isize>().grow(1);
+}
+
 void Context::fill(Paint paint, FillRule rule) {
+    if (recording()) {
+        _record(DisplayList::FillPath{_path, paint, rule}, applyClip(_pathBound(_path)));
+        return;
+    }
+
     _shape.clear();
-    createSolid(_shape, _path);
+    if (not _cachedShape(NONE))
+        createSolid(_shape, _path);
     _fill(paint, rule);
 }
 
@@ -574,7 +1281,15 @@ void Context::stroke() {
 
 void Context::stroke(StrokeStyle style) {
     _shape.clear();
-    createStroke(_shape, _path, style);
+    if (not _cachedShape(style))
+        createStroke(_shape, _path, style);
+
+    if (recording()) {
+        auto bound = _shape.bound().ceil().cast<isize>().grow(1);
+        _record(DisplayList::StrokePath{_path, style}, applyClip(bound));
+        return;
+    }
+
     _fill(style.paint);
 }
 
@@ -583,20 +1298,141 @@ void Context::shadow() {
 }
 
 void Context::shadow(ShadowStyle style) {
+    if (recording()) {
+        auto bound = _pathBound(_path);
+        bound.xy = bound.xy + style.offset;
+        bound = bound.grow((isize)Math::ceil(style.radius) + 1);
+        _record(DisplayList::Shadow{_path, style}, applyClip(bound));
+        return;
+    }
+
+    // Nothing is drawn around the path, only its surroundings need to be
+    // blurred.
+    auto bound = _pathBound(_path).grow((isize)style.radius + 1);
+    auto shadowBound = bound;
+    shadowBound.xy = shadowBound.xy + style.offset;
+    if (not clip().contains(bound) or not clip().contains(shadowBound))
+        _blurClipped = true;
     layer(style.offset, [&](Context &ctx) {
         ctx.fill(style.paint);
-        ctx.apply(BlurFilter{(isize)style.radius});
+        BlurFilter{(isize)style.radius}.apply(ctx.mutPixels().clip(bound));
+    });
+}
+
+void Context::shadow(Math::Recti r, BorderRadius radius) {
+    shadow(r, radius, shadowStyle());
+}
+
+bool Context::_useShadowCache(ShadowStyle const &style) const {
+    return style.paint.is<Color>() and
+           current().trans.isIdentity();
+}
+
+static BorderRadius _spread(BorderRadius radius, f64 spread) {
+    return {
+        max(radius.topLeft + spread, 0.0),
+        max(radius.topRight + spread, 0.0),
+        max(radius.bottomRight + spread, 0.0),
+        max(radius.bottomLeft + spread, 0.0),
+    };
+}
+
+void Context::shadow(Math::Recti r, BorderRadius radius, ShadowStyle style) {
+    bool useCache = _useShadowCache(style);
+    isize blur = max<isize>(style.radius, 0);
+    isize spread = Math::round(style.spread);
+
+    if (recording() and useCache) {
+        r = applyOrigin(r);
+        auto bound = r.grow(spread + ShadowCache::padding(blur));
+        bound.xy = bound.xy + style.offset;
+        _record(DisplayList::BoxShadow{r, radius, style}, applyClip(bound));
+        return;
+    }
+
+    r = r.grow(spread);
+    radius = _spread(radius, spread);
+    if (r.width <= 0 or r.height <= 0)
+        return;
+
+    if (not useCache) {
+        begin();
+        rect(r.cast<f64>(), radius);
+        shadow(style);
+        return;
+    }
+
+    auto &cache = shadowCache();
+    LockScope scope(cache._lock);
+    auto const &mask = cache.get(r.wh, radius, blur);
+    auto dest = applyOrigin(r).grow(ShadowCache::padding(blur));
+    dest.xy = dest.xy + style.offset;
+    _fillShadow(mask, dest, style.paint.unwrap<Color>());
+}
+
+void Context::_fillShadow(ShadowCache::Shadow const &shadow, Math::Recti dest, Color color) {
+    auto clipDest = applyClip(dest);
+    if (clipDest.width <= 0 or clipDest.height <= 0)
+        return;
+
+    Array<u8, 256> alpha;
+    for (usize i = 0; i < 256; i++)
+        alpha[i] = (i * color.alpha + 127) / 255;
+
+    // The corners are copied and the middle row and column repeated, the
+    // right side of the mask is shifted by `tail`.
+    isize start = clipDest.x - dest.x;
+    isize end = start + clipDest.width;
+    isize middle = shadow.stretchX ? *shadow.stretchX : shadow.size.x;
+    isize tail = dest.width - shadow.size.x;
+
+    pixels().fmt().visit([&](auto f) {
+        u32 c;
+        f.store(&c, Color::fromRgb(color.red, color.green, color.blue));
+
+        for (isize y = 0; y < clipDest.height; ++y) {
+            auto sy = ShadowCache::Shadow::_map(clipDest.y - dest.y + y, dest.height, shadow.size.y, shadow.stretchY);
+            auto const *row = shadow.row(sy);
+
+            isize x = start;
+            usize i = 0;
+            for (; x < min(end, middle); x++)
+                _mask[i++] = alpha[row[x]];
+
+            if (shadow.stretchX and x <= middle + tail) {
+                isize n = min(end, middle + tail + 1) - x;
+                Karm::fill(mutSub(_mask, i, i + n), alpha[row[middle]]);
+                i += n;
+                x += n;
+            }
+
+            for (; x < end; x++)
+                _mask[i++] = alpha[row[x - tail]];
+
+            auto *d = static_cast<u8 *>(mutPixels().pixelUnsafe({clipDest.x, clipDest.y + y}));
+            blendSpan<decltype(f)>(d, c, _mask.buf(), clipDest.width);
+        }
     });
 }
 
 /* --- Effects -------------------------------------------------------------- */
 
 void Context::apply(Filter filter) {
-    apply(filter, pixels().bound());
+    apply(std::move(filter), _targetBound());
 }
 
 void Context::apply(Filter filter, Math::Recti r) {
-    filter.apply(mutPixels().clip(applyAll(r)));
+    r = applyOrigin(r);
+    if (filter.is<BlurFilter>() and not clip().contains(r))
+        _blurClipped = true;
+
+    r = applyClip(r);
+    if (recording()) {
+        _record(DisplayList::Apply{std::move(filter), r}, r);
+        return;
+    }
+
+    filter.apply(mutPixels().clip(r));
 }
 
 } // namespace Karm::Gfx
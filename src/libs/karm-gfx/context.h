@@ -4,18 +4,38 @@
 
 #include "buffer.h"
 #include "filters.h"
+#include "glyphs.h"
 #include "paint.h"
 #include "path.h"
+#include "shadows.h"
 #include "shape.h"
 #include "style.h"
 
 namespace Karm::Gfx {
 
+struct DisplayList;
+
 enum struct FillRule {
     NONZERO,
     EVENODD,
 };
 
+enum struct Sampling {
+    // Pick the closest source pixel.
+    NEAREST,
+
+    // Interpolate between the 4 closest source pixels, smoother when scaling.
+    BILINEAR,
+};
+
+enum struct Antialiasing {
+    // Coverage is estimated by sampling 4 sub-scanlines per pixel row.
+    SUPERSAMPLE,
+
+    // Coverage is the exact signed area covered by the shape in each pixel.
+    ANALYTIC,
+};
+
 struct Context {
     struct Scope {
         Paint paint = Gfx::WHITE;
@@ -32,26 +52,87 @@ struct Context {
         }
     };
 
+    // An entry of the edge table, sorted by the top of the edge.
+    struct Edge {
+        Math::Edgef edge;
+        f64 top;
+        f64 bottom;
+        isize sign;
+    };
+
     struct Active {
         f64 x;
         isize sign;
+        usize edge;
+    };
+
+    // A path of the shape cache, moved by whole pixels into place.
+    struct _CachedPath {
+        ShapeCache::Key key;
+        Math::Vec2f offset;
+    };
+
+    // A glyph mask copied out of the glyph cache, so it's blended without
+    // holding the lock of the cache.
+    struct _GlyphMask {
+        // Where the mask is blended, already clipped.
+        Math::Recti dest;
+
+        // Offset of its rows in `_glyphMasks`, they are `dest.width` long.
+        usize offset;
     };
 
     Opt<MutPixels> _pixels{};
     Vec<Scope> _stack{};
     Shape _shape{};
     Path _path{};
+    Opt<_CachedPath> _cachedPath = NONE;
+    Vec<Edge> _edges{};
     Vec<Active> _active{};
     Vec<f64> _scanline;
+    Vec<f32> _accum;
+    Vec<u8> _mask;
+    Vec<u32> _span;
+    Vec<isize> _columns;
+    Vec<_GlyphMask> _placedGlyphs;
+    Vec<u8> _glyphMasks;
+    Antialiasing _antialiasing = Antialiasing::SUPERSAMPLE;
+
+    // Lists being recorded into, the last one is the innermost layer.
+    Vec<DisplayList *> _lists{};
+
+    // Set when a blur reached past the clip since begin(), what it drew then
+    // depends on how the drawing was split into clipped regions.
+    bool _blurClipped = false;
 
     /* --- Scope ------------------------------------------------------------ */
 
     // Begin drawing operations on the given pixels.
     void begin(MutPixels p);
 
+    // Begin recording drawing operations into the given list instead of
+    // drawing them, see DisplayList.
+    void begin(DisplayList &list);
+
     // End drawing operations.
     void end();
 
+    // Whether a blur was cut by the clip since begin().
+    bool blurClipped() const {
+        return _blurClipped;
+    }
+
+    // Whether drawing operations are recorded instead of drawn.
+    bool recording() const {
+        return _lists.len() > 0;
+    }
+
+    // (internal) Bound of the pixels or of the list being drawn on.
+    Math::Recti _targetBound() const;
+
+    // (internal) Append a command to the list being recorded.
+    void _record(auto op, Math::Recti bound);
+
     // Get the pixels being drawn on.
     MutPixels mutPixels();
 
@@ -80,11 +161,20 @@ struct Context {
     // A closure that receives a new Context as input.This context represents a
     // new transparency layer that you can draw into.When the closure returns,
     // karm-ui draws the new layer into the current context.
+    //
+    // Layers are premultiplied, blending into them never divides.
     void layer(Math::Vec2i offset, auto inner) {
+        if (recording()) {
+            _beginLayer(offset);
+            inner(*this);
+            _endLayer();
+            return;
+        }
+
         auto old = mutPixels();
         auto layer = Media::Image::alloc(
             pixels().size(),
-            pixels().fmt());
+            pixels().fmt().withPremultiplied());
 
         _pixels = layer.mutPixels();
         inner(*this);
@@ -92,6 +182,12 @@ struct Context {
         blit(offset - origin(), layer.pixels());
     }
 
+    // (internal) Record the following operations into a nested list, until
+    // the matching _endLayer().
+    void _beginLayer(Math::Vec2i offset);
+
+    void _endLayer();
+
     /* --- Origin & Clipping ------------------------------------------------ */
 
     // Get the current clipping rectangle.
@@ -156,6 +252,9 @@ struct Context {
     // Get the current shadow style.
     ShadowStyle const &shadowStyle();
 
+    // Get the antialiasing mode used by fills.
+    Antialiasing antialiasing() const;
+
     // Set the current fill style.
     Context &fillStyle(Paint style);
 
@@ -168,6 +267,9 @@ struct Context {
     // Set the current shadow style.
     Context &shadowStyle(ShadowStyle style);
 
+    // Set the antialiasing mode used by fills.
+    Context &antialiasing(Antialiasing mode);
+
     /* --- Drawing ---------------------------------------------------------- */
 
     // Clear all pixels with respect to the current origin and clip.
@@ -178,13 +280,32 @@ struct Context {
 
     /* --- Blitting --------------------------------------------------------- */
 
+    void _blitNearest(Math::Recti src, Math::Recti dest, Math::Recti clipDest, Pixels pixels, auto srcFmt, auto destFmt);
+    void _blitBilinear(Math::Recti src, Math::Recti dest, Math::Recti clipDest, Pixels pixels, auto srcFmt, auto destFmt);
+
+    // (internal) Blit `pixels`, or record the command returned by `blit`
+    // when recording.
+    void _blit(Math::Recti src, Math::Recti dest, Pixels pixels, Sampling sampling, auto blit);
+
     // Blit the given pixels to the current pixels
     // using the given source and destination rectangles.
-    void blit(Math::Recti src, Math::Recti dest, Pixels pixels);
+    //
+    // When recording, the pixels are copied into the list.
+    void blit(Math::Recti src, Math::Recti dest, Pixels pixels, Sampling sampling = Sampling::NEAREST);
 
     // Blit the given pixels to the current pixels.
     // The source rectangle is the entire piels.
-    void blit(Math::Recti dest, Pixels pixels);
+    void blit(Math::Recti dest, Pixels pixels, Sampling sampling = Sampling::NEAREST);
+
+    // Blit the given image to the current pixels
+    // using the given source and destination rectangles.
+    //
+    // When recording, the list holds a reference to the image.
+    void blit(Math::Recti src, Math::Recti dest, Media::Image const &image, Sampling sampling = Sampling::NEAREST);
+
+    // Blit the given image to the current pixels.
+    // The source rectangle is the entire image.
+    void blit(Math::Recti dest, Media::Image const &image, Sampling sampling = Sampling::NEAREST);
 
     // Blit the given pixels to the current pixels at the given position.
     void blit(Math::Vec2i dest, Pixels pixels);
@@ -221,6 +342,20 @@ struct Context {
     // Stroke a text rune
     void stroke(Math::Vec2i baseline, Rune rune);
 
+    // Fill a text rune by rasterizing its contour.
+    void _fillContour(Math::Vec2i baseline, Rune rune);
+
+    // Solid text without transformations is blended from the coverage masks
+    // of the glyph cache instead of being rasterized every time.
+    bool _useGlyphCache() const;
+
+    // Copy the mask of a cached glyph with its pen at the given position.
+    // Must be called with the lock of the cache held.
+    void _copyGlyph(GlyphCache const &cache, GlyphCache::Glyph const &glyph, Math::Vec2i pen);
+
+    // Blend the copied glyph masks, and forget them.
+    void _fillGlyphs(Color color);
+
     // Fill a text rune
     void fill(Math::Vec2i baseline, Rune rune);
 
@@ -256,7 +391,11 @@ struct Context {
 
     // (internal) Fill the current shape with the given paint.
     // NOTE: The shape must be flattened before calling this function.
+    void _buildEdgeTable();
+    void _composite(auto paint, auto format, Math::Rectf shapeBound, isize y, isize start, isize end);
     void _fillImpl(auto paint, auto format, FillRule fillRule);
+    void _accumulate(f64 x0, f64 x1, f32 d, isize start, isize end, isize &minX, isize &maxX);
+    void _fillAnalyticImpl(auto paint, auto format, FillRule fillRule);
     void _fill(Paint paint, FillRule rule = FillRule::NONZERO);
 
     // Begin a new path.
@@ -289,6 +428,35 @@ struct Context {
     // Evaluate the given SVG path and add it to the current path.
     bool evalSvg(Str path);
 
+    // Add an already flattened path to the current path, transformed by the
+    // current transform.
+    void path(Path const &path);
+
+    // Replace the current path with the one `build` draws around `pos`,
+    // taking it from the shape cache if it was already flattened with the
+    // same transform. `source` must describe everything `build` draws
+    // relative to `pos`, and `build` must not change the transform.
+    void path(ShapeCache::Source source, Math::Vec2f pos, auto build) {
+        if (auto pending = _beginCachedPath(source, pos)) {
+            build(*this);
+            _endCachedPath(*pending);
+        }
+    }
+
+    // (internal) Look the path up in the shape cache, returns NONE if it was
+    // found and the current path replaced by it.
+    Opt<_CachedPath> _beginCachedPath(ShapeCache::Source source, Math::Vec2f pos);
+
+    // (internal) Store the path built since _beginCachedPath().
+    void _endCachedPath(_CachedPath pending);
+
+    // (internal) Replace the current path by a path of the shape cache.
+    void _useCachedPath(Path const &path, _CachedPath cached);
+
+    // (internal) Add the edges the current path is filled or stroked with to
+    // the shape, if the path comes from the shape cache.
+    bool _cachedShape(Opt<StrokeStyle> const &style);
+
     // Add a line segment to the current path.
     void line(Math::Edgef line);
 
@@ -316,6 +484,20 @@ struct Context {
     // Draw a drop shadow for the current path with the given style.
     void shadow(ShadowStyle style);
 
+    // Draw a drop shadow for a rectangle, this replaces the current path.
+    void shadow(Math::Recti rect, BorderRadius radius = 0);
+
+    // Draw a drop shadow for a rectangle with the given style, this replaces
+    // the current path.
+    void shadow(Math::Recti rect, BorderRadius radius, ShadowStyle style);
+
+    // Solid shadows without transformations are composed from the masks of
+    // the shadow cache instead of being blurred every time.
+    bool _useShadowCache(ShadowStyle const &style) const;
+
+    // Blend a cached shadow mask stretched over the given rectangle.
+    void _fillShadow(ShadowCache::Shadow const &shadow, Math::Recti dest, Color color);
+
     /* --- Filters ---------------------------------------------------------- */
 
     // Apply the given filter to the current pixels.
@@ -0,0 +1,144 @@
+#include "display-list.h"
+
+namespace Karm::Gfx {
+
+void DisplayList::clear() {
+    _cmds.clear();
+    _cells.clear();
+    _index.clear();
+    _cols = 0;
+    _rows = 0;
+}
+
+void DisplayList::_record(Op op, Math::Recti clip, Math::Recti bound, Antialiasing antialiasing) {
+    bound = bound.clipTo(clip);
+    if (bound.width <= 0 or bound.height <= 0)
+        return;
+
+    _cmds.pushBack({
+        .op = std::move(op),
+        .clip = clip,
+        .bound = bound,
+        .antialiasing = antialiasing,
+    });
+}
+
+void DisplayList::_buildIndex() {
+    _cols = (_bound.width + CELL_SIZE - 1) / CELL_SIZE;
+    _rows = (_bound.height + CELL_SIZE - 1) / CELL_SIZE;
+    if (_cols <= 0 or _rows <= 0) {
+        _cols = _rows = 0;
+        return;
+    }
+
+    auto eachCell = [&](Math::Recti bound, auto f) {
+        bound = bound.clipTo(_bound);
+        if (bound.width <= 0 or bound.height <= 0)
+            return;
+
+        isize x0 = (bound.start() - _bound.x) / CELL_SIZE;
+        isize y0 = (bound.top() - _bound.y) / CELL_SIZE;
+        isize x1 = (bound.end() - _bound.x - 1) / CELL_SIZE;
+        isize y1 = (bound.bottom() - _bound.y - 1) / CELL_SIZE;
+
+        for (isize y = y0; y <= y1; y++)
+            for (isize x = x0; x <= x1; x++)
+                f(y * _cols + x);
+    };
+
+    // Count the commands of each cell, then place them one cell after the
+    // other, in recording order.
+    _cells.clear();
+    _cells.resize(_cols * _rows + 1, 0);
+    for (auto const &cmd : _cmds)
+        eachCell(cmd.bound, [&](usize cell) {
+            _cells[cell + 1]++;
+        });
+
+    for (usize i = 1; i < _cells.len(); i++)
+        _cells[i] += _cells[i - 1];
+
+    Vec<usize> next;
+    next.resize(_cols * _rows, 0);
+    for (usize i = 0; i + 1 < _cells.len(); i++)
+        next[i] = _cells[i];
+
+    _index.clear();
+    _index.resize(last(_cells), 0);
+    for (usize i = 0; i < _cmds.len(); i++)
+        eachCell(_cmds[i].bound, [&](usize cell) {
+            _index[next[cell]++] = i;
+        });
+}
+
+void DisplayList::replay(Context &g, Math::Recti rect) const {
+    auto antialiasing = g.antialiasing();
+
+    query(rect, [&](usize i) {
+        auto const &cmd = _cmds[i];
+
+        g.save();
+        g.clip(cmd.clip.clipTo(rect));
+        g.antialiasing(cmd.antialiasing);
+
+        cmd.op.visit(Visitor{
+            [&](Clear const &c) {
+                g.clear(c.rect, c.color);
+            },
+            [&](Blit const &b) {
+                g.blit(b.src, b.dest, b.image.pixels(), b.sampling);
+            },
+            [&](FillRect const &f) {
+                g._fillRect(f.rect, f.color);
+            },
+            [&](FillRune const &f) {
+                g.textFont(f.font);
+                g.fillStyle(f.color);
+                g.fill(f.baseline, f.rune);
+            },
+            [&](FillText const &f) {
+                g.textFont(f.font);
+                g.fillStyle(f.color);
+                g.fill(f.baseline, f.str);
+            },
+            [&](FillPath const &f) {
+                g.begin();
+                g.path(f.path);
+                g.fill(f.paint, f.rule);
+            },
+            [&](StrokePath const &s) {
+                g.begin();
+                g.path(s.path);
+                g.stroke(s.style);
+            },
+            [&](Shadow const &s) {
+                g.begin();
+                g.path(s.path);
+                g.shadow(s.style);
+            },
+            [&](BoxShadow const &s) {
+                g.shadow(s.rect, s.radius, s.style);
+            },
+            [&](Apply const &a) {
+                a.filter.apply(g.mutPixels().clip(g.applyAll(a.region)));
+            },
+            [&](Layer const &l) {
+                g.layer(l.offset, [&](Context &g) {
+                    l.list->replay(g, rect);
+                });
+            },
+            [&](Plot const &p) {
+                g.debugPlot(p.point, p.color);
+            },
+            [&](Line const &l) {
+                g.debugLine(l.edge, l.color);
+            },
+        });
+
+        g.restore();
+    });
+
+    g.antialiasing(antialiasing);
+}
+
+} // namespace Karm::Gfx
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <karm-base/rc.h>
+#include <karm-base/string.h>
+#include <karm-base/var.h>
+
+#include "context.h"
+
+namespace Karm::Gfx {
+
+// Drawing commands recorded by a context, with the region of the target they
+// may touch. Replaying the list into another context gives the same pixels as
+// drawing directly, and only the commands touching the repainted region are
+// replayed.
+//
+// Commands are recorded in the coordinates of the target, after the origin
+// and transform of the recording context were applied, they are replayed
+// relative to the origin of the replaying context.
+//
+// Blitted images are kept alive by the list, bare pixels are copied.
+struct DisplayList {
+    // Side of the cells of the spatial index, in pixels.
+    static constexpr isize CELL_SIZE = 64;
+
+    struct Clear {
+        Math::Recti rect;
+        Color color;
+    };
+
+    struct Blit {
+        Math::Recti src;
+        Math::Recti dest;
+        Media::Image image;
+        Sampling sampling;
+    };
+
+    struct FillRect {
+        Math::Recti rect;
+        Color color;
+    };
+
+    struct FillRune {
+        Math::Vec2i baseline;
+        Rune rune;
+        Media::Font font;
+        Color color;
+    };
+
+    struct FillText {
+        Math::Vec2i baseline;
+        String str;
+        Media::Font font;
+        Color color;
+    };
+
+    struct FillPath {
+        Path path;
+        Paint paint;
+        FillRule rule;
+    };
+
+    struct StrokePath {
+        Path path;
+        StrokeStyle style;
+    };
+
+    struct Shadow {
+        Path path;
+        ShadowStyle style;
+    };
+
+    struct BoxShadow {
+        Math::Recti rect;
+        BorderRadius radius;
+        ShadowStyle style;
+    };
+
+    struct Apply {
+        Filter filter;
+        Math::Recti region;
+    };
+
+    struct Layer {
+        Math::Vec2i offset;
+        Strong<DisplayList> list;
+    };
+
+    struct Plot {
+        Math::Vec2i point;
+        Color color;
+    };
+
+    struct Line {
+        Math::Edgei edge;
+        Color color;
+    };
+
+    using Op = Var<
+        Clear,
+        Blit,
+        FillRect,
+        FillRune,
+        FillText,
+        FillPath,
+        StrokePath,
+        Shadow,
+        BoxShadow,
+        Apply,
+        Layer,
+        Plot,
+        Line>;
+
+    struct Command {
+        Op op;
+
+        // Clipping rectangle of the recording context.
+        Math::Recti clip;
+
+        // Region of the target touched by the command, within the clip.
+        Math::Recti bound;
+
+        Antialiasing antialiasing;
+    };
+
+    Math::Recti _bound;
+    Vec<Command> _cmds;
+
+    // Commands touching each cell of the spatial index, stored one cell
+    // after the other, `_cells[i]` is where the commands of cell i start.
+    Vec<usize> _cells;
+    Vec<u32> _index;
+    isize _cols = 0;
+    isize _rows = 0;
+
+    DisplayList(Math::Recti bound = {})
+        : _bound(bound) {}
+
+    // Region of the target the list was recorded for.
+    Math::Recti bound() const {
+        return _bound;
+    }
+
+    usize len() const {
+        return _cmds.len();
+    }
+
+    bool empty() const {
+        return _cmds.len() == 0;
+    }
+
+    void clear();
+
+    // (internal) Append a command, commands outside the clip are dropped.
+    void _record(Op op, Math::Recti clip, Math::Recti bound, Antialiasing antialiasing);
+
+    // (internal) Build the spatial index, called by the context once the
+    // recording ended.
+    void _buildIndex();
+
+    // Call `f` with the index of every command that might touch the given
+    // rectangle, in recording order.
+    void query(Math::Recti rect, auto f) const {
+        rect = rect.clipTo(_bound);
+        if (rect.width <= 0 or rect.height <= 0 or _cols == 0)
+            return;
+
+        isize x0 = (rect.start() - _bound.x) / CELL_SIZE;
+        isize y0 = (rect.top() - _bound.y) / CELL_SIZE;
+        isize x1 = (rect.end() - _bound.x - 1) / CELL_SIZE;
+        isize y1 = (rect.bottom() - _bound.y - 1) / CELL_SIZE;
+
+        // Cells are already sorted, a single one can be walked directly.
+        if (x0 == x1 and y0 == y1) {
+            usize cell = y0 * _cols + x0;
+            for (usize i = _cells[cell]; i < _cells[cell + 1]; i++) {
+                if (_cmds[_index[i]].bound.colide(rect))
+                    f(_index[i]);
+            }
+            return;
+        }
+
+        Vec<u32> found;
+        for (isize y = y0; y <= y1; y++) {
+            for (isize x = x0; x <= x1; x++) {
+                usize cell = y * _cols + x;
+                for (usize i = _cells[cell]; i < _cells[cell + 1]; i++)
+                    found.pushBack(_index[i]);
+            }
+        }
+
+        sort(found, [](u32 a, u32 b) {
+            return cmp(a, b);
+        });
+
+        for (usize i = 0; i < found.len(); i++) {
+            if (i > 0 and found[i] == found[i - 1])
+                continue;
+            if (_cmds[found[i]].bound.colide(rect))
+                f(found[i]);
+        }
+    }
+
+    // Replay the commands touching `rect` into the given context, clipped to
+    // `rect`. Several contexts may replay the same list at once, as long as
+    // nothing draws into the images it blits meanwhile.
+    void replay(Context &g, Math::Recti rect) const;
+
+    // Replay every command into the given context.
+    void replay(Context &g) const {
+        replay(g, _bound);
+    }
+};
+
+} // namespace Karm::Gfx
@@ -1,179 +1,399 @@
-#include <karm-base/ring.h>
 #include <karm-math/rand.h>
+#include <karm-sys/thread.h>
 
 #include "filters.h"
 
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
 namespace Karm::Gfx {
 
-struct StackBlur {
-    isize _radius;
-    Ring<Math::Vec4u> _queue;
-    Math::Vec4u _sum;
+// Images are split in bands of at least this many rows when processed by a
+// thread pool, smaller ones stay on the calling thread.
+static constexpr isize MIN_BAND = 32;
 
-    StackBlur(isize radius)
-        : _radius(radius), _queue(width()) {
-        clear();
-    }
+static isize _bands(MutPixels p, Sys::ThreadPool &pool) {
+    return min((isize)pool.concurrency() * 2, p.height() / MIN_BAND);
+}
 
-    Math::Vec4u outgoingSum() const {
-        Math::Vec4u sum = {};
-        for (isize i = 0; i < _radius; i++) {
-            sum = sum + _queue.peek(i);
-        }
-        return sum;
+static void _inBands(MutPixels p, Sys::ThreadPool &pool, auto fn) {
+    isize bands = _bands(p, pool);
+    if (bands <= 1) {
+        fn(p, 0);
+        return;
     }
 
-    Math::Vec4u incomingSum() const {
-        Math::Vec4u sum = {};
-        for (isize i = 0; i < _radius; i++) {
-            sum = sum + _queue.peek(width() - i - 1);
-        }
-        return sum;
+    pool.parallelFor(bands, [&](usize i) {
+        isize y0 = p.height() * i / bands;
+        isize y1 = p.height() * (i + 1) / bands;
+        fn(p.clip({0, y0, p.width(), y1 - y0}), y0);
+    });
+}
+
+/* --- Lanes ---------------------------------------------------------------- */
+
+// The 4 channels of a pixel widened to 32 bits, in the order they are
+// stored.
+
+#if defined(__SSE2__)
+
+struct _Lanes {
+    __m128i v;
+
+    ALWAYS_INLINE static _Lanes unpack(u32 pixel) {
+        auto zero = _mm_setzero_si128();
+        auto x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+        return {_mm_unpacklo_epi16(x, zero)};
     }
 
-    isize width() const {
-        return _radius * 2 + 1;
+    // Scale by `f` and narrow back to 8 bits, rounding to the nearest.
+    ALWAYS_INLINE u32 pack(f32 f) const {
+        auto x = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(f)));
+        x = _mm_packs_epi32(x, x);
+        return _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
     }
 
-    isize denominator() const {
-        return _radius * (_radius + 2) - 1;
+    ALWAYS_INLINE _Lanes operator+(_Lanes o) const { return {_mm_add_epi32(v, o.v)}; }
+
+    ALWAYS_INLINE _Lanes operator-(_Lanes o) const { return {_mm_sub_epi32(v, o.v)}; }
+};
+
+#else
+
+struct _Lanes {
+    Array<u32, 4> v;
+
+    ALWAYS_INLINE static _Lanes unpack(u32 pixel) {
+        return {{pixel & 0xff, (pixel >> 8) & 0xff, (pixel >> 16) & 0xff, pixel >> 24}};
     }
 
-    void enqueue(Math::Vec4u color) {
-        _queue.pushBack(color);
-        _sum = _sum + incomingSum() - outgoingSum();
+    ALWAYS_INLINE u32 pack(f32 f) const {
+        u32 pixel = 0;
+        for (usize i = 0; i < 4; i++)
+            pixel |= min((u32)(v[i] * f + 0.5f), 255u) << (i * 8);
+        return pixel;
     }
 
-    Math::Vec4u dequeue() {
-        auto res = _sum / denominator();
-        _queue.dequeue();
-        return res;
+    ALWAYS_INLINE _Lanes operator+(_Lanes o) const {
+        return {{v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3]}};
     }
 
-    void clear() {
-        _sum = {};
-        _queue.clear();
-        for (isize i = 0; i < width(); i++) {
-            _queue.pushBack({});
-        }
+    ALWAYS_INLINE _Lanes operator-(_Lanes o) const {
+        return {{v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3]}};
     }
 };
 
-[[gnu::flatten]] void BlurFilter::apply(MutPixels p) const {
-    if (amount == 0) {
-        return;
+#endif
+
+/* --- Blur ----------------------------------------------------------------- */
+
+// Stack blur of a line, each output is the mean of its neighbors weighted
+// by how close they are (a tent of the given radius), which is a good
+// approximation of a gaussian. The sums are kept up to date as the window
+// slides, so the cost per pixel doesn't depend on the radius.
+//
+// `in` holds the line with `radius` pixels of padding on the left and
+// `radius + 1` on the right.
+static void _blurLine(u32 const *in, u32 *out, isize stride, isize len, isize radius) {
+    auto at = [&](isize i) {
+        return _Lanes::unpack(in[i + radius]);
+    };
+
+    _Lanes sum{}, sumIn{}, sumOut{};
+    // Pixels closer to the center are added to the sums earlier, and so
+    // counted more times.
+    for (isize i = 0; i >= -radius; i--) {
+        sumOut = sumOut + at(i);
+        sum = sum + sumOut;
+    }
+    for (isize i = 1; i <= radius; i++) {
+        sumIn = sumIn + at(i);
+        sum = sum + sumIn;
     }
 
-    StackBlur stack{amount};
-    auto b = p.bound();
+    f32 scale = 1.0f / ((radius + 1) * (radius + 1));
+    for (isize x = 0; x < len; x++) {
+        out[x * stride] = sum.pack(scale);
 
-    for (isize y = b.top(); y < b.bottom(); y++) {
-        for (isize i = 0; i < stack.width(); i++) {
-            auto x = b.start() + i - amount;
-            stack.dequeue();
-            stack.enqueue(p.load({x, y}));
-        }
+        sum = sum - sumOut;
+        sumOut = sumOut - at(x - radius);
+        sumIn = sumIn + at(x + radius + 1);
+        sum = sum + sumIn;
 
-        for (isize x = b.start(); x < b.end(); x++) {
-            p.store({x, y}, stack.dequeue());
-            stack.enqueue(p.load({x + amount + 1, y}));
-        }
+        auto mid = at(x + 1);
+        sumOut = sumOut + mid;
+        sumIn = sumIn - mid;
+    }
+}
 
-        stack.clear();
+// Every channel is blurred the same way, so pixels are blurred as they are
+// stored, premultiplied ones without converting them back and forth.
+//
+// Each line is copied before being blurred, `dst` can be `src`.
+static void _blurRows(Pixels src, MutPixels dst, isize radius) {
+    Vec<u32> line;
+    line.resize(src.width() + radius * 2 + 1);
+
+    for (isize y = 0; y < dst.height(); y++) {
+        auto const *row = static_cast<u32 const *>(src.scanline(y));
+        for (isize i = 0; i < (isize)line.len(); i++)
+            line[i] = row[clamp(i - radius, 0, src.width() - 1)];
+        _blurLine(line.buf(), static_cast<u32 *>(dst.scanline(y)), 1, dst.width(), radius);
     }
+}
 
-    for (isize x = b.start(); x < b.end(); x++) {
-        for (isize i = 0; i < stack.width(); i++) {
-            isize const y = b.top() + i - amount;
-            stack.dequeue();
-            stack.enqueue(p.load({x, y}));
-        }
+// Blur the columns of `dst`, a band of `src` starting at row `top`, the
+// rows around the band are read from `src`.
+static void _blurColumns(Pixels src, MutPixels dst, isize top, isize radius) {
+    Vec<u32> line;
+    line.resize(dst.height() + radius * 2 + 1);
+    isize srcStride = src.stride() / sizeof(u32);
+    isize dstStride = dst.stride() / sizeof(u32);
+
+    for (isize x = 0; x < dst.width(); x++) {
+        auto const *col = static_cast<u32 const *>(src.pixelUnsafe({x, 0}));
+        for (isize i = 0; i < (isize)line.len(); i++)
+            line[i] = col[clamp(top + i - radius, 0, src.height() - 1) * srcStride];
+        _blurLine(line.buf(), static_cast<u32 *>(dst.pixelUnsafe({x, 0})), dstStride, dst.height(), radius);
+    }
+}
 
-        for (isize y = b.top(); y < b.bottom(); y++) {
-            p.store({x, y}, stack.dequeue());
-            stack.enqueue(p.load({x, y + amount + 1}));
-        }
+void BlurFilter::apply(MutPixels p) const {
+    if (amount <= 0 or p.width() <= 0 or p.height() <= 0)
+        return;
 
-        stack.clear();
-    }
+    _blurRows(p, p, amount);
+    _blurColumns(p, p, 0, amount);
 }
 
-void SaturationFilter::apply(MutPixels p) const {
-    auto b = p.bound();
+void BlurFilter::apply(MutPixels p, Sys::ThreadPool &pool) const {
+    if (amount <= 0 or p.width() <= 0 or p.height() <= 0)
+        return;
 
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
+    if (_bands(p, pool) <= 1) {
+        apply(p);
+        return;
+    }
 
-            // weights from CCIR 601 spec
-            // https://stackoverflow.com/questions/13806483/increase-or-decrease-color-saturation
-            auto gray = 0.2989 * color.red + 0.5870 * color.green + 0.1140 * color.blue;
+    // Rows are blurred into a copy, so the columns of each band can read
+    // the `amount` rows above and below it while the other bands are
+    // written.
+    Vec<u32> buf;
+    buf.resize(p.width() * p.height());
+    MutPixels rows{buf.buf(), p.size(), p.width() * sizeof(u32), p.fmt()};
 
-            u8 red = min(gray * amount + color.red * (1 - amount), 255);
-            u8 green = min(gray * amount + color.green * (1 - amount), 255);
-            u8 blue = min(gray * amount + color.blue * (1 - amount), 255);
+    _inBands(p, pool, [&](MutPixels band, isize y) {
+        _blurRows(band, rows.clip({0, y, p.width(), band.height()}), amount);
+    });
+
+    _inBands(p, pool, [&](MutPixels band, isize y) {
+        _blurColumns(rows, band, y, amount);
+    });
+}
 
-            color = Color::fromRgba(red, green, blue, color.alpha);
+/* --- Color Matrix --------------------------------------------------------- */
 
-            p.store({b.x + x, b.y + y}, color);
+ColorMatrix ColorMatrix::then(ColorMatrix const &other) const {
+    ColorMatrix res;
+    for (usize i = 0; i < 4; i++) {
+        for (usize j = 0; j < 5; j++) {
+            f32 v = j == 4 ? other.at(i, 4) : 0;
+            for (usize k = 0; k < 4; k++)
+                v += other.at(i, k) * at(k, j);
+            res.m[i * 5 + j] = v;
         }
     }
+    return res;
 }
 
-void GrayscaleFilter::apply(MutPixels p) const {
-    auto b = p.bound();
+ColorMatrix ColorMatrix::reorder(Array<usize, 4> order) const {
+    ColorMatrix res;
+    for (usize i = 0; i < 4; i++) {
+        for (usize j = 0; j < 4; j++)
+            res.m[i * 5 + j] = at(order[i], order[j]);
+        res.m[i * 5 + 4] = at(order[i], 4);
+    }
+    return res;
+}
 
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
+bool ColorMatrix::keepsPremultiplied() const {
+    for (usize i = 0; i < 3; i++)
+        if (at(i, 3) != 0 or at(3, i) != 0)
+            return false;
+    return at(3, 4) == 0;
+}
 
-            // weights from CCIR 601 spec
-            // https://stackoverflow.com/questions/13806483/increase-or-decrease-color-saturation
-            f64 gray = 0.2989 * color.red + 0.5870 * color.green + 0.1140 * color.blue;
-            color = Color::fromRgba(gray, gray, gray, color.alpha);
-            p.store({b.x + x, b.y + y}, color);
-        }
+// With premultiplied channels c * a, the color rows are scaled by the alpha
+// factor and their offset becomes a multiple of the alpha.
+static ColorMatrix _premultiplied(ColorMatrix const &m) {
+    auto res = m;
+    f32 k = m.at(3, 3);
+    for (usize i = 0; i < 3; i++) {
+        for (usize j = 0; j < 3; j++)
+            res.m[i * 5 + j] = k * m.at(i, j);
+        res.m[i * 5 + 3] = k * m.at(i, 4) / 255;
+        res.m[i * 5 + 4] = 0;
     }
+    return res;
 }
 
-void ContrastFilter::apply(MutPixels p) const {
-    auto b = p.bound();
+Color ColorMatrix::apply(Color c) const {
+    f32 in[4] = {(f32)c.red, (f32)c.green, (f32)c.blue, (f32)c.alpha};
+    u8 out[4];
+    for (usize i = 0; i < 4; i++) {
+        f32 v = at(i, 4);
+        for (usize j = 0; j < 4; j++)
+            v += at(i, j) * in[j];
+        out[i] = clamp(v + 0.5f, 0.0f, 255.0f);
+    }
+    return Color::fromRgba(out[0], out[1], out[2], out[3]);
+}
 
-    f64 const factor = (259 * ((amount * 255) + 255)) / (255 * (259 - (amount * 255)));
+// Apply the matrix to the pixels as they are stored. Premultiplied channels
+// are kept within the alpha.
+template <bool PREMULTIPLIED>
+static void _transform(MutPixels p, ColorMatrix const &m) {
+#if defined(__SSE2__)
+    __m128 cols[5];
+    for (usize j = 0; j < 5; j++)
+        cols[j] = _mm_setr_ps(m.at(0, j), m.at(1, j), m.at(2, j), m.at(3, j));
+
+    auto const zero = _mm_setzero_ps();
+    auto const max = _mm_set1_ps(255);
+
+    for (isize y = 0; y < p.height(); y++) {
+        auto *row = static_cast<u32 *>(p.scanline(y));
+        for (isize x = 0; x < p.width(); x++) {
+            if (PREMULTIPLIED and row[x] == 0)
+                continue;
+
+            auto c = _mm_cvtepi32_ps(_Lanes::unpack(row[x]).v);
+            auto v = _mm_add_ps(cols[4], _mm_mul_ps(cols[0], _mm_shuffle_ps(c, c, 0x00)));
+            v = _mm_add_ps(v, _mm_mul_ps(cols[1], _mm_shuffle_ps(c, c, 0x55)));
+            v = _mm_add_ps(v, _mm_mul_ps(cols[2], _mm_shuffle_ps(c, c, 0xaa)));
+            v = _mm_add_ps(v, _mm_mul_ps(cols[3], _mm_shuffle_ps(c, c, 0xff)));
+            v = _mm_min_ps(_mm_max_ps(v, zero), max);
+            if (PREMULTIPLIED)
+                v = _mm_min_ps(v, _mm_shuffle_ps(v, v, 0xff));
+
+            auto i = _mm_cvtps_epi32(v);
+            i = _mm_packs_epi32(i, i);
+            row[x] = _mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+        }
+    }
+#else
+    for (isize y = 0; y < p.height(); y++) {
+        auto *row = static_cast<u32 *>(p.scanline(y));
+        for (isize x = 0; x < p.width(); x++) {
+            if (PREMULTIPLIED and row[x] == 0)
+                continue;
+
+            auto c = _Lanes::unpack(row[x]);
+            f32 v[4];
+            for (usize i = 0; i < 4; i++) {
+                v[i] = m.at(i, 4);
+                for (usize j = 0; j < 4; j++)
+                    v[i] += m.at(i, j) * c.v[j];
+                v[i] = clamp(v[i], 0.0f, 255.0f);
+            }
+
+            u32 pixel = 0;
+            for (usize i = 0; i < 4; i++) {
+                if (PREMULTIPLIED)
+                    v[i] = min(v[i], v[3]);
+                pixel |= (u32)(v[i] + 0.5f) << (i * 8);
+            }
+            row[x] = pixel;
+        }
+    }
+#endif
+}
 
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
+void ColorMatrix::apply(MutPixels p) const {
+    p.fmt().visit([&](auto f) {
+        using F = decltype(f);
+
+        // Matrices are built for RGBA, reordered to match the bytes.
+        Array<usize, 4> order = {0, 1, 2, 3};
+        if constexpr (Meta::Same<typename F::Order, Bgra8888>)
+            order = {2, 1, 0, 3};
+
+        if constexpr (not F::PREMULTIPLIED) {
+            _transform<false>(p, reorder(order));
+        } else if (keepsPremultiplied()) {
+            _transform<true>(p, _premultiplied(*this).reorder(order));
+        } else {
+            for (isize y = 0; y < p.height(); y++) {
+                for (isize x = 0; x < p.width(); x++) {
+                    auto *px = p.pixelUnsafe({x, y});
+                    f.store(px, apply(f.load(px)));
+                }
+            }
+        }
+    });
+}
 
-            color = Color::fromRgba(
-                clamp(factor * (color.red - 128) + 128, 0, 255),
-                clamp(factor * (color.green - 128) + 128, 0, 255),
-                clamp(factor * (color.blue - 128) + 128, 0, 255),
-                color.alpha);
+/* --- Color Filters -------------------------------------------------------- */
+
+// weights from CCIR 601 spec
+// https://stackoverflow.com/questions/13806483/increase-or-decrease-color-saturation
+static constexpr f32 LUMA_R = 0.2989;
+static constexpr f32 LUMA_G = 0.5870;
+static constexpr f32 LUMA_B = 0.1140;
+
+ColorMatrix SaturationFilter::matrix() const {
+    f32 a = amount;
+    f32 k = 1 - a;
+    return {{
+        LUMA_R * a + k, LUMA_G * a, LUMA_B * a, 0, 0,
+        LUMA_R * a, LUMA_G * a + k, LUMA_B * a, 0, 0,
+        LUMA_R * a, LUMA_G * a, LUMA_B * a + k, 0, 0,
+        0, 0, 0, 1, 0,
+    }};
+}
 
-            p.store({b.x + x, b.y + y}, color);
-        }
-    }
+ColorMatrix GrayscaleFilter::matrix() const {
+    return SaturationFilter{1}.matrix();
 }
 
-void BrightnessFilter::apply(MutPixels p) const {
-    auto b = p.bound();
+ColorMatrix ContrastFilter::matrix() const {
+    f32 factor = (259 * ((amount * 255) + 255)) / (255 * (259 - (amount * 255)));
+    f32 offset = 128 * (1 - factor);
+    return {{
+        factor, 0, 0, 0, offset,
+        0, factor, 0, 0, offset,
+        0, 0, factor, 0, offset,
+        0, 0, 0, 1, 0,
+    }};
+}
 
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
+ColorMatrix BrightnessFilter::matrix() const {
+    return ColorMatrix::diagonal(amount, amount, amount);
+}
 
-            color = Color::fromRgba(
-                min(color.red * amount, 255),
-                min(color.green * amount, 255),
-                min(color.blue * amount, 255),
-                color.alpha);
+ColorMatrix SepiaFilter::matrix() const {
+    f32 a = amount;
+    f32 k = 1 - a;
+    return {{
+        0.393f * a + k, 0.769f * a, 0.189f * a, 0, 0,
+        0.349f * a, 0.686f * a + k, 0.168f * a, 0, 0,
+        0.272f * a, 0.534f * a, 0.131f * a + k, 0, 0,
+        0, 0, 0, 1, 0,
+    }};
+}
 
-            p.store({b.x + x, b.y + y}, color);
-        }
-    }
+ColorMatrix TintFilter::matrix() const {
+    return ColorMatrix::diagonal(
+        amount.red / 255.0f,
+        amount.green / 255.0f,
+        amount.blue / 255.0f,
+        amount.alpha / 255.0f
+    );
 }
 
+/* --- Other Filters -------------------------------------------------------- */
+
 void NoiseFilter::apply(MutPixels p) const {
     Math::Rand rand{0x12341234};
     u8 alpha = 255 * amount;
@@ -190,57 +410,71 @@ void NoiseFilter::apply(MutPixels p) const {
     }
 }
 
-void SepiaFilter::apply(MutPixels p) const {
+void OverlayFilter::apply(MutPixels p) const {
     auto b = p.bound();
 
     for (isize y = 0; y < b.height; y++) {
         for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
-
-            auto sepiaColor = Color::fromRgba(
-                min((color.red * 0.393) + (color.green * 0.769) + (color.blue * 0.189), 255u),
-                min((color.red * 0.349) + (color.green * 0.686) + (color.blue * 0.168), 255u),
-                min((color.red * 0.272) + (color.green * 0.534) + (color.blue * 0.131), 255u),
-                color.alpha);
-
-            p.store({b.x + x, b.y + y}, color.lerpWith(sepiaColor, amount));
+            p.blend(
+                {b.x + x, b.y + y},
+                amount);
         }
     }
 }
 
-void TintFilter::apply(MutPixels p) const {
-    auto b = p.bound();
-
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            auto color = p.load({b.x + x, b.y + y});
-
-            auto tintColor = Color::fromRgba(
-                (color.red * amount.red) / 255,
-                (color.green * amount.green) / 255,
-                (color.blue * amount.blue) / 255,
-                (color.alpha * amount.alpha) / 255);
-
-            p.store({b.x + x, b.y + y}, tintColor);
-        }
-    }
+/* --- Filter --------------------------------------------------------------- */
+
+void Filter::apply(MutPixels p, Sys::ThreadPool &pool) const {
+    visit(Visitor{
+        [&](BlurFilter const &blur) {
+            blur.apply(p, pool);
+        },
+        // The noise would repeat from one band to the next.
+        [&](NoiseFilter const &noise) {
+            noise.apply(p);
+        },
+        [&](auto const &filter) {
+            _inBands(p, pool, [&](MutPixels band, isize) {
+                filter.apply(band);
+            });
+        },
+    });
 }
 
-void OverlayFilter::apply(MutPixels p) const {
-    auto b = p.bound();
-
-    for (isize y = 0; y < b.height; y++) {
-        for (isize x = 0; x < b.width; x++) {
-            p.blend(
-                {b.x + x, b.y + y},
-                amount);
+// Call `fn` with each filter of the chain, consecutive color filters are
+// passed as a single matrix.
+static void _fuse(Slice<Filter> filters, auto fn) {
+    Opt<ColorMatrix> fused;
+    for (auto const &filter : filters) {
+        if (auto m = filter.matrix()) {
+            fused = fused ? fused->then(*m) : *m;
+            continue;
         }
+
+        if (fused)
+            fn(fused.take());
+        fn(filter);
     }
+
+    if (fused)
+        fn(fused.take());
 }
 
 void FilterChain::apply(MutPixels p) const {
-    filters.visit([&](auto &f) {
-        f->apply(p);
+    _fuse(filters, [&](auto const &filter) {
+        filter.apply(p);
+    });
+}
+
+void FilterChain::apply(MutPixels p, Sys::ThreadPool &pool) const {
+    _fuse(filters, [&](auto const &filter) {
+        if constexpr (Meta::Same<Meta::RemoveConstVolatileRef<decltype(filter)>, ColorMatrix>) {
+            _inBands(p, pool, [&](MutPixels band, isize) {
+                filter.apply(band);
+            });
+        } else {
+            filter.apply(p, pool);
+        }
     });
 }
 
@@ -1,17 +1,70 @@
 #pragma once
 
-#include <karm-base/box.h>
+#include <karm-base/array.h>
+#include <karm-base/opt.h>
 #include <karm-base/range.h>
 #include <karm-base/vec.h>
 
 #include "buffer.h"
 #include "color.h"
 
+namespace Karm::Sys {
+
+struct ThreadPool;
+
+} // namespace Karm::Sys
+
 namespace Karm::Gfx {
 
+/* --- Color Matrix --------------------------------------------------------- */
+
+// A 4x5 row major matrix applied to straight RGBA colors, with channels in
+// [0, 255]. The last column is added as is. Consecutive color filters are
+// composed into a single matrix and applied in one pass.
+struct ColorMatrix {
+    Array<f32, 20> m = {
+        1, 0, 0, 0, 0,
+        0, 1, 0, 0, 0,
+        0, 0, 1, 0, 0,
+        0, 0, 0, 1, 0,
+    };
+
+    static ColorMatrix diagonal(f32 r, f32 g, f32 b, f32 a = 1) {
+        return {{
+            r, 0, 0, 0, 0,
+            0, g, 0, 0, 0,
+            0, 0, b, 0, 0,
+            0, 0, 0, a, 0,
+        }};
+    }
+
+    f32 at(usize row, usize col) const {
+        return m[row * 5 + col];
+    }
+
+    // The matrix applying this one, then `other`.
+    ColorMatrix then(ColorMatrix const &other) const;
+
+    // The same matrix for channels stored in a different order, `order[i]`
+    // is the channel stored at index i.
+    ColorMatrix reorder(Array<usize, 4> order) const;
+
+    // Whether the color channels don't depend on the alpha and the alpha is
+    // only scaled, the matrix can then be applied to premultiplied colors.
+    bool keepsPremultiplied() const;
+
+    Color apply(Color c) const;
+
+    void apply(MutPixels p) const;
+};
+
+/* --- Filters -------------------------------------------------------------- */
+
 struct Unfiltered {
     static constexpr auto NAME = "unfiltered";
 
+    ColorMatrix matrix() const { return {}; }
+
     void apply(MutPixels) const {}
 };
 
@@ -22,6 +75,10 @@ struct BlurFilter {
 
     isize amount = DEFAULT;
     void apply(MutPixels) const;
+
+    // Blur in bands of rows processed by the workers of the pool, the
+    // columns of each band are blurred with `amount` rows of margin.
+    void apply(MutPixels, Sys::ThreadPool &) const;
 };
 
 struct SaturationFilter {
@@ -30,12 +87,18 @@ struct SaturationFilter {
     static constexpr f64 DEFAULT = 1;
 
     f64 amount = DEFAULT;
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct GrayscaleFilter {
     static constexpr auto NAME = "grayscale";
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct ContrastFilter {
@@ -44,7 +107,10 @@ struct ContrastFilter {
     static constexpr f64 DEFAULT = 0;
 
     f64 amount = DEFAULT;
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct BrightnessFilter {
@@ -53,7 +119,10 @@ struct BrightnessFilter {
     static constexpr f64 DEFAULT = 1;
 
     f64 amount = DEFAULT;
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct NoiseFilter {
@@ -71,7 +140,10 @@ struct SepiaFilter {
     static constexpr f64 DEFAULT = 0.5;
 
     f64 amount = DEFAULT;
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct TintFilter {
@@ -79,7 +151,10 @@ struct TintFilter {
     static constexpr Color DEFAULT = Color::fromHex(0xffffff);
 
     Color amount = DEFAULT;
-    void apply(MutPixels) const;
+
+    ColorMatrix matrix() const;
+
+    void apply(MutPixels p) const { matrix().apply(p); }
 };
 
 struct OverlayFilter {
@@ -90,15 +165,6 @@ struct OverlayFilter {
     void apply(MutPixels) const;
 };
 
-struct Filter;
-
-struct FilterChain {
-    static constexpr auto NAME = "chain";
-
-    Cons<Box<Filter>> filters;
-    void apply(MutPixels) const;
-};
-
 using _Filters = Var<
     Unfiltered,
     BlurFilter,
@@ -113,11 +179,38 @@ using _Filters = Var<
 
 struct Filter : public _Filters {
     using _Filters::_Filters;
+
+    // The matrix of the filter, if it only transforms colors.
+    Opt<ColorMatrix> matrix() const {
+        return visit([&](auto const &filter) -> Opt<ColorMatrix> {
+            if constexpr (requires { filter.matrix(); })
+                return filter.matrix();
+            else
+                return NONE;
+        });
+    }
+
     void apply(MutPixels s) const {
         visit([&](auto const &filter) {
             filter.apply(s);
         });
     }
+
+    // Apply the filter to large images in bands processed by the workers
+    // of the pool.
+    void apply(MutPixels s, Sys::ThreadPool &pool) const;
+};
+
+// Filters applied one after the other. Consecutive color filters are fused
+// into a single pass.
+struct FilterChain {
+    static constexpr auto NAME = "chain";
+
+    Vec<Filter> filters;
+
+    void apply(MutPixels) const;
+
+    void apply(MutPixels, Sys::ThreadPool &) const;
 };
 
 } // namespace Karm::Gfx
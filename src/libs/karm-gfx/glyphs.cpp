@@ -0,0 +1,281 @@
+#include <karm-base/align.h>
+#include <karm-math/funcs.h>
+#include <karm-media/image.h>
+
+#include "colors.h"
+#include "context.h"
+#include "glyphs.h"
+
+namespace Karm::Gfx {
+
+static usize _hash(GlyphCache::Key const &key) {
+    u64 h = key.face * 0x9e3779b97f4a7c15;
+    h = (h ^ static_cast<u64>(key.size * 64)) * 0xff51afd7ed558ccd;
+    h = (h ^ key.rune) * 0xc4ceb9fe1a85ec53;
+    h = (h ^ static_cast<u64>(key.subpixel)) * 0x9e3779b97f4a7c15;
+    return h ^ (h >> 32);
+}
+
+void GlyphCache::clear() {
+    _shelves.clear();
+    _glyphs.clear();
+    _free.clear();
+    _index.clear();
+    _faces.truncate(0);
+    _blanks = 0;
+}
+
+Opt<GlyphCache::Glyph> GlyphCache::get(Media::Font const &font, Rune rune, isize subpixel) {
+    Key key{
+        .face = _faceId(font.fontface),
+        .size = font.fontsize,
+        .rune = rune,
+        .subpixel = subpixel,
+    };
+
+    if (auto slot = _lookup(key)) {
+        _hits++;
+        auto const &glyph = *_glyphs[*slot];
+        if (glyph.shelf)
+            _shelves[*glyph.shelf].tick = _touch();
+        return glyph;
+    }
+
+    _misses++;
+    return _rasterize(font, key);
+}
+
+usize GlyphCache::_faceId(Strong<Media::Fontface> const &face) {
+    for (auto &f : _faces) {
+        if (&*f.face == &*face) {
+            f.tick = _touch();
+            return f.id;
+        }
+    }
+
+    // Glyphs of a forgotten face would never be looked up again.
+    if (_faces.len() >= MAX_FACES) {
+        auto oldest = *_oldest(_faces);
+        usize id = _faces[oldest].id;
+        _faces.removeAt(oldest);
+        _drop([&](Glyph const &glyph) {
+            return glyph.key.face == id;
+        });
+    }
+
+    _faces.pushBack({face, _nextFace, _touch()});
+    return _nextFace++;
+}
+
+/* --- Index ---------------------------------------------------------------- */
+
+// The index is an open addressing table of glyph slots plus one, zero
+// meaning the entry is empty. It is kept at most half full.
+
+Opt<usize> GlyphCache::_lookup(Key const &key) const {
+    if (_index.len() == 0)
+        return NONE;
+
+    usize mask = _index.len() - 1;
+    for (usize i = _hash(key) & mask;; i = (i + 1) & mask) {
+        auto entry = _index[i];
+        if (entry == 0)
+            return NONE;
+        auto const &glyph = _glyphs[entry - 1];
+        if (glyph and glyph->key == key)
+            return entry - 1;
+    }
+}
+
+void GlyphCache::_reindex() {
+    usize cap = max<usize>(_index.len(), 64);
+    while (cap < _glyphs.len() * 2)
+        cap *= 2;
+
+    _index.clear();
+    _index.resize(cap, 0);
+
+    usize mask = cap - 1;
+    for (usize slot = 0; slot < _glyphs.len(); slot++) {
+        if (not _glyphs[slot])
+            continue;
+        usize i = _hash(_glyphs[slot]->key) & mask;
+        while (_index[i] != 0)
+            i = (i + 1) & mask;
+        _index[i] = slot + 1;
+    }
+}
+
+void GlyphCache::_drop(auto pred) {
+    for (usize i = 0; i < _glyphs.len(); i++) {
+        auto const &glyph = _glyphs[i];
+        if (glyph and pred(*glyph)) {
+            if (not glyph->shelf)
+                _blanks--;
+            _glyphs[i] = NONE;
+            _free.pushBack(i);
+        }
+    }
+    _reindex();
+}
+
+/* --- Rasterization -------------------------------------------------------- */
+
+Opt<GlyphCache::Glyph> GlyphCache::_rasterize(Media::Font const &font, Key const &key) {
+    // The contour is drawn with generous padding, glyphs are allowed to
+    // overflow their metrics.
+    auto m = font.metrics();
+    isize pad = Math::ceil(font.fontsize) + 2;
+    isize ascend = Math::ceil(max(m.ascend, font.fontsize)) + pad;
+    isize width = Math::ceil(font.advance(key.rune)) + 2 * pad;
+    isize height = ascend + Math::ceil(m.descend) + pad;
+
+    auto img = Media::Image::alloc({width, height}, RGBA8888PM);
+    Context g;
+    g.begin(img);
+    g.clear(ALPHA);
+    g.fillStyle(WHITE);
+    g.begin();
+    g.origin({pad, ascend});
+    g.scale(font.fontsize / font.fontface->units());
+    g.translate({key.subpixel / (f64)SUBPIXELS, 0});
+    font.fontface->contour(g, key.rune);
+    g.fill();
+    g.end();
+
+    auto pixels = img.pixels();
+    Math::Recti bound = {width, height, 0, 0};
+    isize right = 0, bottom = 0;
+    for (isize y = 0; y < height; y++) {
+        for (isize x = 0; x < width; x++) {
+            if (pixels.load({x, y}).alpha == 0)
+                continue;
+            bound.x = min(bound.x, x);
+            bound.y = min(bound.y, y);
+            right = max(right, x + 1);
+            bottom = max(bottom, y + 1);
+        }
+    }
+    bound.width = max(right - bound.x, 0);
+    bound.height = max(bottom - bound.y, 0);
+
+    Glyph glyph{
+        .key = key,
+        .bound = {bound.x - pad, bound.y - ascend, bound.width, bound.height},
+        .pos = {},
+        .shelf = NONE,
+    };
+
+    // Blank glyphs are cached too, but don't take any room in the atlas.
+    if (bound.width == 0 or bound.height == 0) {
+        if (_blanks >= MAX_BLANKS)
+            _drop([](Glyph const &glyph) {
+                return not glyph.shelf;
+            });
+        _blanks++;
+    } else {
+        auto alloc = _alloc(bound.wh);
+        if (not alloc)
+            return NONE;
+
+        auto [shelf, x] = alloc.unwrap();
+        glyph.shelf = shelf;
+        glyph.pos = {x, _shelves[shelf].y};
+
+        for (isize y = 0; y < bound.height; y++) {
+            u8 *row = &_atlas[(glyph.pos.y + y) * ATLAS_SIZE + glyph.pos.x];
+            for (isize x = 0; x < bound.width; x++)
+                row[x] = pixels.load({bound.x + x, bound.y + y}).alpha;
+        }
+    }
+
+    usize slot;
+    if (_free.len()) {
+        slot = _free.popBack();
+        _glyphs[slot] = glyph;
+    } else {
+        slot = _glyphs.len();
+        _glyphs.pushBack(glyph);
+    }
+
+    if (_glyphs.len() * 2 > _index.len()) {
+        _reindex();
+    } else {
+        usize mask = _index.len() - 1;
+        usize i = _hash(key) & mask;
+        while (_index[i] != 0)
+            i = (i + 1) & mask;
+        _index[i] = slot + 1;
+    }
+
+    return glyph;
+}
+
+/* --- Atlas ---------------------------------------------------------------- */
+
+Opt<Cons<usize, isize>> GlyphCache::_alloc(Math::Vec2i size) {
+    if (size.x > ATLAS_SIZE or size.y > ATLAS_SIZE)
+        return NONE;
+
+    if (_atlas.len() == 0)
+        _atlas.resize(ATLAS_SIZE * ATLAS_SIZE, 0);
+
+    // Rounding the height lets glyphs of similar sizes share shelves.
+    isize height = min<isize>(alignUp(size.y, 4), ATLAS_SIZE);
+
+    for (usize i = 0; i < _shelves.len(); i++) {
+        auto &shelf = _shelves[i];
+        if (shelf.height == height and shelf.used + size.x <= ATLAS_SIZE) {
+            isize x = shelf.used;
+            shelf.used += size.x;
+            shelf.tick = _touch();
+            return Cons<usize, isize>{i, x};
+        }
+    }
+
+    isize top = _shelves.len() ? last(_shelves).y + last(_shelves).height : 0;
+    if (top + height <= ATLAS_SIZE) {
+        _shelves.pushBack({top, height, size.x, _touch()});
+        return Cons<usize, isize>{_shelves.len() - 1, 0};
+    }
+
+    // The atlas is full, reuse the least recently used shelf that is tall
+    // enough, or start over if there is none.
+    Opt<usize> victim = NONE;
+    for (usize i = 0; i < _shelves.len(); i++) {
+        if (_shelves[i].height < height)
+            continue;
+        if (not victim or _shelves[i].tick < _shelves[*victim].tick)
+            victim = i;
+    }
+
+    if (not victim) {
+        _evictions += _shelves.len();
+        _shelves.clear();
+        _drop([](Glyph const &glyph) {
+            return bool(glyph.shelf);
+        });
+        return _alloc(size);
+    }
+
+    _evict(*victim);
+    auto &shelf = _shelves[*victim];
+    shelf.used = size.x;
+    shelf.tick = _touch();
+    return Cons<usize, isize>{*victim, 0};
+}
+
+void GlyphCache::_evict(usize shelf) {
+    _evictions++;
+    _drop([&](Glyph const &glyph) {
+        return glyph.shelf and *glyph.shelf == shelf;
+    });
+    _shelves[shelf].used = 0;
+}
+
+GlyphCache &glyphCache() {
+    static GlyphCache cache;
+    return cache;
+}
+
+} // namespace Karm::Gfx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <karm-base/vec.h>
+#include <karm-media/font.h>
+
+#include "lru.h"
+
+namespace Karm::Gfx {
+
+// Coverage masks of rasterized glyphs, packed in rows of the same height
+// (shelves) of a single 8 bits atlas. When the atlas is full, the least
+// recently used shelf is cleared and reused.
+struct GlyphCache : LruCache {
+    static constexpr isize ATLAS_SIZE = 1024;
+
+    // Horizontal positions are quantized to this fraction of a pixel.
+    static constexpr isize SUBPIXELS = 4;
+
+    // Fontfaces are kept alive by the cache, the least recently used one is
+    // forgotten past this many.
+    static constexpr usize MAX_FACES = 32;
+
+    // Blank glyphs don't take room in the atlas, they are all dropped past
+    // this many.
+    static constexpr usize MAX_BLANKS = 1024;
+
+    struct Key {
+        usize face;
+        f64 size;
+        Rune rune;
+        isize subpixel;
+
+        bool operator==(Key const &) const = default;
+    };
+
+    struct Glyph {
+        Key key;
+
+        // Position of the mask relative to the pen, and its size.
+        Math::Recti bound;
+
+        // Position of the mask in the atlas.
+        Math::Vec2i pos;
+
+        // Blank glyphs are not in the atlas.
+        Opt<usize> shelf;
+    };
+
+    struct Shelf {
+        isize y;
+        isize height;
+        isize used;
+        u64 tick;
+    };
+
+    struct Face {
+        Strong<Media::Fontface> face;
+        usize id;
+        u64 tick;
+    };
+
+    Vec<u8> _atlas;
+    Vec<Shelf> _shelves;
+    Vec<Opt<Glyph>> _glyphs;
+    Vec<usize> _free;
+    Vec<usize> _index;
+    Vec<Face> _faces;
+    usize _nextFace = 0;
+    usize _blanks = 0;
+    usize _evictions = 0;
+
+    // Number of shelves cleared to make room for new glyphs.
+    usize evictions() const {
+        return _evictions;
+    }
+
+    // Drop every glyph.
+    void clear();
+
+    // Number of cached glyphs, blank or not.
+    usize len() const {
+        return _glyphs.len() - _free.len();
+    }
+
+    // Get the glyph for the rune at the given subpixel offset, rasterizing it
+    // if needed. Returns NONE if it doesn't fit in the atlas.
+    // Must be called with the lock held.
+    Opt<Glyph> get(Media::Font const &font, Rune rune, isize subpixel);
+
+    // The row `y` of the mask of the glyph.
+    u8 const *mask(Glyph const &glyph, isize y) const {
+        return &_atlas[(glyph.pos.y + y) * ATLAS_SIZE + glyph.pos.x];
+    }
+
+    usize _faceId(Strong<Media::Fontface> const &face);
+    Opt<usize> _lookup(Key const &key) const;
+    void _reindex();
+    void _drop(auto pred);
+    Opt<Glyph> _rasterize(Media::Font const &font, Key const &key);
+    Opt<Cons<usize, isize>> _alloc(Math::Vec2i size);
+    void _evict(usize shelf);
+};
+
+GlyphCache &glyphCache();
+
+} // namespace Karm::Gfx
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <karm-base/lock.h>
+#include <karm-base/map.h>
+#include <karm-base/opt.h>
+
+namespace Karm::Gfx {
+
+// Bookkeeping of the caches shared by every context: the lock they are used
+// under, the clock their entries are stamped with when used, and how many
+// lookups they answered.
+struct LruCache {
+    // Held while looking up and using entries.
+    Lock _lock;
+
+    u64 _tick = 0;
+
+    usize _hits = 0;
+    usize _misses = 0;
+
+    // Number of lookups answered from the cache.
+    usize hits() const {
+        return _hits;
+    }
+
+    // Number of lookups that had to be computed.
+    usize misses() const {
+        return _misses;
+    }
+
+    // Stamp for an entry used now.
+    u64 _touch() {
+        return ++_tick;
+    }
+
+    // Index of the entry used the longest time ago, if any, `tick` gives
+    // the stamp of the entry at an index.
+    static Opt<usize> _oldest(usize len, auto tick) {
+        Opt<usize> oldest = NONE;
+        for (usize i = 0; i < len; i++)
+            if (not oldest or tick(i) < tick(*oldest))
+                oldest = i;
+        return oldest;
+    }
+
+    static Opt<usize> _oldest(auto const &entries) {
+        return _oldest(entries.len(), [&](usize i) {
+            return entries[i].tick;
+        });
+    }
+
+    // Key of the entry of a map used the longest time ago, if any.
+    template <typename K, typename V>
+    static Opt<K> _oldestKey(Map<K, V> const &entries) {
+        auto i = _oldest(entries._els.len(), [&](usize i) {
+            return entries._els[i].cdr.tick;
+        });
+        if (not i)
+            return NONE;
+        return entries._els[*i].car;
+    }
+};
+
+} // namespace Karm::Gfx
@@ -41,34 +41,115 @@ void Path::_flattenLineToNoTrans(Math::Vec2f p) {
     c = _trans.apply(c);
     d = _trans.apply(d);
 
-    _flattenCubicToNoTrans(a, b, c, d, 0);
+    _flattenCubicToNoTrans(a, b, c, d);
 }
 
-void Path::_flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, Math::Vec2f d, isize depth) {
-    const isize MAX_DEPTH = 16;
-    const f64 TOLERANCE = 0.25;
+// Curves are flattened as described in "Flattening quadratic Béziers" by Raph
+// Levien. A quadratic curve is a segment of a parabola, the number of lines
+// needed to stay within the tolerance is given by an approximation of the
+// integral of the square root of its curvature, and the lines are placed
+// along the curve where that integral grows evenly. Cubics are first split
+// into quadratics.
 
-    if (depth > MAX_DEPTH)
-        return;
+static f64 _approxParabolaIntegral(f64 x) {
+    constexpr f64 D = 0.67;
+    return x / (1 - D + sqrt(sqrt(D * D * D * D + 0.25 * x * x)));
+}
 
-    auto d1 = d - a;
-    auto d2 = Math::abs((b.x - d.x) * d1.y - (b.y - d.y) * d1.x);
-    auto d3 = Math::abs((c.x - d.x) * d1.y - (c.y - d.y) * d1.x);
+static f64 _approxParabolaInvIntegral(f64 x) {
+    constexpr f64 B = 0.39;
+    return x * (1 - B + sqrt(B * B + 0.25 * x * x));
+}
+
+void Path::_flattenQuadToNoTrans(Math::Vec2f p0, Math::Vec2f p1, Math::Vec2f p2, f64 tolerance) {
+    auto d01 = p1 - p0;
+    auto d12 = p2 - p1;
+    auto dd = d01 - d12;
+    f64 cross = (p2 - p0).cross(dd);
+    f64 x0 = d01.dot(dd) / cross;
+    f64 x2 = d12.dot(dd) / cross;
+    f64 scale = Math::abs(cross / (dd.len() * (x2 - x0)));
+
+    // Straight curves have an infinite scale and are drawn as a single line.
+    f64 a0 = _approxParabolaIntegral(x0);
+    f64 a2 = _approxParabolaIntegral(x2);
+    f64 sqrtTolerance = sqrt(tolerance);
+    f64 val = 0;
+    if (isfinite(scale)) {
+        f64 da = Math::abs(a2 - a0);
+        f64 sqrtScale = sqrt(scale);
+        if ((x0 < 0) == (x2 < 0)) {
+            val = da * sqrtScale;
+        } else {
+            // The curve goes through the vertex of the parabola, where the
+            // approximation breaks down.
+            f64 xmin = sqrtTolerance / sqrtScale;
+            val = sqrtTolerance * da / _approxParabolaIntegral(xmin);
+        }
+    }
 
-    if ((d2 + d3) * (d2 + d3) < TOLERANCE * (d1.x * d1.x + d1.y * d1.y)) {
-        _flattenLineToNoTrans(d);
+    if (not isfinite(val)) {
+        // Curves folding back on themselves don't fit the approximation, they
+        // are split evenly, the distance to the chords shrinking with the
+        // square of their count.
+        isize n = max<isize>(ceil(sqrt(dd.len() / (4 * tolerance))), 1);
+        for (isize i = 1; i < n; i++) {
+            f64 t = i / (f64)n;
+            f64 mt = 1 - t;
+            _flattenLineToNoTrans(p0 * (mt * mt) + p1 * (2 * mt * t) + p2 * (t * t));
+        }
+        _flattenLineToNoTrans(p2);
         return;
     }
 
-    auto ab = (a + b) / 2;
-    auto bc = (b + c) / 2;
-    auto cd = (c + d) / 2;
-    auto abc = (ab + bc) / 2;
-    auto bcd = (bc + cd) / 2;
-    auto abcd = (abc + bcd) / 2;
+    isize n = max<isize>(ceil(0.5 * val / sqrtTolerance), 1);
+    f64 u0 = _approxParabolaInvIntegral(a0);
+    f64 uscale = 1 / (_approxParabolaInvIntegral(a2) - u0);
+
+    for (isize i = 1; i < n; i++) {
+        f64 u = _approxParabolaInvIntegral(a0 + (a2 - a0) * i / n);
+        f64 t = (u - u0) * uscale;
+        f64 mt = 1 - t;
+        _flattenLineToNoTrans(p0 * (mt * mt) + p1 * (2 * mt * t) + p2 * (t * t));
+    }
+
+    _flattenLineToNoTrans(p2);
+}
+
+void Path::_flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, Math::Vec2f d) {
+    // A tenth of the tolerance is left for approximating the cubic with
+    // quadratics, their count follows from the third derivative.
+    f64 tolerance = sqrt(_tolerance);
+    f64 quadTolerance = 0.1 * tolerance;
+    f64 err = ((c * 3 - d) - (b * 3 - a)).lenSq();
+    isize quads = max<isize>(ceil(pow(err / (432 * quadTolerance * quadTolerance), 1.0 / 6)), 1);
+
+    auto at = [&](f64 t) {
+        f64 mt = 1 - t;
+        return a * (mt * mt * mt) + b * (3 * mt * mt * t) + c * (3 * mt * t * t) + d * (t * t * t);
+    };
+
+    auto tangent = [&](f64 t) {
+        f64 mt = 1 - t;
+        return (b - a) * (3 * mt * mt) + (c - b) * (6 * mt * t) + (d - c) * (3 * t * t);
+    };
 
-    _flattenCubicToNoTrans(a, ab, abc, abcd, depth + 1);
-    _flattenCubicToNoTrans(abcd, bcd, cd, d, depth + 1);
+    f64 dt = 1.0 / quads;
+    auto p0 = a;
+    auto t0 = tangent(0);
+    for (isize i = 1; i <= quads; i++) {
+        auto p1 = i == quads ? d : at(i * dt);
+        auto t1 = tangent(i * dt);
+
+        // The quadratic closest to this part of the cubic, its control point
+        // is (3 * (c1 + c2) - (p0 + p1)) / 4 with c1 and c2 the control points
+        // of the part.
+        auto cp = (p0 + p1) * 0.5 + (t0 - t1) * (dt / 4);
+        _flattenQuadToNoTrans(p0, cp, p1, tolerance - quadTolerance);
+
+        p0 = p1;
+        t0 = t1;
+    }
 }
 
 [[gnu::flatten]] void Path::_flattenQuadraticTo(Math::Vec2f start, Math::Vec2f cp, Math::Vec2f point) {
@@ -157,11 +238,14 @@ void Path::_flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, M
     // Approximate the arc using cubic spline segments.
     Math::Trans2f t{cosrx, sinrx, -sinrx, cosrx, cx, cy};
 
-    // Split arc into max 90 degree segments.
-    // The loop assumes an Iter per end point (including start and end), this +1.
-    isize ndivs = (isize)(Math::abs(da) / (M_PI * 0.5f) + 1.0f);
+    // Split arc into max 90 degree segments, shorter ones for arcs large on
+    // screen. The error of a cubic approximating an arc of radius r is about
+    // 2.7e-4 * r for 90 degrees and shrinks with the 6th power of the angle.
+    f64 r = max(_trans.applyVector({radius.x, 0}).len(), _trans.applyVector({0, radius.y}).len());
+    f64 maxAngle = M_PI * 0.5 * min(pow(0.1 * sqrt(_tolerance) / (2.7e-4 * r), 1.0 / 6), 1.0);
+    isize ndivs = max<isize>(ceil(Math::abs(da) / maxAngle), 1);
     f64 hda = (da / (f64)ndivs) / 2.0f;
-    f64 kappa = Math::abs(4.0f / 3.0f * (1.0f - Math::cos(hda)) / Math::sin(hda));
+    f64 kappa = Math::abs(4.0f / 3.0f * (1.0f - cos(hda)) / sin(hda));
 
     if (da < 0.0f) {
         kappa = -kappa;
@@ -173,8 +257,8 @@ void Path::_flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, M
     for (isize i = 0; i <= ndivs; i++) {
         f64 a = a1 + da * (i / (f64)ndivs);
 
-        dx = Math::cos(a);
-        dy = Math::sin(a);
+        dx = cos(a);
+        dy = sin(a);
 
         Math::Vec2f p = t.apply(Math::Vec2f{dx * radius.x, dy * radius.y});
         Math::Vec2f tan = t.applyVector({-dy * radius.x * kappa, dx * radius.y * kappa});
@@ -313,6 +397,18 @@ void Path::arcTo(Math::Vec2f radius, f64 angle, Math::Vec2f p, Flags flags) {
 
 /* --- Shapes ----------------------------------------------------------- */
 
+void Path::path(Path const &other) {
+    _segs.ensure(_segs.len() + other._segs.len());
+    _verts.ensure(_verts.len() + other._verts.len());
+
+    for (auto seg : other.iterSegs()) {
+        _segs.pushBack({_verts.len(), _verts.len(), seg.close});
+        for (auto v : seg)
+            _verts.pushBack(_trans.apply(v));
+        last(_segs).end = _verts.len();
+    }
+}
+
 void Path::line(Math::Edgef edge) {
     moveTo(edge.start);
     lineTo(edge.end);
@@ -112,6 +112,11 @@ struct Path {
     Math::Vec2f _lastP;
     Math::Trans2f _trans = Math::Trans2f::identity();
 
+    // Square of the distance flattened curves may stray from the exact ones,
+    // in the coordinates of the flattened path. Curves are flattened after
+    // being transformed, so the tolerance holds on screen whatever the scale.
+    f64 _tolerance = 0.25;
+
     auto iterSegs() const {
         return Iter([&, i = 0uz]() mutable -> Opt<Seg> {
             if (i >= _segs.len()) {
@@ -137,7 +142,9 @@ struct Path {
 
     void _flattenCubicTo(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, Math::Vec2f d);
 
-    void _flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, Math::Vec2f d, isize depth);
+    void _flattenCubicToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, Math::Vec2f d);
+
+    void _flattenQuadToNoTrans(Math::Vec2f a, Math::Vec2f b, Math::Vec2f c, f64 tolerance);
 
     void _flattenQuadraticTo(Math::Vec2f start, Math::Vec2f cp, Math::Vec2f point);
 
@@ -153,6 +160,20 @@ struct Path {
         return _trans;
     }
 
+    // Bounding box of the flattened vertices.
+    Math::Rectf bound() const {
+        if (_verts.len() == 0)
+            return {};
+
+        auto min = _verts[0];
+        auto max = _verts[0];
+        for (auto v : _verts) {
+            min = {Karm::min(min.x, v.x), Karm::min(min.y, v.y)};
+            max = {Karm::max(max.x, v.x), Karm::max(max.y, v.y)};
+        }
+        return Math::Rectf::fromTwoPoint(min, max);
+    }
+
     /* --- Operations ------------------------------------------------------- */
 
     void evalOp(Op op);
@@ -181,6 +202,9 @@ struct Path {
 
     /* --- Shapes ----------------------------------------------------------- */
 
+    // Append an already flattened path, only the transform is applied.
+    void path(Path const &other);
+
     void line(Math::Edgef edge);
 
     void rect(Math::Rectf rect, BorderRadius radius = 0);
@@ -0,0 +1,87 @@
+#include <karm-math/funcs.h>
+#include <karm-media/image.h>
+
+#include "colors.h"
+#include "context.h"
+#include "shadows.h"
+
+namespace Karm::Gfx {
+
+void ShadowCache::clear() {
+    _shadows.clear();
+}
+
+ShadowCache::Shadow const &ShadowCache::get(Math::Vec2i size, BorderRadius radius, isize blur) {
+    // The straight part of an edge must be wide enough for the blur not to
+    // reach the corners from the middle of it.
+    f64 corner = max(max(radius.topLeft, radius.topRight), max(radius.bottomRight, radius.bottomLeft));
+    isize stretchable = 2 * (Math::ceil(corner) + 1 + blur) + 1;
+
+    Key key{
+        .radius = radius,
+        .blur = blur,
+        .width = size.x < stretchable ? size.x : 0,
+        .height = size.y < stretchable ? size.y : 0,
+    };
+
+    for (auto &shadow : _shadows) {
+        if (shadow.key == key) {
+            _hits++;
+            shadow.tick = _touch();
+            return shadow;
+        }
+    }
+
+    _misses++;
+    if (_shadows.len() >= MAX_SHADOWS)
+        _shadows.removeAt(*_oldest(_shadows));
+
+    _shadows.pushBack(_render(key, {
+                                       key.width ? key.width : stretchable,
+                                       key.height ? key.height : stretchable,
+                                   }));
+    return last(_shadows);
+}
+
+ShadowCache::Shadow ShadowCache::_render(Key const &key, Math::Vec2i size) {
+    isize pad = padding(key.blur);
+    Math::Vec2i maskSize = size + pad * 2;
+
+    auto img = Media::Image::alloc(maskSize, RGBA8888PM);
+    Context g;
+    g.begin(img);
+    g.clear(ALPHA);
+    g.fillStyle(WHITE);
+    g.fill(Math::Recti{pad, pad, size.x, size.y}, key.radius);
+    g.apply(BlurFilter{key.blur});
+    g.end();
+
+    Shadow shadow{
+        .key = key,
+        .mask = {},
+        .size = maskSize,
+        .stretchX = NONE,
+        .stretchY = NONE,
+        .tick = _touch(),
+    };
+
+    if (not key.width)
+        shadow.stretchX = maskSize.x / 2;
+    if (not key.height)
+        shadow.stretchY = maskSize.y / 2;
+
+    auto pixels = img.pixels();
+    shadow.mask.resize(maskSize.x * maskSize.y, 0);
+    for (isize y = 0; y < maskSize.y; y++)
+        for (isize x = 0; x < maskSize.x; x++)
+            shadow.mask[y * maskSize.x + x] = pixels.load({x, y}).alpha;
+
+    return shadow;
+}
+
+ShadowCache &shadowCache() {
+    static ShadowCache cache;
+    return cache;
+}
+
+} // namespace Karm::Gfx
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <karm-base/vec.h>
+#include <karm-math/rect.h>
+
+#include "lru.h"
+#include "style.h"
+
+namespace Karm::Gfx {
+
+// Blurred coverage masks of rounded rectangles, used to draw box shadows
+// without rasterizing and blurring them every time.
+//
+// Away from its corners, the blurred mask of a rectangle doesn't change along
+// its edges. Masks are rendered for the smallest rectangle having such a
+// stretch and shadows of any size are composed from their nine patches, the
+// corners are copied and the middle row and column repeated in between.
+struct ShadowCache : LruCache {
+    // Masks kept at once, a handful of box styles account for most shadows
+    // of an interface.
+    static constexpr usize MAX_SHADOWS = 32;
+
+    struct Key {
+        BorderRadius radius;
+        isize blur;
+
+        // Size of the rectangle along the axes too short to be stretched,
+        // zero along the others.
+        isize width;
+        isize height;
+
+        bool operator==(Key const &) const = default;
+    };
+
+    struct Shadow {
+        Key key;
+        Vec<u8> mask;
+        Math::Vec2i size;
+
+        // Row and column repeated to stretch the mask, if it can be.
+        Opt<isize> stretchX;
+        Opt<isize> stretchY;
+
+        u64 tick;
+
+        // Position in the mask of the pixel at `i` in a shadow `len` pixels
+        // long, along an axis stretched at `stretch`.
+        static isize _map(isize i, isize len, isize size, Opt<isize> stretch) {
+            if (not stretch or i < *stretch)
+                return i;
+            isize tail = len - (size - *stretch);
+            return i <= tail ? *stretch : i - (len - size);
+        }
+
+        // The row `y` of the mask.
+        u8 const *row(isize y) const {
+            return &mask[y * size.x];
+        }
+    };
+
+    Vec<Shadow> _shadows;
+
+    // Space around the rectangle covered by its shadow.
+    static isize padding(isize blur) {
+        return blur + 1;
+    }
+
+    // Drop every mask.
+    void clear();
+
+    // Get the mask of the shadow of a rectangle of the given size, with the
+    // padding around it, rendering it if needed. The mask stays valid until
+    // the next call. Must be called with the lock held.
+    Shadow const &get(Math::Vec2i size, BorderRadius radius, isize blur);
+
+    Shadow _render(Key const &key, Math::Vec2i size);
+};
+
+ShadowCache &shadowCache();
+
+} // namespace Karm::Gfx
@@ -214,4 +214,77 @@ void createSolid(Shape &shape, Path &path) {
     }
 }
 
+/* --- Shape Cache ---------------------------------------------------------- */
+
+void ShapeCache::clear() {
+    _entries.clear();
+}
+
+ShapeCache::Entry *ShapeCache::get(Key const &key) {
+    auto *entry = lookup(key);
+    if (entry)
+        _hits++;
+    else
+        _misses++;
+    return entry;
+}
+
+ShapeCache::Entry *ShapeCache::lookup(Key const &key) {
+    auto *entry = _entries.lookup(key);
+    if (entry)
+        entry->tick = _touch();
+    return entry;
+}
+
+ShapeCache::Entry &ShapeCache::put(Key const &key, Path const &path) {
+    if (_entries.len() >= MAX_PATHS)
+        _entries.del(*_oldestKey(_entries));
+
+    _entries.put(key, {
+                          .path = path,
+                          .solid = NONE,
+                          .strokes = {},
+                          .tick = _touch(),
+                      });
+    return *_entries.lookup(key);
+}
+
+Shape const &ShapeCache::solid(Entry &entry) {
+    if (not entry.solid) {
+        Shape shape;
+        createSolid(shape, entry.path);
+        entry.solid = std::move(shape);
+    }
+    return *entry.solid;
+}
+
+Shape const &ShapeCache::stroke(Entry &entry, StrokeStyle const &style) {
+    for (auto &stroke : entry.strokes) {
+        if (stroke.width == style.width and
+            stroke.align == style.align and
+            stroke.cap == style.cap and
+            stroke.join == style.join)
+            return stroke.shape;
+    }
+
+    if (entry.strokes.len() >= MAX_STROKES)
+        entry.strokes.removeAt(0);
+
+    Shape shape;
+    createStroke(shape, entry.path, style);
+    entry.strokes.pushBack({
+        .width = style.width,
+        .align = style.align,
+        .cap = style.cap,
+        .join = style.join,
+        .shape = std::move(shape),
+    });
+    return last(entry.strokes).shape;
+}
+
+ShapeCache &shapeCache() {
+    static ShapeCache cache;
+    return cache;
+}
+
 } // namespace Karm::Gfx
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <karm-base/map.h>
+
+#include "lru.h"
 #include "path.h"
 #include "style.h"
 
@@ -49,6 +52,13 @@ struct Shape {
         _edges.add(edge);
     }
 
+    // Add the edges of another shape, moved by the given offset.
+    void add(Shape const &other, Math::Vec2f offset) {
+        _edges.ensure(_edges.len() + other.len());
+        for (auto const &edge : other)
+            _edges.pushBack({edge.start + offset, edge.end + offset});
+    }
+
     void clear() {
         _edges.clear();
     }
@@ -58,4 +68,131 @@ void createStroke(Shape &shape, Path const &path, StrokeStyle stroke);
 
 void createSolid(Shape &shape, Path &path);
 
+/* --- Shape Cache ---------------------------------------------------------- */
+
+// Flattened paths and the edges they are filled and stroked with, so widgets
+// and icons drawn again and again are neither flattened nor stroked twice.
+//
+// Paths are keyed by what they were built from and by the transform they were
+// flattened with, minus the whole pixels of its translation. The same path
+// drawn anywhere on the pixel grid is reused, moved by whole pixels.
+struct ShapeCache : LruCache {
+    // Paths kept at once, about what a few screens of widgets and icons
+    // are drawn with.
+    static constexpr usize MAX_PATHS = 256;
+
+    // Styles a path is kept stroked with, the first one stroked goes first.
+    static constexpr usize MAX_STROKES = 4;
+
+    // What a path is built from, compared as is so two different shapes
+    // never share an entry.
+    struct Source {
+        enum struct Kind : u8 {
+            RECT,
+            ELLIPSE,
+            ICON,
+        };
+
+        Kind kind;
+
+        // Size of a rectangle, or radii of an ellipse.
+        Math::Vec2i size{};
+
+        // Corners of a rectangle.
+        BorderRadius radius{};
+
+        // Code point of an icon.
+        u32 code{};
+
+        static Source rect(Math::Vec2i size, BorderRadius radius) {
+            // Hashed bitwise, -0 and 0 must be the same.
+            radius.topLeft += 0.0;
+            radius.topRight += 0.0;
+            radius.bottomRight += 0.0;
+            radius.bottomLeft += 0.0;
+            return {Kind::RECT, size, radius, 0};
+        }
+
+        static Source ellipse(Math::Vec2i radii) {
+            return {Kind::ELLIPSE, radii, {}, 0};
+        }
+
+        static Source icon(u32 code) {
+            return {Kind::ICON, {}, {}, code};
+        }
+
+        Ordr cmp(Source const &other) const {
+            return Karm::cmp(kind, other.kind) |
+                   Karm::cmp(size, other.size) |
+                   Karm::cmp(radius.topLeft, other.radius.topLeft) |
+                   Karm::cmp(radius.topRight, other.radius.topRight) |
+                   Karm::cmp(radius.bottomRight, other.radius.bottomRight) |
+                   Karm::cmp(radius.bottomLeft, other.radius.bottomLeft) |
+                   Karm::cmp(code, other.code);
+        }
+
+        u64 hash() const {
+            Array<f64, 4> corners = {radius.topLeft, radius.topRight, radius.bottomRight, radius.bottomLeft};
+            u64 h = hashCombine(Karm::hash(kind), hashCombine(Karm::hash(size.x), Karm::hash(size.y)));
+            h = hashCombine(h, Karm::hash(corners.bytes()));
+            return hashCombine(h, Karm::hash(code));
+        }
+    };
+
+    struct Key {
+        Source source;
+        Array<f64, 6> trans;
+
+        Ordr cmp(Key const &other) const {
+            if (auto c = source.cmp(other.source); not c.isEq())
+                return c;
+            return Karm::cmp(trans.buf(), trans.len(), other.trans.buf(), other.trans.len());
+        }
+
+        u64 hash() const {
+            return hashCombine(source.hash(), Karm::hash(trans.bytes()));
+        }
+    };
+
+    struct Stroke {
+        f64 width;
+        StrokeAlign align;
+        StrokeCap cap;
+        StrokeJoin join;
+        Shape shape;
+    };
+
+    struct Entry {
+        Path path;
+        Opt<Shape> solid;
+        Vec<Stroke> strokes;
+        u64 tick;
+    };
+
+    Map<Key, Entry> _entries;
+
+    // Drop every path.
+    void clear();
+
+    // Find the entry of a path, counting the hit or the miss. Entries stay
+    // valid until the next call to put(). Must be called with the lock held.
+    Entry *get(Key const &key);
+
+    // Find the entry of a path without counting it. Must be called with the
+    // lock held.
+    Entry *lookup(Key const &key);
+
+    // Store a flattened path, dropping the least recently used one if the
+    // cache is full. Must be called with the lock held.
+    Entry &put(Key const &key, Path const &path);
+
+    // Edges of the fill of a cached path.
+    Shape const &solid(Entry &entry);
+
+    // Edges of the stroke of a cached path with the given style.
+    Shape const &stroke(Entry &entry, StrokeStyle const &style);
+};
+
+ShapeCache &shapeCache();
+
 } // namespace Karm::Gfx
@@ -0,0 +1,338 @@
+#include "buffer.h"
+#include "span.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+namespace Karm::Gfx {
+
+// The blend only depends on the position of the alpha channel, so both
+// formats can be handled as Rgba8888.
+ALWAYS_INLINE static void _blendPixel(u8 *dst, u32 src) {
+    auto c = Rgba8888::load(&src);
+    Rgba8888::store(dst, c.blendOver(Rgba8888::load(dst)));
+}
+
+ALWAYS_INLINE static u32 _withAlpha(u32 color, u8 alpha) {
+    return (color & 0x00ffffff) | ((u32)alpha << 24);
+}
+
+ALWAYS_INLINE static void _blendPixelPm(u8 *dst, u32 src) {
+    if (src == 0)
+        return;
+
+    u8 s[4];
+    __builtin_memcpy(s, &src, sizeof(src));
+    u32 ia = 255 - s[3];
+    for (usize i = 0; i < 4; i++)
+        dst[i] = min(s[i] + div255Round(dst[i] * ia), 255u);
+}
+
+// Scale every channel of an opaque color by the mask.
+ALWAYS_INLINE static u32 _scalePm(u32 color, u8 mask) {
+    u8 c[4];
+    __builtin_memcpy(c, &color, sizeof(color));
+    for (usize i = 0; i < 4; i++)
+        c[i] = div255Round(c[i] * mask);
+    __builtin_memcpy(&color, c, sizeof(color));
+    return color;
+}
+
+/* --- SSE2 ----------------------------------------------------------------- */
+
+#if defined(__SSE2__) and not defined(__AVX2__)
+
+static constexpr usize LANES = 4;
+
+// c * a + bg * (255 - a) / 255 on 16 bits lanes, exact for the whole range.
+ALWAYS_INLINE static __m128i _blend16(__m128i s, __m128i d) {
+    auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+    auto ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    auto x = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, ia));
+    x = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(x, 8);
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, __m128i s) {
+    auto const zero = _mm_setzero_si128();
+    auto const alpha = _mm_set1_epi32(0xff000000);
+
+    auto sa = _mm_and_si128(s, alpha);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xffff)
+        return;
+
+    auto d = _mm_loadu_si128((__m128i const *)dst);
+    auto da = _mm_and_si128(d, alpha);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(da, alpha)) != 0xffff) {
+        u32 src[LANES];
+        _mm_storeu_si128((__m128i *)src, s);
+        for (usize i = 0; i < LANES; i++)
+            _blendPixel(dst + i * 4, src[i]);
+        return;
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, alpha)) == 0xffff) {
+        _mm_storeu_si128((__m128i *)dst, s);
+        return;
+    }
+
+    auto lo = _blend16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+    auto hi = _blend16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 const *src) {
+    _blendLanes(dst, _mm_loadu_si128((__m128i const *)src));
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 color, u8 const *mask) {
+    u32 m;
+    __builtin_memcpy(&m, mask, sizeof(m));
+    if (m == 0)
+        return;
+
+    auto const zero = _mm_setzero_si128();
+    auto a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero), zero);
+    auto s = _mm_or_si128(_mm_set1_epi32(color & 0x00ffffff), _mm_slli_epi32(a, 24));
+    _blendLanes(dst, s);
+}
+
+// x / 255 on 16 bits lanes, rounded to the nearest.
+ALWAYS_INLINE static __m128i _div255Round16(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// s + d * (255 - a) / 255 on 16 bits lanes.
+ALWAYS_INLINE static __m128i _blendPm16(__m128i s, __m128i d) {
+    auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+    auto ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return _mm_add_epi16(s, _div255Round16(_mm_mullo_epi16(d, ia)));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, __m128i s) {
+    auto const zero = _mm_setzero_si128();
+    auto const alpha = _mm_set1_epi32(0xff000000);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+        return;
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha), alpha)) == 0xffff) {
+        _mm_storeu_si128((__m128i *)dst, s);
+        return;
+    }
+
+    auto d = _mm_loadu_si128((__m128i const *)dst);
+    auto lo = _blendPm16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+    auto hi = _blendPm16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo, hi));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 const *src) {
+    _blendLanesPm(dst, _mm_loadu_si128((__m128i const *)src));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 color, u8 const *mask) {
+    u32 m;
+    __builtin_memcpy(&m, mask, sizeof(m));
+    if (m == 0)
+        return;
+
+    // Spread each mask byte over the four channels of its pixel.
+    auto const zero = _mm_setzero_si128();
+    auto x = _mm_cvtsi32_si128(m);
+    x = _mm_unpacklo_epi8(x, x);
+    x = _mm_unpacklo_epi16(x, x);
+
+    auto c = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    auto lo = _div255Round16(_mm_mullo_epi16(c, _mm_unpacklo_epi8(x, zero)));
+    auto hi = _div255Round16(_mm_mullo_epi16(c, _mm_unpackhi_epi8(x, zero)));
+    _blendLanesPm(dst, _mm_packus_epi16(lo, hi));
+}
+
+#endif
+
+/* --- AVX2 ----------------------------------------------------------------- */
+
+#if defined(__AVX2__)
+
+static constexpr usize LANES = 8;
+
+// c * a + bg * (255 - a) / 255 on 16 bits lanes, exact for the whole range.
+ALWAYS_INLINE static __m256i _blend16(__m256i s, __m256i d) {
+    auto a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+    auto ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    auto x = _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, ia));
+    x = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8));
+    return _mm256_srli_epi16(x, 8);
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, __m256i s) {
+    auto const zero = _mm256_setzero_si256();
+    auto const alpha = _mm256_set1_epi32(0xff000000);
+
+    auto sa = _mm256_and_si256(s, alpha);
+    if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == 0xffffffff)
+        return;
+
+    auto d = _mm256_loadu_si256((__m256i const *)dst);
+    auto da = _mm256_and_si256(d, alpha);
+    if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(da, alpha)) != 0xffffffff) {
+        u32 src[LANES];
+        _mm256_storeu_si256((__m256i *)src, s);
+        for (usize i = 0; i < LANES; i++)
+            _blendPixel(dst + i * 4, src[i]);
+        return;
+    }
+
+    if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alpha)) == 0xffffffff) {
+        _mm256_storeu_si256((__m256i *)dst, s);
+        return;
+    }
+
+    auto lo = _blend16(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+    auto hi = _blend16(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_packus_epi16(lo, hi), alpha));
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 const *src) {
+    _blendLanes(dst, _mm256_loadu_si256((__m256i const *)src));
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 color, u8 const *mask) {
+    u64 m;
+    __builtin_memcpy(&m, mask, sizeof(m));
+    if (m == 0)
+        return;
+
+    auto a = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(m));
+    auto s = _mm256_or_si256(_mm256_set1_epi32(color & 0x00ffffff), _mm256_slli_epi32(a, 24));
+    _blendLanes(dst, s);
+}
+
+// x / 255 on 16 bits lanes, rounded to the nearest.
+ALWAYS_INLINE static __m256i _div255Round16(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+// s + d * (255 - a) / 255 on 16 bits lanes.
+ALWAYS_INLINE static __m256i _blendPm16(__m256i s, __m256i d) {
+    auto a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+    auto ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return _mm256_add_epi16(s, _div255Round16(_mm256_mullo_epi16(d, ia)));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, __m256i s) {
+    auto const zero = _mm256_setzero_si256();
+    auto const alpha = _mm256_set1_epi32(0xff000000);
+
+    if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == 0xffffffff)
+        return;
+
+    if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha), alpha)) == 0xffffffff) {
+        _mm256_storeu_si256((__m256i *)dst, s);
+        return;
+    }
+
+    auto d = _mm256_loadu_si256((__m256i const *)dst);
+    auto lo = _blendPm16(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+    auto hi = _blendPm16(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)dst, _mm256_packus_epi16(lo, hi));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 const *src) {
+    _blendLanesPm(dst, _mm256_loadu_si256((__m256i const *)src));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 color, u8 const *mask) {
+    u64 m;
+    __builtin_memcpy(&m, mask, sizeof(m));
+    if (m == 0)
+        return;
+
+    // Spread each mask byte over the four channels of its pixel.
+    auto const zero = _mm256_setzero_si256();
+    auto x = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128(m)), _mm256_set1_epi32(0x01010101));
+
+    auto c = _mm256_unpacklo_epi8(_mm256_set1_epi32(color), zero);
+    auto lo = _div255Round16(_mm256_mullo_epi16(c, _mm256_unpacklo_epi8(x, zero)));
+    auto hi = _div255Round16(_mm256_mullo_epi16(c, _mm256_unpackhi_epi8(x, zero)));
+    _blendLanesPm(dst, _mm256_packus_epi16(lo, hi));
+}
+
+#endif
+
+/* --- Scalar --------------------------------------------------------------- */
+
+#if not defined(__SSE2__) and not defined(__AVX2__)
+
+static constexpr usize LANES = 1;
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 const *src) {
+    _blendPixel(dst, *src);
+}
+
+ALWAYS_INLINE static void _blendLanes(u8 *dst, u32 color, u8 const *mask) {
+    _blendPixel(dst, _withAlpha(color, *mask));
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 const *src) {
+    _blendPixelPm(dst, *src);
+}
+
+ALWAYS_INLINE static void _blendLanesPm(u8 *dst, u32 color, u8 const *mask) {
+    _blendPixelPm(dst, _scalePm(color, *mask));
+}
+
+#endif
+
+/* --- Spans ---------------------------------------------------------------- */
+
+bool isOpaque(u8 const *src, usize len) {
+    u8 acc = 0xff;
+    for (usize i = 0; i < len; i++)
+        acc &= src[i * 4 + 3];
+    return acc == 0xff;
+}
+
+void blendSpan(u8 *dst, u32 const *src, usize len) {
+    usize i = 0;
+    for (; i + LANES <= len; i += LANES)
+        _blendLanes(dst + i * 4, src + i);
+
+    for (; i < len; i++)
+        _blendPixel(dst + i * 4, src[i]);
+}
+
+void blendSpan(u8 *dst, u32 color, u8 const *mask, usize len) {
+    usize i = 0;
+    for (; i + LANES <= len; i += LANES)
+        _blendLanes(dst + i * 4, color, mask + i);
+
+    for (; i < len; i++)
+        _blendPixel(dst + i * 4, _withAlpha(color, mask[i]));
+}
+
+void blendSpanPm(u8 *dst, u32 const *src, usize len) {
+    usize i = 0;
+    for (; i + LANES <= len; i += LANES)
+        _blendLanesPm(dst + i * 4, src + i);
+
+    for (; i < len; i++)
+        _blendPixelPm(dst + i * 4, src[i]);
+}
+
+void blendSpanPm(u8 *dst, u32 color, u8 const *mask, usize len) {
+    usize i = 0;
+    for (; i + LANES <= len; i += LANES)
+        _blendLanesPm(dst + i * 4, color, mask + i);
+
+    for (; i < len; i++)
+        _blendPixelPm(dst + i * 4, _scalePm(color, mask[i]));
+}
+
+} // namespace Karm::Gfx
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "buffer.h"
+
+namespace Karm::Gfx {
+
+// Span compositing for 32 bits formats with the alpha in the last byte
+// (Rgba8888 and Bgra8888). Both the source and the destination must use the
+// same byte order.
+//
+// Blending over opaque destination pixels is vectorized when the target
+// supports it, other pixels go through Color::blendOver. The result is
+// identical in both cases.
+
+// Check whether every pixel of the span is fully opaque.
+bool isOpaque(u8 const *src, usize len);
+
+// Blend `len` source pixels over `dst`.
+void blendSpan(u8 *dst, u32 const *src, usize len);
+
+// Blend a solid color over `dst`, the alpha of the color is replaced by the
+// per-pixel alpha from `mask`.
+void blendSpan(u8 *dst, u32 color, u8 const *mask, usize len);
+
+// Same as above for premultiplied pixels, `dst = src + dst * (255 - a) / 255`
+// whatever the destination alpha, without any division.
+
+// Blend `len` premultiplied source pixels over `dst`.
+void blendSpanPm(u8 *dst, u32 const *src, usize len);
+
+// Blend an opaque color scaled by the per-pixel alpha from `mask` over `dst`.
+void blendSpanPm(u8 *dst, u32 color, u8 const *mask, usize len);
+
+// Blend source pixels of format `S` over destination pixels of format `D`,
+// picking the compositor matching their alpha.
+template <typename S, typename D>
+ALWAYS_INLINE void blendSpan(u8 *dst, u32 const *src, usize len) {
+    static_assert(Meta::Same<typename S::Order, typename D::Order>);
+
+    if constexpr (not S::PREMULTIPLIED) {
+        static_assert(not D::PREMULTIPLIED);
+        blendSpan(dst, src, len);
+    } else if constexpr (D::PREMULTIPLIED) {
+        blendSpanPm(dst, src, len);
+    } else if (isOpaque(dst, len)) {
+        // Opaque pixels are the same in both representations.
+        blendSpanPm(dst, src, len);
+    } else {
+        for (usize i = 0; i < len; i++)
+            D::store(dst + i * 4, S::load(&src[i]).blendOver(D::load(dst + i * 4)));
+    }
+}
+
+// Blend the color stored in format `D`, with an alpha of 255, using the
+// coverage from `mask`.
+template <typename D>
+ALWAYS_INLINE void blendSpan(u8 *dst, u32 color, u8 const *mask, usize len) {
+    if constexpr (D::PREMULTIPLIED)
+        blendSpanPm(dst, color, mask, len);
+    else
+        blendSpan(dst, color, mask, len);
+}
+
+} // namespace Karm::Gfx
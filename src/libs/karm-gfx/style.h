@@ -26,6 +26,8 @@ struct BorderRadius {
 
     BorderRadius(f64 topLeft, f64 topRight, f64 bottomRight, f64 bottomLeft)
         : topLeft(topLeft), topRight(topRight), bottomRight(bottomRight), bottomLeft(bottomLeft) {}
+
+    bool operator==(BorderRadius const &) const = default;
 };
 
 /* --- Stroke Style --------------------------------------------------------- */
@@ -94,6 +96,10 @@ struct ShadowStyle {
     f64 radius{8};
     Math::Vec2i offset{};
 
+    // Distance the shadow of a rectangle is grown by before being blurred,
+    // ignored for other paths.
+    f64 spread{};
+
     static ShadowStyle elevated(f64 v) {
         return {
             Gfx::BLACK.withOpacity(0.7),
@@ -116,6 +122,11 @@ struct ShadowStyle {
         offset = o;
         return *this;
     }
+
+    auto &withSpread(f64 s) {
+        spread = s;
+        return *this;
+    }
 };
 
 inline ShadowStyle shadow(auto... args) {
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <karm-gfx/context.h>
+#include <karm-math/funcs.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Gfx::Tests {
+
+// Draw on a new image of the given size.
+inline Media::Image render(Math::Vec2i size, auto draw) {
+    auto img = Media::Image::alloc(size, BGRA8888);
+    Context g;
+    g.begin(img);
+    draw(g);
+    g.end();
+    return img;
+}
+
+// Expect every channel of every pixel of `a` and `b` to be at most
+// `tolerance` apart.
+inline Res<> expectClose(Driver &_driver, Pixels a, Pixels b, isize tolerance = 0) {
+    expectEq$(a.width(), b.width());
+    expectEq$(a.height(), b.height());
+
+    for (isize y = 0; y < a.height(); y++) {
+        for (isize x = 0; x < a.width(); x++) {
+            auto ca = a.load({x, y});
+            auto cb = b.load({x, y});
+            expect$(Math::abs(ca.red - cb.red) <= tolerance);
+            expect$(Math::abs(ca.green - cb.green) <= tolerance);
+            expect$(Math::abs(ca.blue - cb.blue) <= tolerance);
+            expect$(Math::abs(ca.alpha - cb.alpha) <= tolerance);
+        }
+    }
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
@@ -0,0 +1,166 @@
+#include <karm-gfx/context.h>
+#include <karm-math/funcs.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Gfx::Tests {
+
+// The per-pixel blit the fast paths replaced.
+static void _referenceBlit(Context &g, Math::Recti src, Math::Recti dest, Pixels p) {
+    dest = g.applyOrigin(dest);
+    auto clipDest = g.applyClip(dest);
+
+    for (isize y = 0; y < clipDest.height; ++y) {
+        isize yy = clipDest.y - dest.y + y;
+        auto srcY = src.y + yy * src.height / dest.height;
+
+        for (isize x = 0; x < clipDest.width; ++x) {
+            isize xx = clipDest.x - dest.x + x;
+            auto srcX = src.x + xx * src.width / dest.width;
+            g.mutPixels().blend({clipDest.x + x, clipDest.y + y}, p.load({srcX, srcY}));
+        }
+    }
+}
+
+static Media::Image _source(Math::Vec2i size, bool opaque, Fmt fmt = RGBA8888) {
+    auto img = Media::Image::alloc(size, fmt);
+    for (isize y = 0; y < size.y; y++)
+        for (isize x = 0; x < size.x; x++)
+            img.mutPixels().store({x, y}, Color::fromRgba(x * 7, y * 13, x ^ y, opaque ? 255 : (x * y) & 0xff));
+    return img;
+}
+
+static Res<> _expectSameBlit(Driver &_driver, Math::Recti src, Math::Recti dest, Media::Image const &source) {
+    auto render = [&](bool reference) {
+        auto img = Media::Image::alloc({64, 64}, BGRA8888);
+        img.mutPixels().clear(Color::fromRgb(10, 20, 30));
+
+        Context g;
+        g.begin(img);
+        g.origin({3, -5});
+        if (reference)
+            _referenceBlit(g, src, dest, source);
+        else
+            g.blit(src, dest, source);
+        g.end();
+        return img;
+    };
+
+    auto fast = render(false);
+    auto reference = render(true);
+
+    for (usize i = 0; i < fast._buf->len(); i++)
+        expectEq$(fast._buf->buf()[i], reference._buf->buf()[i]);
+
+    return Ok();
+}
+
+test$(blitCopy) {
+    auto src = _source({40, 40}, true, BGRA8888);
+    return _expectSameBlit(_driver, src.bound(), {10, 10, 40, 40}, src);
+}
+
+test$(blitTranslucent) {
+    auto src = _source({40, 40}, false);
+    return _expectSameBlit(_driver, src.bound(), {-10, 30, 40, 40}, src);
+}
+
+test$(blitScaled) {
+    auto src = _source({40, 40}, false);
+    try$(_expectSameBlit(_driver, src.bound(), {0, 0, 63, 17}, src));
+    return _expectSameBlit(_driver, {5, 3, 30, 30}, {-7, 8, 97, 71}, src);
+}
+
+test$(blitBilinear) {
+    auto src = Media::Image::alloc({32, 32});
+    for (isize y = 0; y < 32; y++)
+        for (isize x = 0; x < 32; x++)
+            src.mutPixels().store({x, y}, (x + y) % 2 ? WHITE : BLACK);
+
+    auto img = Media::Image::alloc({16, 16});
+    Context g;
+    g.begin(img);
+    g.clear(BLACK);
+    g.blit(src.bound(), img.bound(), src, Sampling::BILINEAR);
+    g.end();
+
+    // A checkerboard scaled down by two averages to gray.
+    auto c = img.pixels().load({8, 8});
+    expectGteq$(c.red, 120);
+    expectLteq$(c.red, 135);
+    return Ok();
+}
+
+test$(blitPremultiplied) {
+    // Premultiplied sources are composited without converting them back, the
+    // result only differs from the reference by rounding.
+    auto src = _source({40, 40}, false, RGBA8888PM);
+    for (auto fmt : Array<Fmt, 2>{BGRA8888, BGRA8888PM}) {
+        auto render = [&](bool reference) {
+            auto img = Media::Image::alloc({64, 64}, fmt);
+            img.mutPixels().clear(Color::fromRgb(10, 20, 30));
+
+            Context g;
+            g.begin(img);
+            if (reference)
+                _referenceBlit(g, src.bound(), {-10, 30, 40, 40}, src);
+            else
+                g.blit(src.bound(), {-10, 30, 40, 40}, src);
+            g.end();
+            return img;
+        };
+
+        auto fast = render(false);
+        auto reference = render(true);
+
+        for (usize i = 0; i < fast._buf->len(); i++)
+            expectLteq$(Math::abs((isize)fast._buf->buf()[i] - (isize)reference._buf->buf()[i]), 2);
+    }
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(blitFullscreen) {
+    auto img = Media::Image::alloc({1920, 1080}, BGRA8888);
+    auto opaque = _source({1920, 1080}, true, BGRA8888);
+    auto translucent = _source({1920, 1080}, false, BGRA8888);
+    auto small = _source({640, 360}, true, BGRA8888);
+
+    Context g;
+    g.begin(img);
+
+    _driver.bench("reference (opaque)", [&] {
+        _referenceBlit(g, opaque.bound(), img.bound(), opaque);
+    });
+
+    _driver.bench("opaque", [&] {
+        g.blit(img.bound(), opaque);
+    });
+
+    _driver.bench("reference (translucent)", [&] {
+        _referenceBlit(g, translucent.bound(), img.bound(), translucent);
+    });
+
+    _driver.bench("translucent", [&] {
+        g.blit(img.bound(), translucent);
+    });
+
+    _driver.bench("reference (upscaled)", [&] {
+        _referenceBlit(g, small.bound(), img.bound(), small);
+    });
+
+    _driver.bench("upscaled", [&] {
+        g.blit(img.bound(), small);
+    });
+
+    _driver.bench("downscaled (bilinear)", [&] {
+        g.blit(opaque.bound(), {0, 0, 640, 360}, opaque, Sampling::BILINEAR);
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
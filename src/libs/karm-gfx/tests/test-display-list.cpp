@@ -0,0 +1,202 @@
+#include <karm-gfx/display-list.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <mdi/spec.h>
+
+#include "pixels.h"
+
+namespace Karm::Gfx::Tests {
+
+static Media::Image _sprite() {
+    auto img = Media::Image::alloc({16, 16}, RGBA8888PM);
+    for (isize y = 0; y < 16; y++)
+        for (isize x = 0; x < 16; x++)
+            img.mutPixels().store({x, y}, Color::fromRgba(x * 16, y * 16, 128, (x + y) * 8));
+    return img;
+}
+
+// Rows of buttons with an icon and a label, like a toolbar or a list.
+static void _scene(Context &g, Pixels sprite, bool effects) {
+    g.save();
+    g.clear(Color::fromRgb(10, 20, 30));
+    g.origin({3, 5});
+
+    for (isize y = 0; y < 6; y++) {
+        for (isize x = 0; x < 4; x++) {
+            Math::Recti button = {x * 60, y * 40, 56, 36};
+
+            g.save();
+            g.clip(button);
+            g.fillStyle(Color::fromRgba(40, 50, 60, 200));
+            g.fill(button, 6);
+            g.fillStyle(WHITE);
+            g.fill(button.xy + 2, Media::Icon{(Mdi::Icon)Mdi::codepoints()[x * 6 + y], 18});
+            g.fillStyle(Color::fromRgba(255, 255, 255, 180));
+            g.fill({button.x + 22, button.y + 16}, "Label");
+            g.restore();
+        }
+    }
+
+    g.fillStyle(Color::fromRgba(200, 40, 40, 128));
+    g.fill(Math::Recti{30, 30, 100, 50});
+    g.strokeStyle(StrokeStyle().withWidth(3).withPaint(YELLOW));
+    g.stroke(Math::Ellipsei{180, 120, 40, 25});
+    g.blit({200, 200, 32, 32}, sprite, Sampling::BILINEAR);
+    g.debugLine({0, 230, 239, 230}, CYAN);
+
+    if (effects) {
+        g.begin();
+        g.rect({120, 160, 60, 40}, 8);
+        g.shadow(ShadowStyle::elevated(4));
+        g.apply(BlurFilter{2}, {0, 0, 60, 40});
+        g.layer({4, 4}, [](Context &g) {
+            g.fillStyle(Color::fromRgba(0, 200, 0, 100));
+            g.fill(Math::Ellipsei{60, 180, 30});
+        });
+    }
+
+    g.restore();
+}
+
+static Media::Image _render(Pixels sprite, bool effects) {
+    return render({256, 256}, [&](Context &g) {
+        _scene(g, sprite, effects);
+    });
+}
+
+static DisplayList _record(Pixels sprite, bool effects) {
+    DisplayList list{{0, 0, 256, 256}};
+    Context g;
+    g.begin(list);
+    _scene(g, sprite, effects);
+    g.end();
+    return list;
+}
+
+test$(displayListReplay) {
+    auto sprite = _sprite();
+    auto direct = _render(sprite, true);
+    auto list = _record(sprite, true);
+
+    auto replayed = render({256, 256}, [&](Context &g) {
+        list.replay(g);
+    });
+
+    return expectClose(_driver, direct, replayed);
+}
+
+test$(displayListReplayDirtyRect) {
+    auto sprite = _sprite();
+    auto direct = _render(sprite, false);
+    auto list = _record(sprite, false);
+
+    // Repainting a damaged region must restore it and leave the rest alone.
+    auto replayed = _render(sprite, false);
+    Math::Recti dirty = {70, 50, 90, 70};
+
+    Context g;
+    g.begin(replayed);
+    g.clear(dirty, PINK);
+    list.replay(g, dirty);
+    g.end();
+
+    try$(expectClose(_driver, direct, replayed));
+
+    usize replayedCmds = 0;
+    list.query(dirty, [&](usize) {
+        replayedCmds++;
+    });
+    expect$(replayedCmds < list.len() / 4);
+
+    return Ok();
+}
+
+test$(displayListReplayAtOrigin) {
+    auto sprite = _sprite();
+    auto list = _record(sprite, false);
+
+    // Replaying at an origin draws like drawing directly at that origin.
+    auto direct = render({256, 256}, [&](Context &g) {
+        g.clear(BLACK);
+        g.origin({-20, 12});
+        _scene(g, sprite, false);
+    });
+
+    auto replayed = render({256, 256}, [&](Context &g) {
+        g.clear(BLACK);
+        g.origin({-20, 12});
+        list.replay(g);
+    });
+
+    return expectClose(_driver, direct, replayed);
+}
+
+test$(displayListKeepsBlittedPixels) {
+    auto sprite = _sprite();
+    auto direct = _render(sprite, false);
+
+    // Bare pixels are copied, changing them afterward doesn't matter.
+    auto list = _record(sprite.pixels(), false);
+    sprite.mutPixels().clear(PINK);
+
+    auto replayed = render({256, 256}, [&](Context &g) {
+        list.replay(g);
+    });
+    try$(expectClose(_driver, direct, replayed));
+
+    // Images are kept alive by the list once dropped by their owner.
+    DisplayList blit{{0, 0, 32, 32}};
+    {
+        auto image = _sprite();
+        Context r;
+        r.begin(blit);
+        r.blit({0, 0, 32, 32}, image, Sampling::BILINEAR);
+        r.end();
+    }
+    auto reused = Media::Image::alloc({16, 16}, RGBA8888PM);
+    reused.mutPixels().clear(PINK);
+
+    auto expected = render({32, 32}, [&](Context &g) {
+        g.clear(BLACK);
+        g.blit({0, 0, 32, 32}, _sprite(), Sampling::BILINEAR);
+    });
+
+    auto actual = render({32, 32}, [&](Context &g) {
+        g.clear(BLACK);
+        blit.replay(g);
+    });
+
+    return expectClose(_driver, expected, actual);
+}
+
+bench$(displayListReplay) {
+    auto sprite = _sprite();
+    auto img = Media::Image::alloc({256, 256}, BGRA8888);
+    Context g;
+    g.begin(img);
+
+    _driver.bench("direct", [&] {
+        _scene(g, sprite, false);
+    });
+
+    DisplayList list{{0, 0, 256, 256}};
+    _driver.bench("record", [&] {
+        Context r;
+        r.begin(list);
+        _scene(r, sprite, false);
+        r.end();
+    });
+
+    _driver.bench("replay", [&] {
+        list.replay(g);
+    });
+
+    _driver.bench("replay (64x32 damage)", [&] {
+        list.replay(g, {70, 50, 64, 32});
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
@@ -0,0 +1,320 @@
+#include <karm-gfx/context.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <mdi/spec.h>
+
+namespace Karm::Gfx::Tests {
+
+// The brute force rasterizer the active edge table replaced, every edge of
+// the shape is tested against every sample line.
+static void _referenceFill(Context &g, Color color, FillRule fillRule) {
+    static constexpr auto AA = 4;
+    static constexpr auto UNIT = 1.0f / AA;
+    static constexpr auto HALF_UNIT = 1.0f / AA / 2.0;
+
+    auto &scanline = g._scanline;
+    auto &active = g._active;
+
+    auto rect = g.applyClip(g._shape.bound().ceil().cast<isize>());
+
+    for (isize y = rect.top(); y < rect.bottom(); y++) {
+        zeroFill<f64>(mutSub(scanline, rect.start(), rect.end()));
+
+        for (f64 yy = y; yy < y + 1.0; yy += UNIT) {
+            active.clear();
+
+            for (auto &edge : g._shape) {
+                auto sample = yy + HALF_UNIT;
+
+                if (edge.bound().top() <= sample and sample < edge.bound().bottom()) {
+                    active.pushBack({
+                        .x = edge.sx + (sample - edge.sy) / (edge.ey - edge.sy) * (edge.ex - edge.sx),
+                        .sign = edge.sy > edge.ey ? 1 : -1,
+                        .edge = 0,
+                    });
+                }
+            }
+
+            if (active.len() == 0)
+                continue;
+
+            sort(active, [](auto const &a, auto const &b) {
+                return cmp(a.x, b.x);
+            });
+
+            isize rule = 0;
+            for (usize i = 0; i + 1 < active.len(); i++) {
+                if (fillRule == FillRule::NONZERO) {
+                    rule += active[i].sign;
+                    if (rule == 0)
+                        continue;
+                }
+
+                if (fillRule == FillRule::EVENODD) {
+                    rule++;
+                    if (rule % 2 == 0)
+                        continue;
+                }
+
+                f64 x1 = max(active[i].x, rect.start());
+                f64 x2 = min(active[i + 1].x, rect.end(), (f64)scanline.len() - 1);
+
+                if (x1 >= x2)
+                    continue;
+
+                if (Math::floor(x1) == Math::floor(x2)) {
+                    scanline[Math::floor(x1)] += x2 - x1;
+                } else {
+                    scanline[x1] += (ceil(x1) - x1) * UNIT;
+                    scanline[x2] += (x2 - floor(x2)) * UNIT;
+
+                    for (isize x = ceil(x1); x < floor(x2); x++)
+                        scanline[x] += UNIT;
+                }
+            }
+        }
+
+        auto pixels = g.mutPixels();
+        for (isize x = rect.start(); x < rect.end(); x++) {
+            auto c = pixels.load({x, y});
+            pixels.store({x, y}, color.withOpacity(clamp01(scanline[x])).blendOver(c));
+        }
+    }
+}
+
+enum struct Mode {
+    FILL,
+    REFERENCE,
+};
+
+static Media::Image _render(auto path, Mode mode, FillRule rule = FillRule::NONZERO, bool stroke = false) {
+    auto img = Media::Image::alloc({64, 64});
+    img.mutPixels().clear(BLACK);
+
+    Context g;
+    g.begin(img);
+    g.begin();
+    path(g);
+
+    g._shape.clear();
+    if (stroke)
+        createStroke(g._shape, g._path, StrokeStyle{}.withWidth(3));
+    else
+        createSolid(g._shape, g._path);
+
+    auto color = Color::fromRgba(255, 255, 255, 200);
+    if (mode == Mode::FILL)
+        g._fill(color, rule);
+    else
+        _referenceFill(g, color, rule);
+
+    g.end();
+    return img;
+}
+
+static usize _countDiff(Media::Image const &a, Media::Image const &b) {
+    usize diff = 0;
+    for (usize i = 0; i < a._buf->len(); i++)
+        if (a._buf->buf()[i] != b._buf->buf()[i])
+            diff++;
+    return diff;
+}
+
+static Res<> _expectSameAsReference(Driver &_driver, auto path, FillRule rule = FillRule::NONZERO, bool stroke = false) {
+    auto fill = _render(path, Mode::FILL, rule, stroke);
+    auto reference = _render(path, Mode::REFERENCE, rule, stroke);
+    expectEq$(_countDiff(fill, reference), 0uz);
+    return Ok();
+}
+
+static void _star(Context &g) {
+    g.evalSvg("M32 2 L50 60 L3 24 L61 24 L14 60 Z");
+}
+
+test$(fillEllipse) {
+    return _expectSameAsReference(_driver, [](Context &g) {
+        g.ellipse(Math::Ellipsef{32.3, 31.7, 25.5, 18.25});
+    });
+}
+
+test$(fillRoundedRect) {
+    return _expectSameAsReference(_driver, [](Context &g) {
+        g.rect(Math::Rectf{4.5, 6.25, 50, 40}, 12);
+    });
+}
+
+test$(fillClipped) {
+    return _expectSameAsReference(_driver, [](Context &g) {
+        g.ellipse(Math::Ellipsef{10, 60, 40, 30});
+    });
+}
+
+test$(fillNonZero) {
+    return _expectSameAsReference(_driver, _star, FillRule::NONZERO);
+}
+
+test$(fillEvenOdd) {
+    return _expectSameAsReference(_driver, _star, FillRule::EVENODD);
+}
+
+test$(fillStroke) {
+    return _expectSameAsReference(
+        _driver, [](Context &g) {
+            g.ellipse(Math::Ellipsef{32, 32, 20, 24});
+            _star(g);
+        },
+        FillRule::NONZERO, true
+    );
+}
+
+test$(fillFlattenedPath) {
+    static constexpr Str STAR = "M16 1 L25 30 L1.5 12 L30.5 12 L7 30 Z";
+
+    // Appending an already flattened path only transforms its vertices.
+    Path star;
+    star.evalSvg(STAR);
+
+    auto direct = [](Context &g) {
+        g.scale(2);
+        g.evalSvg(STAR);
+    };
+
+    auto appended = [&](Context &g) {
+        g.scale(2);
+        g.path(star);
+    };
+
+    expectEq$(_countDiff(_render(direct, Mode::FILL), _render(appended, Mode::FILL)), 0uz);
+    return Ok();
+}
+
+static Media::Image _renderAnalytic(auto path, FillRule rule = FillRule::NONZERO) {
+    auto img = Media::Image::alloc({64, 64});
+    img.mutPixels().clear(BLACK);
+
+    Context g;
+    g.begin(img);
+    g.antialiasing(Antialiasing::ANALYTIC);
+    g.begin();
+    path(g);
+    g.fill(WHITE, rule);
+    g.end();
+    return img;
+}
+
+test$(fillAnalyticCoverage) {
+    auto img = _renderAnalytic([](Context &g) {
+        g.rect(Math::Rectf{10.25, 10.5, 20, 20});
+    });
+
+    expectEq$(img.pixels().load({9, 20}).red, 0);
+    expectEq$(img.pixels().load({10, 20}).red, 191);
+    expectEq$(img.pixels().load({20, 10}).red, 127);
+    expectEq$(img.pixels().load({10, 10}).red, 95);
+    expectEq$(img.pixels().load({20, 20}).red, 255);
+    expectEq$(img.pixels().load({30, 20}).red, 63);
+    expectEq$(img.pixels().load({31, 20}).red, 0);
+    return Ok();
+}
+
+test$(fillAnalyticClipped) {
+    auto img = _renderAnalytic([](Context &g) {
+        g.moveTo({-20, 0});
+        g.lineTo({40, 0});
+        g.lineTo({-20, 60});
+        g.close();
+    });
+
+    expectEq$(img.pixels().load({0, 10}).red, 255);
+    expectEq$(img.pixels().load({20, 10}).red, 255);
+    expectEq$(img.pixels().load({30, 10}).red, 0);
+    return Ok();
+}
+
+test$(fillAnalyticEvenOdd) {
+    auto nonzero = _renderAnalytic(_star, FillRule::NONZERO);
+    auto evenodd = _renderAnalytic(_star, FillRule::EVENODD);
+
+    expectEq$(nonzero.pixels().load({32, 34}).red, 255);
+    expectEq$(evenodd.pixels().load({32, 34}).red, 0);
+    expectEq$(evenodd.pixels().load({32, 10}).red, 255);
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+static Vec<Shape> _iconShapes(Context &g) {
+    Vec<Shape> shapes;
+    for (auto code : Mdi::codepoints()) {
+        g.fill({0, 0}, Media::Icon{(Mdi::Icon)code, 48});
+        shapes.pushBack(g._shape);
+    }
+    return shapes;
+}
+
+bench$(fillIcons) {
+    auto img = Media::Image::alloc({48, 48});
+    Context g;
+    g.begin(img);
+
+    auto shapes = _iconShapes(g);
+
+    _driver.bench("reference", [&] {
+        for (auto &shape : shapes) {
+            g._shape = shape;
+            _referenceFill(g, WHITE, FillRule::NONZERO);
+        }
+    });
+
+    _driver.bench("active edge table", [&] {
+        for (auto &shape : shapes) {
+            g._shape = shape;
+            g._fill(WHITE);
+        }
+    });
+
+    g.antialiasing(Antialiasing::ANALYTIC);
+    _driver.bench("analytic", [&] {
+        for (auto &shape : shapes) {
+            g._shape = shape;
+            g._fill(WHITE);
+        }
+    });
+
+    g.end();
+    return Ok();
+}
+
+bench$(fillTranslucent) {
+    auto img = Media::Image::alloc({1920, 1080}, BGRA8888);
+    img.mutPixels().clear(BLACK);
+
+    Context g;
+    g.begin(img);
+    g.begin();
+    g.rect(img.bound().cast<f64>());
+    createSolid(g._shape, g._path);
+
+    auto color = Color::fromRgba(32, 64, 128, 128);
+
+    _driver.bench("reference", [&] {
+        _referenceFill(g, color, FillRule::NONZERO);
+    });
+
+    _driver.bench("span compositor", [&] {
+        g._fill(color);
+    });
+
+    auto gradient = Gradient::linear()
+                        .withColors(color, Color::fromRgba(128, 64, 32, 128))
+                        .bake();
+
+    _driver.bench("span compositor (gradient)", [&] {
+        g._fill(gradient);
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
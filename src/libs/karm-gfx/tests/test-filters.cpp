@@ -0,0 +1,184 @@
+#include <karm-gfx/colors.h>
+#include <karm-gfx/filters.h>
+#include <karm-math/funcs.h>
+#include <karm-media/image.h>
+#include <karm-sys/thread.h>
+#include <karm-test/macros.h>
+
+#include "pixels.h"
+
+namespace Karm::Gfx::Tests {
+
+static Media::Image _source(Math::Vec2i size, Fmt fmt = RGBA8888) {
+    auto img = Media::Image::alloc(size, fmt);
+    for (isize y = 0; y < size.y; y++)
+        for (isize x = 0; x < size.x; x++)
+            img.mutPixels().store({x, y}, Color::fromRgba(x * 7, y * 13, x ^ y, 128 + ((x * y) & 0x7f)));
+    return img;
+}
+
+static bool _same(Color a, Color b) {
+    return a.red == b.red and a.green == b.green and a.blue == b.blue and a.alpha == b.alpha;
+}
+
+test$(filterChainFused) {
+    auto chained = _source({64, 64});
+    auto sequential = _source({64, 64});
+
+    FilterChain chain;
+    chain.filters.pushBack(BrightnessFilter{0.7});
+    chain.filters.pushBack(SepiaFilter{0.8});
+    chain.filters.pushBack(TintFilter{Color::fromRgb(200, 220, 255)});
+    chain.filters.pushBack(SaturationFilter{0.5});
+
+    chain.apply(chained.mutPixels());
+    for (auto const &filter : chain.filters)
+        filter.apply(sequential.mutPixels());
+
+    // Nothing saturates along the way, only the rounding of the
+    // intermediate results differs.
+    return expectClose(_driver, chained, sequential, 2);
+}
+
+test$(filterMatrixPremultiplied) {
+    auto straight = _source({64, 64});
+    auto premultiplied = _source({64, 64}, RGBA8888PM);
+
+    auto filter = ContrastFilter{0.3};
+    filter.apply(straight.mutPixels());
+    filter.apply(premultiplied.mutPixels());
+
+    // Colors are stored with less precision once premultiplied, and the
+    // contrast amplifies the difference.
+    return expectClose(_driver, straight, premultiplied, 4);
+}
+
+// Convolution with a tent of the given radius along `dir`, the edges
+// extended, computed directly.
+static Media::Image _tent(Pixels src, isize radius, Math::Vec2i dir) {
+    auto img = Media::Image::alloc(src.size(), src.fmt());
+    f64 scale = 1.0 / ((radius + 1) * (radius + 1));
+
+    for (isize y = 0; y < src.height(); y++) {
+        for (isize x = 0; x < src.width(); x++) {
+            f64 r = 0, g = 0, b = 0, a = 0;
+            for (isize k = -radius; k <= radius; k++) {
+                auto c = src.load({
+                    clamp(x + dir.x * k, 0, src.width() - 1),
+                    clamp(y + dir.y * k, 0, src.height() - 1),
+                });
+                f64 w = radius + 1 - Math::abs(k);
+                r += c.red * w;
+                g += c.green * w;
+                b += c.blue * w;
+                a += c.alpha * w;
+            }
+            img.mutPixels().store({x, y}, Color::fromRgba(Math::round(r * scale), Math::round(g * scale), Math::round(b * scale), Math::round(a * scale)));
+        }
+    }
+
+    return img;
+}
+
+test$(filterBlurMatchesTent) {
+    for (isize radius : {1, 5, 12}) {
+        auto img = _source({48, 40});
+        auto expected = _tent(_tent(img, radius, {1, 0}), radius, {0, 1});
+
+        BlurFilter{radius}.apply(img.mutPixels());
+
+        // Both round between the passes, only the rounding of the scale
+        // differs.
+        try$(expectClose(_driver, expected, img, 1));
+    }
+
+    return Ok();
+}
+
+test$(filterBlurFlat) {
+    auto img = Media::Image::alloc({40, 30}, BGRA8888);
+    auto color = Color::fromRgba(12, 100, 200, 180);
+    img.mutPixels().clear(color);
+
+    BlurFilter{16}.apply(img.mutPixels());
+
+    for (isize y = 0; y < 30; y++)
+        for (isize x = 0; x < 40; x++)
+            expect$(_same(img.pixels().load({x, y}), color));
+
+    return Ok();
+}
+
+test$(filterBlurSymmetric) {
+    auto img = Media::Image::alloc({33, 33}, RGBA8888);
+    img.mutPixels().clear(BLACK);
+    img.mutPixels().store({16, 16}, WHITE);
+
+    BlurFilter{4}.apply(img.mutPixels());
+
+    auto p = img.pixels();
+    for (isize y = 0; y < 33; y++) {
+        for (isize x = 0; x < 33; x++) {
+            expect$(_same(p.load({x, y}), p.load({32 - x, y})));
+            expect$(_same(p.load({x, y}), p.load({x, 32 - y})));
+        }
+    }
+
+    expect$(p.load({16, 16}).red > p.load({17, 16}).red);
+    expect$(_same(p.load({21, 16}), BLACK));
+
+    return Ok();
+}
+
+test$(filterParallelBands) {
+    Sys::ThreadPool pool{3};
+
+    // Blurs wider than a band read past the rows of their neighbors.
+    Array<Filter, 4> filters = {BlurFilter{7}, BlurFilter{32}, ContrastFilter{-0.2}, NoiseFilter{0.3}};
+    for (auto const &filter : filters) {
+        auto sequential = _source({300, 200}, BGRA8888PM);
+        auto parallel = _source({300, 200}, BGRA8888PM);
+
+        filter.apply(sequential.mutPixels());
+        filter.apply(parallel.mutPixels(), pool);
+
+        try$(expectClose(_driver, sequential, parallel, 0));
+    }
+
+    return Ok();
+}
+
+bench$(filters) {
+    auto img = _source({512, 512}, BGRA8888PM);
+    Sys::ThreadPool pool;
+
+    _driver.bench("blur (radius 2)", [&] {
+        BlurFilter{2}.apply(img.mutPixels());
+    });
+
+    _driver.bench("blur (radius 32)", [&] {
+        BlurFilter{32}.apply(img.mutPixels());
+    });
+
+    _driver.bench("blur (radius 32, pool)", [&] {
+        BlurFilter{32}.apply(img.mutPixels(), pool);
+    });
+
+    FilterChain chain;
+    chain.filters.pushBack(SepiaFilter{});
+    chain.filters.pushBack(BrightnessFilter{1.2});
+    chain.filters.pushBack(ContrastFilter{0.1});
+
+    _driver.bench("3 color filters", [&] {
+        for (auto const &filter : chain.filters)
+            filter.apply(img.mutPixels());
+    });
+
+    _driver.bench("3 color filters (fused)", [&] {
+        chain.apply(img.mutPixels());
+    });
+
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
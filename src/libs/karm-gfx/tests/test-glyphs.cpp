@@ -0,0 +1,176 @@
+#include <karm-gfx/context.h>
+#include <karm-media/font-vga.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Gfx::Tests {
+
+static constexpr Str TEXT = "The quick brown fox jumps over the lazy dog";
+
+static Media::Image _render(bool cached, Color color) {
+    auto img = Media::Image::alloc({400, 32}, BGRA8888);
+    img.mutPixels().clear(Color::fromRgb(10, 20, 30));
+
+    Context g;
+    g.begin(img);
+    g.origin({3, -5});
+    g.clip({0, 12, 300, 40});
+    g.fillStyle(color);
+
+    if (cached) {
+        g.fill({-4, 24}, TEXT);
+    } else {
+        Math::Vec2i baseline = {-4, 24};
+        for (auto r : iterRunes(TEXT)) {
+            g._fillContour(baseline, r);
+            baseline.x += g.textFont().advance(r);
+        }
+    }
+
+    g.end();
+    return img;
+}
+
+static Res<> _expectSameText(Driver &_driver, Color color) {
+    auto cached = _render(true, color);
+    auto reference = _render(false, color);
+
+    for (usize i = 0; i < cached._buf->len(); i++)
+        expectEq$(cached._buf->buf()[i], reference._buf->buf()[i]);
+
+    return Ok();
+}
+
+test$(glyphsMatchContour) {
+    glyphCache().clear();
+    try$(_expectSameText(_driver, WHITE));
+    return _expectSameText(_driver, Color::fromRgba(255, 128, 0, 100));
+}
+
+test$(glyphsAreCached) {
+    auto &cache = glyphCache();
+    cache.clear();
+
+    auto img = Media::Image::alloc({400, 32}, BGRA8888);
+    Context g;
+    g.begin(img);
+
+    auto misses = cache.misses();
+    g.fill({0, 20}, "abcabc");
+    expectEq$(cache.misses() - misses, 3u);
+
+    auto hits = cache.hits();
+    g.fill({0, 20}, "cab");
+    expectEq$(cache.hits() - hits, 3u);
+    expectEq$(cache.misses() - misses, 3u);
+
+    g.end();
+    return Ok();
+}
+
+test$(glyphsEvictLeastRecentlyUsed) {
+    auto &cache = glyphCache();
+    cache.clear();
+
+    // Large glyphs fill the atlas quickly, evicted glyphs are rasterized again.
+    auto font = Media::Font::fallback();
+    font.fontsize = 256;
+
+    auto evictions = cache.evictions();
+    for (Rune r = 'A'; r <= 'Z'; r++) {
+        LockScope scope(cache._lock);
+        expect$(bool(cache.get(font, r, 0)));
+    }
+    expectGt$(cache.evictions(), evictions);
+
+    LockScope scope(cache._lock);
+    auto misses = cache.misses();
+    expect$(bool(cache.get(font, 'Z', 0)));
+    expectEq$(cache.misses(), misses);
+    expect$(bool(cache.get(font, 'A', 0)));
+    expectEq$(cache.misses(), misses + 1);
+
+    return Ok();
+}
+
+test$(glyphsOfForgottenFacesAreEvicted) {
+    auto &cache = glyphCache();
+    cache.clear();
+
+    // Each face is distinct, its glyphs are cached apart from the others.
+    Vec<Media::Font> fonts;
+    for (usize i = 0; i < GlyphCache::MAX_FACES * 2; i++)
+        fonts.pushBack({makeStrong<Media::VgaFontface>(), 8});
+
+    LockScope scope(cache._lock);
+    for (auto &font : fonts) {
+        expect$(bool(cache.get(font, 'A', 0)));
+        expect$(bool(cache.get(font, ' ', 0)));
+    }
+    expectEq$(cache.len(), GlyphCache::MAX_FACES * 2);
+
+    auto misses = cache.misses();
+    expect$(bool(cache.get(last(fonts), ' ', 0)));
+    expectEq$(cache.misses(), misses);
+    expect$(bool(cache.get(fonts[0], ' ', 0)));
+    expectEq$(cache.misses(), misses + 1);
+
+    // Blank glyphs of a single face are capped too.
+    cache.clear();
+    for (usize i = 0; i < GlyphCache::MAX_BLANKS * 2; i++)
+        expect$(bool(cache.get({fonts[0].fontface, 8.0 + i}, ' ', 0)));
+    expectLteq$(cache.len(), GlyphCache::MAX_BLANKS);
+
+    return Ok();
+}
+
+test$(glyphsRunsAreCached) {
+    auto face = Media::Fontface::fallback();
+    auto advance = face->advance('o');
+
+    Media::Run const *first = nullptr;
+    face->shape("hello", [&](Media::Run const &run) {
+        first = &run;
+    });
+
+    Media::Run const *second = nullptr;
+    Media::Run copy;
+    face->shape("hello", [&](Media::Run const &run) {
+        second = &run;
+        copy = run;
+    });
+
+    expect$(first == second);
+    expectEq$(copy.glyphs.len(), 5u);
+    expectEq$(copy.glyphs[4].x, 4 * advance);
+    expectEq$(copy.advance, 5 * advance);
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(glyphsParagraph) {
+    auto img = Media::Image::alloc({400, 400}, BGRA8888);
+    Context g;
+    g.begin(img);
+
+    _driver.bench("contour", [&] {
+        for (isize y = 0; y < 25; y++) {
+            Math::Vec2i baseline = {0, 16 + y * 16};
+            for (auto r : iterRunes(TEXT)) {
+                g._fillContour(baseline, r);
+                baseline.x += g.textFont().advance(r);
+            }
+        }
+    });
+
+    _driver.bench("cached", [&] {
+        for (isize y = 0; y < 25; y++)
+            g.fill({0, 16 + y * 16}, TEXT);
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
@@ -0,0 +1,110 @@
+#include <karm-gfx/colors.h>
+#include <karm-gfx/display-list.h>
+#include <karm-test/macros.h>
+
+#include "pixels.h"
+
+namespace Karm::Gfx::Tests {
+
+static Media::Image _render(auto draw) {
+    return render({160, 120}, [&](Context &g) {
+        g.clear(Color::fromRgb(230, 230, 240));
+        g.origin({7, -3});
+        g.clip({-4, 10, 150, 100});
+        draw(g);
+    });
+}
+
+test$(shadowCachedMatchesBlurred) {
+    Array<Math::Recti, 3> rects = {
+        Math::Recti{20, 30, 100, 60}, // Stretched along both axes
+        Math::Recti{30, 40, 90, 12},  // Too short to be stretched vertically
+        Math::Recti{50, 50, 6, 6},    // Not stretched at all
+    };
+
+    auto style = ShadowStyle::elevated(5).withSpread(2);
+
+    for (auto r : rects) {
+        auto blurred = _render([&](Context &g) {
+            g.begin();
+            g.rect(r.grow(2).cast<f64>(), 6 + 2);
+            g.shadow(style);
+        });
+
+        auto cached = _render([&](Context &g) {
+            g.shadow(r, 6, style);
+        });
+
+        // The blurred shadow is premultiplied, the cached one is scaled
+        // by the alpha of the color when blended.
+        try$(expectClose(_driver, blurred, cached, 2));
+    }
+
+    return Ok();
+}
+
+test$(shadowMasksAreReused) {
+    auto &cache = shadowCache();
+    auto style = ShadowStyle{}.withRadius(9).withPaint(BLUE);
+
+    auto hits = cache.hits();
+    auto misses = cache.misses();
+
+    _render([&](Context &g) {
+        g.shadow({10, 10, 100, 80}, 5.5, style);
+        g.shadow({10, 10, 120, 40}, 5.5, style);
+        g.shadow({20, 30, 50, 50}, 5.5, style);
+    });
+
+    expectEq$(cache.misses() - misses, 1uz);
+    expectEq$(cache.hits() - hits, 2uz);
+
+    return Ok();
+}
+
+test$(shadowReplay) {
+    auto draw = [](Context &g) {
+        g.shadow({20, 30, 100, 60}, {4, 8, 12, 0}, ShadowStyle::elevated(3));
+    };
+
+    auto direct = _render(draw);
+
+    DisplayList list{{0, 0, 160, 120}};
+    Context r;
+    r.begin(list);
+    r.origin({7, -3});
+    draw(r);
+    r.end();
+
+    auto replayed = _render([&](Context &g) {
+        g.origin({-7, 3});
+        list.replay(g);
+    });
+
+    return expectClose(_driver, direct, replayed);
+}
+
+bench$(shadowCard) {
+    auto img = Media::Image::alloc({400, 300}, BGRA8888);
+    Context g;
+    g.begin(img);
+    g.clear(WHITE);
+
+    auto style = ShadowStyle::elevated(8);
+    Math::Recti card = {50, 50, 300, 200};
+
+    _driver.bench("blurred", [&] {
+        g.begin();
+        g.rect(card.cast<f64>(), 8);
+        g.shadow(style);
+    });
+
+    _driver.bench("cached", [&] {
+        g.shadow(card, 8, style);
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
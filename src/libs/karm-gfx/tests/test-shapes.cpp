@@ -0,0 +1,154 @@
+#include <karm-gfx/colors.h>
+#include <karm-test/macros.h>
+#include <mdi/spec.h>
+
+#include "pixels.h"
+
+namespace Karm::Gfx::Tests {
+
+static Media::Image _render(auto draw) {
+    return render({160, 120}, [&](Context &g) {
+        g.clear(BLACK);
+        g.origin({7, -3});
+        g.translate({0.25, 0.75});
+        g.fillStyle(Color::fromRgb(200, 120, 40));
+        g.strokeStyle(StrokeStyle{WHITE}.withWidth(3));
+        draw(g);
+    });
+}
+
+test$(shapeCachedMatchesUncached) {
+    // Drawn twice, so the second time comes from the cache.
+    for (usize i = 0; i < 2; i++) {
+        auto uncached = _render([&](Context &g) {
+            g.begin();
+            g.rect({10, 10, 80, 50}, 12);
+            g.fill();
+            g.stroke();
+
+            g.begin();
+            g.ellipse({110, 70, 30, 20});
+            g.fill();
+            g.stroke();
+        });
+
+        auto cached = _render([&](Context &g) {
+            g.fill(Math::Recti{10, 10, 80, 50}, 12);
+            g.stroke();
+            g.fill(Math::Ellipsei{110, 70, 30, 20});
+            g.stroke();
+        });
+
+        // Only the rounding of the vertices differs.
+        try$(expectClose(_driver, uncached, cached, 1));
+    }
+
+    return Ok();
+}
+
+test$(shapePathsAreReused) {
+    auto &cache = shapeCache();
+    auto hits = cache.hits();
+    auto misses = cache.misses();
+
+    _render([&](Context &g) {
+        // Not representable exactly, the fraction of a pixel left must still
+        // be the same everywhere.
+        g.translate({0.05, 0.1});
+
+        g.fill(Math::Recti{10, 10, 41, 27}, 7);
+        g.fill(Math::Recti{60, 20, 41, 27}, 7);
+        g.stroke(Math::Recti{30, 70, 41, 27}, 7);
+
+        // Not on the same place of the pixel grid anymore.
+        g.translate({0.5, 0});
+        g.fill(Math::Recti{10, 10, 41, 27}, 7);
+    });
+
+    expectEq$(cache.misses() - misses, 2uz);
+    expectEq$(cache.hits() - hits, 2uz);
+
+    return Ok();
+}
+
+test$(shapeCacheEvicts) {
+    auto &cache = shapeCache();
+
+    _render([&](Context &g) {
+        for (isize i = 0; i < (isize)ShapeCache::MAX_PATHS + 8; i++)
+            g.fill(Math::Recti{10, 10, 20 + i, 20}, 4);
+    });
+
+    expect$(cache._entries.len() <= ShapeCache::MAX_PATHS);
+
+    return Ok();
+}
+
+test$(shapeSourcesAreCompared) {
+    using Source = ShapeCache::Source;
+
+    expect$(Op::eq(Source::rect({10, 20}, 4), Source::rect({10, 20}, 4)));
+    expect$(not Op::eq(Source::rect({10, 20}, 4), Source::rect({20, 10}, 4)));
+    expect$(not Op::eq(Source::rect({10, 20}, {4, 4, 4, 0}), Source::rect({10, 20}, 4)));
+    expect$(not Op::eq(Source::rect({10, 10}, 0), Source::ellipse({10, 10})));
+    expect$(not Op::eq(Source::icon(0xf02d1), Source::icon(0xf02d2)));
+
+    // Equal sources must land in the same bucket.
+    expect$(Op::eq(Source::rect({10, 20}, -0.0), Source::rect({10, 20}, 0.0)));
+    expectEq$(Source::rect({10, 20}, -0.0).hash(), Source::rect({10, 20}, 0.0).hash());
+
+    return Ok();
+}
+
+bench$(shapeGeometry) {
+    auto img = Media::Image::alloc({400, 300}, BGRA8888);
+    Context g;
+    g.begin(img);
+    g.scale(2);
+
+    // Only the edges the shapes are filled and stroked with are built, the
+    // time spent filling them doesn't change.
+    auto flattened = [&](auto build) {
+        g.begin();
+        build(g);
+        g._shape.clear();
+        createSolid(g._shape, g._path);
+        createStroke(g._shape, g._path, g.strokeStyle());
+    };
+
+    auto cached = [&](ShapeCache::Source source, auto build) {
+        g.path(source, {}, build);
+        g._shape.clear();
+        g._cachedShape(NONE);
+        g._cachedShape(g.strokeStyle());
+    };
+
+    auto rect = [](Context &g) {
+        g.rect({0, 0, 32, 24}, 6);
+    };
+
+    auto heart = [](Context &g) {
+        g.evalSvg("M12 21.35l-1.45-1.32C5.4 15.36 2 12.28 2 8.5 2 5.42 4.42 3 7.5 3c1.74 0 3.41.81 4.5 2.09C13.09 3.81 14.76 3 16.5 3 19.58 3 22 5.42 22 8.5c0 3.78-3.4 6.86-8.55 11.54L12 21.35z");
+    };
+
+    _driver.bench("rounded rect (flattened)", [&] {
+        flattened(rect);
+    });
+
+    _driver.bench("rounded rect (cached)", [&] {
+        cached(ShapeCache::Source::rect({32, 24}, 6), rect);
+    });
+
+    _driver.bench("icon (flattened)", [&] {
+        flattened(heart);
+    });
+
+    _driver.bench("icon (cached)", [&] {
+        cached(ShapeCache::Source::icon((u32)Mdi::HEART), heart);
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
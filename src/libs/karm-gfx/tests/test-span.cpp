@@ -0,0 +1,143 @@
+#include <karm-gfx/buffer.h>
+#include <karm-gfx/span.h>
+#include <karm-math/funcs.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Gfx::Tests {
+
+test$(blendSpanMatchesBlendOver) {
+    static constexpr usize LEN = 256 + 3;
+
+    u32 dst[LEN], src[LEN];
+    u32 expected[LEN];
+    u8 mask[LEN];
+
+    for (usize i = 0; i < LEN; i++) {
+        // Every 7th pixel has a translucent background to exercise the fallback.
+        auto bg = Color::fromRgba(i * 3, 255 - i, i * 7, i % 7 ? 255 : i);
+        auto fg = Color::fromRgba(i * 5, i * 11, 200, i);
+        Bgra8888::store(&dst[i], bg);
+        Bgra8888::store(&src[i], fg);
+        Bgra8888::store(&expected[i], fg.blendOver(bg));
+        mask[i] = i;
+    }
+
+    blendSpan(reinterpret_cast<u8 *>(dst), src, LEN);
+    for (usize i = 0; i < LEN; i++)
+        expectEq$(dst[i], expected[i]);
+
+    u32 color;
+    Bgra8888::store(&color, Color::fromRgb(10, 20, 30));
+
+    for (usize i = 0; i < LEN; i++) {
+        auto bg = Color::fromRgba(i, i, i, i % 5 ? 255 : 128);
+        Bgra8888::store(&dst[i], bg);
+        Bgra8888::store(&expected[i], Color::fromRgba(10, 20, 30, mask[i]).blendOver(bg));
+    }
+
+    blendSpan(reinterpret_cast<u8 *>(dst), color, mask, LEN);
+    for (usize i = 0; i < LEN; i++)
+        expectEq$(dst[i], expected[i]);
+
+    return Ok();
+}
+
+static u32 _blendPm(u32 src, u32 dst) {
+    u8 s[4], d[4];
+    memcpy(s, &src, 4);
+    memcpy(d, &dst, 4);
+    for (usize i = 0; i < 4; i++)
+        d[i] = min(s[i] + div255Round(d[i] * (255 - s[3])), 255u);
+    memcpy(&dst, d, 4);
+    return dst;
+}
+
+test$(blendSpanPmMatchesScalar) {
+    static constexpr usize LEN = 256 + 3;
+
+    u32 dst[LEN], src[LEN];
+    u32 expected[LEN];
+    u8 mask[LEN];
+
+    for (usize i = 0; i < LEN; i++) {
+        auto bg = Color::fromRgba(i * 3, 255 - i, i * 7, i % 7 ? 255 : i);
+        auto fg = Color::fromRgba(i * 5, i * 11, 200, i % 11 ? i : 255);
+        Bgra8888Pm::store(&dst[i], bg);
+        Bgra8888Pm::store(&src[i], fg);
+        expected[i] = _blendPm(src[i], dst[i]);
+        mask[i] = i % 13 ? i : 0;
+    }
+
+    blendSpanPm(reinterpret_cast<u8 *>(dst), src, LEN);
+    for (usize i = 0; i < LEN; i++)
+        expectEq$(dst[i], expected[i]);
+
+    u32 color;
+    Bgra8888::store(&color, Color::fromRgb(10, 20, 30));
+
+    for (usize i = 0; i < LEN; i++) {
+        Bgra8888Pm::store(&dst[i], Color::fromRgba(i, i, i, i % 5 ? 255 : 128));
+        u32 scaled;
+        Bgra8888Pm::store(&scaled, Color::fromRgba(10, 20, 30, mask[i]));
+        expected[i] = _blendPm(scaled, dst[i]);
+    }
+
+    blendSpanPm(reinterpret_cast<u8 *>(dst), color, mask, LEN);
+    for (usize i = 0; i < LEN; i++)
+        expectEq$(dst[i], expected[i]);
+
+    return Ok();
+}
+
+test$(premultipliedRoundTrip) {
+    // Converting to premultiplied and back is lossless for opaque pixels and
+    // close enough for translucent ones.
+    for (u32 a = 0; a < 256; a += 5) {
+        for (u32 c = 0; c < 256; c += 3) {
+            auto color = Color::fromRgba(c, 255 - c, c / 2, a);
+            auto back = color.premultiply().unpremultiply();
+            expectEq$(back.alpha, color.alpha);
+            if (a == 0)
+                continue;
+
+            isize tolerance = a == 255 ? 0 : 255 / a + 1;
+            expectLteq$(Math::abs((isize)back.red - (isize)color.red), tolerance);
+            expectLteq$(Math::abs((isize)back.green - (isize)color.green), tolerance);
+            expectLteq$(Math::abs((isize)back.blue - (isize)color.blue), tolerance);
+        }
+    }
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(blendSpanTranslucent) {
+    // Blending into a layer, where the destination isn't opaque.
+    static constexpr usize LEN = 1920;
+
+    Vec<u32> dst, src;
+    dst.resize(LEN);
+    src.resize(LEN);
+
+    for (usize i = 0; i < LEN; i++) {
+        Bgra8888::store(&dst[i], Color::fromRgba(i, 255 - i, i * 7, i | 1));
+        Bgra8888::store(&src[i], Color::fromRgba(i * 5, i * 11, 200, i | 1));
+    }
+
+    _driver.bench("straight", [&] {
+        blendSpan(reinterpret_cast<u8 *>(dst.buf()), src.buf(), LEN);
+    });
+
+    for (usize i = 0; i < LEN; i++) {
+        Bgra8888Pm::store(&dst[i], Color::fromRgba(i, 255 - i, i * 7, i | 1));
+        Bgra8888Pm::store(&src[i], Color::fromRgba(i * 5, i * 11, 200, i | 1));
+    }
+
+    _driver.bench("premultiplied", [&] {
+        blendSpanPm(reinterpret_cast<u8 *>(dst.buf()), src.buf(), LEN);
+    });
+
+    return Ok();
+}
+
+} // namespace Karm::Gfx::Tests
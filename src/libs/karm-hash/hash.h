@@ -9,6 +9,13 @@
 #include <karm-io/traits.h>
 #include <karm-logger/logger.h>
 
+#if defined(__x86_64__)
+#    include <cpuid.h>
+#    include <immintrin.h>
+#elif defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
 namespace Karm::Hash {
 
 template <typename T>
@@ -31,6 +38,34 @@ template <usize bits, typename TAG>
 struct Digest : public Array<u8, bits / 8> {
 };
 
+/* --- Cpu Features --------------------------------------------------------- */
+
+#if defined(__x86_64__)
+
+// Extensions used by the accelerated hashes, too recent to be assumed at
+// compile time so they are looked up once at runtime.
+struct _X86 {
+    bool clmul = false;
+    bool sha = false;
+
+    static _X86 const &get() {
+        static _X86 const x86 = [] {
+            _X86 res;
+            u32 a, b, c, d;
+            if (not __get_cpuid(1, &a, &b, &c, &d))
+                return res;
+            bool sse41 = (c & bit_SSSE3) and (c & bit_SSE4_1);
+            res.clmul = sse41 and (c & bit_PCLMUL);
+            if (__get_cpuid_count(7, 0, &a, &b, &c, &d))
+                res.sha = sse41 and (b & bit_SHA);
+            return res;
+        }();
+        return x86;
+    }
+};
+
+#endif
+
 /* --- Adler32 -------------------------------------------------------------- */
 
 // References:
@@ -39,15 +74,65 @@ struct Digest : public Array<u8, bits / 8> {
 struct Adler32 {
     using Digest = Digest<32, struct Adler32>;
 
+    static constexpr u32 MOD = 65521;
+
+    // Largest number of bytes that can be summed before `s2` may overflow.
+    static constexpr usize NMAX = 5552;
+
+#if defined(__SSE2__)
+    // Sum `n` blocks of 16 bytes. Each byte adds itself to `s1` and, once
+    // per remaining position in the block, to `s2`, so the weights are
+    // applied with a multiply-add and the `s1` carried into the following
+    // blocks is accumulated separately.
+    ALWAYS_INLINE static void _addBlocks(u32 &s1, u32 &s2, Byte const *buf, usize n) {
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const wLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+        __m128i const wHi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+
+        __m128i vs1 = zero;
+        __m128i vs2 = zero;
+        __m128i carry = zero;
+        for (usize i = 0; i < n; i++, buf += 16) {
+            __m128i v = _mm_loadu_si128((__m128i const *)buf);
+            carry = _mm_add_epi32(carry, vs1);
+            vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(v, zero));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), wLo));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), wHi));
+        }
+
+        auto hsum = [](__m128i v) -> u32 {
+            v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+            v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xb1));
+            return _mm_cvtsi128_si32(v);
+        };
+
+        s2 += s1 * 16 * n + hsum(carry) * 16 + hsum(vs2);
+        s1 += hsum(vs1);
+    }
+#endif
+
     u32 _sum = 1;
 
     void add(Bytes bytes) {
         u32 s1 = _sum & 0xffff;
         u32 s2 = _sum >> 16;
 
-        for (usize i = 0; i < bytes.len(); ++i) {
-            s1 = (s1 + bytes[i]) % 65521;
-            s2 = (s2 + s1) % 65521;
+        Byte const *buf = bytes.buf();
+        usize len = bytes.len();
+        while (len) {
+            usize n = min(len, NMAX);
+            len -= n;
+#if defined(__SSE2__)
+            _addBlocks(s1, s2, buf, n / 16);
+            buf += n & ~15uz;
+            n &= 15;
+#endif
+            while (n--) {
+                s1 += *buf++;
+                s2 += s1;
+            }
+            s1 %= MOD;
+            s2 %= MOD;
         }
 
         _sum = (s2 << 16) + s1;
@@ -70,36 +155,129 @@ struct Adler32 {
 
 // References:
 // https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+// https://create.stephan-brumme.com/crc32/#slicing-by-8-overview
+// https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/fast-crc-computation-generic-polynomials-pclmulqdq-paper.pdf
 
 struct Crc32 {
     using Digest = Digest<32, struct Crc32>;
 
-    u32 _sum = 0xffffffff;
-    Array<u32, 256> _table{};
+    static constexpr u32 POLY = 0xedb88320;
 
-    Crc32(u32 poly = 0xedb88320)
-        : _table(makeTable(poly)) {}
-
-    static constexpr Array<u32, 256> makeTable(u32 poly) {
-        Array<u32, 256> table;
+    // TABLE[k][b] is the crc of the byte `b` followed by `k` zero bytes,
+    // which lets the slicing loop combine 8 lookups per word.
+    static constexpr Array<Array<u32, 256>, 8> TABLE = [] {
+        Array<Array<u32, 256>, 8> table{};
         for (u32 i = 0; i < 256; ++i) {
             u32 c = i;
-            for (u32 j = 0; j < 8; ++j) {
-                if (c & 1) {
-                    c = (c >> 1) ^ poly;
-                } else {
-                    c >>= 1;
-                }
-            }
-            table[i] = c;
+            for (u32 j = 0; j < 8; ++j)
+                c = (c >> 1) ^ ((c & 1) ? POLY : 0);
+            table[0][i] = c;
         }
+        for (usize k = 1; k < 8; ++k)
+            for (u32 i = 0; i < 256; ++i)
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
         return table;
+    }();
+
+    u32 _sum = 0xffffffff;
+
+    static u32 _addSlicing(u32 crc, Bytes bytes) {
+        Byte const *buf = bytes.buf();
+        usize len = bytes.len();
+
+        for (; len >= 8; buf += 8, len -= 8) {
+            u64le word;
+            memcpy(&word, buf, 8);
+            u64 w = word;
+            u32 lo = (u32)w ^ crc;
+            u32 hi = w >> 32;
+            crc = TABLE[7][lo & 0xff] ^ TABLE[6][(lo >> 8) & 0xff] ^
+                  TABLE[5][(lo >> 16) & 0xff] ^ TABLE[4][lo >> 24] ^
+                  TABLE[3][hi & 0xff] ^ TABLE[2][(hi >> 8) & 0xff] ^
+                  TABLE[1][(hi >> 16) & 0xff] ^ TABLE[0][hi >> 24];
+        }
+
+        while (len--)
+            crc = TABLE[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+        return crc;
     }
 
+#if defined(__x86_64__)
+    [[gnu::target("pclmul,sse4.1")]] ALWAYS_INLINE static __m128i _fold(__m128i x, __m128i k, __m128i next) {
+        __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+        __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+    }
+
+    // Fold 64 bytes at a time with carry-less multiplies, then reduce the
+    // remainder with a Barrett reduction. Needs at least 64 bytes.
+    [[gnu::target("pclmul,sse4.1")]] static u32 _addClmul(u32 crc, Bytes bytes) {
+        Byte const *buf = bytes.buf();
+        usize len = bytes.len();
+
+        auto load = [&] {
+            __m128i v = _mm_loadu_si128((__m128i const *)buf);
+            buf += 16;
+            len -= 16;
+            return v;
+        };
+
+        __m128i x0 = _mm_xor_si128(load(), _mm_cvtsi32_si128(crc));
+        __m128i x1 = load();
+        __m128i x2 = load();
+        __m128i x3 = load();
+
+        // x^(512+64) and x^(512) modulo the polynomial, bit reflected.
+        __m128i k = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+        while (len >= 64) {
+            x0 = _fold(x0, k, load());
+            x1 = _fold(x1, k, load());
+            x2 = _fold(x2, k, load());
+            x3 = _fold(x3, k, load());
+        }
+
+        // Same for a distance of 128 bits.
+        k = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+        x0 = _fold(x0, k, x1);
+        x0 = _fold(x0, k, x2);
+        x0 = _fold(x0, k, x3);
+        while (len >= 16)
+            x0 = _fold(x0, k, load());
+
+        // 128 to 64 bits.
+        __m128i mask = _mm_setr_epi32(~0, 0, 0, 0);
+        __m128i t = _mm_srli_si128(x0, 8);
+        x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, k, 0x10), t);
+
+        // 64 to 32 bits.
+        t = _mm_srli_si128(x0, 4);
+        x0 = _mm_and_si128(x0, mask);
+        x0 = _mm_clmulepi64_si128(x0, _mm_set_epi64x(0, 0x163cd6124), 0x00);
+        x0 = _mm_xor_si128(x0, t);
+
+        // Barrett reduction with the polynomial and its inverse.
+        k = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+        t = x0;
+        x0 = _mm_and_si128(x0, mask);
+        x0 = _mm_clmulepi64_si128(x0, k, 0x10);
+        x0 = _mm_and_si128(x0, mask);
+        x0 = _mm_clmulepi64_si128(x0, k, 0x00);
+        x0 = _mm_xor_si128(x0, t);
+        crc = _mm_extract_epi32(x0, 1);
+
+        return _addSlicing(crc, {buf, len});
+    }
+#endif
+
     void add(Bytes bytes) {
-        for (usize i = 0; i < bytes.len(); ++i) {
-            _sum = _table[(_sum ^ bytes[i]) & 0xff] ^ (_sum >> 8);
+#if defined(__x86_64__)
+        if (bytes.len() >= 64 and _X86::get().clmul) {
+            _sum = _addClmul(_sum, bytes);
+            return;
         }
+#endif
+        _sum = _addSlicing(_sum, bytes);
     }
 
     void reset() {
@@ -270,10 +448,228 @@ struct Md5 {
     };
 };
 
+/* --- Sha256 --------------------------------------------------------------- */
+
+// References:
+// https://en.wikipedia.org/wiki/SHA-2
+// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
+// https://www.intel.com/content/www/us/en/developer/articles/technical/intel-sha-extensions.html
+
+struct Sha256 {
+    using Digest = Digest<256, struct Sha256>;
+
+    using State = Array<u32, 8>;
+
+    static constexpr State INIT = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    static constexpr Array<u32, 64> K = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    State _state = INIT;
+    Array<u8, 64> _buf{};
+    usize _bufLen = 0;
+    u64 _len = 0;
+
+    static void _compressPortable(State &state, Byte const *buf, usize blocks) {
+        for (; blocks; blocks--, buf += 64) {
+            Array<u32, 64> w;
+            for (usize i = 0; i < 16; i++) {
+                u32be word;
+                memcpy(&word, buf + i * 4, 4);
+                w[i] = word;
+            }
+            for (usize i = 16; i < 64; i++) {
+                u32 s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                u32 s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            u32 a = state[0], b = state[1], c = state[2], d = state[3];
+            u32 e = state[4], f = state[5], g = state[6], h = state[7];
+            for (usize i = 0; i < 64; i++) {
+                u32 s1 = ror(e, 6) ^ ror(e, 11) ^ ror(e, 25);
+                u32 ch = (e & f) ^ (~e & g);
+                u32 t1 = h + s1 + ch + K[i] + w[i];
+                u32 s0 = ror(a, 2) ^ ror(a, 13) ^ ror(a, 22);
+                u32 maj = (a & b) ^ (a & c) ^ (b & c);
+                u32 t2 = s0 + maj;
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+#if defined(__x86_64__)
+    // Four rounds of the SHA extensions, `G` being the index of the group of
+    // rounds. The message schedule is computed on the fly, four words per
+    // vector, in a window of four vectors rotating through `prev`, `cur` and
+    // `next`.
+    template <usize G>
+    [[gnu::target("sha,sse4.1")]] ALWAYS_INLINE static void _roundsShaNi(__m128i &abef, __m128i &cdgh, __m128i &prev, __m128i &cur, __m128i &next) {
+        __m128i m = _mm_add_epi32(cur, _mm_loadu_si128((__m128i const *)&K[G * 4]));
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, m);
+        if constexpr (G >= 3 and G < 15) {
+            next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));
+            next = _mm_sha256msg2_epu32(next, cur);
+        }
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(m, 0x0e));
+        if constexpr (G >= 1 and G < 13)
+            prev = _mm_sha256msg1_epu32(prev, cur);
+    }
+
+    [[gnu::target("sha,sse4.1")]] static void _compressShaNi(State &state, Byte const *buf, usize blocks) {
+        __m128i const bswap = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+        // The instructions want the state as ABEF and CDGH.
+        __m128i dcba = _mm_loadu_si128((__m128i const *)&state[0]);
+        __m128i hgfe = _mm_loadu_si128((__m128i const *)&state[4]);
+        __m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+        __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+        for (; blocks; blocks--, buf += 64) {
+            __m128i abefSave = abef;
+            __m128i cdghSave = cdgh;
+
+            __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(buf + 0)), bswap);
+            __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(buf + 16)), bswap);
+            __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(buf + 32)), bswap);
+            __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(buf + 48)), bswap);
+
+            _roundsShaNi<0>(abef, cdgh, m3, m0, m1);
+            _roundsShaNi<1>(abef, cdgh, m0, m1, m2);
+            _roundsShaNi<2>(abef, cdgh, m1, m2, m3);
+            _roundsShaNi<3>(abef, cdgh, m2, m3, m0);
+            _roundsShaNi<4>(abef, cdgh, m3, m0, m1);
+            _roundsShaNi<5>(abef, cdgh, m0, m1, m2);
+            _roundsShaNi<6>(abef, cdgh, m1, m2, m3);
+            _roundsShaNi<7>(abef, cdgh, m2, m3, m0);
+            _roundsShaNi<8>(abef, cdgh, m3, m0, m1);
+            _roundsShaNi<9>(abef, cdgh, m0, m1, m2);
+            _roundsShaNi<10>(abef, cdgh, m1, m2, m3);
+            _roundsShaNi<11>(abef, cdgh, m2, m3, m0);
+            _roundsShaNi<12>(abef, cdgh, m3, m0, m1);
+            _roundsShaNi<13>(abef, cdgh, m0, m1, m2);
+            _roundsShaNi<14>(abef, cdgh, m1, m2, m3);
+            _roundsShaNi<15>(abef, cdgh, m2, m3, m0);
+
+            abef = _mm_add_epi32(abef, abefSave);
+            cdgh = _mm_add_epi32(cdgh, cdghSave);
+        }
+
+        __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+        __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+        _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(feba, dchg, 0xf0));
+        _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(dchg, feba, 8));
+    }
+#endif
+
+    static void _compress(State &state, Byte const *buf, usize blocks) {
+#if defined(__x86_64__)
+        if (_X86::get().sha) {
+            _compressShaNi(state, buf, blocks);
+            return;
+        }
+#endif
+        _compressPortable(state, buf, blocks);
+    }
+
+    void add(Bytes bytes) {
+        Byte const *buf = bytes.buf();
+        usize len = bytes.len();
+        _len += len;
+
+        if (_bufLen) {
+            usize n = min(len, 64 - _bufLen);
+            memcpy(_buf.buf() + _bufLen, buf, n);
+            _bufLen += n;
+            buf += n;
+            len -= n;
+            if (_bufLen < 64)
+                return;
+            _compress(_state, _buf.buf(), 1);
+            _bufLen = 0;
+        }
+
+        // Whole blocks are hashed in place.
+        _compress(_state, buf, len / 64);
+        buf += len & ~63uz;
+        len &= 63;
+
+        memcpy(_buf.buf(), buf, len);
+        _bufLen = len;
+    }
+
+    void reset() {
+        _state = INIT;
+        _bufLen = 0;
+        _len = 0;
+    }
+
+    State sum() const {
+        return _state;
+    }
+
+    Digest digest() const {
+        auto state = _state;
+
+        // Pad with a one bit, zeros and the length in bits, so that the
+        // message ends on a block boundary.
+        Array<u8, 128> tail{};
+        memcpy(tail.buf(), _buf.buf(), _bufLen);
+        tail[_bufLen] = 0x80;
+        usize blocks = _bufLen + 9 > 64 ? 2 : 1;
+        u64be bits = _len * 8;
+        memcpy(tail.buf() + blocks * 64 - 8, &bits, 8);
+        _compress(state, tail.buf(), blocks);
+
+        Digest digest;
+        for (usize i = 0; i < 8; i++) {
+            u32be word = state[i];
+            memcpy(digest.buf() + i * 4, &word, 4);
+        }
+        return digest;
+    }
+};
+
 #define FOR_EACH_HASH(HASH) \
     HASH(ADLER32, Adler32)  \
     HASH(CRC32, Crc32)      \
-    HASH(MD5, Md5)
+    HASH(MD5, Md5)          \
+    HASH(SHA256, Sha256)
 
 enum struct HashType {
     NIL,
@@ -345,6 +741,10 @@ struct AnyHash {
             _h = Md5{};
             break;
 
+        case HashType::SHA256:
+            _h = Sha256{};
+            break;
+
         default:
             unreachable();
             break;
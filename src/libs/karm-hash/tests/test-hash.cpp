@@ -0,0 +1,124 @@
+#include <karm-hash/hash.h>
+#include <karm-test/macros.h>
+#include <karm-test/samples.h>
+
+namespace Karm::Hash::Tests {
+
+static Bytes _bytes(Str str) {
+    return {(Byte const *)str.buf(), str.len()};
+}
+
+static Res<String> _sha256(Bytes bytes) {
+    return Fmt::format("{}", AnyDigest{digest<Sha256>(bytes)});
+}
+
+static Vec<u8> _noise(usize len) {
+    Vec<u8> buf;
+    buf.resize(len, 0);
+    u32 seed = 1;
+    for (auto &b : buf) {
+        seed = seed * 1103515245 + 12345;
+        b = seed >> 24;
+    }
+    return buf;
+}
+
+/* --- Known Answers -------------------------------------------------------- */
+
+test$(hashKnownAnswers) {
+    expectEq$(checksum<Adler32>(_bytes("Wikipedia")), 0x11e60398u);
+    expectEq$(checksum<Crc32>(_bytes("123456789")), 0xcbf43926u);
+    expectEq$(checksum<Crc32>(_bytes("The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.")), 0x9ae90aa7u);
+
+    auto empty = try$(_sha256(_bytes("")));
+    expectEq$(empty.str(), Str{"sha256:e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"});
+    auto abc = try$(_sha256(_bytes("abc")));
+    expectEq$(abc.str(), Str{"sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"});
+    auto twoBlocks = try$(_sha256(_bytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")));
+    expectEq$(twoBlocks.str(), Str{"sha256:248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"});
+
+    Vec<u8> a;
+    a.resize(1000000, 'a');
+    auto million = try$(_sha256(a));
+    expectEq$(million.str(), Str{"sha256:cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"});
+
+    return Ok();
+}
+
+/* --- Implementations ------------------------------------------------------ */
+
+test$(hashFastPathsMatchPortable) {
+    auto buf = _noise(70000);
+
+    for (usize len : {0uz, 1uz, 15uz, 16uz, 63uz, 64uz, 65uz, 127uz, 128uz, 1000uz, 5552uz, 5553uz, 69999uz}) {
+        auto bytes = sub(buf, 1, 1 + len);
+
+        u32 s1 = 1, s2 = 0;
+        for (auto b : bytes) {
+            s1 = (s1 + b) % Adler32::MOD;
+            s2 = (s2 + s1) % Adler32::MOD;
+        }
+        expectEq$(checksum<Adler32>(bytes), (s2 << 16) | s1);
+
+        u32 crc = 0xffffffff;
+        for (auto b : bytes)
+            crc = Crc32::TABLE[0][(crc ^ b) & 0xff] ^ (crc >> 8);
+        expectEq$(Crc32::_addSlicing(0xffffffff, bytes), crc);
+        expectEq$(checksum<Crc32>(bytes), ~crc);
+
+        auto blocks = len / 64;
+        auto fast = Sha256::INIT;
+        auto portable = Sha256::INIT;
+        Sha256::_compress(fast, bytes.buf(), blocks);
+        Sha256::_compressPortable(portable, bytes.buf(), blocks);
+        for (usize i = 0; i < 8; i++)
+            expectEq$(fast[i], portable[i]);
+    }
+
+    return Ok();
+}
+
+test$(hashIncremental) {
+    auto buf = _noise(10000);
+
+    Adler32 adler;
+    Crc32 crc;
+    Sha256 sha;
+    for (usize start = 0, step = 1; start < buf.len(); start += step, step = step * 3 % 997) {
+        auto bytes = sub(buf, start, start + step);
+        adler.add(bytes);
+        crc.add(bytes);
+        sha.add(bytes);
+    }
+
+    expectEq$(adler.sum(), checksum<Adler32>(buf));
+    expectEq$(crc.sum(), checksum<Crc32>(buf));
+    expect$(Op::eq(sha.digest().bytes(), digest<Sha256>(buf).bytes()));
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(hashThroughput) {
+    auto buf = _noise(16 << 20);
+
+    auto run = [&](Str name, auto h) -> Res<> {
+        auto expected = digest(buf, h);
+        return benchThroughput(_driver, name, buf.len(), "MB/s", [&]() -> Res<> {
+            h.reset();
+            h.add(buf);
+            expect$(Op::eq(h.digest().bytes(), expected.bytes()));
+            return Ok();
+        });
+    };
+
+    try$(run("adler32", Adler32{}));
+    try$(run("crc32", Crc32{}));
+    try$(run("md5", Md5{}));
+    try$(run("sha256", Sha256{}));
+
+    return Ok();
+}
+
+} // namespace Karm::Hash::Tests
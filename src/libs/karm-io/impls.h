@@ -105,7 +105,7 @@ struct BufReader :
     BufReader(Bytes buf) : _buf(buf), _pos(0) {}
 
     Res<usize> read(MutBytes bytes) override {
-        Bytes slice = sub(_buf, _pos, sizeOf(bytes));
+        Bytes slice = sub(_buf, _pos, _pos + sizeOf(bytes));
         usize read = copy(slice, bytes);
         _pos += read;
         return Ok(read);
@@ -146,12 +146,8 @@ struct BufferWriter : public Writer, public Flusher {
     BufferWriter(usize cap = 16) : _buf(cap) {}
 
     Res<usize> write(Bytes bytes) override {
-        usize written = 0;
-        for (auto byte : iter(bytes)) {
-            _buf.insert(_buf.len(), std::move(byte));
-            written += 1;
-        }
-        return Ok(written);
+        _buf.insert(COPY, _buf.len(), bytes.buf(), bytes.len());
+        return Ok(bytes.len());
     }
 
     Bytes bytes() const {
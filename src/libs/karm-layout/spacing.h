@@ -59,6 +59,13 @@ struct Spacing {
     constexpr Math::Vec2<T> all() const {
         return {start + end, top + bottom};
     }
+
+    constexpr Ordr cmp(Spacing const &other) const {
+        return ::cmp(start, other.start) |
+               ::cmp(top, other.top) |
+               ::cmp(end, other.end) |
+               ::cmp(bottom, other.bottom);
+    }
 };
 
 using Spacingi = Spacing<isize>;
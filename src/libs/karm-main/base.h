@@ -2,7 +2,10 @@
 
 #include <karm-base/rc.h>
 #include <karm-base/res.h>
+#include <karm-base/string.h>
 #include <karm-base/vec.h>
+#include <karm-meta/nocopy.h>
+
 struct Hook {
     virtual ~Hook() = default;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <karm-base/lock.h>
+#include <karm-gfx/context.h>
 #include <karm-math/rand.h>
 #include <karm-sys/mmap.h>
 #include <ttf/spec.h>
@@ -9,9 +11,23 @@
 namespace Karm::Media {
 
 struct TtfFontface : public Fontface {
+    // A glyph decoded once and kept flattened in font units, drawing it only
+    // transforms its vertices.
+    struct Outline {
+        Gfx::Path path;
+        f64 advance;
+    };
+
+    // Recently mapped runes, so the cmap is only walked on misses.
+    static constexpr usize MAPPINGS = 256;
+
     Sys::Mmap _mmap;
     Ttf::Font _ttf;
 
+    mutable Lock _lock;
+    mutable Array<Opt<Cons<Rune, usize>>, MAPPINGS> _mappings{};
+    mutable Vec<Opt<Strong<Outline>>> _outlines;
+
     static Res<Strong<TtfFontface>> load(Sys::Mmap &&mmap) {
         auto ttf = try$(Ttf::Font::load(mmap.bytes()));
         return Ok(makeStrong<TtfFontface>(std::move(mmap), ttf));
@@ -20,6 +36,38 @@ struct TtfFontface : public Fontface {
     TtfFontface(Sys::Mmap &&mmap, Ttf::Font ttf)
         : _mmap(std::move(mmap)),
           _ttf(std::move(ttf)) {
+        _outlines.resize(max(_ttf.numGlyphs(), 1uz));
+    }
+
+    // Must be called with the lock held.
+    usize _glyphId(Rune rune) const {
+        auto &mapping = _mappings[rune % MAPPINGS];
+        if (not mapping or mapping->car != rune)
+            mapping = Cons<Rune, usize>{rune, _ttf.glyphId(rune)};
+
+        // Out of range glyphs fallback to .notdef
+        return mapping->cdr < _outlines.len() ? mapping->cdr : 0;
+    }
+
+    Outline const &_outline(Rune rune) const {
+        LockScope scope(_lock);
+
+        auto glyphId = _glyphId(rune);
+
+        auto &outline = _outlines[glyphId];
+        if (not outline) {
+            auto o = makeStrong<Outline>();
+
+            // As precise as flattening a glyph drawn 1024 pixels tall.
+            auto k = _ttf.unitPerEm() / 1024.0;
+            o->path._tolerance *= k * k;
+            _ttf.glyphContour(o->path, glyphId);
+            o->advance = _ttf.glyphMetrics(glyphId).advance;
+
+            outline = o;
+        }
+
+        return **outline;
     }
 
     FontMetrics metrics() const override {
@@ -33,11 +81,16 @@ struct TtfFontface : public Fontface {
     }
 
     f64 advance(Rune c) const override {
-        return _ttf.glyphMetrics(c).advance;
+        return _outline(c).advance;
+    }
+
+    f64 kerning(Rune prev, Rune curr) const override {
+        LockScope scope(_lock);
+        return _ttf.glyphKerning(_glyphId(prev), _glyphId(curr));
     }
 
     void contour(Gfx::Context &g, Rune rune) const override {
-        _ttf.glyphContour(g, rune);
+        g.path(_outline(rune).path);
     }
 
     f64 units() const override {
@@ -6,7 +6,31 @@
 namespace Karm::Media {
 
 Strong<Fontface> Fontface::fallback() {
-    return makeStrong<VgaFontface>();
+    // Shared so every context uses the same face, and the same cached glyphs.
+    static Strong<Fontface> face = makeStrong<VgaFontface>();
+    return face;
+}
+
+Strong<Run> Fontface::_run(Str str) const {
+    auto h = hash(str);
+    auto &cached = _runs[h % RUNS];
+    if (cached and cached->hash == h and Op::eq(cached->str.str(), str))
+        return cached->run;
+
+    auto run = makeStrong<Run>();
+    run->glyphs.ensure(str.len());
+
+    Opt<Rune> prev = NONE;
+    for (auto r : iterRunes(str)) {
+        if (prev)
+            run->advance += kerning(*prev, r);
+        run->glyphs.pushBack({r, run->advance});
+        run->advance += advance(r);
+        prev = r;
+    }
+
+    cached = _CachedRun{h, str, run};
+    return run;
 }
 
 Font Font::fallback() {
@@ -45,9 +69,9 @@ FontMesure Font::mesureRune(Rune r) const {
 
 FontMesure Font::mesureStr(Str str) const {
     f64 adv = 0;
-    for (auto r : iterRunes(str)) {
-        adv += advance(r);
-    }
+    fontface->shape(str, [&](Run const &run) {
+        adv = run.advance * (fontsize / fontface->units());
+    });
 
     auto m = metrics();
     return {
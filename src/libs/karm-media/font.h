@@ -1,6 +1,9 @@
 #pragma once
 
+#include <karm-base/lock.h>
 #include <karm-base/rc.h>
+#include <karm-base/string.h>
+#include <karm-base/vec.h>
 #include <karm-math/rect.h>
 
 namespace Karm::Gfx {
@@ -74,7 +77,32 @@ struct FontMesure {
     Math::Vec2f baseline;
 };
 
+// A string laid out by a fontface, with kerning applied. Positions are in
+// font units, relative to the start of the run.
+struct Run {
+    struct Glyph {
+        Rune rune;
+        f64 x;
+    };
+
+    Vec<Glyph> glyphs;
+    f64 advance = 0;
+};
+
 struct Fontface {
+    // Runs are cached by string, a string with a colliding hash replaces the
+    // previous one.
+    static constexpr usize RUNS = 256;
+
+    struct _CachedRun {
+        u64 hash;
+        String str;
+        Strong<Run> run;
+    };
+
+    mutable Lock _runsLock;
+    mutable Array<Opt<_CachedRun>, RUNS> _runs{};
+
     static Strong<Fontface> fallback();
 
     virtual ~Fontface() = default;
@@ -86,6 +114,24 @@ struct Fontface {
     virtual void contour(Gfx::Context &g, Rune rune) const = 0;
 
     virtual f64 units() const = 0;
+
+    // Adjustment to the advance of `prev` when followed by `curr`.
+    virtual f64 kerning(Rune, Rune) const {
+        return 0;
+    }
+
+    // Must be called with the lock held.
+    Strong<Run> _run(Str str) const;
+
+    // Call `fn` with the run of the string, the run is only valid during
+    // the call. The lock is only held while looking it up.
+    void shape(Str str, auto fn) const {
+        auto run = [&] {
+            LockScope scope(_runsLock);
+            return _run(str);
+        }();
+        fn(*run);
+    }
 };
 
 struct Font {
@@ -4,12 +4,18 @@
 
 namespace Karm::Media {
 
-static Opt<Strong<Fontface>> _fontface = NONE;
 Strong<Fontface> Icon::fontface() {
-    if (!_fontface) {
-        _fontface = Media::loadFontfaceOrFallback("bundle://mdi-font/Material-Design-Icons.ttf"_url).unwrap();
-    }
-    return *_fontface;
+    // Loaded once, even when the first icons are painted from several threads.
+    static Strong<Fontface> face = Media::loadFontfaceOrFallback("bundle://mdi-font/Material-Design-Icons.ttf"_url).unwrap();
+    return face;
+}
+
+// The icon font is loaded once for good, the code point and the transform
+// are enough to find its outlines in the shape cache.
+void Icon::_contour(Gfx::Context &g, Strong<Fontface> face) const {
+    g.path(Gfx::ShapeCache::Source::icon((u32)_code), {}, [&](Gfx::Context &g) {
+        face->contour(g, (Rune)_code);
+    });
 }
 
 void Icon::fill(Gfx::Context &g, Math::Vec2i pos) const {
@@ -17,10 +23,9 @@ void Icon::fill(Gfx::Context &g, Math::Vec2i pos) const {
     auto scale = _size / face->units();
 
     g.save();
-    g.begin();
     g.origin(pos + Math::Vec2i{0, (isize)(face->metrics().ascend * scale)});
     g.scale(scale);
-    face->contour(g, (Rune)_code);
+    _contour(g, face);
     g.fill();
     g.restore();
 }
@@ -30,10 +35,9 @@ void Icon::stroke(Gfx::Context &g, Math::Vec2i pos) const {
     auto scale = _size / face->units();
 
     g.save();
-    g.begin();
     g.origin(pos + Math::Vec2i{0, (isize)(face->metrics().ascend * scale)});
     g.scale(scale);
-    face->contour(g, (Rune)_code);
+    _contour(g, face);
     g.stroke();
     g.restore();
 }
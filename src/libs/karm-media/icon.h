@@ -36,6 +36,8 @@ struct Icon {
         return _code;
     }
 
+    void _contour(Gfx::Context &g, Strong<Fontface> face) const;
+
     void fill(Gfx::Context &g, Math::Vec2i pos) const;
 
     void stroke(Gfx::Context &g, Math::Vec2i pos) const;
@@ -44,34 +44,26 @@ Res<Font> loadFontOrFallback(f64 size, Sys::Url url) {
     return Ok(Font::fallback());
 }
 
+// Decoded images are premultiplied once here rather than on every blit.
+
 static Res<Image> loadQoi(Bytes bytes) {
     auto qoi = try$(Qoi::Image::load(bytes));
-    auto img = Image::alloc({qoi.width(), qoi.height()});
+    auto img = Image::alloc({qoi.width(), qoi.height()}, Gfx::RGBA8888PM);
     try$(qoi.decode(img.mutPixels()));
     return Ok(img);
 }
 
 static Res<Image> loadPng(Bytes bytes) {
     auto png = try$(Png::Image::load(bytes));
-    auto img = Image::alloc({png.width(), png.height()});
-
-    img
-        .mutPixels()
-        .clear(Gfx::PINK);
-
-    // try$(png.decode(img));
+    auto img = Image::alloc({png.width(), png.height()}, Gfx::RGBA8888PM);
+    try$(png.decode(img.mutPixels()));
     return Ok(img);
 }
 
-static Res<Image> loadJpeg(Bytes bytes) {
+static Res<Image> loadJpeg(Bytes bytes, usize scale = 1) {
     auto jpeg = try$(Jpeg::Image::load(bytes));
-    auto img = Image::alloc({jpeg.width(), jpeg.height()});
-
-    img
-        .mutPixels()
-        .clear(Gfx::PINK);
-
-    // try$(jpeg.decode(img));
+    auto img = Image::alloc(jpeg.size(scale), Gfx::RGBA8888PM);
+    try$(jpeg.decode(img.mutPixels(), scale));
     return Ok(img);
 }
 
@@ -93,6 +85,23 @@ Res<Image> loadImage(Sys::Url url) {
     return loadImage(std::move(map));
 }
 
+Res<Image> loadThumbnail(Sys::Url url, Math::Vec2i size) {
+    auto file = try$(Sys::File::open(url));
+    auto map = try$(Sys::mmap().map(file));
+    if (not Jpeg::Image::isJpeg(map.bytes()))
+        return loadImage(std::move(map));
+
+    auto jpeg = try$(Jpeg::Image::load(map.bytes()));
+    usize scale = 8;
+    while (scale > 1) {
+        auto scaled = jpeg.size(scale);
+        if (scaled.x >= size.x or scaled.y >= size.y)
+            break;
+        scale /= 2;
+    }
+    return loadJpeg(map.bytes(), scale);
+}
+
 Res<Image> loadImageOrFallback(Sys::Url url) {
     if (auto result = loadImage(url); result) {
         return result;
@@ -21,6 +21,10 @@ Res<Image> loadImage(Sys::Mmap &&map);
 
 Res<Image> loadImage(Sys::Url url);
 
+// Load an image to be shown at `size` or smaller, JPEGs are decoded at the
+// smallest scale still covering it.
+Res<Image> loadThumbnail(Sys::Url url, Math::Vec2i size);
+
 Res<Image> loadImageOrFallback(Sys::Url url);
 
 } // namespace Karm::Media
@@ -0,0 +1,30 @@
+#include <karm-sys/thread.h>
+#include <karm-test/macros.h>
+
+test$(threadPoolParallelFor) {
+    for (usize workers : {0, 1, 3}) {
+        Sys::ThreadPool pool{workers};
+
+        for (usize round = 0; round < 64; round++) {
+            Array<Atomic<usize>, 100> hits{};
+            pool.parallelFor(hits.len(), [&](usize i) {
+                hits[i].fetchAdd(i + round);
+            });
+
+            for (usize i = 0; i < hits.len(); i++)
+                expectEq$(hits[i].load(), i + round);
+        }
+    }
+
+    return Ok();
+}
+
+test$(threadSpawnJoin) {
+    Atomic<usize> value = 0;
+    auto thread = try$(Sys::Thread::spawn([&] {
+        value.store(42);
+    }));
+    try$(thread.join());
+    expectEq$(value.load(), 42uz);
+    return Ok();
+}
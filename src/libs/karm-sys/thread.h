@@ -6,6 +6,10 @@
 #include <karm-base/rc.h>
 #include <karm-base/res.h>
 #include <karm-base/ring.h>
+#include <karm-base/vec.h>
+#include <karm-meta/nocopy.h>
+
+#include <embed-sys/sys.h>
 
 namespace Karm::Sys {
 
@@ -67,16 +71,145 @@ Cons<Tx<T>, Rx<T>> makeChannel() {
     };
 }
 
-struct Thread {
-    Res<Thread> spawn(Func<void(void)>);
+struct Thread : Meta::NoCopy {
+    usize _handle;
+
+    static Res<Thread> spawn(Func<void()> fn) {
+        auto *f = new Func<void()>(std::move(fn));
+        auto handle = Embed::spawnThread(
+            [](void *arg) {
+                auto *f = static_cast<Func<void()> *>(arg);
+                (*f)();
+                delete f;
+            },
+            f
+        );
+
+        if (not handle) {
+            delete f;
+            return handle.none();
+        }
+
+        return Ok(Thread{handle.unwrap()});
+    }
+
+    Thread(usize handle)
+        : _handle(handle) {}
+
+    Thread(Thread &&other)
+        : _handle(std::exchange(other._handle, 0)) {}
+
+    Thread &operator=(Thread &&other) {
+        std::swap(_handle, other._handle);
+        return *this;
+    }
+
+    Res<> join() {
+        return Embed::joinThread(std::exchange(_handle, 0));
+    }
+};
 
-    void join();
+/* --- Thread Pool ---------------------------------------------------------- */
+
+// A fixed set of worker threads running parallel loops. The calling thread
+// takes part in the work, so a pool without workers (or on a system without
+// threads) runs everything inline.
+struct ThreadPool : Meta::Static {
+    Vec<Thread> _workers;
+
+    // Bumped each time a new loop is published, workers wait on it.
+    Atomic<u32> _generation = 0;
+
+    // Number of workers still inside the current loop.
+    Atomic<u32> _busy = 0;
+
+    Atomic<usize> _next = 0;
+    usize _count = 0;
+    void *_ctx = nullptr;
+    void (*_job)(void *, usize) = nullptr;
+    Atomic<bool> _stop = false;
+
+    ThreadPool(usize workers = Embed::hardwareConcurrency() - 1) {
+        for (usize i = 0; i < workers; i++) {
+            auto thread = Thread::spawn([this] {
+                _loop();
+            });
+            if (not thread)
+                break;
+            _workers.pushBack(thread.take());
+        }
+    }
 
-    void detach();
+    ~ThreadPool() {
+        _stop.store(true);
+        _publish();
+        for (auto &w : _workers)
+            (void)w.join();
+    }
 
-    void exit();
+    // Number of threads working on a loop, including the caller.
+    usize concurrency() const {
+        return _workers.len() + 1;
+    }
 
-    void sleep(isize ms);
+    void _publish() {
+        _busy.store(_workers.len());
+        _generation.fetchInc();
+        (void)Embed::wakeAddr(&_generation._val, _workers.len());
+    }
+
+    void _work() {
+        usize i;
+        while ((i = _next.fetchInc()) < _count)
+            _job(_ctx, i);
+    }
+
+    void _loop() {
+        u32 seen = 0;
+        while (true) {
+            u32 gen;
+            while ((gen = _generation.load()) == seen)
+                if (not Embed::waitAddr(&_generation._val, seen))
+                    Embed::relaxe();
+            seen = gen;
+
+            if (_stop.load())
+                return;
+
+            _work();
+
+            if (_busy.fetchSub(1) == 1)
+                (void)Embed::wakeAddr(&_busy._val, 1);
+        }
+    }
+
+    // Call `fn(i)` for every i in [0, count) and return once all the calls
+    // are done. Indices are handed out in order but may complete in any order.
+    void parallelFor(usize count, auto fn) {
+        if (count == 0)
+            return;
+
+        if (_workers.len() == 0 or count == 1) {
+            for (usize i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        _ctx = &fn;
+        _job = [](void *ctx, usize i) {
+            (*static_cast<decltype(fn) *>(ctx))(i);
+        };
+        _count = count;
+        _next.store(0);
+        _publish();
+
+        _work();
+
+        u32 busy;
+        while ((busy = _busy.load()) != 0)
+            if (not Embed::waitAddr(&_busy._val, busy))
+                Embed::relaxe();
+    }
 };
 
 } // namespace Karm::Sys
@@ -9,7 +9,10 @@
 namespace Karm::Test {
 
 void Driver::add(Test *test) {
-    _tests.pushBack(test);
+    if (test->_bench)
+        _benchs.pushBack(test);
+    else
+        _tests.pushBack(test);
 }
 
 static auto GREEN = Cli::Style{Cli::GREEN}.bold();
@@ -58,6 +61,28 @@ void Driver::runAll() {
     Sys::errln("");
 }
 
+void Driver::runAllBenchs() {
+    Sys::errln("Running {} benchmarks...", _benchs.len());
+
+    for (auto *bench : _benchs) {
+        Sys::errln("");
+        Sys::errln(" {} {}", Cli::styled("BENCH", NOTE), bench->_name);
+
+        auto result = bench->run(*this);
+        if (not result)
+            Sys::errln("   {}", Cli::styled(result.none().msg(), RED));
+    }
+
+    Sys::errln("");
+}
+
+void Driver::report(Str label, usize iterations, TimeSpan elapsed) {
+    Sys::errln("   {}: {} us/iter ({} iterations)",
+               label,
+               Cli::styled(elapsed.toUSecs() / iterations, GREEN),
+               iterations);
+}
+
 Driver &driver() {
     static Opt<Driver> driver;
     if (not driver) {
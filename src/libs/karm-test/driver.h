@@ -3,6 +3,7 @@
 #include <karm-base/loc.h>
 #include <karm-base/vec.h>
 #include <karm-sys/chan.h>
+#include <karm-sys/time.h>
 
 namespace Karm::Test {
 
@@ -10,11 +11,33 @@ struct Test;
 
 struct Driver {
     Vec<Test *> _tests;
+    Vec<Test *> _benchs;
 
     void add(Test *test);
 
     void runAll();
 
+    void runAllBenchs();
+
+    void report(Str label, usize iterations, TimeSpan elapsed);
+
+    // Run `fn` repeatedly for at least `budget` and report the mean time per iteration.
+    TimeSpan bench(Str label, auto fn, TimeSpan budget = TimeSpan::fromMSecs(250)) {
+        fn(); // warm up
+
+        usize iterations = 0;
+        auto start = Sys::uptime();
+        auto elapsed = TimeSpan::zero();
+        while (elapsed.toUSecs() < budget.toUSecs()) {
+            fn();
+            iterations++;
+            elapsed = Sys::uptime() - start;
+        }
+
+        report(label, iterations, elapsed);
+        return TimeSpan::fromUSecs(elapsed.toUSecs() / iterations);
+    }
+
     Res<> unexpect(auto const &__lhs, auto const &__rhs, Str op, Loc = Loc::current()) {
         Sys::errln("unexpected: '{}' {} '{}'", __lhs, op, __rhs);
         return Error::other("unexpected");
@@ -13,6 +13,11 @@ namespace Karm::Test {
     static ::Karm::Test::Test var$(_test){#ID, var$(ID)};                           \
     static ::Karm::Res<> var$(ID)([[maybe_unused]] ::Karm::Test::Driver & _driver)
 
+#define bench$(ID)                                                                  \
+    static ::Karm::Res<> var$(ID)([[maybe_unused]] ::Karm::Test::Driver & _driver); \
+    static ::Karm::Test::Test var$(_bench){#ID, var$(ID), true};                    \
+    static ::Karm::Res<> var$(ID)([[maybe_unused]] ::Karm::Test::Driver & _driver)
+
 #define __expect$(LHS, RHS, OP)                         \
     ({                                                  \
         /* Make sure LHS and RHS are evaluated once */  \
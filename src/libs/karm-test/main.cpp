@@ -1,7 +1,10 @@
 #include <karm-main/main.h>
 #include <karm-test/driver.h>
 
-Res<> entryPoint(Ctx &) {
-    Test::driver().runAll();
+Res<> entryPoint(Ctx &ctx) {
+    if (useArgs(ctx).has("--bench"))
+        Test::driver().runAllBenchs();
+    else
+        Test::driver().runAll();
     return Ok();
 }
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <karm-sys/file.h>
+#include <karm-sys/mmap.h>
+
+#include "driver.h"
+
+namespace Karm::Test {
+
+// Map a sample file shipped with the tests, `name` is relative to `dir`.
+inline Res<Sys::Mmap> loadSample(Sys::Url dir, Str name) {
+    dir.append(name);
+    auto file = try$(Sys::File::open(dir));
+    return Sys::mmap().map(file);
+}
+
+// Bench `fn`, which goes through `len` units each call, and report how many
+// millions of them it goes through per second.
+inline Res<> benchThroughput(Driver &driver, Str label, usize len, Str unit, auto fn) {
+    Res<> res = Ok();
+    auto elapsed = driver.bench(label, [&] {
+        if (res)
+            res = fn();
+    });
+    try$(res);
+
+    Sys::errln("   {}: {} {}", label, len / max(elapsed.toUSecs(), 1uz), unit);
+    return Ok();
+}
+
+} // namespace Karm::Test
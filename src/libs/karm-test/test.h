@@ -16,10 +16,11 @@ struct Test : Meta::Static {
 
     Str _name;
     Func _func;
+    bool _bench;
     Loc _loc;
 
-    Test(Str name, Func func, Loc loc = Loc::current())
-        : _name(name), _func(func), _loc(loc) {
+    Test(Str name, Func func, bool bench = false, Loc loc = Loc::current())
+        : _name(name), _func(func), _bench(bench), _loc(loc) {
         driver().add(this);
     }
 
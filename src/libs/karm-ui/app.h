@@ -21,35 +21,35 @@ Child inspector(Child child) {
             button(
                 [](auto &n) {
                     debugShowLayoutBounds = !debugShowLayoutBounds;
-                    Ui::shouldLayout(n);
+                    Ui::shouldRepaintAll(n);
                 },
                 ButtonStyle::subtle(),
                 Mdi::RULER_SQUARE),
             button(
                 [](auto &n) {
                     debugShowRepaintBounds = !debugShowRepaintBounds;
-                    Ui::shouldLayout(n);
+                    Ui::shouldRepaintAll(n);
                 },
                 ButtonStyle::subtle(),
                 Mdi::BRUSH),
             button(
                 [](auto &n) {
                     debugShowEmptyBounds = !debugShowEmptyBounds;
-                    Ui::shouldLayout(n);
+                    Ui::shouldRepaintAll(n);
                 },
                 ButtonStyle::subtle(),
                 Mdi::BORDER_NONE_VARIANT),
             button(
                 [](auto &n) {
                     debugShowScrollBounds = !debugShowScrollBounds;
-                    Ui::shouldLayout(n);
+                    Ui::shouldRepaintAll(n);
                 },
                 ButtonStyle::subtle(),
                 Mdi::ARROW_UP_DOWN),
             button(
                 [](auto &n) {
                     debugShowPerfGraph = !debugShowPerfGraph;
-                    Ui::shouldLayout(n);
+                    Ui::shouldRepaintAll(n);
                 },
                 ButtonStyle::subtle(),
                 Mdi::CHART_HISTOGRAM)) |
@@ -65,18 +65,22 @@ struct BoxStyle {
         return copy;
     }
 
+    // Only the margin and padding take part in the layout.
+    bool sameLayout(BoxStyle const &other) const {
+        return Op::eq(margin, other.margin) and Op::eq(padding, other.padding);
+    }
+
     void paint(Gfx::Context &g, Math::Recti bound, auto inner) {
         bound = padding.grow(Layout::Flow::LEFT_TO_RIGHT, bound);
 
         g.save();
         if (backgroundPaint) {
-            g.begin();
-            g.rect(bound.cast<f64>(), borderRadius);
-
             if (shadowStyle) {
-                g.shadow(*shadowStyle);
+                g.shadow(bound, borderRadius, *shadowStyle);
             }
 
+            g.begin();
+            g.rect(bound.cast<f64>(), borderRadius);
             g.fill(*backgroundPaint);
         }
 
@@ -115,14 +119,14 @@ struct _Box : public ProxyNode<Crtp> {
         rect = boxStyle().margin.shrink(Layout::Flow::LEFT_TO_RIGHT, rect);
         rect = boxStyle().padding.shrink(Layout::Flow::LEFT_TO_RIGHT, rect);
 
-        ProxyNode<Crtp>::child().layout(rect);
+        ProxyNode<Crtp>::child().place(rect);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
         s = s - boxStyle().margin.all();
         s = s - boxStyle().padding.all();
 
-        s = ProxyNode<Crtp>::child().size(s, hint);
+        s = ProxyNode<Crtp>::child().measure(s, hint);
 
         s = s + boxStyle().padding.all();
         s = s + boxStyle().margin.all();
@@ -143,6 +147,8 @@ struct Box : public _Box<Box> {
         : _Box(child), _style(style) {}
 
     void reconcile(Box &o) override {
+        if (not _style.sameLayout(o._style))
+            invalidateLayout();
         _style = o._style;
         _Box<Box>::reconcile(o);
     }
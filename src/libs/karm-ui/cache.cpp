@@ -0,0 +1,248 @@
+#include <karm-gfx/display-list.h>
+#include <karm-media/image.h>
+
+#include "cache.h"
+#include "damage.h"
+
+namespace Karm::Ui {
+
+/* --- Cached --------------------------------------------------------------- */
+
+struct Cached : public ProxyNode<Cached> {
+    // Held while the layer is rendered or blitted, so it's neither
+    // rendered twice nor evicted while in use by another thread.
+    Lock _lock;
+    Math::Recti _bound{};
+    Opt<Media::Image> _image;
+    Damage _damage;
+
+    // Set while the subtree is moved along with the layer, what it reports
+    // then is the same pixels somewhere else on the screen.
+    bool _moving = false;
+
+    Cached(Child child)
+        : ProxyNode(child) {}
+
+    ~Cached() {
+        auto &cache = layerCache();
+        LockScope scope(cache._lock);
+        _drop();
+        cache._forget(this);
+    }
+
+    usize _bytes() const {
+        return _image ? _image->_buf->len() : 0;
+    }
+
+    // Must be called with the cache lock held.
+    void _drop() {
+        layerCache()._used -= _bytes();
+        _image = NONE;
+    }
+
+    void _render(Gfx::Fmt fmt) {
+        auto &cache = layerCache();
+
+        if (not _image) {
+            _image = Media::Image::alloc(_bound.size(), fmt.withPremultiplied());
+            _damage.clear();
+            _damage.add(_bound);
+
+            LockScope scope(cache._lock);
+            cache._used += _bytes();
+        }
+
+        if (_damage.empty()) {
+            LockScope scope(cache._lock);
+            cache._hits++;
+            return;
+        }
+
+        {
+            LockScope scope(cache._lock);
+            cache._misses++;
+        }
+
+        Gfx::Context g;
+        g.begin(*_image);
+        g.origin(-_bound.xy);
+        for (auto r : _damage) {
+            g.save();
+            g.clip(r);
+            g.clear(r, Gfx::ALPHA);
+            child().paint(g, r);
+            g.restore();
+        }
+        g.end();
+
+        _damage.clear();
+    }
+
+    void reconcile(Cached &o) override {
+        ProxyNode::reconcile(o);
+
+        // The new subtree might look different even if nothing bubbled up.
+        _damage.add(_bound);
+    }
+
+    void paint(Gfx::Context &g, Math::Recti r) override {
+        if (_bound.width <= 0 or _bound.height <= 0)
+            return;
+
+        // There are no pixels to take the format of the layer from, and the
+        // display list being recorded already saves drawing the subtree
+        // again.
+        if (g.recording()) {
+            child().paint(g, r);
+            return;
+        }
+
+        LockScope scope(_lock);
+        _render(g.pixels().fmt());
+
+        {
+            auto &cache = layerCache();
+            LockScope cacheScope(cache._lock);
+            cache._use(this);
+            cache._evict(this);
+        }
+
+        g.blit(_bound, *_image);
+    }
+
+    void bubble(Events::Event &e) override {
+        if (e.is<Events::PaintEvent>() and not _moving)
+            _damage.add(e.unwrap<Events::PaintEvent>().bound.clipTo(_bound));
+
+        ProxyNode::bubble(e);
+    }
+
+    void layout(Math::Recti r) override {
+        // The layer is drawn relative to the bound, moving it only moves
+        // where it's blitted, unless the subtree is also laid out anew.
+        if (Op::ne(r.wh, _bound.wh)) {
+            LockScope scope(layerCache()._lock);
+            _drop();
+        } else if (Op::ne(r.xy, _bound.xy) and child()._needsLayout) {
+            _damage.add(r);
+        }
+
+        _moving = Op::ne(r.xy, _bound.xy);
+        _bound = r;
+        child().place(r);
+        _moving = false;
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+Child cached(Child child) {
+    return makeStrong<Cached>(child);
+}
+
+/* --- Recorded ------------------------------------------------------------- */
+
+struct Recorded : public ProxyNode<Recorded> {
+    // Held while the list is recorded, so it's only recorded once when
+    // painted from several threads.
+    Lock _lock;
+    Math::Recti _bound{};
+    Opt<Gfx::DisplayList> _list;
+
+    Recorded(Child child)
+        : ProxyNode(child) {}
+
+    void _record() {
+        Gfx::DisplayList list{_bound};
+        Gfx::Context g;
+        g.begin(list);
+        child().paint(g, _bound);
+        g.end();
+        _list = std::move(list);
+    }
+
+    void reconcile(Recorded &o) override {
+        ProxyNode::reconcile(o);
+        _list = NONE;
+    }
+
+    void paint(Gfx::Context &g, Math::Recti r) override {
+        {
+            LockScope scope(_lock);
+            if (not _list)
+                _record();
+        }
+
+        _list->replay(g, r);
+    }
+
+    void bubble(Events::Event &e) override {
+        if (e.is<Events::PaintEvent>())
+            _list = NONE;
+
+        ProxyNode::bubble(e);
+    }
+
+    void layout(Math::Recti r) override {
+        if (Op::ne(r.xy, _bound.xy) or Op::ne(r.wh, _bound.wh))
+            _list = NONE;
+
+        _bound = r;
+        child().place(r);
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+Child recorded(Child child) {
+    return makeStrong<Recorded>(child);
+}
+
+/* --- Layer Cache ---------------------------------------------------------- */
+
+void LayerCache::budget(usize bytes) {
+    LockScope scope(_lock);
+    _budget = bytes;
+    _evict();
+}
+
+void LayerCache::_use(Cached *layer) {
+    _forget(layer);
+    _lru.pushBack(layer);
+}
+
+void LayerCache::_forget(Cached *layer) {
+    for (usize i = 0; i < _lru.len(); i++) {
+        if (_lru[i] == layer) {
+            _lru.removeAt(i);
+            return;
+        }
+    }
+}
+
+void LayerCache::_evict(Cached *except) {
+    usize i = 0;
+    while (_used > _budget and i < _lru.len()) {
+        auto *layer = _lru[i];
+        // Layers being painted by another thread are kept for now.
+        if (layer == except or not layer->_lock.tryAcquire()) {
+            i++;
+            continue;
+        }
+
+        layer->_drop();
+        layer->_lock.release();
+        _lru.removeAt(i);
+    }
+}
+
+LayerCache &layerCache() {
+    static LayerCache cache;
+    return cache;
+}
+
+} // namespace Karm::Ui
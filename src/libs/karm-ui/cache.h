@@ -0,0 +1,79 @@
+#pragma once
+
+#include <karm-base/lock.h>
+
+#include "node.h"
+
+namespace Karm::Ui {
+
+/* --- Layer Cache ---------------------------------------------------------- */
+
+struct Cached;
+
+// Accounts for the memory used by the rasterized subtrees of every cached
+// node and drops the least recently painted ones when over budget.
+struct LayerCache {
+    // Held while touching the accounting, layers may be painted from
+    // several threads.
+    Lock _lock;
+
+    usize _budget = 64 * 1024 * 1024;
+    usize _used = 0;
+    usize _hits = 0;
+    usize _misses = 0;
+
+    // Least recently painted first.
+    Vec<Cached *> _lru;
+
+    // Set the maximum amount of memory used by the cached layers, in bytes.
+    void budget(usize bytes);
+
+    // Memory currently used by the cached layers, in bytes.
+    usize used() const {
+        return _used;
+    }
+
+    // Number of paints served straight from a cached layer.
+    usize hits() const {
+        return _hits;
+    }
+
+    // Number of paints that had to rasterize the subtree.
+    usize misses() const {
+        return _misses;
+    }
+
+    void _use(Cached *layer);
+    void _forget(Cached *layer);
+    void _evict(Cached *except = nullptr);
+};
+
+LayerCache &layerCache();
+
+/* --- Cached --------------------------------------------------------------- */
+
+// Rasterize the subtree once and blit it on subsequent paints, until it is
+// damaged or its bound changes.
+Child cached(Child child);
+
+inline auto cached() {
+    return [](Child child) {
+        return cached(child);
+    };
+}
+
+/* --- Recorded ------------------------------------------------------------- */
+
+// Record the drawing operations of the subtree once and replay them on
+// subsequent paints, only those touching the repainted region, until it is
+// damaged or its bound changes. Cheaper in memory than cached(), the subtree
+// must not read back the pixels it draws on.
+Child recorded(Child child);
+
+inline auto recorded() {
+    return [](Child child) {
+        return recorded(child);
+    };
+}
+
+} // namespace Karm::Ui
@@ -0,0 +1,135 @@
+#include "damage.h"
+
+namespace Karm::Ui {
+
+static bool _empty(Math::Recti r) {
+    return r.width <= 0 or r.height <= 0;
+}
+
+static usize _area(Math::Recti r) {
+    return r.width * r.height;
+}
+
+// Pixels of the bounding box of two disjoint rectangles that belong to neither.
+static usize _waste(Math::Recti a, Math::Recti b) {
+    return _area(a.mergeWith(b)) - _area(a) - _area(b);
+}
+
+// Split `a` into the (up to 4) pieces not covered by `b`.
+static void _subtract(Math::Recti a, Math::Recti b, auto emit) {
+    if (a.top() < b.top())
+        emit(Math::Recti{a.x, a.y, a.width, b.top() - a.top()});
+
+    if (b.bottom() < a.bottom())
+        emit(Math::Recti{a.x, b.bottom(), a.width, a.bottom() - b.bottom()});
+
+    isize top = max(a.top(), b.top());
+    isize bottom = min(a.bottom(), b.bottom());
+
+    if (a.start() < b.start())
+        emit(Math::Recti{a.x, top, b.start() - a.start(), bottom - top});
+
+    if (b.end() < a.end())
+        emit(Math::Recti{b.end(), top, a.end() - b.end(), bottom - top});
+}
+
+void Damage::_cut(Math::Recti rect) {
+    usize i = 0;
+    usize len = _rects.len();
+    while (i < len) {
+        auto r = _rects[i];
+        if (not r.colide(rect)) {
+            i++;
+            continue;
+        }
+
+        // The pieces are pushed past `len`, they can't collide with `rect`.
+        _rects.removeAt(i);
+        len--;
+        _subtract(r, rect, [&](Math::Recti piece) {
+            _rects.pushBack(piece);
+        });
+    }
+}
+
+void Damage::_insert(Math::Recti rect) {
+    _cut(rect);
+    _rects.pushBack(rect);
+}
+
+void Damage::_coalesce() {
+    auto merge = [&](usize i, usize j) {
+        auto merged = _rects[i].mergeWith(_rects[j]);
+        _rects.removeAt(j);
+        _rects.removeAt(i);
+        _insert(merged);
+    };
+
+    // Merge rectangles that line up, or whose bounding box is mostly damaged anyway.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (usize i = 0; i < _rects.len() and not changed; i++) {
+            for (usize j = i + 1; j < _rects.len() and not changed; j++) {
+                auto waste = _waste(_rects[i], _rects[j]);
+                if (waste * 8 <= _area(_rects[i].mergeWith(_rects[j]))) {
+                    merge(i, j);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Cap fragmentation by merging the pairs that waste the least.
+    while (_rects.len() > MAX_RECTS) {
+        usize bestI = 0, bestJ = 1;
+        usize bestWaste = _waste(_rects[0], _rects[1]);
+        for (usize i = 0; i < _rects.len(); i++) {
+            for (usize j = i + 1; j < _rects.len(); j++) {
+                auto waste = _waste(_rects[i], _rects[j]);
+                if (waste < bestWaste) {
+                    bestI = i;
+                    bestJ = j;
+                    bestWaste = waste;
+                }
+            }
+        }
+        merge(bestI, bestJ);
+    }
+}
+
+void Damage::add(Math::Recti rect) {
+    if (_empty(rect))
+        return;
+
+    _damaged += _area(rect);
+
+    for (auto &r : _rects)
+        if (r.contains(rect))
+            return;
+
+    _insert(rect);
+    _coalesce();
+}
+
+void Damage::sub(Math::Recti rect) {
+    if (_empty(rect))
+        return;
+
+    _cut(rect);
+    _coalesce();
+}
+
+void Damage::clear() {
+    _rects.clear();
+    _damaged = 0;
+}
+
+usize Damage::area() const {
+    usize sum = 0;
+    for (auto &r : _rects)
+        sum += _area(r);
+    return sum;
+}
+
+} // namespace Karm::Ui
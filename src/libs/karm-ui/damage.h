@@ -0,0 +1,64 @@
+#pragma once
+
+#include <karm-base/vec.h>
+#include <karm-math/rect.h>
+
+namespace Karm::Ui {
+
+struct DamageStats {
+    // Sum of the area of every rectangle reported as damaged.
+    usize damaged;
+
+    // Area actually repainted after coalescing.
+    usize painted;
+};
+
+// A set of disjoint rectangles covering the regions of the screen that need
+// to be repainted. Overlapping rectangles are split and adjacent ones are
+// merged so every pixel is covered at most once.
+struct Damage {
+    // Above this many rectangles, the closest ones are merged together even
+    // if it means repainting pixels that were not damaged.
+    static constexpr usize MAX_RECTS = 16;
+
+    Vec<Math::Recti> _rects;
+    usize _damaged = 0;
+
+    // Add a rectangle to the damaged region.
+    void add(Math::Recti rect);
+
+    // Remove a rectangle from the damaged region.
+    void sub(Math::Recti rect);
+
+    // Clear the damaged region.
+    void clear();
+
+    // Area covered by the damaged region.
+    usize area() const;
+
+    DamageStats stats() const {
+        return {_damaged, area()};
+    }
+
+    bool empty() const {
+        return _rects.len() == 0;
+    }
+
+    usize len() const {
+        return _rects.len();
+    }
+
+    Slice<Math::Recti> rects() const {
+        return _rects;
+    }
+
+    auto begin() const { return rects().begin(); }
+
+    auto end() const { return rects().end(); }
+
+    void _cut(Math::Recti rect);
+    void _insert(Math::Recti rect);
+    void _coalesce();
+};
+
+} // namespace Karm::Ui
@@ -104,8 +104,13 @@ struct DialogLayer : public LeafNode<DialogLayer> {
     }
 
     void reconcile(DialogLayer &o) override {
-        _child = tryOr(_child->reconcile(o._child), _child);
+        if (auto replacement = _child->reconcile(o._child)) {
+            _child = *replacement;
+            invalidateLayout();
+        }
         _child->attach(this);
+        if (_child->_needsLayout)
+            invalidateLayout();
     }
 
     void paint(Gfx::Context &g, Math::Recti r) override {
@@ -163,14 +168,16 @@ struct DialogLayer : public LeafNode<DialogLayer> {
     }
 
     void layout(Math::Recti r) override {
-
+        // What's left under a closed dialog or popover is repainted.
         if (_shouldDialogClose) {
+            shouldRepaint(*this, (*_dialog)->bound());
             (*_dialog)->detach(this);
             _dialog = NONE;
             _shouldDialogClose = false;
         }
 
         if (_shouldPopoverClose) {
+            shouldRepaint(*this, (*_popover)->bound());
             (*_popover)->detach(this);
             _popover = NONE;
             _shouldPopoverClose = false;
@@ -194,20 +201,20 @@ struct DialogLayer : public LeafNode<DialogLayer> {
             _shouldPopover = NONE;
         }
 
-        child().layout(r);
+        child().place(r);
 
         if (dialogVisible()) {
-            (*_dialog)->layout(r);
+            (*_dialog)->place(r);
         }
 
         if (popoverVisible()) {
-            auto popoverSize = (*_popover)->size(r.size(), Layout::Hint::MIN);
-            (*_popover)->layout({_popoverAt, popoverSize});
+            auto popoverSize = (*_popover)->measure(r.size(), Layout::Hint::MIN);
+            (*_popover)->place({_popoverAt, popoverSize});
         }
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        return child().size(s, hint);
+        return child().measure(s, hint);
     }
 
     Math::Recti bound() override {
@@ -227,6 +234,7 @@ Child dialogScafold(Layout::Align a, Child inner) {
         .borderWidth = 1,
         .borderPaint = Gfx::ZINC700,
         .backgroundPaint = Gfx::ZINC800,
+        .shadowStyle = Gfx::ShadowStyle::elevated(4),
     };
 
     return inner |
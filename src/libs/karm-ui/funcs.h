@@ -14,6 +14,14 @@ inline void shouldRepaint(Node &n, Math::Recti bound) {
     n.bubble(e);
 }
 
+// Repaint the whole window, for changes to how every node is painted.
+inline void shouldRepaintAll(Node &n) {
+    Node *root = &n;
+    while (root->parent())
+        root = root->parent();
+    shouldRepaint(*root);
+}
+
 inline void shouldLayout(Node &n) {
     Events::LayoutEvent e;
     n.bubble(e);
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <karm-base/ring.h>
+#include <karm-sys/thread.h>
 #include <karm-sys/time.h>
 
+#include "damage.h"
 #include "node.h"
 
 namespace Karm::Ui {
@@ -19,6 +21,9 @@ struct PerfRecord {
     TimeStamp start;
     TimeStamp end;
 
+    // Number of nodes laid out, for layout records.
+    usize count = 0;
+
     Gfx::Color color() const {
         switch (event) {
         case PerfEvent::PAINT:
@@ -48,9 +53,10 @@ struct PerfGraph {
         _records[_index % 256] = PerfRecord{e, Sys::now(), 0};
     }
 
-    auto end() {
+    auto end(usize count = 0) {
         auto n = Sys::now();
         auto elapsed = n - _records[_index % 256].start;
+        _records[_index % 256].count = count;
         _records[_index++ % 256].end = n;
         return elapsed;
     }
@@ -76,16 +82,39 @@ struct PerfGraph {
             g.debugRect(
                 {(isize)i, 0, 1, (isize)e.duration().toMSecs() * 2},
                 e.color());
+
+            // One pixel per 16 nodes laid out, from the bottom.
+            if (e.count) {
+                isize h = min(e.count / 16 + 1, 100uz);
+                g.debugRect({(isize)i, 100 - h, 1, h}, Gfx::ORANGE);
+            }
         }
         g.restore();
     }
 };
 
 struct Host : public Node {
+    // Height of the bands the damage is split into when painting in
+    // parallel. It doesn't depend on the number of workers so the output
+    // is the same whatever the machine.
+    static constexpr isize TILE_HEIGHT = 64;
+
     Child _root;
     Opt<Res<>> _res;
     Gfx::Context _g;
-    Vec<Math::Recti> _dirty;
+    Damage _dirty;
+    Opt<Strong<Sys::ThreadPool>> _pool;
+
+    struct Tile {
+        Math::Recti rect;
+
+        // Index of the damaged region the tile was cut from.
+        usize dirty;
+    };
+
+    Vec<Tile> _tiles;
+    Vec<Gfx::Context> _tileContexts;
+    DamageStats _damageStats{};
     PerfGraph _perf;
 
     bool _shouldLayout{};
@@ -135,15 +164,71 @@ struct Host : public Node {
         g.restore();
     }
 
+    // Pixels reported as damaged and pixels actually repainted since the host started.
+    DamageStats damageStats() const {
+        return _damageStats;
+    }
+
+    // Paint the damaged regions on the workers of `pool`, every node of the
+    // tree must then be safe to paint from several threads at once.
+    void parallel(Strong<Sys::ThreadPool> pool) {
+        _pool = pool;
+    }
+
+    void _splitTiles() {
+        _tiles.clear();
+        for (usize i = 0; i < _dirty.rects().len(); i++) {
+            auto d = _dirty.rects()[i];
+            isize y = d.y - (d.y % TILE_HEIGHT + TILE_HEIGHT) % TILE_HEIGHT;
+            for (; y < d.y + d.height; y += TILE_HEIGHT) {
+                auto tile = d.clipTo({d.x, y, d.width, TILE_HEIGHT});
+                if (tile.height > 0)
+                    _tiles.pushBack({tile, i});
+            }
+        }
+    }
+
+    void _paintTiles(Sys::ThreadPool &pool) {
+        _splitTiles();
+        while (_tileContexts.len() < _tiles.len())
+            _tileContexts.emplaceBack();
+
+        auto pixels = mutPixels();
+        pool.parallelFor(_tiles.len(), [&](usize i) {
+            auto &g = _tileContexts[i];
+            g.begin(pixels);
+            paint(g, _tiles[i].rect);
+            g.end();
+        });
+
+        // A blur cut by a tile didn't see the pixels of the tiles around
+        // it, the whole region is painted again on this thread.
+        Opt<usize> repainted = NONE;
+        _g.begin(pixels);
+        for (usize i = 0; i < _tiles.len(); i++) {
+            auto [tile, dirty] = _tiles[i];
+            auto d = _dirty.rects()[dirty];
+            if ((repainted and *repainted == dirty) or tile.height == d.height or not _tileContexts[i].blurClipped())
+                continue;
+            paint(_g, d);
+            repainted = dirty;
+        }
+        _g.end();
+    }
+
     void paint() {
         if (debugShowPerfGraph)
-            _dirty.pushBack({0, 0, 256, 100});
-
-        _g.begin(mutPixels());
+            _dirty.add(_perf.bound());
 
         _perf.record(PerfEvent::PAINT);
-        for (auto &d : _dirty) {
-            paint(_g, d);
+        if (_pool) {
+            _paintTiles(**_pool);
+        } else {
+            _g.begin(mutPixels());
+            for (auto &d : _dirty) {
+                paint(_g, d);
+            }
+            _g.end();
         }
         auto elapsed = _perf.end();
 
@@ -151,12 +236,17 @@ struct Host : public Node {
             logWarn("Paint took {} ms for {} nodes alive", elapsed.toMSecs(), debugNodeCount);
         }
 
-        if (debugShowPerfGraph)
+        if (debugShowPerfGraph) {
+            _g.begin(mutPixels());
             _perf.paint(_g);
+            _g.end();
+        }
 
-        _g.end();
+        flip(_dirty.rects());
 
-        flip(_dirty);
+        auto stats = _dirty.stats();
+        _damageStats.damaged += stats.damaged;
+        _damageStats.painted += stats.painted;
         _dirty.clear();
     }
 
@@ -173,7 +263,7 @@ struct Host : public Node {
     void bubble(Events::Event &event) override {
         event
             .handle<Events::PaintEvent>([this](auto &e) {
-                _dirty.pushBack(e.bound);
+                _dirty.add(e.bound.clipTo(bound()));
                 return true;
             })
             .handle<Events::LayoutEvent>([this](auto &) {
@@ -192,10 +282,12 @@ struct Host : public Node {
 
     void layout(Math::Recti r) override {
         _perf.record(PerfEvent::LAYOUT);
-        _root->layout(r);
-        auto elapsed = _perf.end();
+        auto before = debugLayoutStats;
+        _root->place(r);
+        auto laidOut = debugLayoutStats.layouts - before.layouts;
+        auto elapsed = _perf.end(laidOut);
         if (elapsed.toMSecs() > 1) {
-            logWarn("Layout took {}ms", elapsed.toMSecs());
+            logWarn("Layout took {}ms for {} nodes", elapsed.toMSecs(), laidOut);
             logDebug("There is {} nodes alive", debugNodeCount);
         }
     }
@@ -216,13 +308,10 @@ struct Host : public Node {
             if (_shouldLayout) {
                 layout(bound());
                 _shouldLayout = false;
-                _dirty.pushBack(bound());
             }
 
-            if (_dirty.len() > 0) {
+            if (not _dirty.empty())
                 paint();
-                _dirty.clear();
-            }
         }
 
         return _res.unwrap();
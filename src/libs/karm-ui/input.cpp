@@ -159,6 +159,11 @@ struct Button : public _Box<Button> {
           _buttonStyle(style) {}
 
     void reconcile(Button &o) override {
+        // Enabling or disabling the button switches to another style.
+        if (not _buttonStyle.sameLayout(o._buttonStyle) or
+            (bool)_onPress != (bool)o._onPress)
+            invalidateLayout();
+
         _buttonStyle = o._buttonStyle;
         _onPress = std::move(o._onPress);
 
@@ -249,8 +254,12 @@ struct Input : public View<Input> {
         : _style(style), _text(text), _onChange(std::move(onChange)) {}
 
     void reconcile(Input &o) override {
+        if (Op::eq(_text, o._text))
+            return;
+
         _text = o._text;
         _mesure = NONE;
+        invalidateLayout();
     }
 
     Media::FontMesure mesure() {
@@ -115,6 +115,13 @@ struct ButtonStyle {
     ButtonStyle withRadius(Gfx::BorderRadius radius) const;
 
     ButtonStyle withForegroundPaint(Gfx::Paint paint) const;
+
+    bool sameLayout(ButtonStyle const &other) const {
+        return idleStyle.sameLayout(other.idleStyle) and
+               hoverStyle.sameLayout(other.hoverStyle) and
+               pressStyle.sameLayout(other.pressStyle) and
+               disabledStyle.sameLayout(other.disabledStyle);
+    }
 };
 
 using OnPress = Opt<Func<void(Node &)>>;
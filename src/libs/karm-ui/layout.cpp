@@ -17,6 +17,8 @@ struct Empty : public View<Empty> {
         : _size(size) {}
 
     void reconcile(Empty &o) override {
+        if (not Op::eq(_size, o._size))
+            invalidateLayout();
         _size = o._size;
     }
 
@@ -60,11 +62,11 @@ struct Bound : public ProxyNode<Bound> {
 
     void layout(Math::Recti bound) override {
         _bound = bound;
-        child().layout(bound);
+        child().place(bound);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        return child().size(s, hint);
+        return child().measure(s, hint);
     }
 };
 
@@ -99,16 +101,16 @@ struct Align : public ProxyNode<Align> {
     Align(Layout::Align align, Child child) : ProxyNode(child), _align(align) {}
 
     void layout(Math::Recti bound) override {
-        auto childSize = child().size(bound.size(), _child.is<Grow>() ? Layout::Hint::MAX : Layout::Hint::MIN);
+        auto childSize = child().measure(bound.size(), _child.is<Grow>() ? Layout::Hint::MAX : Layout::Hint::MIN);
         child()
-            .layout(_align.apply<isize>(
+            .place(_align.apply<isize>(
                 Layout::Flow::LEFT_TO_RIGHT,
                 childSize,
                 bound));
     };
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        return _align.size(child().size(s, hint), s, hint);
+        return _align.size(child().measure(s, hint), s, hint);
     }
 };
 
@@ -168,11 +170,11 @@ struct Sizing : public ProxyNode<Sizing> {
 
     void layout(Math::Recti bound) override {
         _rect = bound;
-        child().layout(bound);
+        child().place(bound);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        auto result = child().size(s, hint);
+        auto result = child().measure(s, hint);
 
         if (_min.x != UNCONSTRAINED) {
             result.x = max(result.x, _min.x);
@@ -231,6 +233,8 @@ struct Spacing : public ProxyNode<Spacing> {
         : ProxyNode(child), _spacing(spacing) {}
 
     void reconcile(Spacing &o) override {
+        if (not Op::eq(_spacing, o._spacing))
+            invalidateLayout();
         _spacing = o._spacing;
         ProxyNode<Spacing>::reconcile(o);
     }
@@ -243,11 +247,11 @@ struct Spacing : public ProxyNode<Spacing> {
     }
 
     void layout(Math::Recti rect) override {
-        child().layout(_spacing.shrink(Layout::Flow::LEFT_TO_RIGHT, rect));
+        child().place(_spacing.shrink(Layout::Flow::LEFT_TO_RIGHT, rect));
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        return child().size(s - _spacing.all(), hint) + _spacing.all();
+        return child().measure(s - _spacing.all(), hint) + _spacing.all();
     }
 
     Math::Recti bound() override {
@@ -268,6 +272,8 @@ struct AspectRatio : public ProxyNode<AspectRatio> {
         : ProxyNode(child), _ratio(ratio) {}
 
     void reconcile(AspectRatio &o) override {
+        if (_ratio != o._ratio)
+            invalidateLayout();
         _ratio = o._ratio;
         ProxyNode<AspectRatio>::reconcile(o);
     }
@@ -280,11 +286,11 @@ struct AspectRatio : public ProxyNode<AspectRatio> {
     }
 
     void layout(Math::Recti rect) override {
-        child().layout(rect);
+        child().place(rect);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        auto childSize = child().size(s, hint);
+        auto childSize = child().measure(s, hint);
         auto childRatio = (f64)childSize.x / (f64)childSize.y;
 
         if (childRatio > _ratio) {
@@ -311,7 +317,7 @@ struct StackLayout : public GroupNode<StackLayout> {
     void layout(Math::Recti r) override {
         _bound = r;
         for (auto &child : children()) {
-            child->layout(r);
+            child->place(r);
         }
     }
 };
@@ -367,8 +373,8 @@ struct DockLayout : public GroupNode<DockLayout> {
         auto outer = bound;
 
         for (auto &child : children()) {
-            Math::Recti inner = child->size(outer.size(), Layout::Hint::MIN);
-            child->layout(getDock(child).apply(inner, outer));
+            Math::Recti inner = child->measure(outer.size(), Layout::Hint::MIN);
+            child->place(getDock(child).apply(inner, outer));
         }
     }
 
@@ -396,7 +402,7 @@ struct DockLayout : public GroupNode<DockLayout> {
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
         Math::Vec2i currentSize{};
         for (auto &child : mutIterRev(children())) {
-            currentSize = apply(getDock(child).orien(), child->size(currentSize, Layout::Hint::MIN), currentSize);
+            currentSize = apply(getDock(child).orien(), child->measure(currentSize, Layout::Hint::MIN), currentSize);
         }
 
         if (hint == Layout::Hint::MAX) {
@@ -461,7 +467,7 @@ struct FlowLayout : public GroupNode<FlowLayout> {
             if (child.is<Grow>()) {
                 grows += child.unwrap<Grow>().grow();
             } else {
-                total += _style.flow.getX(child->size(r.size(), Layout::Hint::MIN));
+                total += _style.flow.getX(child->measure(r.size(), Layout::Hint::MIN));
             }
         }
 
@@ -478,7 +484,7 @@ struct FlowLayout : public GroupNode<FlowLayout> {
 
         for (auto &child : children()) {
             Math::Recti inner = {};
-            auto childSize = child->size(r.size(), Layout::Hint::MIN);
+            auto childSize = child->measure(r.size(), Layout::Hint::MIN);
 
             inner = _style.flow.setStart(inner, start);
             if (child.is<Grow>()) {
@@ -490,7 +496,7 @@ struct FlowLayout : public GroupNode<FlowLayout> {
             inner = _style.flow.setTop(inner, _style.flow.getTop(r));
             inner = _style.flow.setBottom(inner, _style.flow.getBottom(r));
 
-            child->layout(_style.align.apply(_style.flow, Math::Recti{childSize}, inner));
+            child->place(_style.align.apply(_style.flow, Math::Recti{childSize}, inner));
             start += _style.flow.getWidth(inner) + _style.gaps;
         }
     }
@@ -504,7 +510,7 @@ struct FlowLayout : public GroupNode<FlowLayout> {
             if (child.is<Grow>())
                 grow = true;
 
-            auto childSize = child->size(s, Layout::Hint::MIN);
+            auto childSize = child->measure(s, Layout::Hint::MIN);
             w += _style.flow.getX(childSize);
             h = max(h, _style.flow.getY(childSize));
         }
@@ -628,7 +634,7 @@ struct GridLayout : public GroupNode<GridLayout> {
             endRow.end() - startRow.start,
         };
 
-        child->layout(childRect);
+        child->place(childRect);
     }
 
     void layout(Math::Recti r) override {
@@ -8,5 +8,6 @@ bool debugShowEmptyBounds = false;
 bool debugShowScrollBounds = false;
 bool debugShowPerfGraph = false;
 int debugNodeCount = 0;
+LayoutStats debugLayoutStats = {};
 
 } // namespace Karm::Ui
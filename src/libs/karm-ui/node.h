@@ -16,15 +16,76 @@ extern bool debugShowScrollBounds;
 extern bool debugShowPerfGraph;
 extern int debugNodeCount;
 
+struct LayoutStats {
+    // Calls to Node::layout() that went through.
+    usize layouts;
+
+    // Calls to Node::place() skipped because nothing changed.
+    usize skipped;
+
+    // Calls to Node::measure() answered from the cache.
+    usize hits;
+
+    // Calls to Node::measure() that ended up calling Node::size().
+    usize misses;
+};
+
+extern LayoutStats debugLayoutStats;
+
 struct Node;
 
 using Child = Strong<Node>;
 using Children = Vec<Child>;
 using Visitor = Func<void(Node &)>;
 
+/* --- Size Cache ----------------------------------------------------------- */
+
+// The last few results of Node::size(), containers tend to ask the same
+// questions several times per layout pass.
+struct SizeCache {
+    static constexpr usize LEN = 4;
+
+    struct Entry {
+        Math::Vec2i s;
+        Layout::Hint hint;
+        Math::Vec2i result;
+    };
+
+    Array<Entry, LEN> _entries{};
+    usize _len = 0;
+    usize _next = 0;
+
+    Opt<Math::Vec2i> lookup(Math::Vec2i s, Layout::Hint hint) const {
+        for (usize i = 0; i < _len; i++) {
+            auto const &e = _entries[i];
+            if (e.hint == hint and Op::eq(e.s, s))
+                return e.result;
+        }
+        return NONE;
+    }
+
+    void insert(Math::Vec2i s, Layout::Hint hint, Math::Vec2i result) {
+        _entries[_next] = {s, hint, result};
+        _next = (_next + 1) % LEN;
+        _len = min(_len + 1, LEN);
+    }
+
+    void clear() {
+        _len = 0;
+        _next = 0;
+    }
+};
+
 /* --- Node ----------------------------------------------------------------- */
 
 struct Node {
+    // Identifies the node among its siblings across rebuilds, see key().
+    Opt<usize> _key = NONE;
+
+    bool _needsLayout = true;
+    Math::Recti _placed{};
+    SizeCache _sizes;
+
     Node() {
         debugNodeCount++;
     }
@@ -52,6 +113,55 @@ struct Node {
     virtual void attach(Node *) {}
 
     virtual void detach(Node *) {}
+
+    // Drop the cached size and layout of this node, ancestors are
+    // invalidated as the LayoutEvent bubbles up.
+    void invalidateLayout() {
+        _needsLayout = true;
+        _sizes.clear();
+    }
+
+    // Memoized size(), valid until the node is invalidated.
+    Math::Vec2i measure(Math::Vec2i s, Layout::Hint hint) {
+        if (auto cached = _sizes.lookup(s, hint)) {
+            debugLayoutStats.hits++;
+            return *cached;
+        }
+
+        debugLayoutStats.misses++;
+        auto result = size(s, hint);
+        _sizes.insert(s, hint, result);
+        return result;
+    }
+
+    // Layout the node at `r`, unless it's already there and nothing below
+    // it asked for a new layout. A node that moved or got resized has the
+    // regions it left and now covers repainted.
+    void place(Math::Recti r) {
+        bool moved = Op::ne(r.xy, _placed.xy) or Op::ne(r.wh, _placed.wh);
+        if (not _needsLayout and not moved) {
+            debugLayoutStats.skipped++;
+            return;
+        }
+
+        debugLayoutStats.layouts++;
+        _needsLayout = false;
+        if (moved) {
+            _damage(_placed);
+            _damage(r);
+        }
+        _placed = r;
+        layout(r);
+    }
+
+    // Bubbled from the parent, the node itself could take it for damage to
+    // its own content.
+    void _damage(Math::Recti r) {
+        if (r.width <= 0 or r.height <= 0 or not parent())
+            return;
+        Events::PaintEvent e{r};
+        parent()->bubble(e);
+    }
 };
 
 template <typename T>
@@ -67,12 +177,33 @@ ALWAYS_INLINE Child &operator|=(Child &child, Decorator auto decorator) {
     return child = decorator(child);
 }
 
+// When every child of a group has a key, rebuilding the group pairs each new
+// child with the old one of the same key instead of the one at the same index.
+inline Child key(usize k, Child child) {
+    child->_key = k;
+    return child;
+}
+
+inline auto key(usize k) {
+    return [k](Child child) {
+        return key(k, child);
+    };
+}
+
+// Key a node by name, names are hashed so distinct names may collide, in
+// which case the rebuilt node is paired with an unrelated one.
+inline Child key(Str k, Child child) {
+    return key(hash(k), child);
+}
+
 /* --- LeafNode ------------------------------------------------------------- */
 
 template <typename Crtp>
 struct LeafNode : public Node {
     Node *_parent = nullptr;
 
+    // Take the properties of `other`, nodes invalidate their layout
+    // themselves when one that affects it changed.
     virtual void reconcile(Crtp &) {}
 
     Opt<Child> reconcile(Child other) override {
@@ -84,6 +215,9 @@ struct LeafNode : public Node {
     }
 
     void bubble(Events::Event &e) override {
+        if (e.is<Events::LayoutEvent>())
+            invalidateLayout();
+
         if (_parent and not e.accepted)
             _parent->bubble(e);
     }
@@ -131,20 +265,106 @@ struct GroupNode : public LeafNode<Crtp> {
         return _children;
     }
 
-    void reconcile(Crtp &o) override {
+    static bool _keyed(Children const &children) {
+        for (auto const &c : children)
+            if (not c->_key)
+                return false;
+        return children.len() > 0;
+    }
+
+    // Whether the layout of the group has to be done again, because its
+    // children changed or one of them has to be laid out again.
+    static bool _changed(Children const &before, Children const &after) {
+        if (before.len() != after.len())
+            return true;
+        for (usize i = 0; i < after.len(); i++)
+            if (&*before[i] != &*after[i] or after[i]->_needsLayout)
+                return true;
+        return false;
+    }
+
+    bool _reconcileKeyed(Children &them) {
         auto &us = children();
-        auto &them = o.children();
+
+        // Old children sorted by key, the index is cleared once reused.
+        static constexpr usize USED = -1;
+        Vec<Cons<usize, usize>> index;
+        index.ensure(us.len());
+        for (usize i = 0; i < us.len(); i++)
+            if (us[i]->_key)
+                index.pushBack({*us[i]->_key, i});
+        sort(index, [](auto const &a, auto const &b) {
+            return cmp(a.car, b.car);
+        });
+
+        Children result;
+        result.ensure(them.len());
+        for (auto &child : them) {
+            auto found = search(index, [&](auto const &e) {
+                return cmp(e.car, *child->_key);
+            });
+
+            if (found and index[*found].cdr != USED) {
+                auto &old = us[index[*found].cdr];
+                index[*found].cdr = USED;
+                auto replacement = old->reconcile(child);
+                if (replacement)
+                    old->detach(this);
+                result.pushBack(tryOr(replacement, old));
+            } else {
+                result.pushBack(child);
+            }
+            last(result)->attach(this);
+        }
+
+        for (auto const &e : index)
+            if (e.cdr != USED)
+                us[e.cdr]->detach(this);
+
+        // Children without a key can't be paired with a new one.
+        for (auto &c : us)
+            if (not c->_key)
+                c->detach(this);
+
+        bool changed = _changed(us, result);
+        _children = std::move(result);
+        return changed;
+    }
+
+    bool _reconcileIndexed(Children &them) {
+        auto &us = children();
+        bool changed = us.len() != them.len();
 
         for (usize i = 0; i < them.len(); i++) {
             if (i < us.len()) {
-                us.replace(i, tryOr(us[i]->reconcile(them[i]), us[i]));
+                if (auto replacement = us[i]->reconcile(them[i])) {
+                    us[i]->detach(this);
+                    us.replace(i, *replacement);
+                    changed = true;
+                }
+                us[i]->_key = them[i]->_key;
             } else {
                 us.insert(i, them[i]);
             }
             us[i]->attach(this);
+            changed = changed or us[i]->_needsLayout;
         }
 
+        for (usize i = them.len(); i < us.len(); i++)
+            us[i]->detach(this);
         us.truncate(them.len());
+        return changed;
+    }
+
+    void reconcile(Crtp &o) override {
+        auto &them = o.children();
+
+        bool changed = _keyed(them)
+                           ? _reconcileKeyed(them)
+                           : _reconcileIndexed(them);
+
+        if (changed)
+            this->invalidateLayout();
     }
 
     void paint(Gfx::Context &g, Math::Recti r) override {
@@ -171,7 +391,7 @@ struct GroupNode : public LeafNode<Crtp> {
         _bound = r;
 
         for (auto &child : children()) {
-            child->layout(r);
+            child->place(r);
         }
     }
 
@@ -203,8 +423,13 @@ struct ProxyNode : public LeafNode<Crtp> {
     }
 
     void reconcile(Crtp &o) override {
-        _child = tryOr(_child->reconcile(o._child), _child);
+        if (auto replacement = _child->reconcile(o._child)) {
+            _child = *replacement;
+            this->invalidateLayout();
+        }
         _child->attach(this);
+        if (_child->_needsLayout)
+            this->invalidateLayout();
         LeafNode<Crtp>::reconcile(o);
     }
 
@@ -220,11 +445,11 @@ struct ProxyNode : public LeafNode<Crtp> {
     }
 
     void layout(Math::Recti r) override {
-        child().layout(r);
+        child().place(r);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        return child().size(s, hint);
+        return child().measure(s, hint);
     }
 
     Math::Recti bound() override {
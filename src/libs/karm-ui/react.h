@@ -52,13 +52,20 @@ struct React : public LeafNode<Crtp> {
     void reconcile(Crtp &o) override {
         if (_child) {
             if (o._child) {
-                _child = (*_child)->reconcile(*o._child);
+                if (auto replacement = (*_child)->reconcile(*o._child)) {
+                    (*_child)->detach(this);
+                    _child = *replacement;
+                    this->invalidateLayout();
+                }
                 (*_child)->attach(this);
+                if ((*_child)->_needsLayout)
+                    this->invalidateLayout();
             }
         } else {
             if (o._child) {
                 _child = o._child;
                 (*_child)->attach(this);
+                this->invalidateLayout();
             }
         }
         LeafNode<Crtp>::reconcile(o);
@@ -80,6 +87,8 @@ struct React : public LeafNode<Crtp> {
 
     void bubble(Events::Event &e) override {
         if (e.is<Events::BuildEvent>()) {
+            // The rebuilt subtree may look different anywhere in its bound.
+            Ui::shouldRepaint(*this);
             _rebuild = true;
             Ui::shouldLayout(*this);
         } else
@@ -88,12 +97,12 @@ struct React : public LeafNode<Crtp> {
 
     void layout(Math::Recti r) override {
         ensureBuild();
-        (*_child)->layout(r);
+        (*_child)->place(r);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
         ensureBuild();
-        return (*_child)->size(s, hint);
+        return (*_child)->measure(s, hint);
     }
 
     Math::Recti bound() override {
@@ -166,7 +175,13 @@ struct _State : public React<_State<T>> {
     void reconcile(_State &o) override {
         _build = std::move(o._build);
         React<_State>::reconcile(o);
-        shouldRebuild(*this);
+
+        // Rebuilt right away, bubbling a BuildEvent would invalidate the
+        // layout of every ancestor even if nothing changed.
+        this->_rebuild = true;
+        this->ensureBuild();
+        if ((*this->_child)->_needsLayout)
+            this->invalidateLayout();
     }
 
     Child build() override {
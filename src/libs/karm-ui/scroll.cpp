@@ -18,6 +18,9 @@ struct Scroll : public ProxyNode<Scroll> {
         auto childBound = child().bound();
         _scroll.x = clamp(s.x, -(childBound.width - min(childBound.width, bound().width)), 0);
         _scroll.y = clamp(s.y, -(childBound.height - min(childBound.height, bound().height)), 0);
+
+        ViewportEvent e{{_bound.xy - _scroll, _bound.wh}};
+        child().event(e);
     }
 
     void paint(Gfx::Context &g, Math::Recti r) override {
@@ -59,6 +62,8 @@ struct Scroll : public ProxyNode<Scroll> {
         } else if (e.is<Events::AnimateEvent>() and _animated) {
             shouldRepaint(*parent(), bound());
             _animated = false;
+        } else if (e.is<ViewportEvent>()) {
+            // Our content is only concerned with our own viewport.
         } else {
             child().event(e);
         }
@@ -76,19 +81,25 @@ struct Scroll : public ProxyNode<Scroll> {
 
     void layout(Math::Recti r) override {
         _bound = r;
-        auto childSize = child().size(_bound.size(), Layout::Hint::MAX);
+
+        // Let virtualized content know what it will be asked to paint
+        // before it gets laid out.
+        ViewportEvent e{{_bound.xy - _scroll, _bound.wh}};
+        child().event(e);
+
+        auto childSize = child().measure(_bound.size(), Layout::Hint::MAX);
         if (_orient == Layout::Orien::HORIZONTAL) {
             childSize.height = r.height;
         } else if (_orient == Layout::Orien::VERTICAL) {
             childSize.width = r.width;
         }
         r.wh = childSize;
-        child().layout(r);
+        child().place(r);
         scroll(_scroll);
     }
 
     Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
-        auto childSize = child().size(s, hint);
+        auto childSize = child().measure(s, hint);
 
         if (hint == Layout::Hint::MIN) {
             if (_orient == Layout::Orien::HORIZONTAL) {
@@ -124,12 +135,202 @@ Child vscroll(Child child) {
 /* --- List ----------------------------------------------------------------- */
 
 struct List : public GroupNode<List> {
+    // Items built past each side of the viewport, so short scrolls don't
+    // have to build anything.
+    static constexpr usize OVERSCAN = 8;
+
     usize _count;
+    usize _lanes;
+    Layout::Orien _orien;
     BuildItem _builder;
 
-    List(usize count, BuildItem builder)
+    // Index of the item in the first child, children are consecutive items.
+    usize _first = 0;
+    Opt<Math::Recti> _viewport;
+    Math::Vec2i _itemSize{};
+
+    // First item, built to measure it when it's not materialized.
+    Opt<Child> _sample;
+
+    List(usize count, usize lanes, Layout::Orien orien, BuildItem builder)
         : _count(count),
+          _lanes(max(lanes, 1uz)),
+          _orien(orien),
           _builder(std::move(builder)) {}
+
+    void reconcile(List &o) override {
+        bool changed = _count != o._count or
+                       _lanes != o._lanes or
+                       _orien != o._orien;
+
+        _count = o._count;
+        _lanes = o._lanes;
+        _orien = o._orien;
+        _builder = std::move(o._builder);
+        _sample = NONE;
+
+        // Rebuild the visible items in place, the nodes are reused.
+        for (usize i = 0; i < _children.len(); i++) {
+            auto &c = _children[i];
+            if (_first + i >= _count)
+                continue;
+            if (auto replacement = c->reconcile(_builder(_first + i))) {
+                c->detach(this);
+                c = *replacement;
+                c->attach(this);
+                changed = true;
+            }
+            changed = changed or c->_needsLayout;
+        }
+
+        if (changed)
+            invalidateLayout();
+        _materialize();
+    }
+
+    bool _vertical() const {
+        return _orien == Layout::Orien::VERTICAL;
+    }
+
+    usize _lines() const {
+        return (_count + _lanes - 1) / _lanes;
+    }
+
+    // Size of the item along the list, and across it.
+    isize _itemMain() const {
+        return max(_vertical() ? _itemSize.y : _itemSize.x, 1);
+    }
+
+    isize _itemCross() const {
+        return (_vertical() ? _bound.width : _bound.height) / (isize)_lanes;
+    }
+
+    Math::Recti _itemBound(usize i) const {
+        isize main = (i / _lanes) * _itemMain();
+        isize cross = (i % _lanes) * _itemCross();
+        if (_vertical())
+            return {_bound.x + cross, _bound.y + main, _itemCross(), _itemMain()};
+        return {_bound.x + main, _bound.y + cross, _itemMain(), _itemCross()};
+    }
+
+    // Range of items overlapping the viewport, overscan included.
+    Cons<usize, usize> _visible() const {
+        auto viewport = tryOr(_viewport, _bound).clipTo(_bound);
+        isize start = _vertical() ? viewport.y - _bound.y : viewport.x - _bound.x;
+        isize len = _vertical() ? viewport.height : viewport.width;
+
+        usize firstLine = max(start, 0) / _itemMain();
+        usize endLine = (max(start + len, 0) + _itemMain() - 1) / _itemMain();
+        firstLine = firstLine > OVERSCAN ? firstLine - OVERSCAN : 0;
+        endLine = min(endLine + OVERSCAN, _lines());
+
+        return {
+            min(firstLine * _lanes, _count),
+            min(endLine * _lanes, _count),
+        };
+    }
+
+    // Build the items entering the viewport, recycling the nodes of the ones
+    // leaving it.
+    void _materialize() {
+        auto [start, end] = _visible();
+
+        Children recycled;
+        Children items;
+        items.ensure(end - start);
+
+        for (usize i = 0; i < _children.len(); i++) {
+            usize index = _first + i;
+            if (index < start or index >= end)
+                recycled.pushBack(_children[i]);
+        }
+
+        for (usize index = start; index < end; index++) {
+            if (index >= _first and index < _first + _children.len()) {
+                items.pushBack(_children[index - _first]);
+                continue;
+            }
+
+            auto item = _builder(index);
+            if (recycled.len()) {
+                auto node = recycled.popBack();
+                if (auto replacement = node->reconcile(item)) {
+                    node->detach(this);
+                    item = *replacement;
+                } else {
+                    item = node;
+                }
+            }
+            item->attach(this);
+            items.pushBack(item);
+        }
+
+        for (auto &c : recycled)
+            c->detach(this);
+
+        _children = std::move(items);
+        _first = start;
+
+        for (usize i = 0; i < _children.len(); i++)
+            _children[i]->place(_itemBound(_first + i));
+    }
+
+    void _measureItem(Math::Vec2i s) {
+        if (_count == 0) {
+            _itemSize = {};
+            return;
+        }
+
+        if (_first == 0 and _children.len()) {
+            _itemSize = _children[0]->measure(s, Layout::Hint::MIN);
+            return;
+        }
+
+        if (not _sample)
+            _sample = _builder(0);
+        _itemSize = (*_sample)->measure(s, Layout::Hint::MIN);
+    }
+
+    void event(Events::Event &e) override {
+        if (e.is<ViewportEvent>()) {
+            _viewport = e.unwrap<ViewportEvent>().viewport;
+            auto [start, end] = _visible();
+            if (start != _first or end != _first + _children.len())
+                _materialize();
+            return;
+        }
+
+        GroupNode::event(e);
+    }
+
+    void layout(Math::Recti r) override {
+        _bound = r;
+        _measureItem(r.wh);
+        _materialize();
+    }
+
+    Math::Vec2i size(Math::Vec2i s, Layout::Hint hint) override {
+        _measureItem(s);
+        isize main = _lines() * _itemMain();
+        if (_vertical()) {
+            isize cross = hint == Layout::Hint::MAX ? s.x : _itemSize.x * (isize)_lanes;
+            return {cross, main};
+        }
+        isize cross = hint == Layout::Hint::MAX ? s.y : _itemSize.y * (isize)_lanes;
+        return {main, cross};
+    }
 };
 
+Child hlist(usize len, BuildItem child) {
+    return makeStrong<List>(len, 1, Layout::Orien::HORIZONTAL, std::move(child));
+}
+
+Child vlist(usize len, BuildItem child) {
+    return makeStrong<List>(len, 1, Layout::Orien::VERTICAL, std::move(child));
+}
+
+Child vgrid(usize len, usize columns, BuildItem child) {
+    return makeStrong<List>(len, columns, Layout::Orien::VERTICAL, std::move(child));
+}
+
 } // namespace Karm::Ui
@@ -31,12 +31,28 @@ inline auto vscroll() {
     };
 }
 
+// Sent down by Scroll to tell its content which part of it is visible, in
+// the coordinates of the content.
+struct ViewportEvent : public Events::BaseEvent<ViewportEvent> {
+    Math::Recti viewport;
+
+    ViewportEvent(Math::Recti viewport)
+        : viewport(viewport) {}
+};
+
 using Build = Func<Child()>;
 
 using BuildItem = Func<Child(usize)>;
 
+// Lists only build the items visible in the viewport of the surrounding
+// scroll, plus some overscan, and recycle them as it moves. Every item is
+// assumed to have the size of the first one.
+
 Child hlist(usize len, BuildItem child);
 
 Child vlist(usize len, BuildItem child);
 
+// Like vlist(), with `columns` items per row sharing the width.
+Child vgrid(usize len, usize columns, BuildItem child);
+
 } // namespace Karm::Ui
@@ -0,0 +1,144 @@
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-ui/cache.h>
+#include <karm-ui/funcs.h>
+
+namespace Karm::Ui::Tests {
+
+struct Counter : public LeafNode<Counter> {
+    Math::Recti _bound{};
+    usize _paints = 0;
+
+    void paint(Gfx::Context &g, Math::Recti) override {
+        _paints++;
+        g.clear(_bound, Gfx::RED);
+    }
+
+    void layout(Math::Recti r) override {
+        _bound = r;
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+static void _paint(Node &node, Media::Image &img) {
+    Gfx::Context g;
+    g.begin(img);
+    node.paint(g, img.bound());
+    g.end();
+}
+
+test$(cachedPaintsOnce) {
+    auto img = Media::Image::alloc({64, 64});
+    auto counter = makeStrong<Counter>();
+    auto node = cached(counter);
+    node->layout({8, 8, 32, 32});
+
+    _paint(*node, img);
+    _paint(*node, img);
+    _paint(*node, img);
+
+    expectEq$(counter->_paints, 1uz);
+    expectEq$(img.pixels().load({10, 10}).red, Gfx::RED.red);
+    expectEq$(img.pixels().load({0, 0}).red, 0);
+    return Ok();
+}
+
+test$(cachedInvalidation) {
+    auto img = Media::Image::alloc({64, 64});
+    auto counter = makeStrong<Counter>();
+    auto node = cached(counter);
+    node->layout({8, 8, 32, 32});
+    _paint(*node, img);
+
+    shouldRepaint(*counter);
+    _paint(*node, img);
+    expectEq$(counter->_paints, 2uz);
+
+    node->layout({8, 8, 16, 16});
+    _paint(*node, img);
+    expectEq$(counter->_paints, 3uz);
+    return Ok();
+}
+
+test$(cachedMoveOnlyBlits) {
+    auto img = Media::Image::alloc({64, 64});
+    auto counter = makeStrong<Counter>();
+    auto node = cached(counter);
+    node->layout({8, 8, 32, 32});
+    _paint(*node, img);
+
+    img.mutPixels().clear(Gfx::BLACK);
+    node->layout({24, 24, 32, 32});
+    _paint(*node, img);
+
+    expectEq$(counter->_paints, 1uz);
+    expectEq$(img.pixels().load({10, 10}).red, 0);
+    expectEq$(img.pixels().load({50, 50}).red, Gfx::RED.red);
+
+    // Damage is still found in the layer where the subtree is now.
+    shouldRepaint(*counter, {40, 40, 8, 8});
+    _paint(*node, img);
+    expectEq$(counter->_paints, 2uz);
+    return Ok();
+}
+
+test$(cachedBudget) {
+    auto img = Media::Image::alloc({64, 64});
+    auto a = cached(makeStrong<Counter>());
+    auto b = cached(makeStrong<Counter>());
+    a->layout({0, 0, 32, 32});
+    b->layout({32, 32, 32, 32});
+
+    auto &cache = layerCache();
+    auto budget = cache._budget;
+    cache.budget(32 * 32 * 4);
+
+    _paint(*a, img);
+    expectEq$(cache.used(), 32uz * 32 * 4);
+
+    // Painting the second layer evicts the first one.
+    _paint(*b, img);
+    expectEq$(cache.used(), 32uz * 32 * 4);
+
+    cache.budget(budget);
+    return Ok();
+}
+
+test$(recordedPaintsOnce) {
+    auto img = Media::Image::alloc({64, 64});
+    auto counter = makeStrong<Counter>();
+    auto node = recorded(counter);
+    node->layout({8, 8, 32, 32});
+
+    _paint(*node, img);
+    img.mutPixels().clear(Gfx::BLACK);
+    _paint(*node, img);
+    expectEq$(counter->_paints, 1uz);
+    expectEq$(img.pixels().load({10, 10}).red, Gfx::RED.red);
+    expectEq$(img.pixels().load({0, 0}).red, 0);
+
+    shouldRepaint(*counter);
+    _paint(*node, img);
+    expectEq$(counter->_paints, 2uz);
+    return Ok();
+}
+
+test$(recordedCached) {
+    auto img = Media::Image::alloc({64, 64});
+    auto counter = makeStrong<Counter>();
+    auto node = recorded(cached(counter));
+    node->layout({8, 8, 32, 32});
+
+    // The layer is skipped while recording, the list replays the subtree.
+    _paint(*node, img);
+    _paint(*node, img);
+    expectEq$(counter->_paints, 1uz);
+    expectEq$(img.pixels().load({10, 10}).red, Gfx::RED.red);
+    expectEq$(layerCache().used(), 0uz);
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
@@ -0,0 +1,86 @@
+#include <karm-test/macros.h>
+#include <karm-ui/damage.h>
+
+namespace Karm::Ui::Tests {
+
+static bool _disjoint(Damage const &damage) {
+    for (usize i = 0; i < damage.len(); i++)
+        for (usize j = i + 1; j < damage.len(); j++)
+            if (damage.rects()[i].colide(damage.rects()[j]))
+                return false;
+    return true;
+}
+
+static bool _covers(Damage const &damage, Math::Recti rect) {
+    for (isize y = rect.top(); y < rect.bottom(); y++)
+        for (isize x = rect.start(); x < rect.end(); x++) {
+            bool covered = false;
+            for (auto &r : damage)
+                covered = covered or r.contains(Math::Vec2i{x, y});
+            if (not covered)
+                return false;
+        }
+    return true;
+}
+
+test$(damageContained) {
+    Damage damage;
+    damage.add({0, 0, 100, 100});
+    damage.add({10, 10, 20, 20});
+    damage.add({0, 0, 100, 100});
+
+    expectEq$(damage.len(), 1uz);
+    expectEq$(damage.area(), 100uz * 100);
+    expectEq$(damage.stats().damaged, 100uz * 100 * 2 + 20 * 20);
+    return Ok();
+}
+
+test$(damageOverlapping) {
+    Damage damage;
+    damage.add({0, 0, 50, 50});
+    damage.add({100, 100, 50, 50});
+    damage.add({25, 25, 50, 50});
+
+    expect$(_disjoint(damage));
+    expectEq$(damage.area(), 50uz * 50 * 3 - 25 * 25);
+    expect$(_covers(damage, {0, 0, 50, 50}));
+    expect$(_covers(damage, {25, 25, 50, 50}));
+    expect$(_covers(damage, {100, 100, 50, 50}));
+    return Ok();
+}
+
+test$(damageAdjacent) {
+    Damage damage;
+    for (isize i = 0; i < 10; i++)
+        damage.add({i * 10, 0, 10, 30});
+
+    expectEq$(damage.len(), 1uz);
+    expectEq$(damage.rects()[0].width, 100);
+    return Ok();
+}
+
+test$(damageFragmentation) {
+    Damage damage;
+    for (isize y = 0; y < 10; y++)
+        for (isize x = 0; x < 10; x++)
+            damage.add({x * 40, y * 40, 8, 8});
+
+    expectLteq$(damage.len(), Damage::MAX_RECTS);
+    expect$(_disjoint(damage));
+    for (isize y = 0; y < 10; y++)
+        for (isize x = 0; x < 10; x++)
+            expect$(_covers(damage, {x * 40, y * 40, 8, 8}));
+    return Ok();
+}
+
+test$(damageSub) {
+    Damage damage;
+    damage.add({0, 0, 100, 100});
+    damage.sub({25, 25, 50, 50});
+
+    expect$(_disjoint(damage));
+    expectEq$(damage.area(), 100uz * 100 - 50 * 50);
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
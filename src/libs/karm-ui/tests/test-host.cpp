@@ -0,0 +1,177 @@
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-ui/funcs.h>
+#include <karm-ui/host.h>
+#include <karm-ui/layout.h>
+#include <karm-ui/view.h>
+
+namespace Karm::Ui::Tests {
+
+// A node drawing a grid of translucent widgets, heavy enough for the tiles
+// to matter.
+struct Widgets : public LeafNode<Widgets> {
+    Math::Recti _bound{};
+
+    void paint(Gfx::Context &g, Math::Recti) override {
+        for (isize y = _bound.y; y < _bound.y + _bound.height; y += 48) {
+            for (isize x = _bound.x; x < _bound.x + _bound.width; x += 96) {
+                g.fillStyle(Gfx::Color::fromRgba(x & 0xff, y & 0xff, 128, 200));
+                g.fill(Math::Recti{x + 4, y + 4, 88, 40}, 8);
+                g.fillStyle(Gfx::WHITE.withOpacity(0.5));
+                g.fill(Math::Ellipsei{x + 24, y + 24, 12});
+            }
+        }
+    }
+
+    void layout(Math::Recti r) override {
+        _bound = r;
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+struct TestHost : public Host {
+    Media::Image _image;
+
+    TestHost(Child root, Math::Vec2i size)
+        : Host(root), _image(Media::Image::alloc(size, Gfx::BGRA8888)) {}
+
+    Gfx::MutPixels mutPixels() override {
+        return _image;
+    }
+
+    void flip(Slice<Math::Recti>) override {}
+
+    void pump() override {}
+
+    void wait(usize) override {}
+};
+
+static Media::Image _render(Child root, Opt<usize> workers, Slice<Math::Recti> damage) {
+    TestHost host{root, {500, 300}};
+    if (workers)
+        host.parallel(makeStrong<Sys::ThreadPool>(*workers));
+    host.layout(host.bound());
+    host._dirty.clear();
+
+    for (auto d : damage)
+        host._dirty.add(d);
+    host.paint();
+
+    return host._image;
+}
+
+test$(hostParallelPaint) {
+    Array<Math::Recti, 3> damage = {
+        Math::Recti{0, 0, 500, 300},
+        Math::Recti{-20, 70, 100, 90},
+        Math::Recti{300, 250, 60, 60},
+    };
+
+    for (auto d : damage) {
+        auto serial = _render(makeStrong<Widgets>(), NONE, {&d, 1});
+        for (usize workers : {0, 1, 3}) {
+            auto tiled = _render(makeStrong<Widgets>(), workers, {&d, 1});
+            for (usize i = 0; i < serial._buf->len(); i++)
+                expectEq$(tiled._buf->buf()[i], serial._buf->buf()[i]);
+        }
+    }
+
+    return Ok();
+}
+
+// Both blurs reach across several tiles.
+static Child _blurred() {
+    return foregroundFilter(Gfx::BlurFilter{12}, makeStrong<Widgets>());
+}
+
+static Child _shadowed() {
+    return canvas([](Gfx::Context &g, Math::Vec2i) {
+        g.begin();
+        g.ellipse(Math::Ellipsef{250, 150, 120, 90});
+        g.shadow({.paint = Gfx::BLACK, .radius = 24, .offset = {10, 40}});
+    });
+}
+
+test$(hostParallelPaintBlurs) {
+    Array<Math::Recti, 2> damage = {
+        Math::Recti{0, 0, 500, 300},
+        Math::Recti{60, 70, 300, 200},
+    };
+
+    for (auto root : {_blurred, _shadowed}) {
+        for (auto d : damage) {
+            auto serial = _render(root(), NONE, {&d, 1});
+            auto tiled = _render(root(), 3, {&d, 1});
+            for (usize i = 0; i < serial._buf->len(); i++)
+                expectEq$(tiled._buf->buf()[i], serial._buf->buf()[i]);
+        }
+    }
+
+    return Ok();
+}
+
+// As wide as asked, and as tall as the row.
+struct Block : public LeafNode<Block> {
+    isize _width;
+    Math::Recti _bound{};
+
+    Block(isize width)
+        : _width(width) {}
+
+    void layout(Math::Recti r) override {
+        _bound = r;
+    }
+
+    Math::Vec2i size(Math::Vec2i s, Layout::Hint) override {
+        return {_width, s.y};
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+test$(hostDamagesWhatMoved) {
+    auto a = makeStrong<Block>(40);
+    TestHost host{hflow({a, makeStrong<Block>(40), makeStrong<Block>(40)}), {500, 300}};
+    host.layout(host.bound());
+    expectEq$(host._dirty.area(), 500uz * 300);
+    host.paint();
+
+    // The first block grows and pushes the others, the rest of the window
+    // stays as it is.
+    a->_width = 60;
+    shouldLayout(*a);
+    expect$(host._shouldLayout);
+    host.layout(host.bound());
+
+    expectEq$(host._dirty.area(), 140uz * 300);
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(hostPaintFullscreen) {
+    TestHost host{makeStrong<Widgets>(), {1920, 1080}};
+    host.layout(host.bound());
+
+    _driver.bench("serial", [&] {
+        host._dirty.add(host.bound());
+        host.paint();
+    });
+
+    for (usize workers = 1; workers <= Embed::hardwareConcurrency(); workers *= 2) {
+        host.parallel(makeStrong<Sys::ThreadPool>(workers - 1));
+        _driver.bench(Fmt::format("{} threads", workers).unwrap(), [&] {
+            host._dirty.add(host.bound());
+            host.paint();
+        });
+    }
+
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
@@ -0,0 +1,153 @@
+#include <karm-test/macros.h>
+#include <karm-ui/funcs.h>
+#include <karm-ui/layout.h>
+
+namespace Karm::Ui::Tests {
+
+struct Probe : public LeafNode<Probe> {
+    Math::Vec2i _size;
+    Math::Recti _bound{};
+    usize _layouts = 0;
+    usize _sizes = 0;
+
+    Probe(Math::Vec2i size)
+        : _size(size) {}
+
+    void layout(Math::Recti r) override {
+        _layouts++;
+        _bound = r;
+    }
+
+    Math::Vec2i size(Math::Vec2i, Layout::Hint) override {
+        _sizes++;
+        return _size;
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+struct Grid {
+    Vec<Vec<Strong<Probe>>> probes;
+    Child root;
+};
+
+static Grid _grid(usize rows, usize columns) {
+    Vec<Vec<Strong<Probe>>> probes;
+    Children rowNodes;
+    for (usize y = 0; y < rows; y++) {
+        Vec<Strong<Probe>> row;
+        Children cells;
+        for (usize x = 0; x < columns; x++) {
+            auto probe = makeStrong<Probe>(Math::Vec2i{10, 10});
+            row.pushBack(probe);
+            cells.pushBack(probe);
+        }
+        probes.pushBack(row);
+        rowNodes.pushBack(hflow(cells));
+    }
+    return {probes, vflow(rowNodes)};
+}
+
+test$(layoutSkipsCleanSubtrees) {
+    auto grid = _grid(4, 4);
+    grid.root->place({0, 0, 400, 400});
+
+    for (auto &row : grid.probes)
+        for (auto &p : row)
+            expectEq$(p->_layouts, 1uz);
+
+    // Nothing changed, nothing is laid out again.
+    grid.root->place({0, 0, 400, 400});
+    expectEq$(grid.probes[0][0]->_layouts, 1uz);
+
+    // Growing a cell only moves the cells after it in the same row.
+    auto &changed = grid.probes[2][1];
+    auto sizesBefore = grid.probes[0][0]->_sizes;
+    changed->_size = {20, 10};
+    shouldLayout(*changed);
+    grid.root->place({0, 0, 400, 400});
+
+    expectEq$(changed->_layouts, 2uz);
+    expectEq$(grid.probes[2][0]->_layouts, 1uz);
+    expectEq$(grid.probes[2][2]->_layouts, 2uz);
+    expectEq$(grid.probes[0][0]->_layouts, 1uz);
+    expectEq$(grid.probes[3][3]->_layouts, 1uz);
+    expectEq$(grid.probes[0][0]->_sizes, sizesBefore);
+    expectEq$(changed->bound().width, 20);
+
+    // Moving the root lays out everything again.
+    grid.root->place({0, 10, 400, 400});
+    expectEq$(grid.probes[0][0]->_layouts, 2uz);
+    return Ok();
+}
+
+test$(sizeIsMemoized) {
+    auto probe = makeStrong<Probe>(Math::Vec2i{10, 10});
+    Child node = probe;
+
+    probe->measure({100, 100}, Layout::Hint::MIN);
+    probe->measure({100, 100}, Layout::Hint::MIN);
+    expectEq$(probe->_sizes, 1uz);
+
+    probe->measure({100, 100}, Layout::Hint::MAX);
+    expectEq$(probe->_sizes, 2uz);
+
+    probe->_size = {30, 30};
+    shouldLayout(*probe);
+    expectEq$(probe->measure({100, 100}, Layout::Hint::MIN).x, 30);
+    return Ok();
+}
+
+// The probe comes from the first build, rebuilds are reconciled into it.
+static Child _form(Child probe, isize gap) {
+    return vflow({
+        hflow({probe, empty(20)}),
+        hflow({empty(10), spacing(gap, empty(10))}),
+    });
+}
+
+test$(rebuildKeepsUnchangedLayout) {
+    auto probe = makeStrong<Probe>(Math::Vec2i{10, 10});
+    auto root = _form(probe, 4);
+    root->place({0, 0, 400, 400});
+
+    // Rebuilding the same tree doesn't lay out anything again.
+    expect$(not root->reconcile(_form(makeStrong<Probe>(Math::Vec2i{10, 10}), 4)));
+    auto layouts = debugLayoutStats.layouts;
+    root->place({0, 0, 400, 400});
+    expectEq$(debugLayoutStats.layouts, layouts);
+
+    // Only the row with the new spacing is laid out again.
+    expect$(not root->reconcile(_form(makeStrong<Probe>(Math::Vec2i{10, 10}), 8)));
+    layouts = debugLayoutStats.layouts;
+    root->place({0, 0, 400, 400});
+    expect$(debugLayoutStats.layouts > layouts);
+    expectEq$(probe->_layouts, 1uz);
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(layoutGrid) {
+    auto grid = _grid(100, 100);
+    Math::Recti bound = {0, 0, 1920, 1080};
+    auto &cell = grid.probes[50][50];
+
+    // Moving the root moves every node.
+    _driver.bench("full", [&] {
+        bound.y ^= 1;
+        grid.root->place(bound);
+    });
+
+    _driver.bench("incremental", [&] {
+        cell->_size.x ^= 1;
+        shouldLayout(*cell);
+        grid.root->place(bound);
+    });
+
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
@@ -0,0 +1,164 @@
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-ui/funcs.h>
+#include <karm-ui/scroll.h>
+
+namespace Karm::Ui::Tests {
+
+struct Item : public LeafNode<Item> {
+    static inline Vec<Item *> alive;
+
+    usize _index;
+    Math::Recti _bound{};
+
+    Item(usize index)
+        : _index(index) {
+        alive.pushBack(this);
+    }
+
+    ~Item() {
+        alive.removeAll(this);
+    }
+
+    // The materialized item with the lowest index.
+    static Item &first() {
+        Item *first = nullptr;
+        for (auto *i : alive)
+            if (i->_parent and (not first or i->_index < first->_index))
+                first = i;
+        return *first;
+    }
+
+    void reconcile(Item &o) override {
+        _index = o._index;
+    }
+
+    void paint(Gfx::Context &g, Math::Recti) override {
+        g.clear(_bound, _index % 2 ? Gfx::WHITE : Gfx::BLACK);
+    }
+
+    void layout(Math::Recti r) override {
+        _bound = r;
+    }
+
+    Math::Vec2i size(Math::Vec2i, Layout::Hint) override {
+        return {100, 20};
+    }
+
+    Math::Recti bound() override {
+        return _bound;
+    }
+};
+
+// Never paired with an Item, so the item is replaced.
+struct Blank : public LeafNode<Blank> {
+    static inline Vec<Blank *> alive;
+
+    Blank() {
+        alive.pushBack(this);
+    }
+
+    ~Blank() {
+        alive.removeAll(this);
+    }
+
+    Math::Vec2i size(Math::Vec2i, Layout::Hint) override {
+        return {100, 20};
+    }
+};
+
+static void _scroll(Node &node, isize lines) {
+    Events::MouseEvent e{
+        .type = Events::MouseEvent::SCROLL,
+        .pos = {10, 10},
+        .scrollPrecise = {0, (f64)lines},
+    };
+    node.event(e);
+}
+
+test$(vlistMaterializesViewport) {
+    usize built = 0;
+    auto list = vlist(1'000'000, [&](usize i) -> Child {
+        built++;
+        return makeStrong<Item>(i);
+    });
+    auto scroll = vscroll(list);
+    scroll->place({0, 0, 200, 400});
+
+    expectEq$(list->bound().height, 20'000'000);
+
+    // 20 visible rows, plus the overscan after them.
+    expectLteq$(Item::alive.len(), 30uz);
+    expectEq$(Item::first()._index, 0uz);
+    expectEq$(Item::first()._bound.y, 0);
+
+    // Scrolling by 1600px moves the window by 80 rows, minus the overscan.
+    _scroll(*scroll, -100);
+    expectLteq$(Item::alive.len(), 40uz);
+    auto &first = Item::first();
+    expectEq$(first._index, 72uz);
+    expectEq$(first._bound.y, 72 * 20);
+
+    // Nodes are recycled, only the new items are built.
+    auto before = built;
+    _scroll(*scroll, -1);
+    expectLteq$(built - before, 1uz);
+    return Ok();
+}
+
+test$(vlistAttachesReplacedItems) {
+    auto list = vlist(100, [](usize i) -> Child {
+        return makeStrong<Item>(i);
+    });
+    auto scroll = vscroll(list);
+    scroll->place({0, 0, 200, 400});
+
+    // Rebuilt with rows of another type, all the items are replaced.
+    tryOr(scroll->reconcile(vscroll(vlist(100, [](usize) -> Child {
+              return makeStrong<Blank>();
+          }))),
+          scroll);
+    scroll->place({0, 0, 200, 400});
+
+    for (auto *i : Item::alive)
+        expect$(i->_parent == nullptr);
+
+    expectNe$(Blank::alive.len(), 0uz);
+    for (auto *b : Blank::alive)
+        expect$(b->_parent == &*list);
+
+    // The list hears about the replaced items needing a new layout.
+    expect$(not list->_needsLayout);
+    shouldLayout(*Blank::alive[0]);
+    expect$(list->_needsLayout);
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(vlistScroll) {
+    auto img = Media::Image::alloc({400, 1000});
+    auto scroll = vscroll(vlist(1'000'000, [](usize i) -> Child {
+        return makeStrong<Item>(i);
+    }));
+    scroll->place(img.bound());
+
+    Gfx::Context g;
+    g.begin(img);
+
+    isize dir = -1;
+    usize step = 0;
+    _driver.bench("scroll and paint", [&] {
+        // Back and forth over 5000 rows.
+        if (++step % 1000 == 0)
+            dir = -dir;
+        _scroll(*scroll, dir * 5);
+        scroll->paint(g, img.bound());
+    });
+
+    g.end();
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
@@ -0,0 +1,137 @@
+#include <karm-test/macros.h>
+#include <karm-ui/node.h>
+
+namespace Karm::Ui::Tests {
+
+// A leaf carrying some state that must survive rebuilds.
+struct Row : public LeafNode<Row> {
+    usize _id;
+    usize _state = 0;
+
+    Row(usize id)
+        : _id(id) {}
+
+    void reconcile(Row &o) override {
+        _id = o._id;
+    }
+};
+
+// Never paired with a Row, so the row is replaced.
+struct Other : public LeafNode<Other> {};
+
+struct List : public GroupNode<List> {
+    using GroupNode::GroupNode;
+};
+
+static Child _list(Slice<usize> ids, bool keyed) {
+    Children rows;
+    rows.ensure(ids.len());
+    for (auto id : ids) {
+        Child row = makeStrong<Row>(id);
+        rows.pushBack(keyed ? key(id, row) : row);
+    }
+    return makeStrong<List>(rows);
+}
+
+test$(reconcileKeyed) {
+    Array<usize, 4> before = {1, 2, 3, 4};
+    auto list = _list(before, true);
+    for (auto &c : list.unwrap<List>().children())
+        c.unwrap<Row>()._state = c.unwrap<Row>()._id * 10;
+
+    // Insert at the top, drop one, swap two.
+    Array<usize, 4> after = {0, 4, 2, 1};
+    tryOr(list->reconcile(_list(after, true)), list);
+
+    auto &children = list.unwrap<List>().children();
+    expectEq$(children.len(), 4uz);
+    expectEq$(children[0].unwrap<Row>()._state, 0uz);
+    for (usize i = 1; i < children.len(); i++) {
+        auto &row = children[i].unwrap<Row>();
+        expectEq$(row._id, after[i]);
+        expectEq$(row._state, row._id * 10);
+    }
+
+    return Ok();
+}
+
+test$(reconcileUnkeyed) {
+    Array<usize, 3> before = {1, 2, 3};
+    auto list = _list(before, false);
+    auto *first = &list.unwrap<List>().children()[0].unwrap<Row>();
+
+    Array<usize, 3> after = {0, 1, 2};
+    tryOr(list->reconcile(_list(after, false)), list);
+
+    // Without keys, children are paired by index.
+    auto &children = list.unwrap<List>().children();
+    expect$(&children[0].unwrap<Row>() == first);
+    expectEq$(children[0].unwrap<Row>()._id, 0uz);
+    return Ok();
+}
+
+test$(reconcileKeyedDetachesReplaced) {
+    Array<usize, 2> ids = {1, 2};
+    auto list = _list(ids, true);
+    Child replaced = list.unwrap<List>().children()[0];
+
+    Children them = {
+        key(1, makeStrong<Other>()),
+        key(2, makeStrong<Row>(2)),
+    };
+    tryOr(list->reconcile(makeStrong<List>(them)), list);
+
+    auto &children = list.unwrap<List>().children();
+    expect$(children[0].is<Other>());
+    expect$(replaced->parent() == nullptr);
+    expect$(children[0]->parent() == &*list);
+    expect$(children[1]->parent() == &*list);
+    return Ok();
+}
+
+test$(reconcileKeyedDetachesUnkeyed) {
+    Array<usize, 2> ids = {1, 2};
+    auto list = _list(ids, false);
+    Children before = list.unwrap<List>().children();
+
+    tryOr(list->reconcile(_list(ids, true)), list);
+
+    // Nothing to pair the old children with, they are all dropped.
+    for (auto &c : before)
+        expect$(c->parent() == nullptr);
+    for (auto &c : list.unwrap<List>().children())
+        expect$(c->parent() == &*list);
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(reconcileList) {
+    static constexpr usize LEN = 10000;
+
+    Vec<usize> ids;
+    for (usize i = 0; i < LEN; i++)
+        ids.pushBack(i + 1);
+
+    Vec<usize> shifted;
+    shifted.pushBack(0);
+    for (usize i = 0; i + 1 < LEN; i++)
+        shifted.pushBack(i + 1);
+
+    _driver.bench("build only", [&] {
+        auto list = _list(ids, true);
+    });
+
+    for (bool keyed : {false, true}) {
+        auto list = _list(ids, keyed);
+        bool flip = false;
+        _driver.bench(keyed ? "keyed" : "by index", [&] {
+            flip = not flip;
+            tryOr(list->reconcile(_list(flip ? shifted : ids, keyed)), list);
+        });
+    }
+
+    return Ok();
+}
+
+} // namespace Karm::Ui::Tests
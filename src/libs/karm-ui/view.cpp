@@ -4,36 +4,27 @@ namespace Karm::Ui {
 
 /* --- Text ----------------------------------------------------------------- */
 
-static Opt<Strong<Media::Fontface>> _regularFontface = NONE;
+// Faces are loaded on first use, function statics make that safe when text
+// is first measured or painted from several threads.
+
 Strong<Media::Fontface> regularFontface() {
-    if (!_regularFontface) {
-        _regularFontface = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Regular.ttf"_url).unwrap();
-    }
-    return *_regularFontface;
+    static Strong<Media::Fontface> face = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Regular.ttf"_url).unwrap();
+    return face;
 }
 
-static Opt<Strong<Media::Fontface>> _mediumFontface = NONE;
 Strong<Media::Fontface> mediumFontface() {
-    if (!_mediumFontface) {
-        _mediumFontface = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Medium.ttf"_url).unwrap();
-    }
-    return *_mediumFontface;
+    static Strong<Media::Fontface> face = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Medium.ttf"_url).unwrap();
+    return face;
 }
 
-static Opt<Strong<Media::Fontface>> _boldFontface = NONE;
 Strong<Media::Fontface> boldFontface() {
-    if (!_boldFontface) {
-        _boldFontface = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Bold.ttf"_url).unwrap();
-    }
-    return *_boldFontface;
+    static Strong<Media::Fontface> face = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Bold.ttf"_url).unwrap();
+    return face;
 }
 
-static Opt<Strong<Media::Fontface>> _italicFontface = NONE;
 Strong<Media::Fontface> italicFontface() {
-    if (!_italicFontface) {
-        _italicFontface = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Italic.ttf"_url).unwrap();
-    }
-    return *_italicFontface;
+    static Strong<Media::Fontface> face = Media::loadFontfaceOrFallback("bundle://inter-font/fonts/Inter-Italic.ttf"_url).unwrap();
+    return face;
 }
 
 TextStyle TextStyle::displayLarge() {
@@ -177,8 +168,12 @@ struct Text : public View<Text> {
         : _style(style), _text(text) {}
 
     void reconcile(Text &o) override {
+        if (Op::eq(_text, o._text))
+            return;
+
         _text = o._text;
         _mesure = NONE;
+        invalidateLayout();
     }
 
     Media::FontMesure mesure() {
@@ -238,6 +233,8 @@ struct Icon : public View<Icon> {
         : _icon(icon), _color(color) {}
 
     void reconcile(Icon &o) override {
+        if (_icon._size != o._icon._size)
+            invalidateLayout();
         _icon = o._icon;
     }
 
@@ -269,6 +266,7 @@ Child icon(Mdi::Icon i, f64 size, Opt<Gfx::Color> color) {
 struct Image : public View<Image> {
     Media::Image _image;
     Opt<Gfx::BorderRadius> _radius;
+    Gfx::Sampling _sampling = Gfx::Sampling::NEAREST;
 
     Image(Media::Image image)
         : _image(image) {}
@@ -276,12 +274,15 @@ struct Image : public View<Image> {
     Image(Media::Image image, Gfx::BorderRadius radius)
         : _image(image), _radius(radius) {}
 
+    Image(Media::Image image, Gfx::Sampling sampling)
+        : _image(image), _sampling(sampling) {}
+
     void paint(Gfx::Context &g, Math::Recti) override {
         if (_radius) {
             g.fillStyle(_image);
             g.fill(bound(), *_radius);
         } else {
-            g.blit(bound(), _image);
+            g.blit(bound(), _image, _sampling);
         }
 
         if (debugShowLayoutBounds)
@@ -301,6 +302,10 @@ Child image(Media::Image image, Gfx::BorderRadius radius) {
     return makeStrong<Image>(image, radius);
 }
 
+Child image(Media::Image image, Gfx::Sampling sampling) {
+    return makeStrong<Image>(image, sampling);
+}
+
 /* --- Canvas --------------------------------------------------------------- */
 
 struct Canvas : public View<Canvas> {
@@ -114,6 +114,8 @@ Child image(Media::Image image);
 
 Child image(Media::Image image, Gfx::BorderRadius radius);
 
+Child image(Media::Image image, Gfx::Sampling sampling);
+
 /* --- Canvas --------------------------------------------------------------- */
 
 using OnPaint = Func<void(Gfx::Context &g, Math::Vec2i size)>;
@@ -1,19 +1,470 @@
 #pragma once
 
-#include <adler/spec.h>
+#include <huff/huff.h>
+#include <karm-base/endian.h>
+#include <karm-hash/hash.h>
 #include <karm-io/traits.h>
 
 // https://gist.github.com/vurtun/760a6a2a198b706a7b1a6197aa5ac747
 // https://bitbucket.org/rmitton/tigr/src/be3832bee7fb2f274fe5823e38f8ec7fa94e0ce9/src/tigr_inflate.c?at=default&fileviewer=file-view-default
 // https://github.com/github/putty/blob/49fb598b0e78d09d6a2a42679ee0649df482090e/sshzlib.c
 // https://www.ietf.org/rfc/rfc1951.txt
+// https://www.ietf.org/rfc/rfc1950.txt
 
 namespace Deflate {
 
+enum struct Format {
+    // Bare DEFLATE blocks.
+    RAW,
+
+    // DEFLATE blocks wrapped in a zlib header and an Adler32 trailer.
+    ZLIB,
+};
+
 struct Compressor : public Io::Writer {
 };
 
+/* --- Tables --------------------------------------------------------------- */
+
+static constexpr Array<u16, 29> LEN_BASE = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static constexpr Array<u8, 29> LEN_EXTRA = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static constexpr Array<u16, 30> DIST_BASE = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577};
+
+static constexpr Array<u8, 30> DIST_EXTRA = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order in which the lengths of the code length code are stored.
+static constexpr Array<u8, 19> CLEN_ORDER = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/* --- Decompressor --------------------------------------------------------- */
+
+// Streaming inflate, memory use is bounded by the input buffer and twice the
+// size of the window, whatever the size of the stream.
 struct Decompressor : public Io::Reader {
+    static constexpr usize WINDOW = 32 * 1024;
+    static constexpr usize MAX_MATCH = 258;
+    static constexpr usize INPUT = 16 * 1024;
+
+    // Decoding stops once the output reaches this point, the slack past it
+    // lets a match be copied without checking for room, 8 bytes at a time.
+    static constexpr usize LIMIT = 2 * WINDOW;
+    static constexpr usize OUTPUT = LIMIT + MAX_MATCH + 8;
+
+    enum struct State {
+        START,
+        BLOCK,
+        STORED,
+        HUFFMAN,
+        TRAILER,
+        DONE,
+    };
+
+    Io::Reader &_reader;
+    Format _format;
+    State _state = State::START;
+    bool _last = false;
+    bool _fixed = false;
+
+    Vec<u8> _input;
+    usize _inputPos = 0;
+    usize _inputEnd = 0;
+    bool _eof = false;
+
+    // Bits are consumed from the least significant end, the buffer holds
+    // `_count` valid bits. Past the end of the input, zeros are shifted in
+    // and counted in `_padding` to detect truncated streams.
+    u64 _bits = 0;
+    usize _count = 0;
+    usize _padding = 0;
+
+    Vec<u8> _output;
+    usize _outputPos = 0;
+    usize _outputEnd = 0;
+
+    usize _stored = 0;
+    Huff::Table<10> _litlen;
+    Huff::Table<8> _dist;
+    Hash::Adler32 _adler;
+
+    Decompressor(Io::Reader &reader, Format format = Format::RAW)
+        : _reader(reader), _format(format) {
+        _input.resize(INPUT, 0);
+        _output.resize(OUTPUT, 0);
+    }
+
+    Res<usize> read(MutBytes bytes) override {
+        while (_outputPos == _outputEnd and _state != State::DONE) {
+            if (_outputEnd >= LIMIT)
+                _slide();
+            try$(_decode());
+        }
+
+        usize len = min(bytes.len(), _outputEnd - _outputPos);
+        memcpy(bytes.buf(), _output.buf() + _outputPos, len);
+        _outputPos += len;
+        return Ok(len);
+    }
+
+    // Keep the last window of output around for back-references.
+    void _slide() {
+        memmove(_output.buf(), _output.buf() + _outputEnd - WINDOW, WINDOW);
+        _outputPos -= _outputEnd - WINDOW;
+        _outputEnd = WINDOW;
+    }
+
+    /* --- Bits ------------------------------------------------------------- */
+
+    Res<> _fill() {
+        memmove(_input.buf(), _input.buf() + _inputPos, _inputEnd - _inputPos);
+        _inputEnd -= _inputPos;
+        _inputPos = 0;
+
+        while (not _eof and _inputEnd < INPUT) {
+            usize read = try$(_reader.read(mutSub(_input, _inputEnd, INPUT)));
+            if (read == 0)
+                _eof = true;
+            _inputEnd += read;
+        }
+
+        return Ok();
+    }
+
+    // Make sure at least 56 bits are available.
+    ALWAYS_INLINE Res<> _refill() {
+        if (_inputEnd - _inputPos < 8) [[unlikely]]
+            return _refillSlow();
+
+        u64le word;
+        memcpy(&word, _input.buf() + _inputPos, sizeof(word));
+        _bits |= (u64)word << _count;
+        _inputPos += (63 - _count) >> 3;
+        _count |= 56;
+        return Ok();
+    }
+
+    Res<> _refillSlow() {
+        if (not _eof)
+            try$(_fill());
+
+        if (_inputEnd - _inputPos >= 8)
+            return _refill();
+
+        while (_count <= 56) {
+            if (_inputPos < _inputEnd)
+                _bits |= (u64)_input[_inputPos++] << _count;
+            else
+                _padding++;
+            _count += 8;
+        }
+
+        return Ok();
+    }
+
+    ALWAYS_INLINE usize _take(usize len) {
+        usize value = _bits & ((1ull << len) - 1);
+        _bits >>= len;
+        _count -= len;
+        return value;
+    }
+
+    void _align() {
+        _take(_count & 7);
+    }
+
+    Res<> _checkOverrun() {
+        if (_padding * 8 > _count)
+            return Error::invalidData("unexpected end of stream");
+        return Ok();
+    }
+
+    /* --- Blocks ----------------------------------------------------------- */
+
+    Res<> _decode() {
+        usize start = _outputEnd;
+        while (_outputEnd < LIMIT and
+               _state != State::TRAILER and
+               _state != State::DONE) {
+            switch (_state) {
+            case State::START:
+                try$(_header());
+                break;
+
+            case State::BLOCK:
+                try$(_block());
+                break;
+
+            case State::STORED:
+                try$(_copyStored());
+                break;
+
+            case State::HUFFMAN:
+                try$(_inflate());
+                break;
+
+            default:
+                break;
+            }
+        }
+        try$(_checkOverrun());
+
+        if (_format == Format::ZLIB)
+            _adler.add(sub(_output, start, _outputEnd));
+
+        if (_state == State::TRAILER)
+            try$(_trailer());
+
+        return Ok();
+    }
+
+    Res<> _header() {
+        _state = State::BLOCK;
+        if (_format != Format::ZLIB)
+            return Ok();
+
+        try$(_refill());
+        usize cmf = _take(8);
+        usize flg = _take(8);
+        try$(_checkOverrun());
+
+        if ((cmf & 0xf) != 8 or (cmf >> 4) > 7)
+            return Error::invalidData("unsupported zlib compression method");
+        if (((cmf << 8) | flg) % 31 != 0)
+            return Error::invalidData("invalid zlib header checksum");
+        if (flg & 0x20)
+            return Error::invalidData("zlib preset dictionaries are not supported");
+
+        return Ok();
+    }
+
+    Res<> _trailer() {
+        _align();
+        try$(_refill());
+        u32 sum = 0;
+        for (usize i = 0; i < 4; i++)
+            sum = (sum << 8) | _take(8);
+        try$(_checkOverrun());
+
+        if (sum != _adler.sum())
+            return Error::invalidData("adler32 mismatch");
+
+        _state = State::DONE;
+        return Ok();
+    }
+
+    Res<> _block() {
+        if (_last) {
+            _state = _format == Format::ZLIB ? State::TRAILER : State::DONE;
+            return Ok();
+        }
+
+        try$(_refill());
+        _last = _take(1);
+        usize type = _take(2);
+
+        if (type == 0) {
+            _align();
+            try$(_refill());
+            usize len = _take(16);
+            usize nlen = _take(16);
+            try$(_checkOverrun());
+            if (len != (~nlen & 0xffff))
+                return Error::invalidData("invalid stored block length");
+            _stored = len;
+            _state = State::STORED;
+        } else if (type == 1) {
+            try$(_buildFixed());
+            _state = State::HUFFMAN;
+        } else if (type == 2) {
+            try$(_buildDynamic());
+            _state = State::HUFFMAN;
+        } else {
+            return Error::invalidData("invalid block type");
+        }
+
+        return Ok();
+    }
+
+    Res<> _copyStored() {
+        // Whole bytes left in the bit buffer come first.
+        while (_stored and _count >= 8 and _outputEnd < LIMIT) {
+            _output[_outputEnd++] = _take(8);
+            _stored--;
+        }
+
+        if (_count < 8) {
+            try$(_checkOverrun());
+            _bits = 0;
+            _count = 0;
+        }
+
+        while (_stored and _outputEnd < LIMIT) {
+            if (_inputPos == _inputEnd) {
+                if (_eof)
+                    return Error::invalidData("unexpected end of stream");
+                try$(_fill());
+                continue;
+            }
+
+            usize len = min(_stored, _inputEnd - _inputPos, LIMIT - _outputEnd);
+            memcpy(_output.buf() + _outputEnd, _input.buf() + _inputPos, len);
+            _outputEnd += len;
+            _inputPos += len;
+            _stored -= len;
+        }
+
+        if (not _stored)
+            _state = State::BLOCK;
+        return Ok();
+    }
+
+    Res<> _buildFixed() {
+        if (_fixed)
+            return Ok();
+
+        Array<u8, 288> litlen;
+        for (usize i = 0; i < 288; i++)
+            litlen[i] = i < 144 ? 8 : i < 256 ? 9
+                                : i < 280 ? 7
+                                          : 8;
+        try$(_litlen.build(litlen));
+
+        Array<u8, 30> dist;
+        for (auto &len : dist)
+            len = 5;
+        try$(_dist.build(dist));
+
+        _fixed = true;
+        return Ok();
+    }
+
+    Res<> _buildDynamic() {
+        _fixed = false;
+
+        try$(_refill());
+        usize hlit = _take(5) + 257;
+        usize hdist = _take(5) + 1;
+        usize hclen = _take(4) + 4;
+        if (hlit > 286 or hdist > 30)
+            return Error::invalidData("too many huffman codes");
+
+        Array<u8, 19> clens{};
+        for (usize i = 0; i < hclen; i++) {
+            try$(_refill());
+            clens[CLEN_ORDER[i]] = _take(3);
+        }
+
+        Huff::Table<7> clen;
+        try$(clen.build(clens));
+
+        Array<u8, 286 + 30> lens{};
+        usize n = 0;
+        while (n < hlit + hdist) {
+            try$(_refill());
+            auto [sym, len] = clen.decode(_bits);
+            if (not len)
+                return Error::invalidData("invalid code length code");
+            _take(len);
+
+            if (sym < 16) {
+                lens[n++] = sym;
+                continue;
+            }
+
+            u8 fill = 0;
+            usize repeat;
+            if (sym == 16) {
+                if (n == 0)
+                    return Error::invalidData("nothing to repeat");
+                fill = lens[n - 1];
+                repeat = 3 + _take(2);
+            } else if (sym == 17) {
+                repeat = 3 + _take(3);
+            } else {
+                repeat = 11 + _take(7);
+            }
+
+            if (n + repeat > hlit + hdist)
+                return Error::invalidData("code lengths overflow");
+            while (repeat--)
+                lens[n++] = fill;
+        }
+        try$(_checkOverrun());
+
+        if (lens[256] == 0)
+            return Error::invalidData("missing end of block code");
+
+        try$(_litlen.build(sub(lens, 0, hlit)));
+        try$(_dist.build(sub(lens, hlit, hlit + hdist)));
+        return Ok();
+    }
+
+    /* --- Huffman ---------------------------------------------------------- */
+
+    Res<> _inflate() {
+        u8 *out = _output.buf();
+        while (_outputEnd < LIMIT) {
+            // A single refill covers the longest possible symbol: a 15 bits
+            // length code, 5 extra bits, a 15 bits distance code and 13
+            // extra bits.
+            try$(_refill());
+            auto [sym, len] = _litlen.decode(_bits);
+            if (not len) [[unlikely]]
+                return Error::invalidData("invalid literal/length code");
+            _take(len);
+
+            if (sym < 256) {
+                out[_outputEnd++] = sym;
+                continue;
+            }
+
+            if (sym == 256) {
+                _state = State::BLOCK;
+                return Ok();
+            }
+
+            sym -= 257;
+            if (sym >= 29) [[unlikely]]
+                return Error::invalidData("invalid length code");
+            usize length = LEN_BASE[sym] + _take(LEN_EXTRA[sym]);
+
+            auto [dsym, dlen] = _dist.decode(_bits);
+            if (not dlen or dsym >= 30) [[unlikely]]
+                return Error::invalidData("invalid distance code");
+            _take(dlen);
+            usize dist = DIST_BASE[dsym] + _take(DIST_EXTRA[dsym]);
+            if (dist > _outputEnd) [[unlikely]]
+                return Error::invalidData("distance too far back");
+
+            _copyMatch(out + _outputEnd, dist, length);
+            _outputEnd += length;
+        }
+        return Ok();
+    }
+
+    ALWAYS_INLINE static void _copyMatch(u8 *dst, usize dist, usize len) {
+        u8 const *src = dst - dist;
+        if (dist >= 8) {
+            // Chunks may overshoot the match, never the data they read.
+            for (usize i = 0; i < len; i += 8)
+                memcpy(dst + i, src + i, 8);
+        } else if (dist == 1) {
+            memset(dst, *src, len);
+        } else {
+            for (usize i = 0; i < len; i++)
+                dst[i] = src[i];
+        }
+    }
 };
 
 } // namespace Deflate
@@ -0,0 +1,147 @@
+#include <deflate/spec.h>
+#include <karm-io/impls.h>
+#include <karm-test/macros.h>
+#include <karm-test/samples.h>
+
+namespace Deflate::Tests {
+
+// Hands out the input a few bytes at a time.
+struct Trickle : public Io::Reader {
+    Bytes _buf;
+    usize _pos = 0;
+
+    Trickle(Bytes buf) : _buf(buf) {}
+
+    Res<usize> read(MutBytes bytes) override {
+        usize len = min(bytes.len(), _buf.len() - _pos, 7uz);
+        memcpy(bytes.buf(), &_buf[_pos], len);
+        _pos += len;
+        return Ok(len);
+    }
+};
+
+static Res<Vec<u8>> _inflate(Io::Reader &reader, Format format, usize chunk = 4096) {
+    Decompressor decompressor{reader, format};
+    Vec<u8> out;
+    while (true) {
+        usize len = out.len();
+        out.resize(len + chunk, 0);
+        usize read = try$(decompressor.read(mutSub(out, len, len + chunk)));
+        out.truncate(len + read);
+        if (read == 0)
+            return Ok(out);
+    }
+}
+
+static Res<Vec<u8>> _inflate(Bytes bytes, Format format) {
+    Io::BufReader reader{bytes};
+    return _inflate(reader, format);
+}
+
+static bool _eq(Bytes bytes, Str str) {
+    return bytes.len() == str.len() and
+           memcmp(bytes.buf(), str.buf(), bytes.len()) == 0;
+}
+
+test$(inflateStored) {
+    Array<u8, 10> data = {0x01, 0x05, 0x00, 0xfa, 0xff, 'h', 'e', 'l', 'l', 'o'};
+    auto out = try$(_inflate(data, Format::RAW));
+    expect$(_eq(out, "hello"));
+    return Ok();
+}
+
+test$(inflateFixed) {
+    Array<u8, 10> data = {0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0xc8, 0x40, 0x27, 0x01};
+    auto out = try$(_inflate(data, Format::RAW));
+    expect$(_eq(out, "hello hello hello hello"));
+    return Ok();
+}
+
+static constexpr Array<u8, 26> ZLIB = {
+    0x78, 0xda, 0x4b, 0x4c, 0x2a, 0x4a, 0x4c, 0x4e, 0x4c, 0x49, 0x04, 0x52, 0x0a,
+    0x89, 0xd8, 0xd9, 0x8a, 0x89, 0x74, 0x54, 0x03, 0x00, 0x35, 0x71, 0x35, 0x75};
+
+static constexpr Str ABRACADABRA =
+    "abracadabra abracadabra abracadabra!"
+    "abracadabra abracadabra abracadabra!"
+    "abracadabra abracadabra abracadabra!"
+    "abracadabra abracadabra abracadabra!";
+
+test$(inflateZlib) {
+    auto out = try$(_inflate(ZLIB, Format::ZLIB));
+    expect$(_eq(out, ABRACADABRA));
+    return Ok();
+}
+
+test$(inflateRejectsCorruptStreams) {
+    // Reserved block type.
+    Array<u8, 1> reserved = {0x07};
+    expectNot$(bool(_inflate(reserved, Format::RAW)));
+
+    // Stored block length not matching its complement.
+    Array<u8, 5> stored = {0x01, 0x05, 0x00, 0xfa, 0xfe};
+    expectNot$(bool(_inflate(stored, Format::RAW)));
+
+    // Truncated stream.
+    expectNot$(bool(_inflate(sub(ZLIB, 0, 12), Format::ZLIB)));
+
+    // Bad checksum.
+    auto data = ZLIB;
+    data[25] ^= 1;
+    expectNot$(bool(_inflate(data, Format::ZLIB)));
+
+    return Ok();
+}
+
+/* --- Corpus --------------------------------------------------------------- */
+
+struct Sample {
+    Str name;
+    usize size;
+};
+
+static constexpr Array<Sample, 4> CORPUS = {
+    Sample{"source.z", 150701},
+    Sample{"font.z", 289624},
+    Sample{"fixed.z", 150701},
+    Sample{"stored.z", 80000},
+};
+
+static Res<Sys::Mmap> _load(Str name) {
+    return loadSample("bundle://deflate-spec-tests/corpus"_url, name);
+}
+
+test$(inflateCorpus) {
+    for (auto const &sample : CORPUS) {
+        auto map = try$(_load(sample.name));
+
+        auto out = try$(_inflate(map.bytes(), Format::ZLIB));
+        expectEq$(out.len(), sample.size);
+
+        // Streaming through tiny reads must give the same result.
+        Trickle trickle{map.bytes()};
+        auto trickled = try$(_inflate(trickle, Format::ZLIB, 13));
+        expectEq$(trickled.len(), sample.size);
+        expect$(memcmp(out.buf(), trickled.buf(), out.len()) == 0);
+    }
+    return Ok();
+}
+
+bench$(inflateThroughput) {
+    Array<u8, 64 * 1024> buf;
+    for (auto const &sample : CORPUS) {
+        auto map = try$(_load(sample.name));
+
+        try$(benchThroughput(_driver, sample.name, sample.size, "MB/s", [&]() -> Res<> {
+            Io::BufReader reader{map.bytes()};
+            Decompressor decompressor{reader, Format::ZLIB};
+            while (true) {
+                if (try$(decompressor.read(buf.mutBytes())) == 0)
+                    return Ok();
+            }
+        }));
+    }
+    return Ok();
+}
+
+} // namespace Deflate::Tests
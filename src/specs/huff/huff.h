@@ -1,13 +1,126 @@
 #pragma once
 
 #include <karm-base/array.h>
+#include <karm-base/cons.h>
+#include <karm-base/res.h>
+#include <karm-base/slice.h>
+#include <karm-base/vec.h>
 
 namespace Huff {
 
-template <typename T>
-struct Tree {
-    Array<T, sizeof(T) * 8> len;
-    Array<T, sizeof(T) * 8> sym;
+// Canonical Huffman codes with bits stored least significant first, as used
+// by DEFLATE. Codes are decoded with a single lookup of the next `ROOT`
+// bits, longer codes go through a second level table.
+template <usize ROOT>
+struct Table {
+    static constexpr usize MAX_BITS = 15;
+
+    // Layout of an entry:
+    //  - bits 0..3: number of bits to consume, 0 for invalid codes
+    //  - bit  4: the entry points to a second level table
+    //  - bits 8..11: number of bits indexing the second level table
+    //  - bits 16..31: the symbol, or the index of the second level table
+    static constexpr u32 LINK = 1 << 4;
+
+    Vec<u32> _entries;
+
+    static constexpr u32 _leaf(usize sym, usize len) {
+        return (sym << 16) | len;
+    }
+
+    static constexpr usize _reverse(usize code, usize len) {
+        usize res = 0;
+        for (usize i = 0; i < len; i++) {
+            res = (res << 1) | (code & 1);
+            code >>= 1;
+        }
+        return res;
+    }
+
+    // Build the table from the length of the code of each symbol, 0 meaning
+    // the symbol is unused. Incomplete codes are allowed, missing codes
+    // decode as invalid.
+    Res<> build(Slice<u8> lens) {
+        Array<u16, MAX_BITS + 1> count{};
+        for (auto len : lens) {
+            if (len > MAX_BITS)
+                return Error::invalidData("huffman code too long");
+            count[len]++;
+        }
+        count[0] = 0;
+
+        // Over-subscribed codes can't be decoded.
+        isize left = 1;
+        for (usize len = 1; len <= MAX_BITS; len++) {
+            left = (left << 1) - count[len];
+            if (left < 0)
+                return Error::invalidData("huffman code over-subscribed");
+        }
+
+        Array<u16, MAX_BITS + 2> next{};
+        for (usize len = 1; len <= MAX_BITS; len++)
+            next[len + 1] = (next[len] + count[len]) << 1;
+
+        // Codes longer than the root share a second level table per root
+        // prefix, sized for the longest of them.
+        Array<u16, MAX_BITS + 2> code = next;
+        Array<u8, 1 << ROOT> subBits{};
+        for (usize sym = 0; sym < lens.len(); sym++) {
+            usize len = lens[sym];
+            if (len <= ROOT)
+                continue;
+            usize rev = _reverse(code[len]++, len);
+            auto &bits = subBits[rev & ((1 << ROOT) - 1)];
+            bits = max<u8>(bits, len - ROOT);
+        }
+
+        usize size = 1 << ROOT;
+        _entries.clear();
+        _entries.resize(size, 0);
+        for (usize prefix = 0; prefix < (1uz << ROOT); prefix++) {
+            if (not subBits[prefix])
+                continue;
+            _entries[prefix] = (size << 16) | (subBits[prefix] << 8) | LINK | ROOT;
+            size += 1 << subBits[prefix];
+        }
+        _entries.resize(size, 0);
+
+        code = next;
+        for (usize sym = 0; sym < lens.len(); sym++) {
+            usize len = lens[sym];
+            if (len == 0)
+                continue;
+
+            usize rev = _reverse(code[len]++, len);
+            if (len <= ROOT) {
+                for (usize i = rev; i < (1uz << ROOT); i += 1 << len)
+                    _entries[i] = _leaf(sym, len);
+            } else {
+                auto link = _entries[rev & ((1 << ROOT) - 1)];
+                usize start = link >> 16;
+                usize bits = (link >> 8) & 0xf;
+                usize sub = rev >> ROOT;
+                for (usize i = sub; i < (1uz << bits); i += 1 << (len - ROOT))
+                    _entries[start + i] = _leaf(sym, len - ROOT);
+            }
+        }
+
+        return Ok();
+    }
+
+    // Lookup the entry for the next bits of the stream, which must hold at
+    // least MAX_BITS bits. Returns the symbol and the length of its code, a
+    // length of 0 means the code is invalid.
+    ALWAYS_INLINE Cons<usize, usize> decode(u64 bits) const {
+        u32 e = _entries[bits & ((1 << ROOT) - 1)];
+        if (e & LINK) [[unlikely]] {
+            usize sub = (bits >> ROOT) & ((1 << ((e >> 8) & 0xf)) - 1);
+            u32 leaf = _entries[(e >> 16) + sub];
+            usize len = leaf & 0xf;
+            return {leaf >> 16, len ? len + ROOT : 0};
+        }
+        return {e >> 16, e & 0xf};
+    }
 };
 
 } // namespace Huff
@@ -6,12 +6,104 @@
 
 #include "../bscan.h"
 
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+// https://www.w3.org/Graphics/JPEG/itu-t81.pdf
+
 namespace Jpeg {
 
+// Full range ITU-R BT.601 as used by JFIF.
 struct YCbCr {
     f64 y;
     f64 cb;
     f64 cr;
+
+    static constexpr f64 CR_R = 1.402;
+    static constexpr f64 CB_G = 0.344136;
+    static constexpr f64 CR_G = 0.714136;
+    static constexpr f64 CB_B = 1.772;
+
+    Gfx::Color toRgb() const {
+        auto chan = [](f64 v) {
+            return (u8)clamp(v + 0.5, 0.0, 255.0);
+        };
+
+        return Gfx::Color::fromRgb(
+            chan(y + CR_R * (cr - 128)),
+            chan(y - CB_G * (cb - 128) - CR_G * (cr - 128)),
+            chan(y + CB_B * (cb - 128))
+        );
+    }
+
+    // Same as `toRgb()` in fixed point over whole rows of samples. The
+    // products are computed at twice the sample scale so the result can be
+    // rounded after the last shift.
+    static constexpr i16 FIX_CR_R = CR_R * (1 << 14) + 0.5;
+    static constexpr i16 FIX_CB_G = CB_G * (1 << 14) + 0.5;
+    static constexpr i16 FIX_CR_G = CR_G * (1 << 14) + 0.5;
+    static constexpr i16 FIX_CB_B = CB_B * (1 << 14) + 0.5;
+
+    ALWAYS_INLINE static i32 _mulhi(i32 a, i32 b) {
+        return (a * b) >> 16;
+    }
+
+    ALWAYS_INLINE static u8 _clamp(i32 v) {
+        return clamp(v, 0, 255);
+    }
+
+    // Convert `len` pixels to RGBA8888, or BGRA8888 when `bgra` is set.
+    static void toRgba(u8 const *y, u8 const *cb, u8 const *cr, u8 *out, usize len, bool bgra) {
+        usize i = 0;
+
+#if defined(__SSE2__)
+        __m128i zero = _mm_setzero_si128();
+        __m128i center = _mm_set1_epi16(128);
+        __m128i one = _mm_set1_epi16(1);
+        __m128i alpha = _mm_set1_epi8(-1);
+
+        for (; i + 8 <= len; i += 8) {
+            auto load = [&](u8 const *p) {
+                return _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(p + i)), zero);
+            };
+
+            __m128i yy = _mm_add_epi16(_mm_slli_epi16(load(y), 1), one);
+            __m128i b8 = _mm_slli_epi16(_mm_sub_epi16(load(cb), center), 3);
+            __m128i r8 = _mm_slli_epi16(_mm_sub_epi16(load(cr), center), 3);
+
+            __m128i r = _mm_add_epi16(yy, _mm_mulhi_epi16(r8, _mm_set1_epi16(FIX_CR_R)));
+            __m128i g = _mm_sub_epi16(yy, _mm_mulhi_epi16(b8, _mm_set1_epi16(FIX_CB_G)));
+            g = _mm_sub_epi16(g, _mm_mulhi_epi16(r8, _mm_set1_epi16(FIX_CR_G)));
+            __m128i b = _mm_add_epi16(yy, _mm_mulhi_epi16(b8, _mm_set1_epi16(FIX_CB_B)));
+
+            r = _mm_srai_epi16(r, 1);
+            g = _mm_srai_epi16(g, 1);
+            b = _mm_srai_epi16(b, 1);
+            if (bgra)
+                std::swap(r, b);
+
+            __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+            __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), alpha);
+            _mm_storeu_si128((__m128i *)(out + i * 4), _mm_unpacklo_epi16(rg, ba));
+            _mm_storeu_si128((__m128i *)(out + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+        }
+#endif
+
+        usize ri = bgra ? 2 : 0;
+        usize bi = bgra ? 0 : 2;
+        for (; i < len; i++) {
+            i32 yy = y[i] * 2 + 1;
+            i32 b8 = (cb[i] - 128) * 8;
+            i32 r8 = (cr[i] - 128) * 8;
+
+            u8 *p = out + i * 4;
+            p[ri] = _clamp((yy + _mulhi(r8, FIX_CR_R)) >> 1);
+            p[1] = _clamp((yy - _mulhi(b8, FIX_CB_G) - _mulhi(r8, FIX_CR_G)) >> 1);
+            p[bi] = _clamp((yy + _mulhi(b8, FIX_CB_B)) >> 1);
+            p[3] = 255;
+        }
+    }
 };
 
 static constexpr Array<u8, 8 * 8> ZIG_ZAG = {
@@ -24,6 +116,24 @@ static constexpr Array<u8, 8 * 8> ZIG_ZAG = {
     58, 59, 52, 45, 38, 31, 39, 46,
     53, 60, 61, 54, 47, 55, 62, 63};
 
+enum Marker : u8 {
+    SOF0 = 0xC0,
+    SOF1 = 0xC1,
+    SOF2 = 0xC2,
+    DHT = 0xC4,
+    JPG = 0xC8,
+    DAC = 0xCC,
+    SOF15 = 0xCF,
+    RST0 = 0xD0,
+    RST7 = 0xD7,
+    SOI = 0xD8,
+    EOI = 0xD9,
+    SOS = 0xDA,
+    DQT = 0xDB,
+    DRI = 0xDD,
+    APP14 = 0xEE,
+};
+
 struct Jfif : public BChunk {
     static constexpr Str ID = "JFIF";
 };
@@ -32,63 +142,1146 @@ struct Jfxx : public BChunk {
     static constexpr Str ID = "JFXX";
 };
 
+/* --- Entropy Coding ------------------------------------------------------- */
+
+// Bits of an entropy coded segment, most significant first, with the
+// stuffed zero bytes removed. Reading stops at markers, past which zero
+// bits are fed.
+struct BitReader {
+    u8 const *_p = nullptr;
+    u8 const *_end = nullptr;
+    u64 _bits = 0;
+    usize _count = 0;
+    usize _padding = 0;
+
+    BitReader() = default;
+
+    BitReader(Bytes bytes)
+        : _p(bytes.buf()), _end(bytes.buf() + bytes.len()) {}
+
+    ALWAYS_INLINE void refill() {
+        // Whole words at once when they hold no 0xFF, which needs unstuffing.
+        if (_p + 8 <= _end) {
+            u64be word;
+            memcpy(&word, _p, sizeof(word));
+            u64 w = word;
+            if ((((~w) - 0x0101010101010101) & w & 0x8080808080808080) == 0) {
+                usize n = (63 - _count) >> 3;
+                _bits |= (w >> (64 - n * 8)) << (64 - n * 8 - _count);
+                _p += n;
+                _count += n * 8;
+                return;
+            }
+        }
+
+        while (_count <= 56) {
+            u64 byte = 0;
+            if (_p < _end and *_p != 0xFF) {
+                byte = *_p++;
+            } else if (_p + 1 < _end and _p[1] == 0x00) {
+                byte = 0xFF;
+                _p += 2;
+            } else {
+                _padding++;
+            }
+            _bits |= byte << (56 - _count);
+            _count += 8;
+        }
+    }
+
+    // Callers make sure at least `n` bits are buffered.
+    ALWAYS_INLINE u32 peek(usize n) const {
+        return _bits >> (64 - n);
+    }
+
+    ALWAYS_INLINE void consume(usize n) {
+        _bits <<= n;
+        _count -= n;
+    }
+
+    ALWAYS_INLINE u32 next(usize n) {
+        if (n == 0)
+            return 0;
+        if (_count < n)
+            refill();
+        u32 v = peek(n);
+        consume(n);
+        return v;
+    }
+
+    // Whether bits past the end of the data were consumed.
+    bool overrun() const {
+        return _padding * 8 > _count;
+    }
+
+    // Skip to the data following the next restart marker.
+    bool restart() {
+        _bits = 0;
+        _count = 0;
+        _padding = 0;
+        while (_p + 1 < _end and _p[0] == 0xFF and _p[1] == 0xFF)
+            _p++;
+        if (_p + 1 < _end and _p[0] == 0xFF and _p[1] >= RST0 and _p[1] <= RST7) {
+            _p += 2;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Canonical Huffman codes, the next `FAST` bits resolve most symbols with a
+// single lookup, longer codes are found by comparing against the last code
+// of each length.
+struct Huffman {
+    static constexpr usize FAST = 9;
+
+    bool _defined = false;
+    // (len << 8) | symbol, 0 for codes longer than FAST
+    Array<u16, 1 << FAST> _fast{};
+    // One past the last code of each length, left aligned on 16 bits.
+    Array<u32, 18> _maxcode{};
+    Array<i32, 17> _delta{};
+    Array<u8, 256> _syms{};
+
+    Res<> build(Bytes counts, Bytes syms) {
+        _fast = {};
+        for (usize i = 0; i < syms.len(); i++)
+            _syms[i] = syms[i];
+
+        usize code = 0;
+        usize k = 0;
+        for (usize len = 1; len <= 16; len++) {
+            _delta[len] = k - code;
+            for (usize i = 0; i < counts[len - 1]; i++, k++, code++) {
+                if (code >= (1uz << len))
+                    return Error::invalidData("huffman code over-subscribed");
+
+                if (len <= FAST) {
+                    usize first = code << (FAST - len);
+                    for (usize j = 0; j < (1uz << (FAST - len)); j++)
+                        _fast[first + j] = (len << 8) | syms[k];
+                }
+            }
+            _maxcode[len] = code << (16 - len);
+            code <<= 1;
+        }
+        _maxcode[17] = ~0u;
+        _defined = true;
+
+        return Ok();
+    }
+
+    // Decode the next symbol, the reader must hold at least 16 bits.
+    // Returns -1 for invalid codes.
+    ALWAYS_INLINE isize decode(BitReader &bits) const {
+        u16 e = _fast[bits.peek(FAST)];
+        if (e) [[likely]] {
+            bits.consume(e >> 8);
+            return e & 0xff;
+        }
+
+        u32 c = bits.peek(16);
+        usize len = FAST + 1;
+        while (c >= _maxcode[len])
+            len++;
+        if (len > 16)
+            return -1;
+        bits.consume(len);
+        return _syms[(c >> (16 - len)) + _delta[len]];
+    }
+};
+
+// Value of a `size` bits magnitude category, see F.2.2.1.
+ALWAYS_INLINE static i32 extend(u32 v, usize size) {
+    if (size == 0)
+        return 0;
+    return v < (1u << (size - 1)) ? (i32)v - (1 << size) + 1 : (i32)v;
+}
+
+/* --- Inverse DCT ---------------------------------------------------------- */
+
+// Arai, Agui and Nakajima's scaled IDCT in integer arithmetic, the scale
+// factors are folded into the dequantization multipliers.
+
+static constexpr Array<u16, 64> AAN_SCALES = {
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299, 6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585, 5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426, 5315,
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    12873, 17855, 16819, 15137, 12873, 10114, 6967, 3552,
+    8867, 12299, 11585, 10426, 8867, 6967, 4799, 2446,
+    4520, 6270, 5906, 5315, 4520, 3552, 2446, 1247};
+
+// Fractional bits of the dequantized coefficients, kept until the end of
+// the second pass.
+static constexpr usize IDCT_PASS_BITS = 4;
+
+using Quant = Array<u16, 64>;
+using Dequant = Array<i32, 64>;
+
+static inline Dequant aanDequant(Quant const &q) {
+    Dequant res;
+    for (usize i = 0; i < 64; i++)
+        res[i] = (q[i] * AAN_SCALES[i] + (1 << (13 - IDCT_PASS_BITS))) >> (14 - IDCT_PASS_BITS);
+    return res;
+}
+
+ALWAYS_INLINE static i32 _aanMul(i32 v, i32 c) {
+    return ((i64)v * c) >> 14;
+}
+
+static constexpr i32 AAN_1_082 = 17734;
+static constexpr i32 AAN_1_414 = 23170;
+static constexpr i32 AAN_1_847 = 30274;
+static constexpr i32 AAN_2_613 = 42813;
+
+template <typename T>
+ALWAYS_INLINE static void _aan(T x0, T x1, T x2, T x3, T x4, T x5, T x6, T x7, i32 *out, usize step) {
+    // Even part
+    i32 t10 = x0 + x4;
+    i32 t11 = x0 - x4;
+    i32 t13 = x2 + x6;
+    i32 t12 = _aanMul(x2 - x6, AAN_1_414) - t13;
+
+    i32 t0 = t10 + t13;
+    i32 t3 = t10 - t13;
+    i32 t1 = t11 + t12;
+    i32 t2 = t11 - t12;
+
+    // Odd part
+    i32 z13 = x5 + x3;
+    i32 z10 = x5 - x3;
+    i32 z11 = x1 + x7;
+    i32 z12 = x1 - x7;
+
+    i32 t7 = z11 + z13;
+    i32 t11o = _aanMul(z11 - z13, AAN_1_414);
+    i32 z5 = _aanMul(z10 + z12, AAN_1_847);
+    i32 t10o = _aanMul(z12, AAN_1_082) - z5;
+    i32 t12o = z5 - _aanMul(z10, AAN_2_613);
+
+    i32 t6 = t12o - t7;
+    i32 t5 = t11o - t6;
+    i32 t4 = t10o + t5;
+
+    out[0 * step] = t0 + t7;
+    out[7 * step] = t0 - t7;
+    out[1 * step] = t1 + t6;
+    out[6 * step] = t1 - t6;
+    out[2 * step] = t2 + t5;
+    out[5 * step] = t2 - t5;
+    out[4 * step] = t3 + t4;
+    out[3 * step] = t3 - t4;
+}
+
+static inline void idct8x8(i16 const *in, Dequant const &dq, u8 *out, usize stride) {
+    Array<i32, 64> ws;
+
+    for (usize c = 0; c < 8; c++) {
+        i16 const *i = in + c;
+        i32 const *q = dq.buf() + c;
+        if ((i[8] | i[16] | i[24] | i[32] | i[40] | i[48] | i[56]) == 0) {
+            i32 dc = i[0] * q[0];
+            for (usize r = 0; r < 8; r++)
+                ws[r * 8 + c] = dc;
+            continue;
+        }
+
+        _aan<i32>(
+            i[0] * q[0], i[8] * q[8], i[16] * q[16], i[24] * q[24],
+            i[32] * q[32], i[40] * q[40], i[48] * q[48], i[56] * q[56],
+            ws.buf() + c, 8
+        );
+    }
+
+    static constexpr usize SHIFT = IDCT_PASS_BITS + 3;
+    // Level shift and rounding, every output gets exactly one copy of the
+    // first input of the row.
+    static constexpr i32 BIAS = (128 << SHIFT) + (1 << (SHIFT - 1));
+
+    for (usize r = 0; r < 8; r++) {
+        i32 *w = ws.buf() + r * 8;
+        u8 *o = out + r * stride;
+        w[0] += BIAS;
+
+        if ((w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) == 0) {
+            u8 v = clamp(w[0] >> SHIFT, 0, 255);
+            for (usize c = 0; c < 8; c++)
+                o[c] = v;
+            continue;
+        }
+
+        Array<i32, 8> row;
+        _aan<i32>(w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7], row.buf(), 1);
+        for (usize c = 0; c < 8; c++)
+            o[c] = clamp(row[c] >> SHIFT, 0, 255);
+    }
+}
+
+// Reduced IDCTs for decoding at 1/2 and 1/4 scale, giving the average of
+// each 2x2 or 4x4 group of samples of the full IDCT. Entries are the basis
+// functions C(u) * cos((2x + 1) * u * PI / 16) / 2 averaged over the samples
+// of each group.
+static constexpr Array<f32, 4 * 8> IDCT4 = {
+    0.35355339f, 0.45306372f, 0.32664074f, 0.15909482f, 0.0f, -0.10630376f, -0.13529903f, -0.09011998f,
+    0.35355339f, 0.18766514f, -0.32664074f, -0.38408888f, 0.0f, 0.25663998f, 0.13529903f, -0.03732892f,
+    0.35355339f, -0.18766514f, -0.32664074f, 0.38408888f, 0.0f, -0.25663998f, 0.13529903f, 0.03732892f,
+    0.35355339f, -0.45306372f, 0.32664074f, -0.15909482f, 0.0f, 0.10630376f, -0.13529903f, 0.09011998f};
+
+static constexpr Array<f32, 2 * 8> IDCT2 = {
+    0.35355339f, 0.32036443f, 0.0f, -0.11249703f, 0.0f, 0.07516811f, 0.0f, -0.06372445f,
+    0.35355339f, -0.32036443f, 0.0f, 0.11249703f, 0.0f, -0.07516811f, 0.0f, 0.06372445f};
+
+template <usize N>
+static inline void idctReduced(i16 const *in, Quant const &q, u8 *out, usize stride) {
+    auto const &t = [] -> auto const & {
+        if constexpr (N == 4)
+            return IDCT4;
+        else
+            return IDCT2;
+    }();
+
+    // Rows of coefficients are mostly zero past the first few.
+    Array<f32, 8 * N> ws{};
+    usize rows = 0;
+    for (usize v = 0; v < 8; v++) {
+        i16 const *i = in + v * 8;
+        if ((i[0] | i[1] | i[2] | i[3] | i[4] | i[5] | i[6] | i[7]) == 0)
+            continue;
+        rows = v + 1;
+
+        Array<f32, 8> c;
+        for (usize u = 0; u < 8; u++)
+            c[u] = i[u] * q[v * 8 + u];
+        for (usize x = 0; x < N; x++) {
+            f32 sum = 0;
+            for (usize u = 0; u < 8; u++)
+                sum += t[x * 8 + u] * c[u];
+            ws[v * N + x] = sum;
+        }
+    }
+
+    for (usize y = 0; y < N; y++) {
+        for (usize x = 0; x < N; x++) {
+            f32 sum = 128.5f;
+            for (usize v = 0; v < rows; v++)
+                sum += t[y * 8 + v] * ws[v * N + x];
+            out[y * stride + x] = clamp((i32)sum, 0, 255);
+        }
+    }
+}
+
+static inline void idct1x1(i16 const *in, Quant const &q, u8 *out) {
+    *out = clamp((in[0] * q[0] + (128 << 3) + 4) >> 3, 0, 255);
+}
+
+/* --- Image ---------------------------------------------------------------- */
+
+enum struct ColorSpace : u8 {
+    GREYSCALE,
+    YCBCR,
+    RGB,
+};
+
 struct Image {
-    static constexpr Array<u8, 2> SOI = {0xFF, 0xD8};
-    static constexpr Array<u8, 2> SOS = {0xFF, 0xDA};
-    static constexpr Array<u8, 2> EOI = {0xFF, 0xD9};
+    static constexpr Array<u8, 2> SIG = {0xFF, SOI};
+
+    struct Segment {
+        u8 marker;
+        Bytes data;
+    };
+
+    struct Component {
+        u8 id;
+        u8 h;
+        u8 v;
+        u8 tq;
+    };
 
     Bytes _slice;
-    Bytes _imageData;
 
-    isize _width;
-    isize _height;
+    isize _width = 0;
+    isize _height = 0;
+    bool _progressive = false;
+    ColorSpace _colorSpace = ColorSpace::YCBCR;
+    usize _len = 0;
+    Array<Component, 3> _comps{};
 
     isize width() {
-        return 16;
+        return _width;
     }
 
     isize height() {
-        return 16;
+        return _height;
+    }
+
+    // Size of the image decoded at 1/scale.
+    Math::Vec2i size(usize scale = 1) const {
+        return {
+            (_width + (isize)scale - 1) / (isize)scale,
+            (_height + (isize)scale - 1) / (isize)scale,
+        };
     }
 
     static bool isJpeg(Bytes slice) {
-        return slice.len() >= 2 and Op::eq(sub(slice, 0, 2), bytes(SOI));
+        return slice.len() >= 2 and Op::eq(sub(slice, 0, 2), bytes(SIG));
+    }
+
+    Image(Bytes slice) : _slice(slice) {
+    }
+
+    BScan begin() const {
+        return BScan{_slice};
+    }
+
+    // Segments following SOI. The data of a SOS segment runs up to the
+    // end of the entropy coded data following its header.
+    auto iterSegs() const {
+        auto s = begin();
+        s.skip(2);
+
+        return Iter{[s, all = _slice]() mutable -> Opt<Segment> {
+            while (not s.ended() and s.peekU8be() != 0xFF)
+                s.skip(1);
+            while (not s.ended() and s.peekU8be() == 0xFF)
+                s.skip(1);
+            if (s.ended())
+                return NONE;
+
+            u8 marker = s.nextU8be();
+            if (marker == SOI or marker == EOI or (marker >= RST0 and marker <= RST7))
+                return Segment{marker, {}};
+
+            if (s.rem() < 2)
+                return NONE;
+            usize len = s.nextU16be();
+            if (len < 2)
+                return NONE;
+
+            usize start = all.len() - s.rem();
+            s.skip(len - 2);
+            if (marker == SOS) {
+                usize pos = all.len() - s.rem();
+                while (pos + 1 < all.len()) {
+                    u8 b = all[pos + 1];
+                    if (all[pos] == 0xFF and b != 0x00 and not(b >= RST0 and b <= RST7))
+                        break;
+                    pos++;
+                }
+                if (pos + 1 >= all.len())
+                    pos = all.len();
+                s.skip(pos - (all.len() - s.rem()));
+            }
+
+            return Segment{marker, sub(all, start, all.len() - s.rem())};
+        }};
     }
 
     static Res<Image> load(Bytes slice) {
+        if (not isJpeg(slice))
+            return Error::invalidData("invalid signature");
+
         Image image{slice};
+        bool adobeRgb = false;
+        for (auto seg : image.iterSegs()) {
+            BScan s{seg.data};
+            if (seg.marker == APP14 and Op::eq(s.nextStr(5), Str{"Adobe"}) and seg.data.len() >= 12) {
+                adobeRgb = seg.data[11] == 0;
+            } else if (seg.marker >= SOF0 and seg.marker <= SOF15 and
+                       seg.marker != DHT and seg.marker != JPG and seg.marker != DAC) {
+                if (seg.marker != SOF0 and seg.marker != SOF1 and seg.marker != SOF2)
+                    return Error::unsupported("unsupported jpeg coding process");
+                try$(image._frame(seg, adobeRgb));
+                return Ok(image);
+            } else if (seg.marker == SOS or seg.marker == EOI) {
+                break;
+            }
+        }
 
-        return Ok(image);
+        return Error::invalidData("missing frame header");
     }
 
-    Image(Bytes slice) : _slice(slice) {
+    Res<> _frame(Segment seg, bool adobeRgb) {
+        BScan s{seg.data};
+        if (s.rem() < 6)
+            return Error::invalidData("truncated frame header");
+
+        if (s.nextU8be() != 8)
+            return Error::unsupported("unsupported sample precision");
+        _height = s.nextU16be();
+        _width = s.nextU16be();
+        _len = s.nextU8be();
+        _progressive = seg.marker == SOF2;
+
+        if (_width == 0 or _height == 0)
+            return Error::invalidData("invalid image size");
+        if (_len != 1 and _len != 3)
+            return Error::unsupported("unsupported number of components");
+        if (s.rem() < _len * 3)
+            return Error::invalidData("truncated frame header");
+
+        for (usize i = 0; i < _len; i++) {
+            auto &c = _comps[i];
+            c.id = s.nextU8be();
+            u8 hv = s.nextU8be();
+            c.h = hv >> 4;
+            c.v = hv & 0xf;
+            c.tq = s.nextU8be();
+            if (c.h < 1 or c.h > 4 or c.v < 1 or c.v > 4)
+                return Error::invalidData("invalid sampling factors");
+            if (c.tq > 3)
+                return Error::invalidData("invalid quantization table");
+        }
+
+        // A single component is always coded one block at a time.
+        if (_len == 1)
+            _comps[0].h = _comps[0].v = 1;
+
+        bool rgbIds = _len == 3 and _comps[0].id == 'R' and _comps[1].id == 'G' and _comps[2].id == 'B';
+        if (_len == 1)
+            _colorSpace = ColorSpace::GREYSCALE;
+        else if (adobeRgb or rgbIds)
+            _colorSpace = ColorSpace::RGB;
+
+        return Ok();
     }
 
-    BScan begin() {
-        return BScan{_slice};
+    // Decode the image at 1/scale, with scale being 1, 2, 4 or 8, into the
+    // top left corner of `dest`.
+    Res<> decode(Gfx::MutPixels dest, usize scale = 1) const;
+};
+
+/* --- Decoder -------------------------------------------------------------- */
+
+struct Decoder {
+    struct State {
+        u8 h;
+        u8 v;
+        u8 tq;
+        u8 td = 0;
+        u8 ta = 0;
+
+        // Blocks covered by the image, and padded to whole MCUs.
+        usize cw;
+        usize ch;
+        usize bw;
+        usize bh;
+
+        bool latched = false;
+        Quant quant;
+        Dequant dequant;
+        i32 pred = 0;
+
+        // All coefficients, for progressive and multi-scan images.
+        Vec<i16> coefs;
+
+        // One MCU row of samples, each block inverse transformed to n x n
+        // samples. Subsampled components are decoded at a larger size than
+        // the others when scaling down, which leaves less to upsample.
+        usize n;
+        usize sh;
+        usize sv;
+        Vec<u8> plane;
+        usize stride;
+
+        // Horizontally upsampled row.
+        Vec<u8> row;
+    };
+
+    Image const &_image;
+    Gfx::MutPixels _dest;
+    usize _n;
+    isize _width;
+    isize _height;
+
+    usize _hmax = 1;
+    usize _vmax = 1;
+    usize _mcusX;
+    usize _mcusY;
+    Array<State, 3> _comps;
+
+    Array<Huffman, 4> _dc;
+    Array<Huffman, 4> _ac;
+    Array<Quant, 4> _quant{};
+    Array<bool, 4> _quantDefined{};
+    usize _restart = 0;
+
+    BitReader _bits;
+    usize _eobrun = 0;
+    bool _scanned = false;
+    bool _buffered = false;
+
+    Decoder(Image const &image, Gfx::MutPixels dest, usize scale)
+        : _image(image), _dest(dest), _n(8 / scale) {
+        auto size = image.size(scale);
+        _width = min(size.x, dest.width());
+        _height = min(size.y, dest.height());
+
+        for (usize i = 0; i < image._len; i++) {
+            _hmax = max<usize>(_hmax, image._comps[i].h);
+            _vmax = max<usize>(_vmax, image._comps[i].v);
+        }
+
+        _mcusX = (image._width + 8 * _hmax - 1) / (8 * _hmax);
+        _mcusY = (image._height + 8 * _vmax - 1) / (8 * _vmax);
+
+        for (usize i = 0; i < image._len; i++) {
+            auto const &c = image._comps[i];
+            auto &s = _comps[i];
+            s.h = c.h;
+            s.v = c.v;
+            s.tq = c.tq;
+            s.cw = ((image._width * c.h + _hmax - 1) / _hmax + 7) / 8;
+            s.ch = ((image._height * c.v + _vmax - 1) / _vmax + 7) / 8;
+            s.bw = _mcusX * c.h;
+            s.bh = _mcusY * c.v;
+
+            usize ratio = min(_hmax / c.h, _vmax / c.v);
+            s.n = _n;
+            for (usize r = 2; r <= ratio and s.n < 8; r *= 2)
+                s.n *= 2;
+            s.sh = c.h * s.n / _n;
+            s.sv = c.v * s.n / _n;
+
+            s.stride = s.bw * s.n;
+            s.plane.resize(s.stride * c.v * s.n, 0);
+            if (s.sh != _hmax)
+                s.row.resize(_width + 1, 0);
+        }
+    }
+
+    Res<> run() {
+        for (auto seg : _image.iterSegs()) {
+            switch (seg.marker) {
+            case DQT:
+                try$(_defineQuant(seg.data));
+                break;
+
+            case DHT:
+                try$(_defineHuffman(seg.data));
+                break;
+
+            case DRI:
+                if (seg.data.len() < 2)
+                    return Error::invalidData("truncated restart interval");
+                _restart = BScan{seg.data}.nextU16be();
+                break;
+
+            case SOS:
+                try$(_scan(seg.data));
+                break;
+
+            case EOI:
+                return _finish();
+
+            default:
+                break;
+            }
+        }
+
+        // Tolerate a missing EOI.
+        return _finish();
+    }
+
+    Res<> _defineQuant(Bytes data) {
+        BScan s{data};
+        while (not s.ended()) {
+            u8 pt = s.nextU8be();
+            usize precision = pt >> 4;
+            usize id = pt & 0xf;
+            if (id > 3 or precision > 1)
+                return Error::invalidData("invalid quantization table");
+            if (s.rem() < 64 * (precision + 1))
+                return Error::invalidData("truncated quantization table");
+
+            for (usize i = 0; i < 64; i++)
+                _quant[id][ZIG_ZAG[i]] = precision ? s.nextU16be() : s.nextU8be();
+            _quantDefined[id] = true;
+        }
+        return Ok();
+    }
+
+    Res<> _defineHuffman(Bytes data) {
+        BScan s{data};
+        while (not s.ended()) {
+            u8 tc = s.nextU8be();
+            usize cls = tc >> 4;
+            usize id = tc & 0xf;
+            if (cls > 1 or id > 3)
+                return Error::invalidData("invalid huffman table");
+
+            if (s.rem() < 16)
+                return Error::invalidData("truncated huffman table");
+            auto counts = s.nextBytes(16);
+            usize total = 0;
+            for (auto c : counts)
+                total += c;
+            if (total > 256 or s.rem() < total)
+                return Error::invalidData("invalid huffman table");
+
+            try$((cls ? _ac : _dc)[id].build(counts, s.nextBytes(total)));
+        }
+        return Ok();
+    }
+
+    ALWAYS_INLINE isize _decode(Huffman const &h) {
+        if (_bits._count < 32)
+            _bits.refill();
+        return h.decode(_bits);
+    }
+
+    /* --- Scans ------------------------------------------------------------ */
+
+    struct Scan {
+        usize len;
+        Array<usize, 3> comps;
+        usize ss;
+        usize se;
+        usize ah;
+        usize al;
+    };
+
+    Res<> _scan(Bytes data) {
+        BScan s{data};
+        Scan scan;
+
+        scan.len = s.nextU8be();
+        if (scan.len < 1 or scan.len > _image._len or s.rem() < scan.len * 2 + 3)
+            return Error::invalidData("invalid scan header");
+
+        for (usize i = 0; i < scan.len; i++) {
+            u8 id = s.nextU8be();
+            u8 t = s.nextU8be();
+
+            usize index = 0;
+            while (index < _image._len and _image._comps[index].id != id)
+                index++;
+            if (index == _image._len)
+                return Error::invalidData("unknown scan component");
+            scan.comps[i] = index;
+
+            auto &c = _comps[index];
+            c.td = t >> 4;
+            c.ta = t & 0xf;
+            if (c.td > 3 or c.ta > 3)
+                return Error::invalidData("invalid huffman table");
+
+            // The quantization table in effect when a component first
+            // appears is the one used for the whole image.
+            if (not c.latched) {
+                if (not _quantDefined[c.tq])
+                    return Error::invalidData("missing quantization table");
+                c.quant = _quant[c.tq];
+                c.dequant = aanDequant(c.quant);
+                c.latched = true;
+            }
+        }
+
+        scan.ss = s.nextU8be();
+        scan.se = s.nextU8be();
+        u8 a = s.nextU8be();
+        scan.ah = a >> 4;
+        scan.al = a & 0xf;
+
+        if (_image._progressive) {
+            bool dc = scan.ss == 0;
+            if ((dc and scan.se != 0) or
+                (not dc and (scan.se < scan.ss or scan.se > 63 or scan.len != 1)) or
+                scan.al > 13)
+                return Error::invalidData("invalid progressive scan");
+        } else if (scan.ss != 0 or scan.se != 63 or scan.ah != 0 or scan.al != 0) {
+            return Error::invalidData("invalid sequential scan");
+        }
+
+        for (usize i = 0; i < scan.len; i++) {
+            auto &c = _comps[scan.comps[i]];
+            bool dcNeeded = scan.ss == 0 and scan.ah == 0;
+            bool acNeeded = scan.se != 0;
+            if ((dcNeeded and not _dc[c.td]._defined) or (acNeeded and not _ac[c.ta]._defined))
+                return Error::invalidData("missing huffman table");
+        }
+
+        _bits = BitReader{s.restBytes()};
+        _eobrun = 0;
+        _scanned = true;
+        for (auto &c : _comps)
+            c.pred = 0;
+
+        // A sequential scan holding every component is the only scan of the
+        // image, it's decoded straight to the output one MCU row at a time.
+        if (not _image._progressive and scan.len == _image._len)
+            return _scanSequential(scan);
+
+        if (not _buffered) {
+            for (usize i = 0; i < _image._len; i++) {
+                auto &c = _comps[i];
+                c.coefs.resize(c.bw * c.bh * 64, 0);
+            }
+            _buffered = true;
+        }
+
+        if (not _image._progressive)
+            return _scanBuffered(scan, [&](State &c, i16 *block) {
+                return _decodeBlock(c, block);
+            });
+
+        if (scan.ss == 0 and scan.ah == 0)
+            return _scanBuffered(scan, [&](State &c, i16 *block) {
+                return _decodeDcFirst(c, block, scan);
+            });
+
+        if (scan.ss == 0)
+            return _scanBuffered(scan, [&](State &, i16 *block) {
+                return _decodeDcRefine(block, scan);
+            });
+
+        if (scan.ah == 0)
+            return _scanBuffered(scan, [&](State &c, i16 *block) {
+                return _decodeAcFirst(c, block, scan);
+            });
+
+        return _scanBuffered(scan, [&](State &c, i16 *block) {
+            return _decodeAcRefine(c, block, scan);
+        });
+    }
+
+    Res<> _nextInterval(usize &left) {
+        if (not _restart)
+            return Ok();
+
+        if (--left == 0) {
+            if (_bits.overrun())
+                return Error::invalidData("unexpected end of data");
+            if (not _bits.restart())
+                return Error::invalidData("missing restart marker");
+            _eobrun = 0;
+            for (auto &c : _comps)
+                c.pred = 0;
+            left = _restart;
+        }
+
+        return Ok();
     }
 
-    auto iterSegs() {
-        struct Seg {
-            Str id;
-            Bytes data;
+    Res<> _scanSequential(Scan const &scan) {
+        Array<i16, 64> block;
+        usize left = _restart;
+
+        for (usize my = 0; my < _mcusY; my++) {
+            for (usize mx = 0; mx < _mcusX; mx++) {
+                for (usize i = 0; i < scan.len; i++) {
+                    auto &c = _comps[scan.comps[i]];
+                    for (usize by = 0; by < c.v; by++) {
+                        for (usize bx = 0; bx < c.h; bx++) {
+                            block = {};
+                            try$(_decodeBlock(c, block.buf()));
+                            _idct(c, block.buf(), mx * c.h + bx, by);
+                        }
+                    }
+                }
+
+                if (my + 1 < _mcusY or mx + 1 < _mcusX)
+                    try$(_nextInterval(left));
+            }
+
+            if (_bits.overrun())
+                return Error::invalidData("unexpected end of data");
+            _emit(my);
+        }
+
+        return Ok();
+    }
+
+    Res<> _scanBuffered(Scan const &scan, auto decode) {
+        usize left = _restart;
+
+        if (scan.len == 1) {
+            // Non-interleaved scans code the blocks covering the component
+            // in raster order.
+            auto &c = _comps[scan.comps[0]];
+            for (usize by = 0; by < c.ch; by++) {
+                for (usize bx = 0; bx < c.cw; bx++) {
+                    try$(decode(c, c.coefs.buf() + (by * c.bw + bx) * 64));
+                    if (by + 1 < c.ch or bx + 1 < c.cw)
+                        try$(_nextInterval(left));
+                }
+            }
+        } else {
+            for (usize my = 0; my < _mcusY; my++) {
+                for (usize mx = 0; mx < _mcusX; mx++) {
+                    for (usize i = 0; i < scan.len; i++) {
+                        auto &c = _comps[scan.comps[i]];
+                        for (usize by = 0; by < c.v; by++) {
+                            for (usize bx = 0; bx < c.h; bx++) {
+                                usize index = (my * c.v + by) * c.bw + mx * c.h + bx;
+                                try$(decode(c, c.coefs.buf() + index * 64));
+                            }
+                        }
+                    }
+                    if (my + 1 < _mcusY or mx + 1 < _mcusX)
+                        try$(_nextInterval(left));
+                }
+            }
+        }
+
+        if (_bits.overrun())
+            return Error::invalidData("unexpected end of data");
+
+        return Ok();
+    }
+
+    Res<> _finish() {
+        if (not _scanned)
+            return Error::invalidData("missing image data");
+        if (not _buffered)
+            return Ok();
+
+        for (usize my = 0; my < _mcusY; my++) {
+            for (usize i = 0; i < _image._len; i++) {
+                auto &c = _comps[i];
+                if (not c.latched)
+                    return Error::invalidData("missing component data");
+                for (usize by = 0; by < c.v; by++) {
+                    for (usize bx = 0; bx < c.bw; bx++) {
+                        usize index = (my * c.v + by) * c.bw + bx;
+                        _idct(c, c.coefs.buf() + index * 64, bx, by);
+                    }
+                }
+            }
+            _emit(my);
+        }
+
+        return Ok();
+    }
+
+    /* --- Blocks ----------------------------------------------------------- */
+
+    Res<> _decodeBlock(State &c, i16 *block) {
+        isize s = _decode(_dc[c.td]);
+        if (s < 0 or s > 15)
+            return Error::invalidData("invalid dc code");
+        c.pred += extend(_bits.next(s), s);
+        block[0] = c.pred;
+
+        auto const &ac = _ac[c.ta];
+        for (usize k = 1; k < 64;) {
+            isize rs = _decode(ac);
+            if (rs < 0)
+                return Error::invalidData("invalid ac code");
+
+            usize r = rs >> 4;
+            usize size = rs & 15;
+            if (size == 0) {
+                if (r != 15)
+                    break;
+                k += 16;
+                continue;
+            }
+
+            k += r;
+            if (k > 63)
+                return Error::invalidData("coefficient out of range");
+            block[ZIG_ZAG[k++]] = extend(_bits.next(size), size);
+        }
+
+        return Ok();
+    }
+
+    Res<> _decodeDcFirst(State &c, i16 *block, Scan const &scan) {
+        isize s = _decode(_dc[c.td]);
+        if (s < 0 or s > 15)
+            return Error::invalidData("invalid dc code");
+        c.pred += extend(_bits.next(s), s);
+        block[0] = c.pred * (1 << scan.al);
+        return Ok();
+    }
+
+    Res<> _decodeDcRefine(i16 *block, Scan const &scan) {
+        if (_bits.next(1))
+            block[0] |= 1 << scan.al;
+        return Ok();
+    }
+
+    Res<> _decodeAcFirst(State &c, i16 *block, Scan const &scan) {
+        if (_eobrun) {
+            _eobrun--;
+            return Ok();
+        }
+
+        auto const &ac = _ac[c.ta];
+        for (usize k = scan.ss; k <= scan.se;) {
+            isize rs = _decode(ac);
+            if (rs < 0)
+                return Error::invalidData("invalid ac code");
+
+            usize r = rs >> 4;
+            usize size = rs & 15;
+            if (size == 0) {
+                if (r < 15) {
+                    _eobrun = (1 << r) - 1 + _bits.next(r);
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+
+            k += r;
+            if (k > 63)
+                return Error::invalidData("coefficient out of range");
+            block[ZIG_ZAG[k++]] = extend(_bits.next(size), size) * (1 << scan.al);
+        }
+
+        return Ok();
+    }
+
+    // See G.1.2.3, coefficients already non-zero get one more bit of
+    // precision, and a run of zero coefficients is skipped over before
+    // each newly non-zero one.
+    Res<> _decodeAcRefine(State &c, i16 *block, Scan const &scan) {
+        i16 p1 = 1 << scan.al;
+        i16 m1 = -1 * (1 << scan.al);
+
+        auto refine = [&](i16 &coef) {
+            if (_bits.next(1) and (coef & p1) == 0)
+                coef += coef >= 0 ? p1 : m1;
         };
 
-        auto s = begin();
-        s.nextI16be(); // SOI
+        usize k = scan.ss;
+        if (_eobrun == 0) {
+            auto const &ac = _ac[c.ta];
+            for (; k <= scan.se; k++) {
+                isize rs = _decode(ac);
+                if (rs < 0)
+                    return Error::invalidData("invalid ac code");
 
-        return Iter{[s]() mutable -> Opt<Seg> {
-            Seg seg;
+                isize r = rs >> 4;
+                usize size = rs & 15;
+                i16 value = 0;
+                if (size) {
+                    if (size != 1)
+                        return Error::invalidData("invalid ac refinement");
+                    value = _bits.next(1) ? p1 : m1;
+                } else if (r != 15) {
+                    _eobrun = (1 << r) + _bits.next(r);
+                    break;
+                }
 
-            auto app0 = s.nextBytes(2);
+                for (; k <= scan.se; k++) {
+                    i16 &coef = block[ZIG_ZAG[k]];
+                    if (coef != 0)
+                        refine(coef);
+                    else if (--r < 0)
+                        break;
+                }
 
-            if (Op::eq(app0, bytes(SOI))) {
-                return NONE;
+                if (value and k <= scan.se)
+                    block[ZIG_ZAG[k]] = value;
             }
+        }
 
-            return seg;
-        }};
+        if (_eobrun > 0) {
+            for (; k <= scan.se; k++) {
+                i16 &coef = block[ZIG_ZAG[k]];
+                if (coef != 0)
+                    refine(coef);
+            }
+            _eobrun--;
+        }
+
+        return Ok();
+    }
+
+    /* --- Output ----------------------------------------------------------- */
+
+    // Inverse transform a block into the MCU row of samples.
+    ALWAYS_INLINE void _idct(State &c, i16 const *block, usize bx, usize by) {
+        u8 *out = c.plane.buf() + by * c.n * c.stride + bx * c.n;
+        switch (c.n) {
+        case 8:
+            idct8x8(block, c.dequant, out, c.stride);
+            break;
+        case 4:
+            idctReduced<4>(block, c.quant, out, c.stride);
+            break;
+        case 2:
+            idctReduced<2>(block, c.quant, out, c.stride);
+            break;
+        default:
+            idct1x1(block, c.quant, out);
+            break;
+        }
+    }
+
+    u8 const *_sampleRow(State &c, usize y) {
+        u8 const *src = c.plane.buf() + (y * c.sv / _vmax) * c.stride;
+        if (c.sh == _hmax)
+            return src;
+
+        u8 *row = c.row.buf();
+        if (c.sh * 2 == _hmax) {
+            // Triangle filter, each output is 3/4 of the nearest sample and
+            // 1/4 of the next nearest one.
+            isize len = (_width + 1) / 2;
+            for (isize i = 0; i < len; i++) {
+                u32 s = src[i] * 3;
+                row[i * 2] = (s + src[max<isize>(i - 1, 0)] + 1) >> 2;
+                row[i * 2 + 1] = (s + src[min(i + 1, len - 1)] + 2) >> 2;
+            }
+        } else {
+            for (isize x = 0; x < _width; x++)
+                row[x] = src[x * c.sh / _hmax];
+        }
+        return row;
+    }
+
+    void _emit(usize my) {
+        isize top = my * _vmax * _n;
+        isize rows = min<isize>(_vmax * _n, _height - top);
+        // Every pixel is opaque, premultiplied or not doesn't matter.
+        bool bgra = _dest.fmt().is<Gfx::Bgra8888>() or _dest.fmt().is<Gfx::Bgra8888Pm>();
+
+        for (isize y = 0; y < rows; y++) {
+            u8 *out = static_cast<u8 *>(_dest.pixelUnsafe({0, top + y}));
+
+            if (_image._colorSpace == ColorSpace::GREYSCALE) {
+                u8 const *g = _sampleRow(_comps[0], y);
+                for (isize x = 0; x < _width; x++) {
+                    u8 *p = out + x * 4;
+                    p[0] = p[1] = p[2] = g[x];
+                    p[3] = 255;
+                }
+                continue;
+            }
+
+            u8 const *a = _sampleRow(_comps[0], y);
+            u8 const *b = _sampleRow(_comps[1], y);
+            u8 const *c = _sampleRow(_comps[2], y);
+
+            if (_image._colorSpace == ColorSpace::YCBCR) {
+                YCbCr::toRgba(a, b, c, out, _width, bgra);
+                continue;
+            }
+
+            if (bgra)
+                std::swap(a, c);
+            for (isize x = 0; x < _width; x++) {
+                u8 *p = out + x * 4;
+                p[0] = a[x];
+                p[1] = b[x];
+                p[2] = c[x];
+                p[3] = 255;
+            }
+        }
     }
 };
 
+inline Res<> Image::decode(Gfx::MutPixels dest, usize scale) const {
+    if (scale != 1 and scale != 2 and scale != 4 and scale != 8)
+        return Error::invalidInput("unsupported scale");
+
+    Decoder decoder{*this, dest, scale};
+    return decoder.run();
+}
+
 } // namespace Jpeg
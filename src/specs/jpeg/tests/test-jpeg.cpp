@@ -0,0 +1,165 @@
+#include <jpeg/spec.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-test/samples.h>
+
+namespace Jpeg::Tests {
+
+static Res<Sys::Mmap> _load(Str name) {
+    return loadSample("bundle://jpeg-spec-tests"_url, name);
+}
+
+static Res<Media::Image> _decode(Bytes bytes, usize scale = 1) {
+    auto jpeg = try$(Image::load(bytes));
+    auto img = Media::Image::alloc(jpeg.size(scale), Gfx::RGBA8888);
+    try$(jpeg.decode(img, scale));
+    return Ok(img);
+}
+
+static Res<Media::Image> _decode(Str name, usize scale = 1) {
+    auto map = try$(_load(name));
+    return _decode(map.bytes(), scale);
+}
+
+// Mean absolute difference per channel.
+static f64 _error(Media::Image const &img, auto expected) {
+    u64 sum = 0;
+    for (isize y = 0; y < img.height(); y++) {
+        for (isize x = 0; x < img.width(); x++) {
+            auto a = img.pixels().load({x, y});
+            Gfx::Color b = expected(x, y);
+            sum += Math::abs(a.red - b.red) + Math::abs(a.green - b.green) + Math::abs(a.blue - b.blue);
+        }
+    }
+    return sum / (img.width() * img.height() * 3.0);
+}
+
+/* --- Gradients ------------------------------------------------------------ */
+
+// The samples are this pattern encoded by libjpeg at quality 95.
+static constexpr Math::Vec2i SIZE = {75, 53};
+
+static Gfx::Color _gradient(isize x, isize y) {
+    if (x >= 20 and x < 40 and y >= 16 and y < 32)
+        return Gfx::Color::fromRgb(240, 240, 240);
+    return Gfx::Color::fromRgb(x * 3, y * 4, (x + y) * 2);
+}
+
+test$(jpegBaselineMatchesSource) {
+    Array<Str, 4> names = {
+        "gradient-444.jpg",
+        "gradient-422.jpg",
+        "gradient-420.jpg",
+        "gradient-440.jpg",
+    };
+
+    for (auto name : names) {
+        auto img = try$(_decode(name));
+        expectEq$(img._size, SIZE);
+        expectLt$(_error(img, _gradient), 1.5);
+    }
+
+    auto grey = try$(_decode("gradient-gray.jpg"));
+    expectEq$(grey._size, SIZE);
+    expectLt$(_error(grey, [](isize x, isize y) {
+                  auto c = _gradient(x, y);
+                  u8 v = (c.red * 299 + c.green * 587 + c.blue * 114 + 500) / 1000;
+                  return Gfx::Color::fromRgb(v, v, v);
+              }),
+              0.5);
+
+    return Ok();
+}
+
+test$(jpegProgressiveMatchesBaseline) {
+    // Same coefficients coded differently, the pixels must be identical.
+    struct Pair {
+        Str baseline;
+        Str other;
+    };
+
+    Array<Pair, 3> pairs = {
+        Pair{"gradient-420.jpg", "gradient-progressive.jpg"},
+        Pair{"gradient-420.jpg", "gradient-restart.jpg"},
+        Pair{"gradient-gray.jpg", "gradient-gray-progressive.jpg"},
+    };
+
+    for (auto const &pair : pairs) {
+        auto baseline = try$(_decode(pair.baseline));
+        auto other = try$(_decode(pair.other));
+        expectEq$(baseline._size, other._size);
+        expect$(Op::eq(baseline.pixels().bytes(), other.pixels().bytes()));
+    }
+
+    return Ok();
+}
+
+test$(jpegScaledMatchesDownsampled) {
+    auto full = try$(_decode("gradient-420.jpg"));
+
+    for (isize scale : {2, 4, 8}) {
+        auto img = try$(_decode("gradient-420.jpg", scale));
+        expectEq$(img._size, (SIZE + scale - 1) / scale);
+
+        // Close to the average of the pixels covered at full scale.
+        expectLt$(_error(img, [&](isize x, isize y) {
+                      u32 r = 0, g = 0, b = 0, n = 0;
+                      for (isize yy = y * scale; yy < min((y + 1) * scale, SIZE.y); yy++) {
+                          for (isize xx = x * scale; xx < min((x + 1) * scale, SIZE.x); xx++) {
+                              auto c = full.pixels().load({xx, yy});
+                              r += c.red;
+                              g += c.green;
+                              b += c.blue;
+                              n++;
+                          }
+                      }
+                      return Gfx::Color::fromRgb((r + n / 2) / n, (g + n / 2) / n, (b + n / 2) / n);
+                  }),
+                  1.0);
+    }
+
+    return Ok();
+}
+
+test$(jpegRejectsCorrupt) {
+    auto map = try$(_load("gradient-420.jpg"));
+    auto bytes = map.bytes();
+
+    // Truncated entropy coded data.
+    expectNot$(bool(_decode(sub(bytes, 0, bytes.len() / 2))));
+
+    // Lossless coding isn't supported.
+    Vec<u8> lossless{bytes};
+    for (usize i = 0; i + 1 < lossless.len(); i++) {
+        if (lossless[i] == 0xFF and lossless[i + 1] == SOF0) {
+            lossless[i + 1] = 0xC3;
+            break;
+        }
+    }
+    expectNot$(bool(Image::load(lossless)));
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(jpegPhoto) {
+    Array<Str, 2> names = {"kodim23.jpg", "kodim23-progressive.jpg"};
+
+    for (auto name : names) {
+        auto map = try$(_load(name));
+        auto jpeg = try$(Image::load(map.bytes()));
+
+        for (usize scale : {1uz, 8uz}) {
+            auto img = Media::Image::alloc(jpeg.size(scale), Gfx::RGBA8888);
+            auto label = try$(Fmt::format("{} at 1/{}", name, scale));
+            try$(benchThroughput(_driver, label, jpeg.width() * jpeg.height(), "Mpx/s", [&] {
+                return jpeg.decode(img, scale);
+            }));
+        }
+    }
+
+    return Ok();
+}
+
+} // namespace Jpeg::Tests
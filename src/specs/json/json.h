@@ -15,6 +15,7 @@ struct Value;
 
 using Array = Vec<Value>;
 
+// Most keys are short enough to be stored inline, without allocating.
 using Object = Map<String, Value>;
 
 #ifdef __osdk_freestanding__
@@ -125,10 +126,10 @@ struct Value {
                 [](None) {
                     return "null";
                 },
-                [](Vec<Value>) {
+                [](Array const &) {
                     return "<array>";
                 },
-                [](Map<String, Value>) {
+                [](Object const &) {
                     return "<object>";
                 },
                 [](String s) {
@@ -181,13 +182,13 @@ struct Value {
                 [](None) {
                     return false;
                 },
-                [](Vec<Value> v) {
+                [](Array const &v) {
                     return v.len() > 0;
                 },
-                [](Map<String, Value> m) {
+                [](Object const &m) {
                     return m.len() > 0;
                 },
-                [](String s) {
+                [](String const &s) {
                     return s.len() > 0;
                 },
                 [](Number d) {
@@ -219,13 +220,13 @@ struct Value {
                 [](None) {
                     return 0;
                 },
-                [](Vec<Value> v) {
+                [](Array const &v) {
                     return v.len();
                 },
-                [](Map<String, Value> m) {
+                [](Object const &m) {
                     return m.len();
                 },
-                [](String s) {
+                [](String const &s) {
                     return s.len();
                 },
                 [](Number) {
@@ -84,7 +84,7 @@ Res<Object> parseObject(Text::Scan &s) {
         s.eat(Re::space());
 
         auto value = try$(parse(s));
-        m.put(key, value);
+        m.put(key, std::move(value));
 
         s.eat(Re::space());
 
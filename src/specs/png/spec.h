@@ -1,13 +1,29 @@
 #pragma once
 
+#include <deflate/spec.h>
 #include <karm-base/string.h>
 #include <karm-gfx/context.h>
+#include <karm-hash/hash.h>
 #include <karm-logger/logger.h>
 
 #include "../bscan.h"
 
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+// https://www.w3.org/TR/png/
+
 namespace Png {
 
+enum ColorType : u8 {
+    GREYSCALE = 0,
+    TRUECOLOR = 2,
+    INDEXED = 3,
+    GREYSCALE_ALPHA = 4,
+    TRUECOLOR_ALPHA = 6,
+};
+
 struct Ihdr : public BChunk {
     static constexpr Str SIG = "IHDR";
 
@@ -38,10 +54,45 @@ struct Ihdr : public BChunk {
     u8 interlaceMethod() {
         return begin().skip(12).nextU8be();
     }
+
+    usize channels() {
+        switch (colorType()) {
+        case GREYSCALE:
+        case INDEXED:
+            return 1;
+        case GREYSCALE_ALPHA:
+            return 2;
+        case TRUECOLOR:
+            return 3;
+        case TRUECOLOR_ALPHA:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    // Number of bits per pixel.
+    usize bits() {
+        return channels() * bitDepth();
+    }
 };
 
 struct Plte : public BChunk {
     static constexpr Str SIG = "PLTE";
+
+    usize len() const {
+        return _slice.len() / 3;
+    }
+
+    Gfx::Color color(usize i) const {
+        return Gfx::Color::fromRgb(_slice[i * 3], _slice[i * 3 + 1], _slice[i * 3 + 2]);
+    }
+};
+
+// Alpha of the palette entries, or the single color to treat as transparent
+// for images without an alpha channel.
+struct Trns : public BChunk {
+    static constexpr Str SIG = "tRNS";
 };
 
 struct Idat : public BChunk {
@@ -52,15 +103,210 @@ struct Iend : public BChunk {
     static constexpr Str SIG = "IEND";
 };
 
+/* --- Filtering ------------------------------------------------------------ */
+
+enum struct Filter : u8 {
+    NONE,
+    SUB,
+    UP,
+    AVERAGE,
+    PAETH,
+};
+
+ALWAYS_INLINE static u8 paeth(u8 a, u8 b, u8 c) {
+    isize p = a + b - c;
+    isize pa = p > a ? p - a : a - p;
+    isize pb = p > b ? p - b : b - p;
+    isize pc = p > c ? p - c : c - p;
+    if (pa <= pb and pa <= pc)
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+#if defined(__SSE2__)
+
+// Average and Paeth depend on the previous pixel of the row, pixels are
+// processed one at a time with every channel in a lane, like libpng.
+
+ALWAYS_INLINE static __m128i _load4(u8 const *p) {
+    i32 v;
+    memcpy(&v, p, 4);
+    return _mm_cvtsi32_si128(v);
+}
+
+ALWAYS_INLINE static void _store(u8 *p, __m128i v, usize bpp) {
+    i32 r = _mm_cvtsi128_si32(v);
+    memcpy(p, &r, bpp);
+}
+
+ALWAYS_INLINE static void _unfilterAverageSse2(u8 *row, u8 const *prev, usize len, usize bpp) {
+    auto const one = _mm_set1_epi8(1);
+    auto a = _mm_setzero_si128();
+    for (usize i = 0; i < len; i += bpp) {
+        auto b = _load4(prev + i);
+        auto x = _load4(row + i);
+
+        // _mm_avg_epu8 rounds up, the filter rounds down.
+        auto avg = _mm_avg_epu8(a, b);
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), one));
+
+        a = _mm_add_epi8(x, avg);
+        _store(row + i, a, bpp);
+    }
+}
+
+ALWAYS_INLINE static __m128i _abs16(__m128i x) {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+ALWAYS_INLINE static __m128i _select(__m128i cond, __m128i t, __m128i f) {
+    return _mm_or_si128(_mm_and_si128(cond, t), _mm_andnot_si128(cond, f));
+}
+
+ALWAYS_INLINE static void _unfilterPaethSse2(u8 *row, u8 const *prev, usize len, usize bpp) {
+    auto const zero = _mm_setzero_si128();
+    auto a = zero, c = zero;
+    for (usize i = 0; i < len; i += bpp) {
+        auto b = _mm_unpacklo_epi8(_load4(prev + i), zero);
+        auto x = _load4(row + i);
+
+        // pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+        auto pa = _mm_sub_epi16(b, c);
+        auto pb = _mm_sub_epi16(a, c);
+        auto pc = _mm_add_epi16(pa, pb);
+        pa = _abs16(pa);
+        pb = _abs16(pb);
+        pc = _abs16(pc);
+
+        auto smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        auto nearest = _select(
+            _mm_cmpeq_epi16(smallest, pa), a,
+            _select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+        auto d = _mm_add_epi8(x, _mm_packus_epi16(nearest, nearest));
+        _store(row + i, d, bpp);
+
+        a = _mm_unpacklo_epi8(d, zero);
+        c = b;
+    }
+}
+
+#endif
+
+// Undo the filter of a row in place. The `bpp` bytes before `row` and `prev`
+// must be zeros, and `prev` is all zeros for the first row of a pass. Both
+// must be readable 4 bytes past `len`.
+static Res<> unfilter(u8 filter, u8 *row, u8 const *prev, usize len, usize bpp) {
+    switch (static_cast<Filter>(filter)) {
+    case Filter::NONE:
+        return Ok();
+
+    case Filter::SUB:
+        for (usize i = 0; i < len; i++)
+            row[i] += row[i - bpp];
+        return Ok();
+
+    case Filter::UP:
+        for (usize i = 0; i < len; i++)
+            row[i] += prev[i];
+        return Ok();
+
+    case Filter::AVERAGE:
+#if defined(__SSE2__)
+        if (bpp == 3 or bpp == 4) {
+            _unfilterAverageSse2(row, prev, len, bpp);
+            return Ok();
+        }
+#endif
+        for (usize i = 0; i < len; i++)
+            row[i] += (row[i - bpp] + prev[i]) >> 1;
+        return Ok();
+
+    case Filter::PAETH:
+#if defined(__SSE2__)
+        if (bpp == 3 or bpp == 4) {
+            _unfilterPaethSse2(row, prev, len, bpp);
+            return Ok();
+        }
+#endif
+        for (usize i = 0; i < len; i++)
+            row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+        return Ok();
+
+    default:
+        return Error::invalidData("invalid filter type");
+    }
+}
+
+/* --- Interlacing ---------------------------------------------------------- */
+
+struct Pass {
+    isize x, y;
+    isize dx, dy;
+};
+
+static constexpr Array<Pass, 7> ADAM7 = {
+    Pass{0, 0, 8, 8},
+    Pass{4, 0, 8, 8},
+    Pass{0, 4, 4, 8},
+    Pass{2, 0, 4, 4},
+    Pass{0, 2, 2, 4},
+    Pass{1, 0, 2, 2},
+    Pass{0, 1, 1, 2},
+};
+
+/* --- Image ---------------------------------------------------------------- */
+
+// The data of consecutive IDAT chunks, read as a single stream.
+struct IdatReader : public Io::Reader {
+    BScan _s;
+    Bytes _data{};
+
+    IdatReader(BScan s) : _s(s) {}
+
+    Res<usize> read(MutBytes bytes) override {
+        while (_data.len() == 0) {
+            if (_s.rem() < 12)
+                return Ok(0uz);
+
+            usize len = _s.nextU32be();
+            Str sig = _s.nextStr(4);
+            Bytes data = _s.nextBytes(len);
+            _s.skip(4);
+
+            if (Op::eq(sig, Iend::SIG))
+                return Ok(0uz);
+            if (Op::eq(sig, Idat::SIG))
+                _data = data;
+        }
+
+        usize len = min(bytes.len(), _data.len());
+        memcpy(bytes.buf(), _data.buf(), len);
+        _data = next(_data, len);
+        return Ok(len);
+    }
+};
+
 struct Image {
     static constexpr Array<u8, 8> SIG = {
         0x89, 0x50, 0x4E, 0x47,
         0x0D, 0x0A, 0x1A, 0x0A};
 
+    // Room for the bytes of the previous pixel before a row.
+    static constexpr usize PAD = 8;
+
+    // Larger images are rejected before anything is allocated for them, the
+    // header alone could otherwise ask for gigabytes.
+    static constexpr isize MAX_SIZE = 16384;
+    static constexpr isize MAX_PIXELS = 8192 * 8192;
+
     Bytes _slice;
 
     Ihdr _ihdr;
     Plte _plte;
+    Trns _trns;
     Idat _idat;
 
     Bytes sig() {
@@ -71,19 +317,6 @@ struct Image {
         return slice.len() >= 8 and Op::eq(sub(slice, 0, 8), bytes(SIG));
     }
 
-    static Res<Image> load(Bytes slice) {
-        Image image{slice};
-
-        if (not Op::eq(image.sig(), bytes(SIG)))
-            return Error::invalidData("invalid signature");
-
-        image._ihdr = image.lookupChunk<Ihdr>();
-        image._plte = image.lookupChunk<Plte>();
-        image._idat = image.lookupChunk<Idat>();
-
-        return Ok(image);
-    }
-
     Image(Bytes slice)
         : _slice(slice) {}
 
@@ -103,12 +336,15 @@ struct Image {
         };
 
         return Iter{[s]() mutable -> Opt<Chunk> {
+            if (s.rem() < 12)
+                return NONE;
+
             Chunk c;
 
-            c.len = s.nextI32be();
+            c.len = s.nextU32be();
             c.sig = s.nextStr(4);
             c.data = s.nextBytes(c.len);
-            c.crc32 = s.nextI32be();
+            c.crc32 = s.nextU32be();
 
             if (Op::eq(c.sig, Iend::SIG)) {
                 return NONE;
@@ -118,6 +354,41 @@ struct Image {
         }};
     }
 
+    static Res<Image> load(Bytes slice) {
+        Image image{slice};
+
+        if (not isPng(slice))
+            return Error::invalidData("invalid signature");
+
+        // Only the small chunks are checked, the image data is covered by
+        // the checksum of the zlib stream.
+        for (auto chunk : image.iterChunks()) {
+            if (chunk.data.len() != chunk.len)
+                return Error::invalidData("truncated chunk");
+
+            bool isIdat = Op::eq(chunk.sig, Idat::SIG);
+            if (not isIdat) {
+                Hash::Crc32 crc;
+                crc.add(Bytes{reinterpret_cast<u8 const *>(chunk.sig.buf()), 4});
+                crc.add(chunk.data);
+                if (crc.sum() != chunk.crc32)
+                    return Error::invalidData("chunk checksum mismatch");
+            }
+
+            if (Op::eq(chunk.sig, Ihdr::SIG))
+                image._ihdr = Ihdr{chunk.data};
+            else if (Op::eq(chunk.sig, Plte::SIG))
+                image._plte = Plte{chunk.data};
+            else if (Op::eq(chunk.sig, Trns::SIG))
+                image._trns = Trns{chunk.data};
+            else if (isIdat and not image._idat.present())
+                image._idat = Idat{chunk.data};
+        }
+
+        try$(image._validate());
+        return Ok(image);
+    }
+
     template <typename T>
     T lookupChunk() {
         for (auto chunk : iterChunks()) {
@@ -137,6 +408,219 @@ struct Image {
     isize height() {
         return _ihdr.size().y;
     }
+
+    Res<> _validate() {
+        if (_ihdr._slice.len() != 13)
+            return Error::invalidData("missing or invalid IHDR chunk");
+
+        if (width() <= 0 or height() <= 0)
+            return Error::invalidData("invalid image size");
+
+        if (width() > MAX_SIZE or height() > MAX_SIZE or width() * height() > MAX_PIXELS)
+            return Error::invalidData("image too large");
+
+        usize depth = _ihdr.bitDepth();
+        bool valid = false;
+        switch (_ihdr.colorType()) {
+        case GREYSCALE:
+            valid = depth == 1 or depth == 2 or depth == 4 or depth == 8 or depth == 16;
+            break;
+        case INDEXED:
+            valid = depth == 1 or depth == 2 or depth == 4 or depth == 8;
+            break;
+        case TRUECOLOR:
+        case GREYSCALE_ALPHA:
+        case TRUECOLOR_ALPHA:
+            valid = depth == 8 or depth == 16;
+            break;
+        default:
+            return Error::invalidData("invalid color type");
+        }
+        if (not valid)
+            return Error::invalidData("invalid bit depth");
+
+        if (_ihdr.compressionMethod() != 0 or _ihdr.filterMethod() != 0)
+            return Error::invalidData("unsupported compression or filter method");
+        if (_ihdr.interlaceMethod() > 1)
+            return Error::invalidData("invalid interlace method");
+
+        if (_ihdr.colorType() == INDEXED and not _plte.present())
+            return Error::invalidData("missing palette");
+        if (not _idat.present())
+            return Error::invalidData("missing image data");
+
+        return Ok();
+    }
+
+    /* --- Decoding --------------------------------------------------------- */
+
+    // Decode the image into `dest`, which must be at least as large. Only
+    // two rows of the image are kept in memory.
+    Res<> decode(Gfx::MutPixels dest) {
+        if (dest.width() < width() or dest.height() < height())
+            return Error::invalidInput("destination too small");
+
+        Array<Gfx::Color, 256> palette;
+        for (auto &c : palette)
+            c = Gfx::BLACK;
+        if (_ihdr.colorType() == INDEXED) {
+            for (usize i = 0; i < min(_plte.len(), 256uz); i++)
+                palette[i] = _plte.color(i);
+            for (usize i = 0; i < min(_trns._slice.len(), 256uz); i++)
+                palette[i].alpha = _trns._slice[i];
+        }
+
+        IdatReader idats{begin().skip(8)};
+        Deflate::Decompressor data{idats, Deflate::Format::ZLIB};
+
+        if (_ihdr.interlaceMethod() == 0)
+            return _decodePass(data, dest, palette, {0, 0, 1, 1});
+
+        for (auto const &pass : ADAM7)
+            try$(_decodePass(data, dest, palette, pass));
+        return Ok();
+    }
+
+    Res<> _decodePass(Io::Reader &data, Gfx::MutPixels dest, Array<Gfx::Color, 256> const &palette, Pass pass) {
+        isize w = (width() - pass.x + pass.dx - 1) / pass.dx;
+        isize h = (height() - pass.y + pass.dy - 1) / pass.dy;
+        if (w <= 0 or h <= 0)
+            return Ok();
+
+        usize bpp = max(_ihdr.bits() / 8, 1uz);
+        usize len = (w * _ihdr.bits() + 7) / 8;
+
+        Vec<u8> curr, prev;
+        curr.resize(PAD + len + 4, 0);
+        prev.resize(PAD + len + 4, 0);
+
+        for (isize y = 0; y < h; y++) {
+            // The filter type is read in the padding, which must then be
+            // cleared again.
+            auto row = mutSub(curr, PAD - 1, PAD + len);
+            for (usize read = 0; read < row.len();) {
+                usize n = try$(data.read(mutNext(row, read)));
+                if (n == 0)
+                    return Error::invalidData("unexpected end of image data");
+                read += n;
+            }
+
+            u8 filter = curr[PAD - 1];
+            curr[PAD - 1] = 0;
+            try$(unfilter(filter, curr.buf() + PAD, prev.buf() + PAD, len, bpp));
+
+            _emitRow(dest, palette, curr.buf() + PAD, pass.y + y * pass.dy, pass, w);
+            std::swap(curr, prev);
+        }
+
+        return Ok();
+    }
+
+    // Whether the raw sample of the first channel matches the transparent
+    // color of greyscale or truecolor images.
+    ALWAYS_INLINE bool _isTransparent(u16 r, u16 g, u16 b) {
+        if (_trns._slice.len() < 6)
+            return false;
+        auto s = _trns.begin();
+        return r == s.nextU16be() and g == s.nextU16be() and b == s.nextU16be();
+    }
+
+    ALWAYS_INLINE bool _isTransparent(u16 v) {
+        if (_trns._slice.len() < 2)
+            return false;
+        return v == _trns.begin().nextU16be();
+    }
+
+    void _emitRow(Gfx::MutPixels dest, Array<Gfx::Color, 256> const &palette, u8 const *row, isize y, Pass pass, isize w) {
+        usize depth = _ihdr.bitDepth();
+        u8 colorType = _ihdr.colorType();
+        bool hasTrns = _trns.present();
+
+        dest.fmt().visit([&](auto f) {
+            u8 *out = static_cast<u8 *>(dest.pixelUnsafe({pass.x, y}));
+            usize step = pass.dx * f.bpp();
+
+            auto put = [&](isize x, Gfx::Color c) {
+                f.store(out + x * step, c);
+            };
+
+            // Samples smaller than a byte, most significant bits first.
+            auto packed = [&](isize x) -> u8 {
+                usize bit = x * depth;
+                return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+            };
+
+            switch (colorType) {
+            case GREYSCALE:
+                if (depth == 16) {
+                    for (isize x = 0; x < w; x++) {
+                        u8 v = row[x * 2];
+                        u16 raw = (v << 8) | row[x * 2 + 1];
+                        put(x, Gfx::Color{v, v, v, u8(hasTrns and _isTransparent(raw) ? 0 : 255)});
+                    }
+                } else {
+                    u8 scale = 255 / ((1 << depth) - 1);
+                    for (isize x = 0; x < w; x++) {
+                        u8 raw = depth == 8 ? row[x] : packed(x);
+                        u8 v = raw * scale;
+                        put(x, Gfx::Color{v, v, v, u8(hasTrns and _isTransparent(raw) ? 0 : 255)});
+                    }
+                }
+                break;
+
+            case TRUECOLOR:
+                if (depth == 16) {
+                    for (isize x = 0; x < w; x++) {
+                        u8 const *p = row + x * 6;
+                        bool transparent = hasTrns and
+                                           _isTransparent((p[0] << 8) | p[1], (p[2] << 8) | p[3], (p[4] << 8) | p[5]);
+                        put(x, Gfx::Color{p[0], p[2], p[4], u8(transparent ? 0 : 255)});
+                    }
+                } else if (hasTrns) {
+                    for (isize x = 0; x < w; x++) {
+                        u8 const *p = row + x * 3;
+                        put(x, Gfx::Color{p[0], p[1], p[2], u8(_isTransparent(p[0], p[1], p[2]) ? 0 : 255)});
+                    }
+                } else {
+                    for (isize x = 0; x < w; x++) {
+                        u8 const *p = row + x * 3;
+                        put(x, Gfx::Color{p[0], p[1], p[2]});
+                    }
+                }
+                break;
+
+            case INDEXED:
+                for (isize x = 0; x < w; x++)
+                    put(x, palette[depth == 8 ? row[x] : packed(x)]);
+                break;
+
+            case GREYSCALE_ALPHA: {
+                usize size = depth / 4;
+                for (isize x = 0; x < w; x++) {
+                    u8 const *p = row + x * size;
+                    put(x, Gfx::Color{p[0], p[0], p[0], p[size / 2]});
+                }
+                break;
+            }
+
+            case TRUECOLOR_ALPHA:
+                if (depth == 16) {
+                    for (isize x = 0; x < w; x++) {
+                        u8 const *p = row + x * 8;
+                        put(x, Gfx::Color{p[0], p[2], p[4], p[6]});
+                    }
+                } else if (pass.dx == 1 and Meta::Same<decltype(f), Gfx::Rgba8888>) {
+                    memcpy(out, row, w * 4);
+                } else {
+                    for (isize x = 0; x < w; x++) {
+                        u8 const *p = row + x * 4;
+                        put(x, Gfx::Color{p[0], p[1], p[2], p[3]});
+                    }
+                }
+                break;
+            }
+        });
+    }
 };
 
 } // namespace Png
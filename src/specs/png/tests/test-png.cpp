@@ -0,0 +1,141 @@
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-test/samples.h>
+#include <png/spec.h>
+
+namespace Png::Tests {
+
+// FNV-1a, what the reference hashes below were computed with.
+static u64 _fnv(Bytes bytes) {
+    u64 h = 0xcbf29ce484222325;
+    for (auto b : bytes)
+        h = (h ^ b) * 0x100000001b3;
+    return h;
+}
+
+static Res<Media::Image> _decode(Bytes bytes) {
+    auto png = try$(Image::load(bytes));
+    auto img = Media::Image::alloc({png.width(), png.height()}, Gfx::RGBA8888);
+    try$(png.decode(img));
+    return Ok(img);
+}
+
+static Res<Media::Image> _decodeSuite(Str name) {
+    auto map = try$(loadSample("bundle://png-spec-tests"_url, name));
+    return _decode(map.bytes());
+}
+
+/* --- PngSuite ------------------------------------------------------------- */
+
+// http://www.schaik.com/pngsuite/
+
+test$(pngSuiteMatchesReference) {
+    // Hashes of the RGBA pixels, computed with an independent decoder.
+    struct Sample {
+        Str name;
+        u64 hash;
+    };
+
+    Array<Sample, 8> samples = {
+        Sample{"basn0g01.png", 0xf76ab9c2cc275b5d},
+        Sample{"basn2c16.png", 0x016a07c086368525},
+        Sample{"basn3p04.png", 0x817fff880b5d72c5},
+        Sample{"basn4a16.png", 0x8c09f25148b55145},
+        Sample{"basn6a08.png", 0xf9ed41b6375b125d},
+        Sample{"tbbn3p08.png", 0x6cdff609c65aac37},
+        Sample{"tbrn2c08.png", 0x1e1f86e420f8ad04},
+        Sample{"basi0g02.png", 0x100bbcf53d1fd325},
+    };
+
+    for (auto const &sample : samples) {
+        auto img = try$(_decodeSuite(sample.name));
+        expectEq$(_fnv(img.pixels().bytes()), sample.hash);
+    }
+
+    return Ok();
+}
+
+test$(pngSuiteInterlaced) {
+    // Interlaced images hold the same pixels as their progressive version.
+    Array<Str, 15> kinds = {
+        "0g01", "0g02", "0g04", "0g08", "0g16",
+        "2c08", "2c16",
+        "3p01", "3p02", "3p04", "3p08",
+        "4a08", "4a16",
+        "6a08", "6a16"};
+
+    for (auto kind : kinds) {
+        auto progressive = try$(_decodeSuite(try$(Fmt::format("basn{}.png", kind))));
+        auto interlaced = try$(_decodeSuite(try$(Fmt::format("basi{}.png", kind))));
+        expectEq$(progressive._size, interlaced._size);
+        expect$(Op::eq(progressive.pixels().bytes(), interlaced.pixels().bytes()));
+    }
+
+    return Ok();
+}
+
+test$(pngSuiteRejectsCorrupt) {
+    Array<Str, 13> corrupt = {
+        "xc1n0g08.png", "xc9n2c08.png", "xcrn0g04.png", "xd0n2c08.png",
+        "xd3n2c08.png", "xd9n2c08.png", "xdtn0g01.png", "xhdn0g08.png",
+        "xlfn0g04.png", "xs1n0g01.png", "xs2n0g01.png", "xs4n0g01.png",
+        "xs7n0g01.png"};
+
+    for (auto name : corrupt)
+        expectNot$(bool(_decodeSuite(name)));
+
+    return Ok();
+}
+
+test$(pngRejectsHugeHeader) {
+    auto map = try$(loadSample("bundle://png-spec-tests"_url, "basn0g08.png"));
+    auto bytes = map.bytes();
+    Vec<u8> buf;
+    buf.pushBack(bytes);
+    expect$(bool(Image::load(buf)));
+
+    // Rewrite the size in the IHDR chunk, and its checksum.
+    auto patch = [&](u32 width, u32 height) {
+        for (usize i = 0; i < 4; i++) {
+            buf[16 + i] = width >> (24 - i * 8);
+            buf[20 + i] = height >> (24 - i * 8);
+        }
+
+        Hash::Crc32 crc;
+        crc.add(sub(buf, 12, 29));
+        u32 sum = crc.sum();
+        for (usize i = 0; i < 4; i++)
+            buf[29 + i] = sum >> (24 - i * 8);
+    };
+
+    patch(0x7fffffff, 32);
+    expectNot$(bool(Image::load(buf)));
+
+    patch(32, Image::MAX_SIZE + 1);
+    expectNot$(bool(Image::load(buf)));
+
+    patch(Image::MAX_SIZE, Image::MAX_SIZE);
+    expectNot$(bool(Image::load(buf)));
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(pngWallpapers) {
+    Array<Str, 2> names = {"abstract.png", "brutal.png"};
+
+    for (auto name : names) {
+        auto map = try$(loadSample("bundle://skift-wallpapers/images"_url, name));
+        auto png = try$(Image::load(map.bytes()));
+        auto img = Media::Image::alloc({png.width(), png.height()}, Gfx::RGBA8888);
+
+        try$(benchThroughput(_driver, name, img.pixels().bytes().len(), "MB/s", [&] {
+            return png.decode(img);
+        }));
+    }
+
+    return Ok();
+}
+
+} // namespace Png::Tests
@@ -3,19 +3,52 @@
 #include <karm-base/res.h>
 #include <karm-gfx/buffer.h>
 #include <karm-gfx/colors.h>
+#include <karm-io/traits.h>
 
 #include "../bscan.h"
 
 namespace Qoi {
 
-struct Image {
-    // magic "qoif"
-    static constexpr Array<u8, 4> MAGIC = {
-        0x71, 0x6F, 0x69, 0x66};
+// https://qoiformat.org/qoi-specification.pdf
+
+// magic "qoif"
+static constexpr Array<u8, 4> MAGIC = {
+    0x71, 0x6F, 0x69, 0x66};
+
+static constexpr Array<u8, 8> END = {
+    0, 0, 0, 0, 0, 0, 0, 1};
+
+static constexpr usize HEADER_LEN = 14;
+
+// Limit of the reference implementation, keeps the size of the decoded
+// image well within an isize.
+static constexpr usize MAX_PIXELS = 400'000'000;
+
+enum Chunk : u8 {
+    RGB = 0b11111110,
+    RGBA = 0b11111111,
+    INDEX = 0b00000000,
+    DIFF = 0b01000000,
+    LUMA = 0b10000000,
+    RUN = 0b11000000,
+
+    MASK = 0b11000000,
+};
 
-    static constexpr Array<u8, 8> END = {
-        0, 0, 0, 0, 0, 0, 0, 1};
+// Longest run a single chunk can encode, 63 and 64 would collide with the
+// RGB and RGBA tags.
+static constexpr usize MAX_RUN = 62;
 
+ALWAYS_INLINE static usize hash(Gfx::Color c) {
+    return (c.red * 3 + c.green * 5 + c.blue * 7 + c.alpha * 11) % 64;
+}
+
+ALWAYS_INLINE static bool same(Gfx::Color a, Gfx::Color b) {
+    return a.red == b.red and a.green == b.green and
+           a.blue == b.blue and a.alpha == b.alpha;
+}
+
+struct Image {
     Bytes _slice;
 
     BScan begin() const { return _slice; }
@@ -38,7 +71,7 @@ struct Image {
     }
 
     static Res<Image> load(Bytes slice) {
-        if (slice.len() < 14) {
+        if (slice.len() < HEADER_LEN + END.len()) {
             return Error::invalidData("image too small");
         }
 
@@ -47,6 +80,11 @@ struct Image {
             return Error::invalidData("invalid magic");
         }
 
+        if (image.width() <= 0 or image.height() <= 0 or
+            (usize)image.width() * (usize)image.height() > MAX_PIXELS) {
+            return Error::invalidData("invalid image size");
+        }
+
         if (not(image.channels() == 4 or image.channels() == 3)) {
             return Error::invalidData("invalid number of channels");
         }
@@ -55,53 +93,49 @@ struct Image {
             return Error::invalidData("invalid color space");
         }
 
+        if (Op::ne(sub(slice, slice.len() - END.len(), slice.len()), bytes(END))) {
+            return Error::invalidData("missing end marker");
+        }
+
         return Ok(image);
     }
 
-    enum Chunk : u8 {
-        RGB = 0b11111110,
-        RGBA = 0b11111111,
-        INDEX = 0b00000000,
-        DIFF = 0b01000000,
-        LUMA = 0b10000000,
-        RUN = 0b11000000,
-
-        MASK = 0b11000000,
-    };
-
-    usize hash(Gfx::Color c) {
-        return c.red * 3 + c.green * 5 + c.blue * 7 + c.alpha * 11;
-    }
+    // No chunk is longer than the end marker, so as long as a chunk starts
+    // before it, all of its bytes are in bounds.
+    template <typename F>
+    Res<> _decode(F f, Gfx::MutPixels dest) const {
+        u8 const *p = _slice.buf() + HEADER_LEN;
+        u8 const *end = _slice.buf() + _slice.len() - END.len();
 
-    [[gnu::flatten]] Res<> decode(Gfx::MutPixels dest) {
-        usize run = 0;
         Array<Gfx::Color, 64> index{};
         Gfx::Color pixel = Gfx::BLACK;
-
-        auto s = begin().skip(14);
+        usize run = 0;
 
         for (isize y = 0; y < height(); y++) {
-            for (isize x = 0; x < width(); x++) {
-                if (s.ended()) {
-                    return Error::invalidData("unexpected end of file");
-                }
+            u8 *out = static_cast<u8 *>(dest.scanline(y));
+            u8 *eol = out + width() * f.bpp();
 
+            while (out < eol) {
                 if (run > 0) {
-                    run--;
-                    dest.store({x, y}, pixel);
+                    usize n = min(run, (usize)(eol - out) / f.bpp());
+                    for (usize i = 0; i < n; i++, out += f.bpp())
+                        f.store(out, pixel);
+                    run -= n;
                     continue;
                 }
 
-                auto b1 = s.nextU8be();
+                if (p >= end) [[unlikely]]
+                    return Error::invalidData("unexpected end of data");
+
+                u8 b1 = *p++;
                 if (b1 == Chunk::RGB) {
-                    pixel.red = s.nextU8be();
-                    pixel.green = s.nextU8be();
-                    pixel.blue = s.nextU8be();
+                    pixel.red = p[0];
+                    pixel.green = p[1];
+                    pixel.blue = p[2];
+                    p += 3;
                 } else if (b1 == Chunk::RGBA) {
-                    pixel.red = s.nextU8be();
-                    pixel.green = s.nextU8be();
-                    pixel.blue = s.nextU8be();
-                    pixel.alpha = s.nextU8be();
+                    pixel = Gfx::Color::fromRgba(p[0], p[1], p[2], p[3]);
+                    p += 4;
                 } else if ((b1 & Chunk::MASK) == Chunk::INDEX) {
                     pixel = index[b1];
                 } else if ((b1 & Chunk::MASK) == Chunk::DIFF) {
@@ -109,28 +143,156 @@ struct Image {
                     pixel.green += ((b1 >> 2) & 0x03) - 2;
                     pixel.blue += (b1 & 0x03) - 2;
                 } else if ((b1 & Chunk::MASK) == Chunk::LUMA) {
-                    auto b2 = s.nextU8be();
-                    auto vg = (b1 & 0x3f) - 32;
+                    u8 b2 = *p++;
+                    int vg = (b1 & 0x3f) - 32;
                     pixel.red += vg - 8 + ((b2 >> 4) & 0x0f);
                     pixel.green += vg;
                     pixel.blue += vg - 8 + (b2 & 0x0f);
-                } else if ((b1 & Chunk::MASK) == Chunk::RUN) {
-                    run = b1 & (~Chunk::MASK);
                 } else {
-                    return Error::invalidData("invalid chunk");
+                    // Runs still go through the index, like the reference
+                    // decoder does.
+                    run = (b1 & ~Chunk::MASK) + 1;
+                    index[hash(pixel)] = pixel;
+                    continue;
                 }
 
-                index[hash(pixel) % index.len()] = pixel;
-                dest.store({x, y}, pixel);
+                index[hash(pixel)] = pixel;
+                f.store(out, pixel);
+                out += f.bpp();
             }
         }
 
-        if (Op::ne(s.nextBytes(8), bytes(END))) {
-            return Error::invalidData("missing end marker");
+        return Ok();
+    }
+
+    [[gnu::flatten]] Res<> decode(Gfx::MutPixels dest) const {
+        if (dest.width() < width() or dest.height() < height()) {
+            return Error::invalidInput("destination too small");
         }
 
-        return Ok();
+        return dest.fmt().visit([&](auto f) {
+            return _decode(f, dest);
+        });
     }
 };
 
+/* --- Encoder -------------------------------------------------------------- */
+
+template <typename F>
+Res<> _encode(F f, Gfx::Pixels src, Io::Writer &writer) {
+    Array<u8, 4096> buf;
+    usize len = 0;
+
+    auto flush = [&]() -> Res<> {
+        if (try$(writer.write(sub(buf, 0, len))) != len)
+            return Error::writeZero("short write");
+        len = 0;
+        return Ok();
+    };
+
+    // Only claim an alpha channel when it carries something, the chunks are
+    // the same either way.
+    bool opaque = true;
+    for (isize y = 0; y < src.height() and opaque; y++) {
+        u8 const *in = static_cast<u8 const *>(src.scanline(y));
+        for (isize x = 0; x < src.width(); x++, in += f.bpp())
+            opaque &= f.load(in).alpha == 255;
+    }
+
+    auto putU32 = [&](u32 v) {
+        buf[len++] = v >> 24;
+        buf[len++] = v >> 16;
+        buf[len++] = v >> 8;
+        buf[len++] = v;
+    };
+
+    for (auto b : MAGIC)
+        buf[len++] = b;
+    putU32(src.width());
+    putU32(src.height());
+    buf[len++] = opaque ? 3 : 4;
+    buf[len++] = 0;
+
+    Array<Gfx::Color, 64> index{};
+    Gfx::Color prev = Gfx::BLACK;
+    usize run = 0;
+
+    for (isize y = 0; y < src.height(); y++) {
+        u8 const *in = static_cast<u8 const *>(src.scanline(y));
+        for (isize x = 0; x < src.width(); x++, in += f.bpp()) {
+            // A pixel takes at most a run and an RGBA chunk.
+            if (len + 6 > buf.len())
+                try$(flush());
+
+            auto pixel = f.load(in);
+            if (same(pixel, prev)) {
+                if (++run == MAX_RUN) {
+                    buf[len++] = Chunk::RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                buf[len++] = Chunk::RUN | (run - 1);
+                run = 0;
+            }
+
+            usize slot = hash(pixel);
+            if (same(index[slot], pixel)) {
+                buf[len++] = Chunk::INDEX | slot;
+            } else if (pixel.alpha != prev.alpha) {
+                index[slot] = pixel;
+                buf[len++] = Chunk::RGBA;
+                buf[len++] = pixel.red;
+                buf[len++] = pixel.green;
+                buf[len++] = pixel.blue;
+                buf[len++] = pixel.alpha;
+            } else {
+                index[slot] = pixel;
+                i8 vr = pixel.red - prev.red;
+                i8 vg = pixel.green - prev.green;
+                i8 vb = pixel.blue - prev.blue;
+                i8 vgr = vr - vg;
+                i8 vgb = vb - vg;
+
+                if (vr >= -2 and vr <= 1 and
+                    vg >= -2 and vg <= 1 and
+                    vb >= -2 and vb <= 1) {
+                    buf[len++] = Chunk::DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                } else if (vgr >= -8 and vgr <= 7 and
+                           vg >= -32 and vg <= 31 and
+                           vgb >= -8 and vgb <= 7) {
+                    buf[len++] = Chunk::LUMA | (vg + 32);
+                    buf[len++] = (vgr + 8) << 4 | (vgb + 8);
+                } else {
+                    buf[len++] = Chunk::RGB;
+                    buf[len++] = pixel.red;
+                    buf[len++] = pixel.green;
+                    buf[len++] = pixel.blue;
+                }
+            }
+
+            prev = pixel;
+        }
+    }
+
+    if (len + 1 + END.len() > buf.len())
+        try$(flush());
+    if (run > 0)
+        buf[len++] = Chunk::RUN | (run - 1);
+    for (auto b : END)
+        buf[len++] = b;
+
+    return flush();
+}
+
+// Encode `src` as a QOI image. Chunks are picked the same way as the
+// reference encoder does, so the output matches it byte for byte.
+[[gnu::flatten]] inline Res<> encode(Gfx::Pixels src, Io::Writer &writer) {
+    return src.fmt().visit([&](auto f) {
+        return _encode(f, src, writer);
+    });
+}
+
 } // namespace Qoi
@@ -0,0 +1,158 @@
+#include <karm-io/impls.h>
+#include <karm-media/image.h>
+#include <karm-test/macros.h>
+#include <karm-test/samples.h>
+#include <png/spec.h>
+#include <qoi/spec.h>
+
+namespace Qoi::Tests {
+
+static Res<Sys::Mmap> _load(Str name) {
+    return loadSample("bundle://qoi-spec-tests"_url, name);
+}
+
+static Res<Media::Image> _decode(Bytes bytes) {
+    auto qoi = try$(Image::load(bytes));
+    auto img = Media::Image::alloc({qoi.width(), qoi.height()}, Gfx::RGBA8888);
+    try$(qoi.decode(img));
+    return Ok(img);
+}
+
+static Res<Vec<u8>> _encode(Gfx::Pixels pixels) {
+    Io::BufferWriter writer;
+    try$(encode(pixels, writer));
+    auto bytes = writer.bytes();
+    return Ok(Vec<u8>{bytes});
+}
+
+static bool _eq(Bytes a, Bytes b) {
+    return a.len() == b.len() and memcmp(a.buf(), b.buf(), a.len()) == 0;
+}
+
+static constexpr Array<Str, 7> SAMPLES = {
+    "dice", "kodim10", "kodim23", "qoi_logo",
+    "testcard", "testcard_rgba", "wikipedia_008"};
+
+/* --- Decoder -------------------------------------------------------------- */
+
+test$(qoiMatchesPng) {
+    for (auto name : SAMPLES) {
+        auto qoiMap = try$(_load(try$(Fmt::format("{}.qoi", name))));
+        auto qoi = try$(_decode(qoiMap.bytes()));
+
+        auto pngMap = try$(_load(try$(Fmt::format("{}.png", name))));
+        auto png = try$(Png::Image::load(pngMap.bytes()));
+        expectEq$(qoi._size, Math::Vec2i(png.width(), png.height()));
+
+        auto ref = Media::Image::alloc(qoi._size, Gfx::RGBA8888);
+        try$(png.decode(ref));
+        expect$(_eq(qoi.pixels().bytes(), ref.pixels().bytes()));
+    }
+
+    return Ok();
+}
+
+test$(qoiRejectsCorrupt) {
+    auto map = try$(_load("qoi_logo.qoi"));
+    auto bytes = map.bytes();
+    Vec<u8> data{bytes};
+
+    // Missing end marker.
+    expectNot$(bool(_decode(sub(data, 0, data.len() - 1))));
+
+    // Chunks running out before the last pixel.
+    Vec<u8> truncated;
+    for (usize i = 0; i < data.len() / 2; i++)
+        truncated.pushBack(data[i]);
+    for (auto b : END)
+        truncated.pushBack(b);
+    expectNot$(bool(_decode(truncated)));
+
+    // Empty image.
+    auto empty = data;
+    for (usize i = 4; i < 8; i++)
+        empty[i] = 0;
+    expectNot$(bool(_decode(empty)));
+
+    // Destination smaller than the image.
+    auto qoi = try$(Image::load(data));
+    auto small = Media::Image::alloc({qoi.width() - 1, qoi.height()}, Gfx::RGBA8888);
+    expectNot$(bool(qoi.decode(small)));
+
+    return Ok();
+}
+
+/* --- Encoder -------------------------------------------------------------- */
+
+test$(qoiEncodeMatchesReference) {
+    for (auto name : SAMPLES) {
+        auto map = try$(_load(try$(Fmt::format("{}.qoi", name))));
+        auto img = try$(_decode(map.bytes()));
+        auto out = try$(_encode(img.pixels()));
+
+        // The channel count is informative only, some of the samples claim
+        // an alpha channel they don't use.
+        expectEq$(out.len(), map.bytes().len());
+        out[12] = map.bytes()[12];
+        expect$(_eq(out, map.bytes()));
+    }
+
+    return Ok();
+}
+
+test$(qoiRoundTrip) {
+    // Long runs crossing rows, small and large steps, and varying alpha.
+    auto img = Media::Image::alloc({97, 61}, Gfx::BGRA8888);
+    auto pixels = img.mutPixels();
+    u32 seed = 1;
+    for (isize y = 0; y < img.height(); y++) {
+        for (isize x = 0; x < img.width(); x++) {
+            seed = seed * 1103515245 + 12345;
+            Gfx::Color c = Gfx::Color::fromRgba(x * 2, y * 4, (x + y), 255);
+            if (y % 7 == 3)
+                c = Gfx::Color::fromRgba(10, 20, 30, 255);
+            else if (y % 5 == 1)
+                c = Gfx::Color::fromRgba(seed >> 24, seed >> 16, seed >> 8, x < 50 ? seed : 255);
+            pixels.storeUnsafe({x, y}, c);
+        }
+    }
+
+    auto out = try$(_encode(pixels));
+    auto qoi = try$(Image::load(out));
+    expectEq$(qoi.channels(), 4);
+
+    auto back = Media::Image::alloc(img._size, Gfx::BGRA8888);
+    try$(qoi.decode(back));
+    expect$(_eq(back.pixels().bytes(), img.pixels().bytes()));
+
+    return Ok();
+}
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+bench$(qoiThroughput) {
+    Array<Str, 3> names = {"kodim23", "testcard_rgba", "wikipedia_008"};
+
+    for (auto name : names) {
+        auto map = try$(_load(try$(Fmt::format("{}.qoi", name))));
+        auto qoi = try$(Image::load(map.bytes()));
+        auto img = Media::Image::alloc({qoi.width(), qoi.height()}, Gfx::RGBA8888);
+        auto len = img.pixels().bytes().len();
+
+        try$(benchThroughput(_driver, try$(Fmt::format("decode {}", name)), len, "MB/s", [&] {
+            return qoi.decode(img);
+        }));
+
+        // Worst case is a tag and four bytes per pixel.
+        Vec<u8> out;
+        out.resize(HEADER_LEN + len / 4 * 5 + END.len(), 0);
+        try$(benchThroughput(_driver, try$(Fmt::format("encode {}", name)), len, "MB/s", [&] {
+            Io::BufWriter writer{out};
+            return encode(img, writer);
+        }));
+    }
+
+    return Ok();
+}
+
+} // namespace Qoi::Tests
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <karm-gfx/context.h>
+#include <karm-gfx/path.h>
 #include <karm-logger/logger.h>
 
 #include "../bscan.h"
@@ -151,8 +151,9 @@ struct Loca : public BChunk {
     usize glyfOffset(isize glyphId, Head const &head) const {
         auto s = begin();
         if (head.locaFormat() == 0) {
+            // Short offsets are stored divided by two.
             s.skip(glyphId * 2);
-            return s.nextU16be();
+            return s.nextU16be() * 2;
         } else {
             s.skip(glyphId * 4);
             return s.nextU32be();
@@ -212,7 +213,7 @@ struct Glyf : public BChunk {
         i16 y;
     };
 
-    void contourSimple(Gfx::Context &g, Metrics m, BScan &s) const {
+    void contourSimple(Gfx::Path &g, Metrics m, BScan &s) const {
         auto endPtsOfContours = s;
         auto nPoints = s.peek(2 * (m.numContours - 1)).nextU16be() + 1u;
         u16 instructionLength = s.skip(m.numContours * 2).nextU16be();
@@ -306,18 +307,60 @@ struct Glyf : public BChunk {
         }
     }
 
-    void contourComposite(Gfx::Context &, Metrics, BScan &) const {
-        logTodo();
+    static constexpr u16 ARG_1_AND_2_ARE_WORDS = 0x0001;
+    static constexpr u16 ARGS_ARE_XY_VALUES = 0x0002;
+    static constexpr u16 WE_HAVE_A_SCALE = 0x0008;
+    static constexpr u16 MORE_COMPONENTS = 0x0020;
+    static constexpr u16 WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+    static constexpr u16 WE_HAVE_A_TWO_BY_TWO = 0x0080;
+    static constexpr u16 SCALED_COMPONENT_OFFSET = 0x0800;
+
+    static f64 _nextF2Dot14(BScan &s) {
+        return s.nextI16be() / 16384.0;
     }
 
-    void contour(Gfx::Context &g, usize glyfOffset) const {
-        auto s = begin();
-        auto m = metrics(s, glyfOffset);
+    // Call `component(glyphId, trans)` for each component of a composite
+    // glyph, the transform is expressed with the y axis pointing down.
+    void contourComposite(BScan &s, auto component) const {
+        u16 flags = MORE_COMPONENTS;
+        while (flags & MORE_COMPONENTS) {
+            flags = s.nextU16be();
+            usize glyphId = s.nextU16be();
+
+            f64 e = 0, f = 0;
+            if (flags & ARG_1_AND_2_ARE_WORDS) {
+                e = s.nextI16be();
+                f = s.nextI16be();
+            } else {
+                e = s.nextI8be();
+                f = s.nextI8be();
+            }
 
-        if (m.numContours > 0) {
-            contourSimple(g, m, s);
-        } else if (m.numContours < 0) {
-            contourComposite(g, m, s);
+            // Aligning points of the components is not supported, they are
+            // drawn without an offset.
+            if (not(flags & ARGS_ARE_XY_VALUES))
+                e = f = 0;
+
+            f64 a = 1, b = 0, c = 0, d = 1;
+            if (flags & WE_HAVE_A_SCALE) {
+                a = d = _nextF2Dot14(s);
+            } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
+                a = _nextF2Dot14(s);
+                d = _nextF2Dot14(s);
+            } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
+                a = _nextF2Dot14(s);
+                b = _nextF2Dot14(s);
+                c = _nextF2Dot14(s);
+                d = _nextF2Dot14(s);
+            }
+
+            if (flags & SCALED_COMPONENT_OFFSET) {
+                auto o = Math::Vec2f{e * a + f * c, e * b + f * d};
+                e = o.x;
+                f = o.y;
+            }
+
+            component(glyphId, Math::Trans2f{a, -b, -c, d, e, -f});
         }
     }
 };
@@ -552,6 +595,77 @@ enum struct GposLookupType : u16 {
     EXTENSION_POSITIONING = 9,
 };
 
+struct Coverage : public BChunk {
+    // Index of the glyph in the coverage, or NONE if it's not covered.
+    Opt<usize> index(usize glyphId) const {
+        auto s = begin();
+        auto format = s.nextU16be();
+        usize count = s.nextU16be();
+        usize lo = 0, hi = count;
+
+        if (format == 1) {
+            while (lo < hi) {
+                usize mid = (lo + hi) / 2;
+                usize glyph = begin().skip(4 + mid * 2).nextU16be();
+                if (glyph == glyphId)
+                    return mid;
+                if (glyph < glyphId)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+        } else if (format == 2) {
+            while (lo < hi) {
+                usize mid = (lo + hi) / 2;
+                auto r = begin().skip(4 + mid * 6);
+                usize start = r.nextU16be();
+                usize end = r.nextU16be();
+                usize startIndex = r.nextU16be();
+                if (glyphId < start)
+                    hi = mid;
+                else if (glyphId > end)
+                    lo = mid + 1;
+                else
+                    return startIndex + glyphId - start;
+            }
+        }
+
+        return NONE;
+    }
+};
+
+struct ClassDef : public BChunk {
+    // Class of the glyph, glyphs not listed are in class 0.
+    usize classOf(usize glyphId) const {
+        auto s = begin();
+        auto format = s.nextU16be();
+
+        if (format == 1) {
+            usize start = s.nextU16be();
+            usize count = s.nextU16be();
+            if (glyphId < start or glyphId >= start + count)
+                return 0;
+            return s.skip((glyphId - start) * 2).nextU16be();
+        } else if (format == 2) {
+            usize lo = 0, hi = s.nextU16be();
+            while (lo < hi) {
+                usize mid = (lo + hi) / 2;
+                auto r = begin().skip(4 + mid * 6);
+                usize start = r.nextU16be();
+                usize end = r.nextU16be();
+                if (glyphId < start)
+                    hi = mid;
+                else if (glyphId > end)
+                    lo = mid + 1;
+                else
+                    return r.nextU16be();
+            }
+        }
+
+        return 0;
+    }
+};
+
 struct Gpos : public BChunk {
     static constexpr Str SIG = "GPOS";
 
@@ -559,6 +673,10 @@ struct Gpos : public BChunk {
     using FeatureListOffset = BField<u16be, 6>;
     using LookupListOffset = BField<u16be, 8>;
 
+    static constexpr u16 X_PLACEMENT = 0x0001;
+    static constexpr u16 Y_PLACEMENT = 0x0002;
+    static constexpr u16 X_ADVANCE = 0x0004;
+
     ScriptList scriptList() const {
         return ScriptList{begin().skip(get<ScriptListOffset>()).restBytes()};
     }
@@ -571,31 +689,124 @@ struct Gpos : public BChunk {
         return LookupList{begin().skip(get<LookupListOffset>()).restBytes()};
     }
 
-    // Positioning
+    // Indices of the lookups of every feature with the given tag, whatever
+    // the script or language they belong to.
+    Vec<usize> lookupsFor(Str tag) const {
+        Vec<usize> lookups;
+        if (not present())
+            return lookups;
+
+        auto features = featureList();
+        for (auto feat : features.iter()) {
+            if (not Op::eq(feat.tag, tag))
+                continue;
+            for (usize lookup : feat.iterLookups())
+                if (not lookups.contains(lookup))
+                    lookups.pushBack(lookup);
+        }
+
+        sort(lookups, [](usize a, usize b) {
+            return cmp(a, b);
+        });
+
+        return lookups;
+    }
+
+    static usize _valueSize(u16 format) {
+        return __builtin_popcount(format & 0xff) * 2;
+    }
+
+    static isize _xAdvance(BScan s, u16 format) {
+        if (format & X_PLACEMENT)
+            s.skip(2);
+        if (format & Y_PLACEMENT)
+            s.skip(2);
+        return format & X_ADVANCE ? s.nextI16be() : 0;
+    }
+
+    // Adjustment of the advance of the first glyph by a pair positioning
+    // subtable, or NONE if the subtable doesn't apply to the pair.
+    static Opt<isize> _pairAdjustment(BChunk subtable, usize first, usize second) {
+        auto s = subtable.begin();
+        auto format = s.nextU16be();
+        auto coverage = Coverage{subtable.begin().skip(s.nextU16be()).restBytes()};
+        u16 format1 = s.nextU16be();
+        u16 format2 = s.nextU16be();
+
+        auto index = coverage.index(first);
+        if (not index)
+            return NONE;
+
+        usize recordSize = _valueSize(format1) + _valueSize(format2);
+
+        if (format == 1) {
+            auto pairSet = subtable.begin().skip(s.skip(2 + *index * 2).nextU16be());
+            usize lo = 0, hi = pairSet.nextU16be();
+            while (lo < hi) {
+                usize mid = (lo + hi) / 2;
+                auto r = pairSet.peek(mid * (2 + recordSize));
+                usize glyph = r.nextU16be();
+                if (glyph == second)
+                    return _xAdvance(r, format1);
+                if (glyph < second)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return NONE;
+        }
 
-    /*
-    Res<Math::Vec2i> positione(usize prev, usize curr) const {
-        (void)lhs;
-        (void)rhs;
-        // 1. Locate the current script in the GPOS ScriptList table.
+        if (format == 2) {
+            auto classDef1 = ClassDef{subtable.begin().skip(s.nextU16be()).restBytes()};
+            auto classDef2 = ClassDef{subtable.begin().skip(s.nextU16be()).restBytes()};
+            usize class1Count = s.nextU16be();
+            usize class2Count = s.nextU16be();
 
-        // 2. If the language system is known, search the script for the correct LangSys table; otherwise, use the script’s default LangSys table.
+            usize class1 = classDef1.classOf(first);
+            usize class2 = classDef2.classOf(second);
+            if (class1 >= class1Count or class2 >= class2Count)
+                return NONE;
 
-        // FIXME: hard-coded to latin
-        auto scriptOff = try$(findScript("latn"));
-        (void)scriptOff;
+            return _xAdvance(s.skip((class1 * class2Count + class2) * recordSize), format1);
+        }
 
-        // 3. The LangSys table provides index numbers into the GPOS FeatureList table to access a required feature and a number of additional features.
+        return NONE;
+    }
 
-        // 4. Inspect the featureTag of each feature, and select the feature tables to apply to an input glyph string.
+    // Sum of the adjustments of the given pair positioning lookups to the
+    // advance of the first glyph, in font units.
+    isize pairAdjustment(Slice<usize> lookups, usize first, usize second) const {
+        isize adjustment = 0;
+        auto list = lookupList();
+
+        for (auto i : lookups) {
+            auto lookup = list.at(i);
+            auto type = lookup.lookupType();
+
+            for (usize j = 0; j < lookup.len(); j++) {
+                usize offset = lookup.begin().skip(6 + j * 2).nextU16be();
+                auto subtable = BChunk{lookup.begin().skip(offset).restBytes()};
+
+                // Extension subtables point to the actual subtable with a 32 bits offset.
+                auto subtableType = type;
+                if (type == (u16)GposLookupType::EXTENSION_POSITIONING) {
+                    auto s = subtable.begin().skip(2);
+                    subtableType = s.nextU16be();
+                    subtable = BChunk{subtable.begin().skip(s.nextU32be()).restBytes()};
+                }
 
-        // 5. If a Feature Variation table is present, evaluate conditions in the Feature Variation table to determine if any of the initially-selected feature tables should be substituted by an alternate feature table.
+                if (subtableType != (u16)GposLookupType::PAIR_ADJUSTMENT)
+                    continue;
 
-        // 6. Each feature provides an array of index numbers into the GPOS LookupList table. Assemble all lookups from the set of chosen feature tables, and apply the lookups in the order given in the LookupList table.
+                if (auto value = _pairAdjustment(subtable, first, second)) {
+                    adjustment += *value;
+                    break;
+                }
+            }
+        }
 
-        return Ok(Math::Vec2i{0, 0});
+        return adjustment;
     }
-*/
 };
 
 struct Gsub : public BChunk {
@@ -638,6 +849,7 @@ struct Font {
     Bytes _slice;
 
     Head _head;
+    Maxp _maxp;
     Cmap _cmap;
     Cmap::Table _cmapTable;
     Glyf _glyf;
@@ -646,6 +858,7 @@ struct Font {
     Hmtx _hmtx;
     Gpos _gpos;
     Gsub _gsub;
+    Vec<usize> _kernLookups;
 
     static Res<Cmap::Table> chooseCmap(Font &font) {
         Opt<Cmap::Table> bestCmap = NONE;
@@ -696,6 +909,7 @@ struct Font {
         }
 
         font._head = try$(font.requireTable<Head>());
+        font._maxp = try$(font.requireTable<Maxp>());
         font._cmap = try$(font.requireTable<Cmap>());
         font._cmapTable = try$(chooseCmap(font));
         font._glyf = try$(font.requireTable<Glyf>());
@@ -704,6 +918,7 @@ struct Font {
         font._hmtx = try$(font.requireTable<Hmtx>());
         font._gpos = font.lookupTable<Gpos>();
         font._gsub = font.lookupTable<Gsub>();
+        font._kernLookups = font._gpos.lookupsFor("kern");
 
         return Ok(font);
     }
@@ -775,9 +990,15 @@ struct Font {
         return Error::other("table not found");
     }
 
-    GlyphMetrics glyphMetrics(Rune rune) const {
-        auto glyphId = _cmapTable.glyphIdFor(rune);
+    usize numGlyphs() const {
+        return _maxp.numGlyphs();
+    }
+
+    usize glyphId(Rune rune) const {
+        return _cmapTable.glyphIdFor(rune);
+    }
 
+    GlyphMetrics glyphMetrics(usize glyphId) const {
         auto glyfOffset = _loca.glyfOffset(glyphId, _head);
         auto glyf = _glyf.metrics(glyfOffset);
         auto hmtx = _hmtx.metrics(glyphId, _hhea);
@@ -792,14 +1013,43 @@ struct Font {
         };
     }
 
-    void glyphContour(Gfx::Context &g, Rune rune) const {
-        auto glyphId = _cmapTable.glyphIdFor(rune);
+    GlyphMetrics glyphMetrics(Rune rune) const {
+        return glyphMetrics(glyphId(rune));
+    }
+
+    // Kerning between two glyphs, in font units.
+    isize glyphKerning(usize first, usize second) const {
+        if (_kernLookups.len() == 0)
+            return 0;
+        return _gpos.pairAdjustment(_kernLookups, first, second);
+    }
+
+    static constexpr isize MAX_COMPOSITE_DEPTH = 8;
+
+    void _glyphContour(Gfx::Path &path, usize glyphId, Math::Trans2f trans, isize depth) const {
         auto glyfOffset = _loca.glyfOffset(glyphId, _head);
 
         if (glyfOffset == _loca.glyfOffset(glyphId + 1, _head))
             return;
 
-        _glyf.contour(g, glyfOffset);
+        auto s = _glyf.begin();
+        auto m = _glyf.metrics(s, glyfOffset);
+
+        if (m.numContours > 0) {
+            path.transform(trans);
+            _glyf.contourSimple(path, m, s);
+        } else if (m.numContours < 0 and depth < MAX_COMPOSITE_DEPTH) {
+            _glyf.contourComposite(s, [&](usize component, Math::Trans2f t) {
+                _glyphContour(path, component, t.multiply(trans), depth + 1);
+            });
+        }
+    }
+
+    // Add the outline of the glyph, in font units, to the path.
+    void glyphContour(Gfx::Path &path, usize glyphId) const {
+        auto trans = path.transform();
+        _glyphContour(path, glyphId, trans, 0);
+        path.transform(trans);
     }
 
     Metrics metrics() const {